@@ -2,6 +2,7 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <cmath>
 
 #include <unistd.h>
 #include <getopt.h>
@@ -24,6 +25,7 @@
 #include "core/styles.hpp"
 #include "core/utilities.hpp"
 #include "core/plot_opt.hpp"
+#include "core/current_log.hpp"
 
 using namespace std;
 
@@ -38,23 +40,6 @@ void multVector(vector<float> &vals, float factor){
   for(unsigned ind=0; ind<vals.size(); ind++) vals[ind] *= factor;
 }
 
-float toHours(TString time, TString ampm){
-  time.ReplaceAll(".", " ");
-  istringstream iss(time.Data());
-  float hours, min, sec;
-  TString decsec;
-  iss >> hours >> min >> sec >> decsec;
-  //cout<<hours<<":"<<min<<":"<<sec<<":"<<decsec<<" from "<<time<<endl;
-
-  if(ampm=="AM") {
-    if(hours>11.5) hours = 0;
-  } else
-    if (hours<11.5) hours += 12;
-  
-  decsec = "0."+decsec;
-  return hours + min/60. + (sec+decsec.Atof())/(60*60);
-}
-
 // Returns list of directorites or files in folder
 vector<TString> dirlist(const TString &folder,
                         const TString &inname,
@@ -79,53 +64,26 @@ vector<TString> dirlist(const TString &folder,
   return v_dirs;
 }
 
-TString readFile(TString fname, vector<vector<float> > &vals, vector<vector<float> > &times, vector<int> &channels,
-                 TString &maratonID, TString &date){
-  ;
-  TString time_s, ampm, title;
-  
-  ifstream infile(fname);
-  string line_s;
-  int channel;
-  float current;
-  int nrows=0;
-  getline(infile, line_s);
-  while(getline(infile, line_s)){
-    ReplaceAll(line_s, ",", " ");
-    istringstream iss(line_s);
-    iss >> date >> time_s >> ampm >> maratonID >> channel >> current;
-    //cout << "  " << date << "  " << time_s << "  " << ampm << "  " << maratonID << "  " << channel << "  " << current<<endl;
-    bool found=false;
-    for(unsigned ind=0; ind<channels.size(); ind++){
-      if(channel == channels[ind]) {
-        vals[ind].push_back(current);
-        times[ind].push_back(toHours(time_s, ampm));
-        found = true;
-      }
-    }// Loop over channels
-    if(!found){
-      vals.push_back(vector<float>()); vals[vals.size()-1].push_back(current);
-      times.push_back(vector<float>()); times[times.size()-1].push_back(toHours(time_s, ampm));
-      channels.push_back(channel);
-    }
-    nrows++;
-  } // Loop over rows
-  infile.close();
+void plotCurrent(TString file){
 
-  title = "Currents for Maraton #" + maratonID + " on " + date;
-  return title;
-}
+  CurrentLog log;
+  log.Load(file.Data());
+  const vector<CurrentLog::Channel> &channels = log.Channels();
+  if(channels.size() == 0) return;
 
-void plotCurrent(TString file){
+  //// Times are plotted in hours since midnight of the first reading
+  double t_start = log.StartTime(), t_end = log.EndTime();
+  double day_start = 24.*floor(t_start/24.);
+  TString maratonID = to_string(channels.front().maraton_);
+  TString date = CurrentLog::FormatDate(t_start);
+  TString title = "Currents for Maraton #" + maratonID + " on " + date;
 
-  TString title, maratonID, date;
-  vector<int> channels;
-  vector<vector<float> > currents, times;
-  title = readFile(file, currents, times, channels, maratonID, date);
+  vector<vector<double> > currents(channels.size()), times(channels.size());
   float minY=1e11, maxY=-1e11;
-  for(size_t ichan=0; ichan<currents.size(); ichan++){
+  for(size_t ichan=0; ichan<channels.size(); ichan++){
+    channels[ichan].Downsample(t_start, t_end, 1000, times[ichan], currents[ichan]);
     for(unsigned ind=0; ind<currents[ichan].size(); ind++){
-      //cout<<"At "<<times[ichan][ind]<<" current was "<<currents[ichan][ind]<<endl;
+      times[ichan][ind] -= day_start;
       if(currents[ichan][ind] > maxY) maxY = currents[ichan][ind];
       if(currents[ichan][ind] < minY) minY = currents[ichan][ind];
     }
@@ -162,9 +120,9 @@ void plotCurrent(TString file){
   vector<TGraph*> graphs;
   for(size_t ichan=0; ichan<currents.size(); ichan++){
     graphs.push_back(new TGraph(currents[ichan].size(), &(times[ichan][0]), &(currents[ichan][0])));
-    graphs[ichan]->SetLineWidth(linw); graphs[ichan]->SetLineColor(colors[channels[ichan]]);
+    graphs[ichan]->SetLineWidth(linw); graphs[ichan]->SetLineColor(colors[channels[ichan].channel_]);
     graphs[ichan]->Draw("same");
-    TString chan_s = "Channel "; chan_s += channels[ichan];
+    TString chan_s = "Channel "; chan_s += channels[ichan].channel_;
     legModel.AddEntry(graphs[ichan], chan_s, "l");
   } // Loop over Maraton channels
 
@@ -16,6 +16,7 @@ public:
   std::vector<TString> planecuts, abcdcuts, allcuts;
   std::vector<bool> signalplanes;
   std::vector<std::vector<TString> > bincuts;
+  std::vector<std::vector<TString> > allfactors;
   TString caption, basecuts, title, rd_letter; 
 
   size_t indexBin(size_t iplane, size_t ibin, size_t iabcd);
@@ -25,6 +26,7 @@ public:
   void printCuts();
   TString lowerNjets(TString &cut);
   void serializeCuts();
+  std::vector<TString> splitFactors(const TString &cut);
   void setIntNbNj(bool int_nbnj_b);
 
 
@@ -0,0 +1,130 @@
+#ifndef H_CHECKPOINT
+#define H_CHECKPOINT
+
+#include <cstdint>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <set>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+#include "core/figure.hpp"
+#include "core/exact_sum.hpp"
+
+class TH1;
+
+class Checkpoint{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Checkpoint(const std::string &path,
+             double interval,
+             const std::vector<Figure::FigureComponent*> &components,
+             const std::string &configuration = "");
+  ~Checkpoint() = default;
+
+  bool Restore();
+  void Save();
+  void Remove();
+
+  bool Due() const;
+  bool Done(const std::string &unit) const;
+  void Complete(const std::string &unit);
+  std::size_t NumDone() const;
+
+  std::uint64_t Key() const;
+
+  static std::string UnitName(const Baby &baby);
+  static std::string UnitName(const Process &replayed);
+
+  template<typename T>
+  static void Write(std::ostream &out, const T &value);
+  template<typename T>
+  static void Write(std::ostream &out, const std::vector<T> &values);
+  static void Write(std::ostream &out, const std::string &value);
+  static void Write(std::ostream &out, const ExactSum &value);
+  static void WriteHist(std::ostream &out, const TH1 &hist);
+
+  template<typename T>
+  static void Read(std::istream &in, T &value);
+  template<typename T>
+  static void Read(std::istream &in, std::vector<T> &values);
+  static void Read(std::istream &in, std::string &value);
+  static void Read(std::istream &in, ExactSum &value);
+  static void ReadHist(std::istream &in, TH1 &hist);
+
+private:
+  Checkpoint() = delete;
+  Checkpoint(const Checkpoint &) = delete;
+  Checkpoint& operator=(const Checkpoint &) = delete;
+  Checkpoint(Checkpoint &&) = delete;
+  Checkpoint& operator=(Checkpoint &&) = delete;
+
+  std::string path_;//!<File holding the checkpoint
+  std::chrono::duration<double> interval_;//!<Minimum time between saves
+  std::vector<Figure::FigureComponent*> components_;//!<Components whose state is saved, in a fixed order
+  std::uint64_t key_;//!<Hash of the definitions of components_, rejecting stale checkpoints
+  std::set<std::string> done_;//!<Units whose events are included in the saved state
+  Clock::time_point last_save_;//!<Time of last save, or of construction
+  bool enabled_;//!<False once a component turned out not to support saving
+};
+
+/*!\brief Writes a trivially copyable value in native byte order
+
+  \param[in,out] out Stream to write to
+
+  \param[in] value Value to write
+*/
+template<typename T>
+void Checkpoint::Write(std::ostream &out, const T &value){
+  static_assert(std::is_trivially_copyable<T>::value, "Checkpoint can only write plain values");
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*!\brief Writes the size of a vector followed by its elements
+
+  \param[in,out] out Stream to write to
+
+  \param[in] values Elements to write
+*/
+template<typename T>
+void Checkpoint::Write(std::ostream &out, const std::vector<T> &values){
+  Write(out, static_cast<std::uint64_t>(values.size()));
+  for(const auto &value: values){
+    Write(out, value);
+  }
+}
+
+/*!\brief Reads a value written by Write()
+
+  \param[in,out] in Stream to read from
+
+  \param[out] value Value read
+*/
+template<typename T>
+void Checkpoint::Read(std::istream &in, T &value){
+  static_assert(std::is_trivially_copyable<T>::value, "Checkpoint can only read plain values");
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+/*!\brief Reads a vector written by Write()
+
+  \param[in,out] in Stream to read from
+
+  \param[out] values Elements read
+*/
+template<typename T>
+void Checkpoint::Read(std::istream &in, std::vector<T> &values){
+  std::uint64_t size = 0;
+  Read(in, size);
+  if(!in) return;
+  values.resize(size);
+  for(auto &value: values){
+    Read(in, value);
+  }
+}
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef H_CLUSTERIZER
 #define H_CLUSTERIZER
 
+#include <cstdint>
+
 #include <list>
 #include <set>
 #include <vector>
+#include <istream>
 #include <ostream>
 #include <random>
 
@@ -35,12 +38,64 @@ namespace Clustering{
     std::vector<std::list<Node>::iterator> neighbor_of_;
   };
 
+  class Reservoir{
+  public:
+    explicit Reservoir(long capacity = -1,
+                       std::uint64_t seed = 0);
+
+    void Add(const Point &p,
+             std::uint64_t event_tag = 0,
+             std::uint64_t index = 0);
+    void Merge(const Reservoir &other);
+    void Clear(std::uint64_t seed = 0);
+
+    std::vector<Point> Sample() const;
+
+    long Capacity() const;
+    void Capacity(long capacity);
+
+    void Reproducible(bool reproducible);
+
+    std::size_t MemoryUsage() const;
+    static std::size_t BytesPerPoint();
+
+    void SaveState(std::ostream &out) const;
+    void LoadState(std::istream &in);
+
+  private:
+    struct Entry{
+      double key_;//!<Log of the A-Res key u^(1/w)
+      Point point_;//!<Sampled point with its original weight
+    };
+
+    std::vector<Entry> heap_;//!<Kept points, as a min-heap on key_
+    long capacity_;//!<Maximum number of kept points. Negative for no limit.
+    long num_seen_;//!<Number of positive-weight points offered, including merged reservoirs
+    double total_weight_;//!<Sum of positive weights offered
+    double skip_;//!<Weight still to be skipped before the next replacement (A-ExpJ)
+    bool reproducible_;//!<If true, keys are hashed from the points and their events instead of drawn
+    std::mt19937_64 prng_;//!<Source of keys and jumps
+
+    static bool KeyGreater(const Entry &a, const Entry &b);
+
+    double Uniform();
+    double HashUniform(const Point &p, std::uint64_t event_tag, std::uint64_t index) const;
+    void Push(double key, const Point &p);
+    void Replace(double key, const Point &p);
+    void DrawSkip();
+    bool Full() const;
+  };
+
   class Clusterizer{
   public:
     explicit Clusterizer(const TH2D &hist_template,
                          long max_points = -1);
 
-    void AddPoint(float x, float y, float w);
+    void AddPoint(float x, float y, float w,
+                  std::uint64_t event_tag = 0,
+                  std::uint64_t index = 0);
+    void Merge(const Clusterizer &other);
+    void Clear(std::uint64_t seed = 0);
     
     void SetPoints(const std::vector<Point> &points);
     void SetPoints(const TH2D &h);
@@ -48,11 +103,21 @@ namespace Clustering{
     TH2D GetHistogram(double luminosity) const;
     TGraph GetGraph(double luminosity, bool keep_in_frame = true) const;
 
+    long MaxPoints() const;
+    void MaxPoints(long max_points);
+
+    void Reproducible(bool reproducible);
+
+    std::size_t MemoryUsage() const;
+
+    void SaveState(std::ostream &out) const;
+    void LoadState(std::istream &in);
+
   private:
     long max_points_;
     bool hist_mode_;
     TH2D hist_;
-    std::vector<Point> orig_points_;
+    Reservoir reservoir_;
     mutable std::list<Node> nodes_;
     mutable std::vector<Point> final_points_;
     mutable float clustered_lumi_;
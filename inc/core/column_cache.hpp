@@ -0,0 +1,134 @@
+#ifndef H_COLUMN_CACHE
+#define H_COLUMN_CACHE
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <unordered_map>
+
+class ColumnCache{
+public:
+  enum class Type : std::uint32_t{
+    kBool = 0,
+    kInt = 1,
+    kLong = 2,
+    kFloat = 3,
+    kDouble = 4
+  };
+
+  class Column{
+  public:
+    Type type_;//!<Type of stored values
+    bool is_vector_;//!<True if each entry holds a variable-length array
+    const std::uint64_t *offsets_;//!<Start of each entry's values for vector columns (num_entries+1 elements)
+    const char *values_;//!<Values of all entries
+
+    template<typename T>
+    const T & Scalar(long entry) const{
+      return reinterpret_cast<const T*>(values_)[entry];
+    }
+
+    template<typename T>
+    void Read(long entry, std::vector<T>* const &out) const{
+      const T *values = reinterpret_cast<const T*>(values_);
+      out->assign(values+offsets_[entry], values+offsets_[entry+1]);
+    }
+  };
+
+  class File{
+  public:
+    explicit File(const std::string &path);
+    ~File();
+
+    bool Valid() const;
+    bool Matches(const std::string &source_path) const;
+    long NumEntries() const;
+    const Column * Find(const std::string &name) const;
+
+  private:
+    File(const File &) = delete;
+    File & operator=(const File &) = delete;
+    File(File &&) = delete;
+    File & operator=(File &&) = delete;
+
+    void *map_;//!<Start of memory-mapped file
+    std::size_t size_;//!<Size of mapped region
+    long num_entries_;//!<Number of entries in each column
+    std::uint64_t source_size_;//!<Size of ROOT file from which cache was made
+    std::int64_t source_mtime_;//!<Modification time of ROOT file from which cache was made
+    std::unordered_map<std::string, Column> columns_;//!<Columns by branch name
+  };
+
+  static std::unique_ptr<ColumnCache> Open(const std::set<std::string> &file_names);
+  static std::string Convert(const std::string &source_path,
+                             const std::vector<std::string> &branches = {});
+
+  ~ColumnCache() = default;
+
+  inline bool Load(long entry){
+    if(entry >= first_entry_ && entry < last_entry_){
+      entry_ = entry-first_entry_;
+      return false;
+    }
+    return Seek(entry);
+  }
+  inline long Entry() const{
+    return entry_;
+  }
+  inline long NumEntries() const{
+    return file_starts_.empty() ? 0 : file_starts_.back();
+  }
+
+  template<typename T>
+  const Column * Find(const std::string &name, const T &) const{
+    Type type;
+    if(!GetType(static_cast<const T*>(nullptr), type)) return nullptr;
+    return Find(name, type, false);
+  }
+  template<typename T>
+  const Column * Find(const std::string &name, std::vector<T>* &out) const{
+    Type type;
+    if(!GetType(static_cast<const T*>(nullptr), type)) return nullptr;
+    const Column *column = Find(name, type, true);
+    if(column != nullptr && out == nullptr) out = new std::vector<T>();
+    return column;
+  }
+
+  static const std::string & Directory();
+  static void Directory(const std::string &dir);
+  static std::string CachePath(const std::string &source_path);
+
+  static bool GetType(const bool *, Type &type){type = Type::kBool; return true;}
+  static bool GetType(const int *, Type &type){type = Type::kInt; return true;}
+  static bool GetType(const long long *, Type &type){type = Type::kLong; return true;}
+  static bool GetType(const float *, Type &type){type = Type::kFloat; return true;}
+  static bool GetType(const double *, Type &type){type = Type::kDouble; return true;}
+  template<typename T>
+  static bool GetType(const T *, Type &){return false;}
+
+  static std::size_t TypeSize(Type type);
+
+private:
+  ColumnCache();
+  ColumnCache(const ColumnCache &) = delete;
+  ColumnCache & operator=(const ColumnCache &) = delete;
+  ColumnCache(ColumnCache &&) = delete;
+  ColumnCache & operator=(ColumnCache &&) = delete;
+
+  std::vector<std::unique_ptr<File> > files_;//!<Mapped cache of each file in chain order
+  std::vector<long> file_starts_;//!<Chain entry number of first entry in each file
+  std::size_t file_;//!<Index of current file
+  long first_entry_;//!<First chain entry in current file
+  long last_entry_;//!<One past last chain entry in current file
+  long entry_;//!<Entry number within current file
+
+  bool Seek(long entry);
+  const Column * Find(const std::string &name, Type type, bool is_vector) const;
+
+  static std::string directory_;//!<Directory containing cache files. Empty to disable caching.
+};
+
+#endif
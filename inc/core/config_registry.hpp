@@ -0,0 +1,65 @@
+#ifndef H_CONFIG_REGISTRY
+#define H_CONFIG_REGISTRY
+
+#include <ctime>
+
+#include <string>
+#include <map>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <istream>
+
+class ConfigRegistry{
+public:
+  template<typename T>
+  static std::shared_ptr<const T> Get(const std::string &path,
+                                      const std::string &format,
+                                      const std::function<T(std::istream &)> &parse);
+
+  static void Invalidate(const std::string &path);
+  static void Clear();
+
+private:
+  using Parser = std::shared_ptr<const void>(std::istream &);
+
+  struct Entry{
+    std::time_t mtime_;//!<Modification time of file when parsed, in seconds
+    long mtime_nsec_;//!<Nanoseconds part of modification time
+    long long size_;//!<Size of file when parsed, or -1 if it did not exist
+    std::shared_ptr<const void> parsed_;//!<Parsed contents
+  };
+
+  ConfigRegistry() = delete;
+
+  static std::shared_ptr<const void> Lookup(const std::string &path,
+                                            const std::string &format,
+                                            const std::function<Parser> &parse);
+
+  static std::mutex & Mutex();
+  static std::map<std::pair<std::string, std::string>, Entry> & Entries();
+};
+
+/*!\brief Get parsed contents of a file, parsing it only if not already done
+  since its last modification
+
+  \param[in] path Path to file
+
+  \param[in] format Name distinguishing parsers of the same file
+
+  \param[in] parse Parser turning the file contents into a T. Gets an empty
+  stream if the file does not exist.
+
+  \return Shared, immutable parsed contents
+*/
+template<typename T>
+std::shared_ptr<const T> ConfigRegistry::Get(const std::string &path,
+                                             const std::string &format,
+                                             const std::function<T(std::istream &)> &parse){
+  return std::static_pointer_cast<const T>(Lookup(path, format, [&parse](std::istream &stream){
+        return std::shared_ptr<const void>(std::make_shared<const T>(parse(stream)));
+      }));
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef H_CURRENT_LOG
+#define H_CURRENT_LOG
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+class CurrentLog{
+public:
+  class Channel{
+  public:
+    Channel() = default;
+    Channel(int maraton, int channel);
+
+    int maraton_;//!<Maraton (power supply) ID
+    int channel_;//!<Channel number within the Maraton
+    std::vector<double> times_;//!<Time of each reading in hours since the Unix epoch, sorted
+    std::vector<double> values_;//!<Current of each reading
+
+    std::size_t Size() const;
+    std::pair<std::size_t, std::size_t> Window(double t_min, double t_max) const;
+    void Downsample(double t_min, double t_max, std::size_t num_bins,
+                    std::vector<double> &times, std::vector<double> &values) const;
+  };
+
+  explicit CurrentLog(std::size_t num_threads = 0);
+  CurrentLog(const CurrentLog &) = default;
+  CurrentLog & operator=(const CurrentLog &) = default;
+  CurrentLog(CurrentLog &&) = default;
+  CurrentLog & operator=(CurrentLog &&) = default;
+  ~CurrentLog() = default;
+
+  CurrentLog & Load(const std::string &path);
+  CurrentLog & Load(const std::vector<std::string> &paths);
+
+  const std::vector<Channel> & Channels() const;
+  const Channel * Find(int maraton, int channel) const;
+  const Channel & Get(int maraton, int channel) const;
+
+  double StartTime() const;
+  double EndTime() const;
+
+  const std::string & CacheDir() const;
+  CurrentLog & CacheDir(const std::string &cache_dir);
+
+  std::size_t NumThreads() const;
+  CurrentLog & NumThreads(std::size_t num_threads);
+
+  static std::string FormatDate(double time);
+
+private:
+  struct Row{
+    int maraton_;
+    int channel_;
+    double time_;
+    double value_;
+  };
+
+  std::vector<Channel> channels_;//!<Time series of each channel, in order of first appearance
+  std::unordered_map<std::uint64_t, std::size_t> index_;//!<Map from (maraton, channel) key to position in channels_
+  std::string cache_dir_;//!<Directory for binary caches of parsed files. Empty disables caching.
+  std::size_t num_threads_;//!<Number of threads used for parsing
+
+  void Merge(const std::vector<Channel> &channels);
+  std::string CachePath(const std::string &path) const;
+  bool ReadCache(const std::string &path, std::vector<Channel> &channels) const;
+  void WriteCache(const std::string &path, const std::vector<Channel> &channels) const;
+
+  static std::uint64_t MakeKey(int maraton, int channel);
+  static std::vector<Row> ParseChunk(const std::string &text,
+                                     std::size_t begin,
+                                     std::size_t end);
+  static std::vector<Channel> BuildChannels(const std::vector<std::vector<Row> > &chunks);
+  static void SortChannel(Channel &channel);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef H_ERROR_PROPAGATOR
+#define H_ERROR_PROPAGATOR
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <utility>
+
+#include "RooWorkspace.h"
+#include "RooFitResult.h"
+#include "RooRealVar.h"
+
+class ErrorPropagator{
+public:
+  using ShiftFunc = std::pair<double, double>(const RooRealVar &fit_par);
+
+  ErrorPropagator(RooWorkspace &w,
+                  const RooFitResult &f,
+                  std::size_t num_threads = 0);
+  ErrorPropagator(const ErrorPropagator &) = default;
+  ErrorPropagator & operator=(const ErrorPropagator &) = default;
+  ErrorPropagator(ErrorPropagator &&) = default;
+  ErrorPropagator & operator=(ErrorPropagator &&) = default;
+  ~ErrorPropagator() = default;
+
+  ErrorPropagator & Compute(const std::vector<std::string> &yield_names,
+                            const std::function<ShiftFunc> &shift,
+                            double scale = 1.);
+
+  const std::vector<std::string> & YieldNames() const;
+  const std::vector<std::string> & ParameterNames() const;
+  const std::vector<std::vector<double> > & Jacobian() const;
+  const std::vector<std::vector<double> > & Correlation() const;
+
+  std::vector<std::vector<double> > Covariance() const;
+  std::vector<double> Errors() const;
+
+  std::size_t NumThreads() const;
+  ErrorPropagator & NumThreads(std::size_t num_threads);
+
+  static std::function<ShiftFunc> ErrorShift(int errtype = 0);
+  static std::function<ShiftFunc> CovarianceShift(double lambda = 0.01);
+
+private:
+  ErrorPropagator() = delete;
+
+  RooWorkspace *w_;//!<Workspace with variables set to fitted values
+  const RooFitResult *f_;//!<Fit result providing parameters and correlations
+  std::size_t num_threads_;//!<Number of threads (and workspace clones) used for the sweep
+  std::vector<std::string> yield_names_;//!<Functions whose errors are propagated
+  std::vector<std::string> par_names_;//!<Floating fit parameters in order of the fit result
+  std::vector<std::vector<double> > jacobian_;//!<Shift of each yield [parameter][yield]
+  std::vector<std::vector<double> > correlation_;//!<Parameter correlation matrix
+
+  void FillCorrelation();
+  void ComputeRange(RooWorkspace &w,
+                    std::size_t first_par,
+                    std::size_t last_par,
+                    const std::function<ShiftFunc> &shift,
+                    double scale);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef H_EVENT_CACHE
+#define H_EVENT_CACHE
+
+#include <cstdint>
+#include <cstdio>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <functional>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/named_func.hpp"
+
+class EventCache final : public Figure{
+public:
+  class SingleCache final : public Figure::FigureComponent{
+  public:
+    SingleCache(const EventCache &event_cache,
+                const std::shared_ptr<Process> &process);
+    ~SingleCache();
+
+    void RecordEvent(const Baby &baby) final;
+    std::size_t MemoryUsage() const final;
+    void MemoryLimit(std::size_t bytes, std::size_t num_threads) final;
+    bool MemoryLimited() const final;
+
+    long NumRows() const;
+    long Replay(const std::function<void(const Baby &)> &callback) const;
+
+  private:
+    SingleCache() = delete;
+    SingleCache(const SingleCache &) = delete;
+    SingleCache& operator=(const SingleCache &) = delete;
+    SingleCache(SingleCache &&) = delete;
+    SingleCache& operator=(SingleCache &&) = delete;
+
+    void Spill();
+
+    NamedFunc full_cut_;//!<Cached cache&&process cut
+    std::vector<double> values_;//!<Columns of selected events not yet spilled, one row after another
+    long num_rows_;//!<Number of selected events
+    long num_spilled_;//!<Number of rows written to scratch_
+    std::size_t memory_limit_;//!<Bytes of values_ above which rows are spilled. 0 for no limit.
+    std::FILE *scratch_;//!<Temporary file holding spilled rows, or nullptr
+    const Baby *baby_;//!<Baby from which rows were recorded, handed to figures during replay
+  };
+
+  EventCache(const std::string &name,
+             const NamedFunc &cut,
+             const std::vector<NamedFunc> &columns,
+             const std::vector<std::shared_ptr<Process> > &processes);
+  ~EventCache();
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::set<const Process*> GetProcesses() const final;
+
+  FigureComponent * GetComponent(const Process *process) final;
+
+  NamedFunc Column(std::size_t icolumn) const;
+  NamedFunc Column(const std::string &name) const;
+
+  std::shared_ptr<Process> Replayed(const std::shared_ptr<Process> &process);
+
+  static const SingleCache * Source(const Process *process);
+  static std::uint64_t RowHash();
+
+  std::string name_;//!<Name of cache, used in printout and column names
+  NamedFunc cut_;//!<Cut selecting cached events
+  std::vector<NamedFunc> columns_;//!<Scalar quantities stored for each selected event
+
+private:
+  std::vector<std::unique_ptr<SingleCache> > caches_;//!<One cache for each process
+  std::vector<std::shared_ptr<Process> > replayed_;//!<Processes created by Replayed()
+
+  static std::mutex sources_mutex_;//!<Protects sources_
+  static std::map<const Process*, const SingleCache*> sources_;//!<Cache replayed by each process from Replayed()
+  static thread_local const EventCache *current_cache_;//!<Cache being replayed in this thread, or nullptr
+  static thread_local const double *current_row_;//!<Row being replayed in this thread
+
+  EventCache(const EventCache &) = delete;
+  EventCache& operator=(const EventCache &) = delete;
+  EventCache(EventCache &&) = delete;
+  EventCache& operator=(EventCache &&) = delete;
+  EventCache() = delete;
+};
+
+#endif
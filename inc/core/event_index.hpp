@@ -0,0 +1,59 @@
+#ifndef H_EVENT_INDEX
+#define H_EVENT_INDEX
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include "core/named_func.hpp"
+
+class EventIndex{
+public:
+  struct Key{
+    std::int32_t run_;//!<Run number
+    std::int32_t lumiblock_;//!<Luminosity block
+    std::int64_t event_;//!<Event number
+
+    bool operator<(const Key &other) const;
+    bool operator==(const Key &other) const;
+  };
+
+  EventIndex();
+  explicit EventIndex(const std::string &path);
+  EventIndex(const EventIndex &) = default;
+  EventIndex & operator=(const EventIndex &) = default;
+  EventIndex(EventIndex &&) = default;
+  EventIndex & operator=(EventIndex &&) = default;
+  ~EventIndex() = default;
+
+  EventIndex & Insert(const Key &key);
+  EventIndex & Insert(const EventIndex &other);
+  EventIndex & Sort();
+
+  bool Contains(const Key &key) const;
+  bool Contains(std::int32_t run, std::int32_t lumiblock, std::int64_t event) const;
+
+  std::size_t Size() const;
+  const std::vector<Key> & Keys() const;
+  std::size_t MemoryUsage() const;
+
+  EventIndex Intersection(const EventIndex &other) const;
+  EventIndex Union(const EventIndex &other) const;
+  EventIndex Difference(const EventIndex &other) const;
+
+  void Write(const std::string &path, bool text = false) const;
+
+  NamedFunc Cut(const std::string &name = "") const;
+  static NamedFunc Cut(const std::string &path, const std::string &name);
+
+private:
+  std::vector<Key> keys_;//!<Event keys, sorted and unique if sorted_
+  bool sorted_;//!<Flag if keys_ is sorted and free of duplicates
+
+  void ReadBinary(std::ifstream &file, const std::string &path);
+  void ReadText(std::ifstream &file);
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef H_EVENT_LIST
+#define H_EVENT_LIST
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/event_index.hpp"
+
+class EventList final : public Figure{
+ public:
+  class SingleList final : public Figure::FigureComponent{
+ public:
+   SingleList(const EventList &event_list,
+              const std::shared_ptr<Process> &process);
+   ~SingleList() = default;
+
+   void RecordEvent(const Baby &baby) final;
+   std::size_t MemoryUsage() const final;
+
+   EventIndex index_;//!<Selected events
+
+ private:
+   SingleList() = delete;
+   SingleList(const SingleList &) = delete;
+   SingleList& operator=(const SingleList &) = delete;
+   SingleList(SingleList &&) = delete;
+   SingleList& operator=(SingleList &&) = delete;
+
+   NamedFunc full_cut_;//!<Cached list&&process cut
+ };
+
+ EventList(const std::string &name,
+           const NamedFunc &cut,
+           const std::vector<std::shared_ptr<Process> > &processes);
+ EventList(EventList &&) = default;
+ EventList& operator=(EventList &&) = default;
+ ~EventList() = default;
+
+ void Print(double luminosity,
+            const std::string &subdir) final;
+
+ std::set<const Process*> GetProcesses() const final;
+
+ FigureComponent * GetComponent(const Process *process) final;
+
+ EventIndex Merged() const;
+ std::string FileName(const Process *process) const;
+
+ bool Text() const;
+ EventList & Text(bool text);
+
+ std::string name_;//!<Name of list for saving to file
+ NamedFunc cut_;//!<Cut selecting listed events
+
+ private:
+ std::vector<std::unique_ptr<SingleList> > lists_;//!<One list for each process
+ bool text_;//!<Write "run lumiblock event" text lists instead of binary indices
+
+ EventList(const EventList &) = delete;
+ EventList& operator=(const EventList &) = delete;
+ EventList() = delete;
+};
+
+#endif
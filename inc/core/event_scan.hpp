@@ -1,10 +1,14 @@
 #ifndef H_EVENT_SCAN
 #define H_EVENT_SCAN
 
+#include <cstdint>
+
 #include <memory>
 #include <vector>
 #include <string>
 #include <fstream>
+#include <atomic>
+#include <mutex>
 
 #include "core/figure.hpp"
 #include "core/process.hpp"
@@ -18,21 +22,45 @@ class EventScan final : public Figure{
    ~SingleScan() = default;
 
    void RecordEvent(const Baby &baby) final;
+   std::size_t MemoryUsage() const final;
+   bool Concurrent() const final;
+   bool Done() const final;
 
    void Precision(unsigned precision);
+   void WriteBinary(const std::string &path);
 
  private:
+   struct Buffer{
+     Buffer(std::size_t num_columns);
+
+     std::vector<std::uint64_t> rows_;//!<Row of each recorded instance
+     std::vector<std::uint32_t> instances_;//!<Instance within row of each recorded instance
+     std::vector<std::vector<NamedFunc::ScalarType> > values_;//!<Values of each column for each recorded instance
+     NamedFunc::VectorType cut_vector_;//!<Cut results (to avoid creating new vector each event)
+     std::vector<NamedFunc::VectorType> val_vectors_;//!<Values for each column (to avoid creating new vectors each event)
+   };
+
    SingleScan() = delete;
    SingleScan(const SingleScan &) = delete;
    SingleScan& operator=(const SingleScan &) = delete;
    SingleScan(SingleScan &&) = delete;
    SingleScan& operator=(SingleScan &&) = delete;
 
-   std::ofstream out_;//!<File to which results are printed
+   std::size_t Evaluate(const Baby &baby,
+                        NamedFunc::VectorType &cut_vector,
+                        std::vector<NamedFunc::VectorType> &val_vectors) const;
+   void RecordText(const Baby &baby);
+   void RecordBinary(const Baby &baby);
+   Buffer & ThreadBuffer();
+
+   std::ofstream out_;//!<File to which results are printed in text mode
    NamedFunc full_cut_;//!<Cached scan&&process cut
    NamedFunc::VectorType cut_vector_;//!<Cut results (to avoid creating new vector each event)
    std::vector<NamedFunc::VectorType> val_vectors_;//!<Values for each column (to avoid creating new vectors each event)
-   std::size_t row_;
+   std::atomic<std::size_t> row_;//!<Number of rows (events with at least one instance) taken so far
+   std::size_t id_;//!<Unique identifier used to find each thread's buffer
+   mutable std::mutex buffers_mutex_;//!<Protects buffers_
+   std::vector<std::unique_ptr<Buffer> > buffers_;//!<Per-thread append buffers in binary mode
  };
 
  EventScan(const std::string &name,
@@ -54,6 +82,18 @@ class EventScan final : public Figure{
  unsigned Precision() const;
  EventScan & Precision(unsigned precision);
 
+ bool Binary() const;
+ EventScan & Binary(bool binary);
+
+ std::size_t MaxRows() const;
+ EventScan & MaxRows(std::size_t max_rows);
+
+ std::string FileName(const Process *process) const;
+
+ static void Render(const std::string &binary_path,
+                    const std::string &text_path,
+                    unsigned precision = 10);
+
  std::string name_;//!<Name of scan for saving to file
  NamedFunc cut_;//!<Cut restricting printed events/objects
  std::vector<NamedFunc> columns_;//!<Variables to print
@@ -62,6 +102,8 @@ class EventScan final : public Figure{
  std::vector<std::unique_ptr<SingleScan> > scans_;//!<One scan for each process
  unsigned precision_;//!<Decimal places to print
  unsigned width_;//!<Width of column in characters. Determined from precision
+ bool binary_;//!<Write binary columnar output instead of text
+ std::size_t max_rows_;//!<Maximum number of rows to record per process. 0 for no limit.
  
  EventScan(const EventScan &) = delete;
  EventScan& operator=(const EventScan &) = delete;
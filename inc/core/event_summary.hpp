@@ -0,0 +1,172 @@
+#ifndef H_EVENT_SUMMARY
+#define H_EVENT_SUMMARY
+
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+
+#include "core/figure.hpp"
+#include "core/process.hpp"
+#include "core/named_func.hpp"
+#include "core/exact_sum.hpp"
+
+class EventSummary final : public Figure{
+public:
+  class Key{
+  public:
+    Key(const NamedFunc &var,
+        const std::vector<double> &edges,
+        bool integer = false);
+    Key(const Key &) = default;
+    Key& operator=(const Key &) = default;
+    Key(Key &&) = default;
+    Key& operator=(Key &&) = default;
+    ~Key() = default;
+
+    static Key Integer(const NamedFunc &var, int min, int max);
+
+    Key & IncludeInLowerBin(const std::vector<double> &edges);
+
+    std::size_t NumBins() const;
+    std::size_t Bin(NamedFunc::ScalarType value) const;
+    double Low(std::size_t ibin) const;
+    double High(std::size_t ibin) const;
+    bool LowIncluded(std::size_t ibin) const;
+    bool HighIncluded(std::size_t ibin) const;
+    bool IsNaNBin(std::size_t ibin) const;
+
+    std::string Definition() const;
+
+    NamedFunc var_;//!<Scalar quantity being discretized
+    std::vector<double> edges_;//!<Increasing bin edges, with underflow and overflow bins outside
+    bool integer_;//!<True if var_ only takes integer values, so that "<" and "<=" cuts are told apart
+    std::vector<bool> in_lower_bin_;//!<For each edge, true if values on it belong to the bin below rather than above
+
+  private:
+    Key() = delete;
+  };
+
+  class Selection{
+  public:
+    Selection() = default;
+    Selection(const Selection &) = default;
+    Selection& operator=(const Selection &) = default;
+    Selection(Selection &&) = default;
+    Selection& operator=(Selection &&) = default;
+    ~Selection() = default;
+
+    bool Pass(std::uint64_t record) const;
+
+    struct Node{
+      enum class Type{constant, atom, logical_not, logical_and, logical_or};
+
+      Type type_;//!<Operation performed by node
+      bool value_;//!<Result of a constant node
+      std::uint64_t stride_;//!<Stride of the key of an atom in the record key
+      std::uint64_t num_bins_;//!<Number of bins of the key of an atom
+      std::vector<bool> truth_;//!<Result of an atom in each bin of its key
+      std::size_t left_, right_;//!<Operands of logical nodes
+    };
+
+  private:
+    friend class EventSummary;
+
+    bool Evaluate(std::size_t inode, std::uint64_t record) const;
+
+    std::vector<Node> nodes_;//!<Nodes of the expression, with the root last
+  };
+
+  class SingleSummary final : public Figure::FigureComponent{
+  public:
+    SingleSummary(const EventSummary &event_summary,
+                  const std::shared_ptr<Process> &process);
+    ~SingleSummary() = default;
+
+    void RecordEvent(const Baby &baby) final;
+    std::size_t MemoryUsage() const final;
+    bool Done() const final;
+
+    void Reproducible(bool reproducible) final;
+    void Finalize() final;
+
+    std::string Definition() const final;
+    bool SaveState(std::ostream &out) const final;
+    void LoadState(std::istream &in) final;
+
+    bool Loaded() const;
+    std::size_t NumRecords() const;
+    void Sum(const Selection &selection, std::size_t iweight,
+             double &sumw, double &sumw2) const;
+
+  private:
+    friend class EventSummary;
+
+    SingleSummary() = delete;
+    SingleSummary(const SingleSummary &) = delete;
+    SingleSummary& operator=(const SingleSummary &) = delete;
+    SingleSummary(SingleSummary &&) = delete;
+    SingleSummary& operator=(SingleSummary &&) = delete;
+
+    std::size_t Record(std::uint64_t key);
+    void Index();
+
+    std::string identity_;//!<Process name, cut and files, identifying the summary in its file
+    std::vector<std::uint64_t> keys_;//!<Bin key of each record
+    std::vector<double> sums_;//!<Sum of each weight followed by sum of its square, for each record
+    std::vector<ExactSum> exact_sums_;//!<Order-independent sums used in reproducible mode
+    std::unordered_map<std::uint64_t, std::size_t> index_;//!<Record of each bin key
+    bool reproducible_;//!<If true, accumulate into exact_sums_
+    bool loaded_;//!<True if the records were read from the summary file rather than events
+  };
+
+  EventSummary(const std::string &file_name,
+               const std::vector<Key> &keys,
+               const std::vector<NamedFunc> &weights,
+               const std::vector<std::shared_ptr<Process> > &processes);
+  ~EventSummary() = default;
+
+  void Print(double luminosity,
+             const std::string &subdir) final;
+
+  std::set<const Process*> GetProcesses() const final;
+
+  FigureComponent * GetComponent(const Process *process) final;
+
+  const SingleSummary * Loaded(const Process *process) const;
+  long WeightIndex(const NamedFunc &weight) const;
+  bool Compile(const NamedFunc &cut, Selection &selection) const;
+
+  std::string Definition() const;
+
+  std::string file_name_;//!<File from which summaries are read and to which they are written
+  std::vector<Key> keys_;//!<Discretized quantities forming the bin key of each record
+  std::vector<NamedFunc> weights_;//!<Nominal weight and its variations summed in each record
+
+private:
+  struct Section{
+    std::string identity_;//!<Identity of the summarized process
+    std::vector<std::uint64_t> keys_;//!<Bin key of each record
+    std::vector<double> sums_;//!<Sums of weights and squared weights of each record
+  };
+
+  std::vector<std::unique_ptr<SingleSummary> > summaries_;//!<One summary for each process
+  std::vector<Section> other_sections_;//!<Summaries in the file for processes not in this figure, kept when rewriting it
+  std::vector<std::uint64_t> strides_;//!<Factor multiplying the bin of each key in the record key
+
+  void Load();
+  void Save() const;
+
+  EventSummary(const EventSummary &) = delete;
+  EventSummary& operator=(const EventSummary &) = delete;
+  EventSummary(EventSummary &&) = delete;
+  EventSummary& operator=(EventSummary &&) = delete;
+  EventSummary() = delete;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef H_EXACT_SUM
+#define H_EXACT_SUM
+
+#include <cstdint>
+
+#include <vector>
+#include <istream>
+#include <ostream>
+
+class ExactSum{
+public:
+  ExactSum();
+  ExactSum(const ExactSum &) = default;
+  ExactSum & operator=(const ExactSum &) = default;
+  ExactSum(ExactSum &&) = default;
+  ExactSum & operator=(ExactSum &&) = default;
+  ~ExactSum() = default;
+
+  ExactSum & operator+=(double x);
+  ExactSum & operator+=(const ExactSum &other);
+
+  double Value() const;
+  void Clear();
+
+  std::size_t MemoryUsage() const;
+
+  void SaveState(std::ostream &out) const;
+  void LoadState(std::istream &in);
+
+private:
+  static const int limb_bits_ = 32;//!<Number of bits of the sum held by each limb
+  static const int min_exponent_ = -1127;//!<Power of 2 of the least significant bit of limb 0
+  static const std::uint32_t max_pending_ = 1u << 29;//!<Additions allowed before carries must be propagated
+
+  void Reserve(std::size_t first, std::size_t last);
+  void Compact();
+
+  static std::int64_t Propagate(std::vector<std::int64_t> &limbs);
+
+  std::vector<std::int64_t> limbs_;//!<Limb i holds multiples of 2^(32*(first_+i)+min_exponent_)
+  std::size_t first_;//!<Index of the lowest limb stored
+  double special_;//!<Sum of the infinite and NaN addends
+  std::uint32_t pending_;//!<Additions since carries were last propagated
+};
+
+#endif
@@ -4,11 +4,16 @@
 #include <memory>
 #include <vector>
 #include <mutex>
+#include <string>
+#include <istream>
+#include <ostream>
 
 #include "core/process.hpp"
 #include "core/baby.hpp"
 #include "core/named_func.hpp"
 
+class OutputStage;
+
 class Figure{
 public:
   class FigureComponent{
@@ -19,6 +24,23 @@ public:
 
     virtual void RecordEvent(const Baby &baby) = 0;
 
+    virtual std::size_t MemoryUsage() const;
+    virtual void MemoryLimit(std::size_t bytes, std::size_t num_threads);
+    virtual bool MemoryLimited() const;
+
+    virtual bool Concurrent() const;
+    virtual bool Done() const;
+
+    virtual void Reproducible(bool reproducible);
+    virtual void Finalize();
+
+    virtual void Specialize(const Baby &baby);
+    virtual void Unspecialize(const Baby &baby);
+
+    virtual std::string Definition() const;
+    virtual bool SaveState(std::ostream &out) const;
+    virtual void LoadState(std::istream &in);
+
     const Figure& figure_;//!<Reference to figure containing this component
     std::shared_ptr<Process> process_;//!<Process associated to this part of the figure
     std::mutex mutex_;
@@ -31,7 +53,7 @@ public:
     FigureComponent& operator=(FigureComponent &&) = delete;
   };
 
-  Figure() = default;
+  Figure();
   Figure(const Figure &) = default;
   Figure& operator=(const Figure &) = default;
   Figure(Figure &&) = default;
@@ -44,6 +66,11 @@ public:
   virtual std::set<const Process*> GetProcesses() const = 0;
 
   virtual FigureComponent * GetComponent(const Process *process) = 0;
+
+  void UseOutputStage(OutputStage *output_stage);
+
+protected:
+  OutputStage *output_stage_;//!<Collects outputs for batched rendering, or nullptr to write them immediately
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "core/named_func.hpp"
+#include "core/trigger_menu.hpp"
  
 namespace Functions{
   extern const NamedFunc n_isr_match;
@@ -39,6 +40,7 @@ namespace Functions{
   extern const NamedFunc wgt_run2_nosf;
   extern const NamedFunc mht_ratio;
   extern const NamedFunc fake_met;
+  extern const TriggerMenu trig_menu_run2;
   extern const NamedFunc trig_run2;
   extern const NamedFunc eff_trig_run2;
 
@@ -2,6 +2,7 @@
 #define H_GENERATE_BABY
 
 #include <string>
+#include <fstream>
 #include <map>
 #include <set>
 
@@ -32,6 +33,7 @@ public:
   bool ImplementIn(const std::string &baby_type) const;
   bool NotInBase() const;
   bool EverythingIn(const std::string &baby_type) const;
+  bool PackedInBase() const;
 
   bool operator<(const Variable& other) const;
 
@@ -53,7 +55,8 @@ void RemoveExtraSpaces(std::string &line);
 void WriteBaseHeader(const std::set<Variable> &vars,
                      const std::set<std::string> &types);
 
-void WriteBaseSource(const std::set<Variable> &vars);
+void WriteBaseSource(const std::set<Variable> &vars,
+                     const std::set<std::string> &types);
 
 void WriteSpecializedHeader(const std::set<Variable> &vars,
                             const std::string &type);
@@ -61,6 +64,14 @@ void WriteSpecializedHeader(const std::set<Variable> &vars,
 void WriteSpecializedSource(const std::set<Variable> &vars,
                             const std::string &type);
 
+void WriteFunctionLookup(std::ofstream &file, const Variable &var,
+                         const std::set<std::string> &types);
+
+void WriteAccessorBody(std::ofstream &file, const std::string &type,
+                       const std::string &name);
+
+void WritePackedAccessorBody(std::ofstream &file, const std::string &name);
+
 void WriteMergedHeader(const std::set<Variable> &vars,
                        const std::set<std::string> &types);
 
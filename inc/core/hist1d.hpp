@@ -5,6 +5,7 @@
 #include <utility>
 #include <memory>
 #include <set>
+#include <map>
 #include <limits>
 
 #include "TH1D.h"
@@ -19,6 +20,7 @@
 #include "core/process.hpp"
 #include "core/axis.hpp"
 #include "core/plot_opt.hpp"
+#include "core/exact_sum.hpp"
 
 class Hist1D final: public Figure{
 public:
@@ -33,6 +35,20 @@ public:
     mutable TH1D scaled_hist_;//!<Kludge. Mutable storage of scaled and stacked histogram
 
     void RecordEvent(const Baby &baby) final;
+    std::size_t MemoryUsage() const final;
+
+    void Reproducible(bool reproducible) final;
+    void Finalize() final;
+
+    void Specialize(const Baby &baby) final;
+    void Unspecialize(const Baby &baby) final;
+
+    std::string Definition() const final;
+    bool SaveState(std::ostream &out) const final;
+    void LoadState(std::istream &in) final;
+
+    long NumPassing(const Baby &baby);
+    void FillBin(int bin, NamedFunc::ScalarType val, NamedFunc::ScalarType wgt);
 
     double GetMax(double max_bound = std::numeric_limits<double>::infinity(),
                   bool include_error_bar = false,
@@ -48,8 +64,46 @@ public:
     SingleHist1D(SingleHist1D &&) = delete;
     SingleHist1D& operator=(SingleHist1D &&) = delete;
 
+    struct Specialization{
+      NamedFunc cut_;//!<proc_and_hist_cut_ specialized to a Baby
+      NamedFunc weight_;//!<Hist1D::weight_ specialized to a Baby
+      NamedFunc var_;//!<Variable on x-axis specialized to a Baby
+    };
+
+    void Fill(NamedFunc::ScalarType val, NamedFunc::ScalarType wgt);
+    const Specialization * GetSpecialization(const Baby &baby);
+
     NamedFunc proc_and_hist_cut_;
     NamedFunc::VectorType cut_vector_, wgt_vector_, val_vector_;
+    bool reproducible_;//!<If true, fill exact_sumw_ and exact_sumw2_ instead of raw_hist_
+    std::vector<ExactSum> exact_sumw_, exact_sumw2_;//!<Order-independent bin contents used in reproducible mode
+    std::vector<double> banked_sumw_, banked_sumw2_;//!<Bin contents from FillBin() not yet added to raw_hist_
+    double banked_stats_[4];//!<Sums of w, w^2, wx and wx^2 from FillBin(), as kept by TH1
+    long num_fills_;//!<Number of fills recorded in exact_sumw_ or banked_sumw_
+    std::map<const Baby*, Specialization> specializations_;//!<Functions specialized to each Baby being processed
+    const Baby *current_baby_;//!<Baby of the last recorded event
+    const Specialization *current_;//!<Specialization for current_baby_, or nullptr to use general functions
+  };
+
+  class Bank{
+  public:
+    static std::vector<std::unique_ptr<Bank> > Group(std::set<Figure::FigureComponent*> &components,
+                                                     const Baby &baby);
+
+    void RecordEvent(const Baby &baby);
+
+  private:
+    Bank(const NamedFunc &var, const NamedFunc &weight,
+         const std::vector<SingleHist1D*> &members);
+    Bank() = delete;
+    Bank(const Bank &) = delete;
+    Bank& operator=(const Bank &) = delete;
+    Bank(Bank &&) = delete;
+    Bank& operator=(Bank &&) = delete;
+
+    NamedFunc var_;//!<Variable on x-axis shared by all members, specialized to the Baby
+    NamedFunc weight_;//!<Weight shared by all members, specialized to the Baby
+    std::vector<SingleHist1D*> members_;//!<Histograms filled from the shared value, weight and bin
   };
 
   Hist1D(const Axis &xaxis, const NamedFunc &cut,
@@ -1,6 +1,10 @@
 #ifndef H_HIST2D
 #define H_HIST2D
 
+#include <cstdint>
+
+#include <mutex>
+
 #include "TH2D.h"
 #include "TGraph.h"
 #include "TLine.h"
@@ -24,16 +28,41 @@ public:
     Clustering::Clusterizer clusterizer_;
 
     void RecordEvent(const Baby &baby);
+    std::size_t MemoryUsage() const;
+    void MemoryLimit(std::size_t bytes, std::size_t num_threads);
+    bool MemoryLimited() const;
+    bool Concurrent() const;
+    void Reproducible(bool reproducible);
+    void Finalize();
+
+    std::string Definition() const;
+    bool SaveState(std::ostream &out) const;
+    void LoadState(std::istream &in);
+
+    void MaxPoints(long max_points);
 
   private:
+    struct Buffer{
+      Buffer(const Clustering::Clusterizer &empty, std::uint64_t seed);
+
+      Clustering::Clusterizer clusterizer_;//!<Histogram and sampled points recorded by one thread
+      NamedFunc::VectorType cut_vector_, wgt_vector_, xval_vector_, yval_vector_;
+    };
+
     SingleHist2D() = delete;
     SingleHist2D(const SingleHist2D &) = delete;
     SingleHist2D& operator=(const SingleHist2D &) = delete;
     SingleHist2D(SingleHist2D &&) = delete;
     SingleHist2D& operator=(SingleHist2D &&) = delete;
 
+    Buffer & ThreadBuffer();
+
     NamedFunc proc_and_hist_cut_;
-    NamedFunc::VectorType cut_vector_, wgt_vector_, xval_vector_, yval_vector_;
+    std::size_t id_;//!<Unique identifier used to find each thread's buffer
+    bool reproducible_;//!<If true, points are tagged with their event for hashed sampling
+    bool replayed_;//!<True if the process replays an EventCache, whose baby variables are not loaded
+    mutable std::mutex buffers_mutex_;//!<Protects buffers_
+    std::vector<std::unique_ptr<Buffer> > buffers_;//!<Per-thread buffers merged into clusterizer_ by Finalize()
   };
 
   Hist2D(const Axis &xaxis, const Axis &yaxis, const NamedFunc &cut,
@@ -54,6 +83,7 @@ public:
 
   Hist2D & Weight(const NamedFunc &weight);
   Hist2D & Tag(const std::string &tag);
+  Hist2D & MaxPoints(long max_points);
 
   Axis xaxis_, yaxis_;
   NamedFunc cut_, weight_;
@@ -0,0 +1,34 @@
+#ifndef H_MEMORY_MONITOR
+#define H_MEMORY_MONITOR
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class MemoryMonitor{
+public:
+  MemoryMonitor();
+  MemoryMonitor(const MemoryMonitor &) = default;
+  MemoryMonitor & operator=(const MemoryMonitor &) = default;
+  MemoryMonitor(MemoryMonitor &&) = default;
+  MemoryMonitor & operator=(MemoryMonitor &&) = default;
+  ~MemoryMonitor() = default;
+
+  MemoryMonitor & StartPhase(const std::string &name);
+  MemoryMonitor & EndPhase();
+  MemoryMonitor & RecordPeak(const std::string &name);
+
+  const std::vector<std::pair<std::string, std::size_t> > & Phases() const;
+  std::string Summary() const;
+
+  static std::size_t ResidentBytes();
+  static std::size_t PeakResidentBytes();
+  static bool ResetPeak();
+  static std::string FormatBytes(std::size_t bytes);
+
+private:
+  std::vector<std::pair<std::string, std::size_t> > phases_;//!<Name and peak resident memory of each finished phase
+  std::string current_phase_;//!<Name of phase in progress, or empty
+};
+
+#endif
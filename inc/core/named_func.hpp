@@ -5,6 +5,7 @@
 #include <functional>
 #include <ostream>
 #include <vector>
+#include <memory>
 
 #include "TString.h"
 
@@ -16,6 +17,7 @@ public:
   using VectorType = std::vector<ScalarType>;
   using ScalarFunc = ScalarType(const Baby &);
   using VectorFunc = VectorType(const Baby &);
+  using SpecializerFunc = NamedFunc(const Baby &);
 
   NamedFunc(const std::string &name,
             const std::function<ScalarFunc> &function);
@@ -31,6 +33,13 @@ public:
   NamedFunc & operator=(NamedFunc &&) = default;
   ~NamedFunc() = default;
 
+  template<typename BabyType>
+  static NamedFunc Typed(const std::string &name,
+                         const std::function<ScalarType(const BabyType &)> &function);
+  template<typename BabyType>
+  static NamedFunc Typed(const std::string &name,
+                         const std::function<VectorType(const BabyType &)> &function);
+
   const std::string & Name() const;
   NamedFunc & Name(const std::string &name);
   std::string PlainName() const;
@@ -44,6 +53,13 @@ public:
   bool IsScalar() const;
   bool IsVector() const;
 
+  NamedFunc & Specializer(const std::function<SpecializerFunc> &specializer);
+  bool IsSpecializable() const;
+  NamedFunc Specialized(const Baby &b) const;
+
+  bool IsConstant() const;
+  ScalarType ConstantValue() const;
+
   ScalarType GetScalar(const Baby &b) const;
   VectorType GetVector(const Baby &b) const;
 
@@ -60,10 +76,79 @@ private:
   std::string name_;//!<String representation of the function
   std::function<ScalarFunc> scalar_func_;//<!Scalar function. Cannot be valid at same time as NamedFunc::vector_func_.
   std::function<VectorFunc> vector_func_;//<!Vector function. Cannot be valid at same time as NamedFunc::scalar_func_.
+  std::shared_ptr<const std::function<SpecializerFunc> > specializer_;//!<Builds an equivalent function for the file-level constants of a Baby, or nullptr
+  bool is_constant_;//!<True if scalar_func_ returns constant_ for every event
+  ScalarType constant_;//!<Value returned by a constant function
 
   void CleanName();
+
+  template<typename BabyType, typename Result>
+  static NamedFunc Bind(const std::string &name,
+                        const std::function<Result(const BabyType &)> &function);
+  template<typename BabyType>
+  static const BabyType & Cast(const Baby &b, const std::string &name);
+  [[noreturn]] static void BadBabyType(const std::string &name);
 };
 
+/*!\brief Constructs a NamedFunc reading a concrete Baby type
+
+  Derived Baby classes are final, so accessors called on a BabyType are not
+  virtual and can be inlined, even for variables absent from other Baby
+  types. The function is bound to each Baby once through
+  NamedFunc::Specialized(). Without specialization, the Baby is cast on every
+  call.
+
+  \param[in] name Name of function
+
+  \param[in] function Function returning a scalar for an event of a BabyType
+
+  \return NamedFunc accepting any Baby, which must be a BabyType
+*/
+template<typename BabyType>
+NamedFunc NamedFunc::Typed(const std::string &name,
+                           const std::function<ScalarType(const BabyType &)> &function){
+  return Bind<BabyType, ScalarType>(name, function);
+}
+
+/*!\brief Constructs a NamedFunc reading a concrete Baby type
+
+  \see NamedFunc::Typed(const std::string &, const std::function<ScalarType(const BabyType &)> &)
+
+  \param[in] name Name of function
+
+  \param[in] function Function returning a vector for an event of a BabyType
+
+  \return NamedFunc accepting any Baby, which must be a BabyType
+*/
+template<typename BabyType>
+NamedFunc NamedFunc::Typed(const std::string &name,
+                           const std::function<VectorType(const BabyType &)> &function){
+  return Bind<BabyType, VectorType>(name, function);
+}
+
+template<typename BabyType, typename Result>
+NamedFunc NamedFunc::Bind(const std::string &name,
+                          const std::function<Result(const BabyType &)> &function){
+  auto shared = std::make_shared<const std::function<Result(const BabyType &)> >(function);
+  NamedFunc result(name, std::function<Result(const Baby &)>([shared, name](const Baby &b){
+        return (*shared)(Cast<BabyType>(b, name));
+      }));
+  std::string clean_name = result.Name();
+  return result.Specializer([shared, clean_name](const Baby &b){
+      const BabyType *typed = &Cast<BabyType>(b, clean_name);
+      return NamedFunc(clean_name, std::function<Result(const Baby &)>([shared, typed](const Baby &){
+            return (*shared)(*typed);
+          }));
+    });
+}
+
+template<typename BabyType>
+const BabyType & NamedFunc::Cast(const Baby &b, const std::string &name){
+  const BabyType *typed = dynamic_cast<const BabyType*>(&b);
+  if(typed == nullptr) BadBabyType(name);
+  return *typed;
+}
+
 NamedFunc operator + (NamedFunc f, NamedFunc g);
 NamedFunc operator - (NamedFunc f, NamedFunc g);
 NamedFunc operator * (NamedFunc f, NamedFunc g);
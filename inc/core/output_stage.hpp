@@ -0,0 +1,62 @@
+#ifndef H_OUTPUT_STAGE
+#define H_OUTPUT_STAGE
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+
+class OutputStage{
+public:
+  explicit OutputStage(const std::string &manifest = ".output_hashes");
+  ~OutputStage() = default;
+
+  void AddTable(const std::string &tex_path, const std::string &content);
+  void AddRender(const std::vector<std::string> &outputs,
+                 const std::string &inputs,
+                 const std::function<void()> &render);
+
+  void Run();
+
+  bool Compile() const;
+  OutputStage & Compile(bool compile);
+
+  std::size_t NumWorkers() const;
+  OutputStage & NumWorkers(std::size_t num_workers);
+
+  static std::uint64_t Hash(const std::string &data);
+
+private:
+  struct Task{
+    std::vector<std::string> outputs_;//!<Files produced by the task
+    std::uint64_t hash_;//!<Hash of everything that determines the outputs
+    std::function<void()> run_;//!<Produces the outputs
+  };
+
+  OutputStage(const OutputStage &) = delete;
+  OutputStage & operator=(const OutputStage &) = delete;
+  OutputStage(OutputStage &&) = delete;
+  OutputStage & operator=(OutputStage &&) = delete;
+
+  bool UpToDate(const Task &task) const;
+  std::vector<bool> RunRenders(const std::vector<const Task*> &tasks,
+                               std::size_t &num_workers) const;
+  std::vector<bool> RunCompiles(const std::vector<const Task*> &tasks) const;
+  std::string ManifestPath(const std::string &directory) const;
+  std::map<std::string, std::uint64_t> ReadManifest(const std::string &directory) const;
+  void ReadManifest(const std::set<std::string> &directories);
+  void WriteManifest(const std::set<std::string> &directories) const;
+
+  std::string manifest_name_;//!<Name of the file in each output directory recording the input hash of each output
+  std::map<std::string, std::uint64_t> manifest_;//!<Input hash of each queued output as of its last run
+  std::vector<Task> renders_;//!<Pending plot renders
+  std::vector<Task> compiles_;//!<Pending LaTeX compilations
+  std::vector<std::string> tables_;//!<All tables written in this stage
+  bool compile_;//!<Whether to compile tables with pdflatex
+  std::size_t num_workers_;//!<Number of concurrent worker processes or threads
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef H_PARAM_WEIGHT
+#define H_PARAM_WEIGHT
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "core/named_func.hpp"
+
+class ParamWeight{
+public:
+  using ParamFunc = double(const std::vector<double> &);
+
+  explicit ParamWeight(const std::vector<std::string> &parameters);
+  ParamWeight(const ParamWeight &) = default;
+  ParamWeight & operator=(const ParamWeight &) = default;
+  ParamWeight(ParamWeight &&) = default;
+  ParamWeight & operator=(ParamWeight &&) = default;
+  ~ParamWeight() = default;
+
+  ParamWeight & Add(const NamedFunc &basis,
+                    const std::function<ParamFunc> &coefficient);
+  ParamWeight & Add(const NamedFunc &basis,
+                    const std::vector<unsigned> &powers,
+                    double factor = 1.);
+
+  const std::vector<std::string> & Parameters() const;
+  std::size_t NumTerms() const;
+  const NamedFunc & Basis(std::size_t iterm) const;
+
+  std::vector<double> Coefficients(const std::vector<double> &values) const;
+  NamedFunc Evaluated(const std::vector<double> &values) const;
+
+private:
+  ParamWeight() = delete;
+
+  void CheckValues(const std::vector<double> &values) const;
+
+  std::vector<std::string> parameters_;//!<Names of the parameters
+  std::vector<NamedFunc> basis_;//!<Per-event factor of each term
+  std::vector<std::function<ParamFunc> > coefficients_;//!<Parameter-dependent factor of each term
+};
+
+#endif
@@ -5,11 +5,14 @@
 #include <set>
 #include <memory>
 #include <utility>
+#include <string>
 
 #include "core/plot_opt.hpp"
 #include "core/figure.hpp"
 
 class Process;
+class ProgressTracker;
+class OutputStage;
 
 class PlotMaker{
 public:
@@ -42,16 +45,61 @@ public:
 
   bool multithreaded_;
   bool min_print_;
+  std::string status_file_;
+  std::size_t memory_budget_;
+  std::size_t baby_memory_;
+  std::size_t pipeline_readers_;
+  long pipeline_cache_;
+  bool batch_output_;
+  bool compile_tables_;
+  bool reproducible_;
+  std::string checkpoint_file_;
+  double checkpoint_interval_;
 
 private:
+  friend class PlotSession;
+
+  class ImplicitMTScope{
+  public:
+    explicit ImplicitMTScope(std::size_t num_threads);
+    ~ImplicitMTScope();
+
+  private:
+    ImplicitMTScope() = delete;
+    ImplicitMTScope(const ImplicitMTScope &) = delete;
+    ImplicitMTScope& operator=(const ImplicitMTScope &) = delete;
+    ImplicitMTScope(ImplicitMTScope &&) = delete;
+    ImplicitMTScope& operator=(ImplicitMTScope &&) = delete;
+
+    bool enabled_;//!<True if this scope enabled ROOT's implicit multithreading
+  };
+
   std::vector<std::unique_ptr<Figure> > figures_;//!<Figures to be produced
 
   void GetYields();
-  long GetYield(Baby *baby_ptr);
+  void StartYields();
+  void FinishYields();
+  void PrintFigures(double luminosity, const std::string &subdir,
+                    OutputStage &output);
+  std::size_t ApplyMemoryBudget(std::size_t num_threads);
+  static std::size_t ApplyMemoryBudget(std::size_t num_threads,
+                                       std::size_t memory_budget,
+                                       std::size_t baby_memory,
+                                       const std::set<Figure::FigureComponent*> &components);
+  void PrintComponentMemory() const;
+  std::size_t SetupPipeline(std::size_t num_threads) const;
+  void SetupPipeline(Baby &baby) const;
+  long GetYield(Baby *baby_ptr, ProgressTracker &progress);
+  long GetSharedYield(Baby *baby_ptr, ProgressTracker &progress,
+                      const std::vector<const PlotMaker*> &makers);
+  long ReplayYield(const Process *process, ProgressTracker &progress);
 
   std::set<Baby*> GetBabies() const;
   std::set<const Process *> GetProcesses() const;
+  std::vector<const Process *> GetReplays() const;
   std::set<Figure::FigureComponent*> GetComponents(const Process *process) const;
+  std::set<Figure::FigureComponent*> GetComponents() const;
+  std::vector<Figure::FigureComponent*> GetOrderedComponents() const;
 };
 
 #endif
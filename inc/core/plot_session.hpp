@@ -0,0 +1,39 @@
+#ifndef H_PLOT_SESSION
+#define H_PLOT_SESSION
+
+#include <vector>
+#include <string>
+
+#include "core/plot_maker.hpp"
+
+class PlotSession{
+public:
+  PlotSession();
+  ~PlotSession() = default;
+
+  PlotSession & Add(PlotMaker &plot_maker,
+                    double luminosity,
+                    const std::string &subdir = "");
+
+  void Run();
+
+  bool multithreaded_;//!<If false, process one baby at a time
+  bool min_print_;//!<If true, reduce printout
+  std::string status_file_;//!<File to which progress is written, or empty
+
+private:
+  struct Entry{
+    PlotMaker *plot_maker_;//!<Maker whose figures are filled
+    double luminosity_;//!<Luminosity with which the maker's plots are drawn
+    std::string subdir_;//!<Subdirectory for the maker's plots
+  };
+
+  PlotSession(const PlotSession &) = delete;
+  PlotSession& operator=(const PlotSession &) = delete;
+  PlotSession(PlotSession &&) = delete;
+  PlotSession& operator=(PlotSession &&) = delete;
+
+  std::vector<Entry> entries_;//!<Makers run by the session, in order added
+};
+
+#endif
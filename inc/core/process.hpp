@@ -6,10 +6,13 @@
 #include <map>
 #include <set>
 #include <mutex>
+#include <algorithm>
 
 #include "core/baby.hpp"
 #include "core/named_func.hpp"
 #include "core/utilities.hpp"
+#include "core/setup_profiler.hpp"
+#include "core/work_planner.hpp"
 
 class Process : public TAttFill, public TAttLine, public TAttMarker{
 public:
@@ -72,26 +75,41 @@ Process::Process(BabyType * /*dummy_baby*/,
   cut_(cut),
   color_(color){
   std::lock_guard<std::mutex> lock(mutex_);
+  std::set<std::string> full_files;
   for(const auto &file: files){
-    const auto &full_files = Glob(file);
-    for(const auto &full_file: full_files){
-      bool found = false;
-      for(auto &baby_p: baby_pool_){
-        auto &baby = *baby_p;
-        if(typeid(baby) != typeid(BabyType)) continue;
-        const auto &baby_files = baby.FileNames();
-        if(baby_files.find(full_file) != baby_files.end()){
-          baby.processes_.insert(this);
-          found = true;
-          break;
-        }
-      }
-      if(!found){
-        baby_pool_.emplace(static_cast<Baby*>(new BabyType(std::set<std::string>{full_file},
-                                                           std::set<const Process*>{this})));
+    const auto &globbed = Glob(file);
+    full_files.insert(globbed.cbegin(), globbed.cend());
+  }
+  std::set<std::string> unshared;
+  std::size_t num_reread = 0;
+  for(const auto &full_file: full_files){
+    bool found = false, packed_elsewhere = false;
+    for(auto &baby_p: baby_pool_){
+      auto &baby = *baby_p;
+      if(typeid(baby) != typeid(BabyType)) continue;
+      const auto &baby_files = baby.FileNames();
+      if(baby_files.find(full_file) == baby_files.end()) continue;
+      if(std::includes(full_files.cbegin(), full_files.cend(),
+                       baby_files.cbegin(), baby_files.cend())){
+        baby.processes_.insert(this);
+        found = true;
+        break;
       }
+      packed_elsewhere = true;
     }
+    if(!found) unshared.insert(full_file);
+    if(!found && packed_elsewhere) ++num_reread;
+  }
+  if(num_reread > 0){
+    DBG(std::to_string(num_reread)+" files of process "+name_
+        +" are packed into babies of other processes with files outside "+name_
+        +" and will be read again. Use WorkPlanner::TargetBytes(0) to read each file once.");
   }
+  SetupProfiler::Scope scope("babies");
+  auto sample_type = [](const std::string &file){return BabyType::SetSampleType(file);};
+  for(const auto &unit: WorkPlanner::Pack(unshared, sample_type)){
+    baby_pool_.emplace(static_cast<Baby*>(new BabyType(unit, std::set<const Process*>{this})));
   }
+}
 
 #endif
@@ -0,0 +1,87 @@
+#ifndef H_PROGRESS_TRACKER
+#define H_PROGRESS_TRACKER
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class ProgressTracker{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  class Counter{
+  public:
+    explicit Counter(ProgressTracker &tracker);
+    ~Counter();
+
+    inline void Iterate(){
+      if(++pending_ >= flush_size_) Flush();
+    }
+    void Skip(long entries);
+    void Flush();
+
+  private:
+    Counter(const Counter &) = delete;
+    Counter & operator=(const Counter &) = delete;
+    Counter(Counter &&) = delete;
+    Counter & operator=(Counter &&) = delete;
+
+    static const long flush_size_ = 4096;//!<Entries accumulated locally before updating shared total
+
+    ProgressTracker &tracker_;//!<Tracker to which entries are reported
+    long pending_;//!<Entries processed since last flush
+  };
+
+  explicit ProgressTracker(std::size_t num_tasks,
+                           bool print = true,
+                           const std::string &status_file = "",
+                           double interval = 10.);
+  ~ProgressTracker();
+
+  void Start();
+  void Stop();
+
+  void StartTask(long num_entries);
+  void FinishTask();
+
+  long EntriesDone() const;
+  long EntriesExpected() const;
+  long BytesRead() const;
+  double ElapsedSeconds() const;
+  double Rate() const;
+  double RemainingSeconds() const;
+
+  std::string StatusLine() const;
+  std::string StatusJSON(const std::string &state) const;
+
+private:
+  ProgressTracker(const ProgressTracker &) = delete;
+  ProgressTracker & operator=(const ProgressTracker &) = delete;
+  ProgressTracker(ProgressTracker &&) = delete;
+  ProgressTracker & operator=(ProgressTracker &&) = delete;
+
+  std::size_t num_tasks_;//!<Total number of tasks (babies) to process
+  bool print_;//!<Whether to print a status line at every interval
+  std::string status_file_;//!<Path of JSON status file. Empty to disable.
+  std::chrono::duration<double> interval_;//!<Time between status updates
+
+  std::atomic<long> entries_done_;//!<Entries processed by all workers
+  std::atomic<long> entries_known_;//!<Entries in all tasks started so far
+  std::atomic<std::size_t> tasks_started_;//!<Number of tasks started
+  std::atomic<std::size_t> tasks_done_;//!<Number of tasks finished
+  long start_bytes_;//!<Bytes read by ROOT before start
+  Clock::time_point start_time_;//!<Time of Start() call
+
+  std::thread monitor_;//!<Thread periodically reporting progress
+  std::mutex mutex_;//!<Protects stop_
+  std::condition_variable cv_;//!<Wakes monitor thread on Stop()
+  bool stop_;//!<Set to stop monitor thread
+
+  void Monitor();
+  void WriteStatus(const std::string &state) const;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef H_SETUP_PROFILER
+#define H_SETUP_PROFILER
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <mutex>
+
+class SetupProfiler{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  class Scope{
+  public:
+    explicit Scope(const std::string &phase);
+    ~Scope();
+
+  private:
+    Scope() = delete;
+    Scope(const Scope &) = delete;
+    Scope& operator=(const Scope &) = delete;
+    Scope(Scope &&) = delete;
+    Scope& operator=(Scope &&) = delete;
+
+    std::string phase_;//!<Phase the time is charged to
+    Clock::time_point start_;//!<Time the scope was entered
+    bool outermost_;//!<True if no scope of the same phase was already active in this thread
+  };
+
+  struct Phase{
+    std::string name_;//!<Name of phase
+    std::chrono::duration<double> time_;//!<Total wall time spent in phase
+    long calls_;//!<Number of times the phase was entered
+  };
+
+  static void Add(const std::string &phase,
+                  std::chrono::duration<double> time);
+  static std::vector<Phase> Phases();
+  static std::chrono::duration<double> Elapsed();
+  static std::string Summary();
+  static void Reset();
+
+private:
+  SetupProfiler() = delete;
+
+  static std::mutex & Mutex();
+  static std::vector<Phase> & PhaseList();
+  static Clock::time_point & Start();
+  static std::vector<std::string> & Active();
+};
+
+#endif
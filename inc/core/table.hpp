@@ -1,13 +1,19 @@
 #ifndef H_TABLE
 #define H_TABLE
 
+#include <cstdint>
+
 #include <memory>
 #include <vector>
 #include <string>
-#include <fstream>
+#include <map>
+#include <ostream>
 
 #include "core/figure.hpp"
 #include "core/table_row.hpp"
+#include "core/exact_sum.hpp"
+#include "core/param_weight.hpp"
+#include "core/event_summary.hpp"
 #include "core/process.hpp"
 #include "core/gamma_params.hpp"
 #include "core/plot_opt.hpp"
@@ -21,6 +27,21 @@ public:
     ~TableColumn() = default;
 
     void RecordEvent(const Baby &baby) final;
+    std::size_t MemoryUsage() const final;
+    bool Done() const final;
+
+    void Reproducible(bool reproducible) final;
+    void Finalize() final;
+
+    void Specialize(const Baby &baby) final;
+    void Unspecialize(const Baby &baby) final;
+
+    std::string Definition() const final;
+    bool SaveState(std::ostream &out) const final;
+    void LoadState(std::istream &in) final;
+
+    void Evaluate(const std::vector<double> &coefficients);
+    void Serve(const EventSummary *summary);
 
     std::vector<double> sumw_, sumw2_;
 
@@ -31,8 +52,37 @@ public:
     TableColumn(TableColumn &&) = delete;
     TableColumn& operator=(TableColumn &&) = delete;
 
+    struct Specialization{
+      std::vector<NamedFunc> cuts_;//!<proc_and_table_cut_ specialized to a Baby
+      std::vector<NamedFunc> weights_;//!<Row weights specialized to a Baby
+      std::vector<NamedFunc> factors_;//!<factors_ specialized to a Baby
+      std::vector<std::uint64_t> known_;//!<Bitset of factors folded to constants
+      std::vector<std::uint64_t> passed_;//!<Bitset of constant factors that pass
+    };
+
+    const Specialization * GetSpecialization(const Baby &baby);
+    bool PassFactors(const Baby &baby, std::size_t irow,
+                     const std::vector<NamedFunc> &factors);
+    void Accumulate(const Baby &baby, std::size_t irow, NamedFunc::ScalarType wgt);
+
     std::vector<NamedFunc> proc_and_table_cut_;
     NamedFunc::VectorType cut_vector_, wgt_vector_, val_vector_;
+    std::vector<NamedFunc> factors_;//!<Distinct scalar cut factors of all factorized rows
+    std::vector<std::vector<std::uint64_t> > row_masks_;//!<Bitset of factors of each row. Empty if row is not factorized.
+    std::vector<std::uint64_t> known_;//!<Bitset of factors already evaluated for current event
+    std::vector<std::uint64_t> passed_;//!<Bitset of factors passed by current event
+    bool reproducible_;//!<If true, accumulate into exact_sumw_ and exact_sumw2_
+    std::vector<ExactSum> exact_sumw_, exact_sumw2_;//!<Order-independent sums used in reproducible mode
+    std::vector<NamedFunc::ScalarType> basis_values_;//!<ParamWeight basis terms of current event
+    bool have_basis_;//!<True if basis_values_ holds the current event
+    std::vector<std::vector<double> > param_sumw_;//!<Sum of weight times each basis term, for each row
+    std::vector<std::vector<double> > param_sumw2_;//!<Sum of squared weight times each product of two basis terms, for each row
+    std::map<const Baby*, Specialization> specializations_;//!<Functions specialized to each Baby being processed
+    const Baby *current_baby_;//!<Baby of the last recorded event
+    const Specialization *current_;//!<Specialization for current_baby_, or nullptr to use general functions
+    const EventSummary::SingleSummary *summary_;//!<Summary serving some rows, or nullptr
+    std::vector<EventSummary::Selection> served_cuts_;//!<Row cuts compiled for summary_
+    std::vector<long> served_weights_;//!<Index of summed weight serving each row, or -1 to fill the row from events
   };
 
   Table(const std::string &name,
@@ -57,6 +107,13 @@ public:
   
   std::set<const Process*> GetProcesses() const final;
 
+  Table & Summarized(const EventSummary &summary);
+
+  Table & Parametric(const ParamWeight &weight,
+                     const std::vector<double> &values);
+  const std::vector<double> & Parameters() const;
+  Table & Parameters(const std::vector<double> &values);
+
   FigureComponent * GetComponent(const Process *process) final;
   
   std::string name_;
@@ -73,6 +130,8 @@ private:
   std::vector<std::unique_ptr<TableColumn> > backgrounds_;//!<Background components of the figure
   std::vector<std::unique_ptr<TableColumn> > signals_;//!<Signal components of the figure
   std::vector<std::unique_ptr<TableColumn> > datas_;//!<Data components of the figure
+  std::unique_ptr<ParamWeight> param_weight_;//!<Parameter-dependent factor of all row weights, or nullptr
+  std::vector<double> param_values_;//!<Parameter values at which sumw_ and sumw2_ are evaluated
 
   Table(const Table &) = delete;
   Table& operator=(const Table &) = delete;
@@ -80,10 +139,10 @@ private:
 
   const std::vector<std::unique_ptr<TableColumn> >& GetComponentList(const Process *process) const;
 
-  void PrintHeader(std::ofstream &file, double luminosity) const;
-  void PrintRow(std::ofstream &file, std::size_t irow, double luminosity) const;
+  void PrintHeader(std::ostream &file, double luminosity) const;
+  void PrintRow(std::ostream &file, std::size_t irow, double luminosity) const;
   void PrintPie(std::size_t irow, double luminosity) const;
-  void PrintFooter(std::ofstream &file) const;
+  void PrintFooter(std::ostream &file) const;
 
   std::size_t NumColumns() const;
 
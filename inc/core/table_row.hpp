@@ -2,6 +2,7 @@
 #define H_TABLE_ROW
 
 #include <string>
+#include <vector>
 
 #include "core/named_func.hpp"
 
@@ -16,6 +17,12 @@ public:
            std::size_t lines_before = 0,
            std::size_t line_after = 0,
            const NamedFunc &weight = "weight");
+  TableRow(const std::string &label,
+           const NamedFunc &cut,
+           const std::vector<NamedFunc> &factors,
+           std::size_t lines_before = 0,
+           std::size_t line_after = 0,
+           const NamedFunc &weight = "weight");
   TableRow(const TableRow &) = default;
   TableRow& operator=(const TableRow &) = default;
   TableRow(TableRow &&) = default;
@@ -24,6 +31,7 @@ public:
 
   std::string label_;
   NamedFunc cut_, weight_;
+  std::vector<NamedFunc> factors_;
   std::size_t lines_before_, lines_after_;
   bool is_data_row_;
 
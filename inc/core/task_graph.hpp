@@ -0,0 +1,38 @@
+#ifndef H_TASK_GRAPH
+#define H_TASK_GRAPH
+
+#include <functional>
+#include <vector>
+
+class TaskGraph{
+public:
+  using TaskId = std::size_t;
+
+  TaskGraph();
+  ~TaskGraph() = default;
+
+  TaskId Add(const std::function<void()> &task,
+             const std::vector<TaskId> &dependencies = {},
+             bool uses_root = false);
+
+  void Run(std::size_t num_threads = 0);
+
+  std::size_t Size() const;
+
+private:
+  struct Node{
+    std::function<void()> task_;//!<Work to do
+    std::vector<TaskId> dependents_;//!<Tasks that can only start after this one
+    std::size_t num_dependencies_;//!<Number of tasks that must finish first
+    bool uses_root_;//!<If true, holds Multithreading::root_mutex while running
+  };
+
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph & operator=(const TaskGraph &) = delete;
+  TaskGraph(TaskGraph &&) = delete;
+  TaskGraph & operator=(TaskGraph &&) = delete;
+
+  std::vector<Node> nodes_;//!<All tasks, in order added
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef H_TRIGGER_MENU
+#define H_TRIGGER_MENU
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class Baby;
+
+class TriggerMenu{
+public:
+  using Mask = std::vector<std::uint64_t>;
+
+  explicit TriggerMenu(const std::string &name);
+  TriggerMenu(const TriggerMenu &) = default;
+  TriggerMenu & operator=(const TriggerMenu &) = default;
+  TriggerMenu(TriggerMenu &&) = default;
+  TriggerMenu & operator=(TriggerMenu &&) = default;
+  ~TriggerMenu() = default;
+
+  TriggerMenu & Add(int sample_type,
+                    const std::vector<std::size_t> &paths);
+  TriggerMenu & Add(const std::vector<std::size_t> &paths);
+
+  const std::string & Name() const;
+  const Mask & GetMask(int sample_type) const;
+
+  bool Pass(int sample_type, const std::vector<std::uint64_t> &bits) const;
+  bool Pass(const Baby &b) const;
+
+  static bool Test(const Mask &mask, const std::vector<std::uint64_t> &bits);
+
+private:
+  TriggerMenu() = delete;
+
+  static Mask MakeMask(const std::vector<std::size_t> &paths);
+
+  std::string name_;//!<Name of menu, used in error messages
+  std::vector<std::pair<int, Mask> > masks_;//!<Mask of trig indices for each listed SampleType
+  Mask default_mask_;//!<Mask for sample types not in masks_
+};
+
+#endif
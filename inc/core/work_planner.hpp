@@ -0,0 +1,27 @@
+#ifndef H_WORK_PLANNER
+#define H_WORK_PLANNER
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <functional>
+
+class WorkPlanner{
+public:
+  static std::vector<std::set<std::string> > Pack(const std::set<std::string> &files,
+                                                  const std::function<int(const std::string &)> &sample_type);
+
+  static std::size_t TargetBytes();
+  static void TargetBytes(std::size_t bytes);
+
+  static long FileSize(const std::string &path);
+
+private:
+  WorkPlanner() = delete;
+
+  static std::size_t target_bytes_;//!<Size on disk each unit of packed files aims for. 0 disables packing.
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef H_WORKSPACE_INDEX
+#define H_WORKSPACE_INDEX
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "RooWorkspace.h"
+#include "RooArgSet.h"
+#include "RooAbsReal.h"
+
+class WorkspaceIndex{
+public:
+  class Entry{
+  public:
+    Entry() = default;
+    Entry(const std::string &name);
+
+    std::string name_;//!<Full name of function/variable in the workspace
+    std::string kind_;//!<Name prefix before "_BLK_" or "_BIN_" (e.g. ymc, nbkg, frac)
+    std::string block_;//!<Block name following "_BLK_", or empty
+    std::string bin_;//!<Bin name following "_BIN_", or empty
+    std::string process_;//!<Process name following "_PRC_", or empty
+    RooAbsReal *arg_;//!<Function/variable in the workspace
+
+    bool Valid() const;
+  };
+
+  explicit WorkspaceIndex(const RooWorkspace &w);
+  explicit WorkspaceIndex(const RooArgSet &args);
+  WorkspaceIndex(const WorkspaceIndex &) = default;
+  WorkspaceIndex & operator=(const WorkspaceIndex &) = default;
+  WorkspaceIndex(WorkspaceIndex &&) = default;
+  WorkspaceIndex & operator=(WorkspaceIndex &&) = default;
+  ~WorkspaceIndex() = default;
+
+  RooAbsReal * Find(const std::string &kind,
+                    const std::string &bin,
+                    const std::string &process = "") const;
+  const Entry * FindEntry(const std::string &kind,
+                          const std::string &bin,
+                          const std::string &process = "") const;
+
+  const std::vector<Entry> & Entries() const;
+  std::vector<const Entry*> Entries(const std::string &kind) const;
+
+  std::vector<std::string> Bins(const std::string &kind) const;
+  std::vector<std::string> Processes(const std::string &kind) const;
+
+private:
+  WorkspaceIndex() = delete;
+
+  std::vector<Entry> entries_;//!<Parsed entries in workspace iteration order
+  std::unordered_map<std::string, std::size_t> lookup_;//!<Map from (kind, bin, process) key to position in entries_
+
+  void AddArgs(const RooArgSet &args);
+  static std::string MakeKey(const std::string &kind,
+                             const std::string &bin,
+                             const std::string &process);
+};
+
+#endif
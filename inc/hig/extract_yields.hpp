@@ -119,6 +119,10 @@ void MakeCovarianceMatrix(RooWorkspace &w,
 
 std::string PrettyBinName(std::string name);
 
+void PropagateErrors(RooWorkspace &w,
+                     const RooFitResult &f,
+                     const std::vector<std::string> &bin_names);
+
 double GetError(const RooAbsReal &var,  const RooFitResult &f, int errtype=0);
 
 #endif
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "core/named_func.hpp"
+#include "core/trigger_menu.hpp"
  
 namespace Higfuncs{
   // count number of jets associated with true B-hadrons 
@@ -40,6 +41,9 @@ namespace Higfuncs{
 
 
   // analysis trigger and its efficiency
+  extern const TriggerMenu trig_menu_met;
+  extern const TriggerMenu trig_menu_el;
+  extern const TriggerMenu trig_menu_mu;
   NamedFunc::ScalarType trig_hig_decision(const Baby &b);
   extern const NamedFunc trig_hig;
   extern const NamedFunc eff_higtrig;
@@ -78,6 +78,7 @@ void abcd_method::setIntNbNj(bool int_nbnj_b){
 // Setting up all the cuts serially
 void abcd_method::serializeCuts(){
   allcuts.clear();
+  allfactors.clear();
   for(size_t iplane=0; iplane < planecuts.size(); iplane++) {
     //// Finding the OR of all bin cuts to apply to R1/R3 if int_nbnj is true
     TString c_allnbnj = "(("+bincuts[iplane][0];
@@ -129,11 +130,48 @@ void abcd_method::serializeCuts(){
         }
 
         allcuts.push_back(totcut);
+        allfactors.push_back(splitFactors(totcut));
       } // Loop over ABCD cuts
     } // Loop over bin cuts
   } // Loop over plane cuts
 } //serializeCuts
 
+//// Splits a cut into the terms of its top-level AND, so that tables can
+//// evaluate the terms shared by many bins only once per event. A cut with a
+//// top-level OR is not a product and is returned as a single factor
+vector<TString> abcd_method::splitFactors(const TString &cut){
+  vector<TString> factors;
+  string scut = cut.Data();
+  int depth = 0;
+  for(size_t ichar=0; ichar < scut.size(); ichar++){
+    if(scut[ichar] == '(') depth++;
+    else if(scut[ichar] == ')') depth--;
+    else if(depth == 0 && scut.compare(ichar, 2, "||") == 0){
+      TString whole = cut;
+      whole.ReplaceAll(" ","");
+      if(whole != "") factors.push_back(whole);
+      return factors;
+    }
+  }
+  depth = 0;
+  size_t begin = 0;
+  for(size_t ichar=0; ichar < scut.size(); ichar++){
+    if(scut[ichar] == '(') depth++;
+    else if(scut[ichar] == ')') depth--;
+    else if(depth == 0 && scut.compare(ichar, 2, "&&") == 0){
+      TString factor = scut.substr(begin, ichar-begin);
+      factor.ReplaceAll(" ","");
+      if(factor != "") factors.push_back(factor);
+      begin = ichar+2;
+      ichar++;
+    }
+  }
+  TString factor = scut.substr(begin);
+  factor.ReplaceAll(" ","");
+  if(factor != "") factors.push_back(factor);
+  return factors;
+}
+
 //// Returns index in allcuts of a given bin in a plane and ABCD
 size_t abcd_method::indexBin(size_t indplane, size_t indbin, size_t indabcd){
   if(indplane >= planecuts.size()) {
@@ -0,0 +1,347 @@
+/*! \class Checkpoint
+
+  \brief Saves the accumulated state of figure components during a long event
+  loop so that an interrupted run can resume
+
+  The unit of work is one Baby, or one process replaying an EventCache.
+  Results only depend on which units have been read, so PlotMaker saves a
+  checkpoint when no unit is being processed. The checkpoint holds the state
+  of every component (through FigureComponent::SaveState()) and the names of
+  the completed units. It is written to a temporary file that is then renamed,
+  so an interruption during the save leaves the previous checkpoint intact.
+
+  The file starts with a key hashed from the definitions of all components
+  (FigureComponent::Definition()), in a fixed order. A checkpoint written by a
+  run with different figures, cuts, weights or binning has a different key and
+  is ignored, so the run starts over instead of mixing incompatible results.
+  PlotMaker also hashes the names of all units into the key, since a change in
+  how files are packed into babies (see WorkPlanner) changes what a completed
+  unit means.
+
+  Checkpointing is disabled, with a message, if any component cannot save its
+  state.
+*/
+#include "core/checkpoint.hpp"
+
+#include <cstdio>
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <typeinfo>
+#include <algorithm>
+
+#include "TH1.h"
+
+#include "core/baby.hpp"
+#include "core/process.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const char checkpoint_magic[4] = {'P', 'M', 'C', 'K'};
+  const uint32_t checkpoint_version = 1;
+
+  uint64_t Hash(uint64_t hash, const string &text){
+    for(const auto &c: text){
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+}
+
+/*!\brief Prepares checkpointing of a set of components
+
+  \param[in] path File holding the checkpoint
+
+  \param[in] interval Minimum number of seconds between saves
+
+  \param[in] components Components whose state is saved. The order must be
+  the same in every run.
+
+  \param[in] configuration Further settings changing the meaning of the saved
+  state, hashed into the key
+*/
+Checkpoint::Checkpoint(const string &path,
+                       double interval,
+                       const vector<Figure::FigureComponent*> &components,
+                       const string &configuration):
+  path_(path),
+  interval_(interval),
+  components_(components),
+  key_(Hash(0xcbf29ce484222325ULL, configuration)),
+  done_(),
+  last_save_(Clock::now()),
+  enabled_(true){
+  key_ = Hash(key_, to_string(components_.size()));
+  for(const auto &component: components_){
+    key_ = Hash(key_, '\n'+component->Definition());
+  }
+}
+
+/*!\brief Loads the saved state into the components if the checkpoint matches
+
+  \return True if a matching checkpoint was found and loaded
+*/
+bool Checkpoint::Restore(){
+  ifstream file(path_, ios::binary);
+  if(!file.is_open()) return false;
+
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t key = 0, num_components = 0;
+  file.read(magic, sizeof(magic));
+  Read(file, version);
+  Read(file, key);
+  Read(file, num_components);
+  if(!file || !equal(magic, magic+4, checkpoint_magic) || version != checkpoint_version){
+    cout << "Ignoring unreadable checkpoint " << path_ << '.' << endl;
+    return false;
+  }
+  if(key != key_ || num_components != components_.size()){
+    cout << "Ignoring stale checkpoint " << path_ << ": figures or cuts have changed." << endl;
+    return false;
+  }
+
+  vector<string> states(num_components);
+  for(auto &state: states){
+    Read(file, state);
+  }
+  vector<string> units;
+  Read(file, units);
+  if(!file) ERROR("Checkpoint "+path_+" is truncated.");
+
+  for(size_t i = 0; i < components_.size(); ++i){
+    istringstream state(states.at(i));
+    components_.at(i)->LoadState(state);
+    if(!state || state.peek() != char_traits<char>::eof()){
+      ERROR("Checkpoint "+path_+" does not match the state of "+components_.at(i)->process_->name_+".");
+    }
+  }
+  done_ = set<string>(units.cbegin(), units.cend());
+  cout << "Restored checkpoint " << path_ << " with " << done_.size()
+       << (done_.size() == 1 ? " completed unit." : " completed units.") << endl;
+  return true;
+}
+
+/*!\brief Writes the state of all components and the completed units
+
+  Must only be called while no unit is being processed.
+*/
+void Checkpoint::Save(){
+  last_save_ = Clock::now();
+  if(!enabled_) return;
+
+  vector<string> states(components_.size());
+  for(size_t i = 0; i < components_.size(); ++i){
+    ostringstream state;
+    if(!components_.at(i)->SaveState(state)){
+      cout << "Checkpointing disabled: a component for process "
+           << components_.at(i)->process_->name_ << " cannot save its state." << endl;
+      enabled_ = false;
+      return;
+    }
+    states.at(i) = state.str();
+  }
+
+  string temp_path = path_+".tmp";
+  {
+    ofstream file(temp_path, ios::binary | ios::trunc);
+    file.write(checkpoint_magic, sizeof(checkpoint_magic));
+    Write(file, checkpoint_version);
+    Write(file, key_);
+    Write(file, static_cast<uint64_t>(states.size()));
+    for(const auto &state: states){
+      Write(file, state);
+    }
+    Write(file, vector<string>(done_.cbegin(), done_.cend()));
+    file.close();
+    if(!file) ERROR("Could not write checkpoint "+temp_path+".");
+  }
+  if(rename(temp_path.c_str(), path_.c_str()) != 0){
+    ERROR("Could not move checkpoint to "+path_+".");
+  }
+}
+
+/*!\brief Deletes the checkpoint, e.g. once all units are done
+ */
+void Checkpoint::Remove(){
+  if(FileExists(path_)) remove(path_.c_str());
+}
+
+/*!\brief Check if the interval since the last save has passed
+
+  \return True if a save is due
+*/
+bool Checkpoint::Due() const{
+  return enabled_ && Clock::now()-last_save_ >= interval_;
+}
+
+/*!\brief Check if a unit is included in the restored state
+
+  \param[in] unit Name of unit from UnitName()
+
+  \return True if the unit must not be processed again
+*/
+bool Checkpoint::Done(const string &unit) const{
+  return done_.find(unit) != done_.end();
+}
+
+/*!\brief Records that all events of a unit have been recorded
+
+  \param[in] unit Name of unit from UnitName()
+*/
+void Checkpoint::Complete(const string &unit){
+  done_.insert(unit);
+}
+
+/*!\brief Get number of completed units
+
+  \return Number of units restored or completed
+*/
+size_t Checkpoint::NumDone() const{
+  return done_.size();
+}
+
+/*!\brief Get the hash identifying the configuration
+
+  \return Key written to and expected in the checkpoint
+*/
+uint64_t Checkpoint::Key() const{
+  return key_;
+}
+
+/*!\brief Get the name identifying a Baby as a unit of work
+
+  \param[in] baby Baby whose events form the unit
+
+  \return Baby type and files read
+*/
+string Checkpoint::UnitName(const Baby &baby){
+  string name = string("baby:")+typeid(baby).name();
+  for(const auto &file: baby.FileNames()){
+    name += ':'+file;
+  }
+  return name;
+}
+
+/*!\brief Get the name identifying a replayed EventCache process as a unit of
+  work
+
+  \param[in] replayed Process from EventCache::Replayed()
+
+  \return Name of process
+*/
+string Checkpoint::UnitName(const Process &replayed){
+  return "cache:"+replayed.name_;
+}
+
+/*!\brief Writes the length of a string followed by its characters
+
+  \param[in,out] out Stream to write to
+
+  \param[in] value String to write
+*/
+void Checkpoint::Write(ostream &out, const string &value){
+  Write(out, static_cast<uint64_t>(value.size()));
+  out.write(value.data(), value.size());
+}
+
+/*!\brief Writes the exact state of a sum
+
+  \param[in,out] out Stream to write to
+
+  \param[in] value Sum to write
+*/
+void Checkpoint::Write(ostream &out, const ExactSum &value){
+  value.SaveState(out);
+}
+
+/*!\brief Writes bin contents, squared weights and statistics of a histogram
+
+  \param[in,out] out Stream to write to
+
+  \param[in] hist Histogram to write
+*/
+void Checkpoint::WriteHist(ostream &out, const TH1 &hist){
+  int32_t num_cells = hist.GetNcells();
+  Write(out, num_cells);
+  for(int32_t cell = 0; cell < num_cells; ++cell){
+    Write(out, hist.GetBinContent(cell));
+  }
+  uint8_t have_sumw2 = hist.GetSumw2N() > 0;
+  Write(out, have_sumw2);
+  if(have_sumw2){
+    const double *sumw2 = hist.GetSumw2()->GetArray();
+    for(int32_t cell = 0; cell < num_cells; ++cell){
+      Write(out, sumw2[cell]);
+    }
+  }
+  double stats[13] = {};
+  hist.GetStats(stats);
+  Write(out, stats);
+  Write(out, hist.GetEntries());
+}
+
+/*!\brief Reads a string written by Write()
+
+  \param[in,out] in Stream to read from
+
+  \param[out] value String read
+*/
+void Checkpoint::Read(istream &in, string &value){
+  uint64_t size = 0;
+  Read(in, size);
+  if(!in) return;
+  value.resize(size);
+  in.read(&value[0], size);
+}
+
+/*!\brief Reads a sum written by Write()
+
+  \param[in,out] in Stream to read from
+
+  \param[out] value Sum read
+*/
+void Checkpoint::Read(istream &in, ExactSum &value){
+  value.LoadState(in);
+}
+
+/*!\brief Reads a histogram written by WriteHist() into one with the same
+  binning
+
+  \param[in,out] in Stream to read from
+
+  \param[in,out] hist Histogram whose contents and statistics are replaced
+*/
+void Checkpoint::ReadHist(istream &in, TH1 &hist){
+  int32_t num_cells = 0;
+  Read(in, num_cells);
+  if(!in) return;
+  if(num_cells != hist.GetNcells()){
+    ERROR("Checkpoint has "+to_string(num_cells)+" bins for a histogram with "
+          +to_string(hist.GetNcells())+".");
+  }
+  for(int32_t cell = 0; cell < num_cells; ++cell){
+    double content = 0.;
+    Read(in, content);
+    hist.SetBinContent(cell, content);
+  }
+  uint8_t have_sumw2 = 0;
+  Read(in, have_sumw2);
+  if(have_sumw2){
+    if(hist.GetSumw2N() == 0) hist.Sumw2(true);
+    double *sumw2 = hist.GetSumw2()->GetArray();
+    for(int32_t cell = 0; cell < num_cells; ++cell){
+      Read(in, sumw2[cell]);
+    }
+  }
+  double stats[13] = {};
+  Read(in, stats);
+  hist.PutStats(stats);
+  double entries = 0.;
+  Read(in, entries);
+  hist.SetEntries(entries);
+}
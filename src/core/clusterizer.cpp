@@ -1,12 +1,15 @@
 #include "core/clusterizer.hpp"
 
 #include <cmath>
+#include <cstring>
 
 #include <tuple>
 #include <array>
 #include <random>
+#include <algorithm>
 
 #include "core/utilities.hpp"
+#include "core/checkpoint.hpp"
 
 using namespace std;
 using namespace Clustering;
@@ -22,6 +25,24 @@ namespace{
     seed_seq ss(begin(sd), end(sd));
     return mt19937_64(ss);
   }
+
+  uint64_t SplitMix(uint64_t x){
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  uint64_t Bits(float x){
+    uint32_t bits = 0;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+  }
+
+  //Maps 53 random bits to the open interval (0, 1)
+  double ToUnit(uint64_t x){
+    return ldexp(static_cast<double>(x >> 11) + 0.5, -53);
+  }
 }
 
 Point::Point(float x, float y, float w):
@@ -58,6 +79,241 @@ bool Node::operator<(const Node &other) const{
   return make_tuple(x_, y_, w_, dist_to_neighbor_)<make_tuple(other.x_, other.y_, other.w_, other.dist_to_neighbor_);
 }
 
+/*! \class Clustering::Reservoir
+
+  \brief Fixed-capacity weighted random sample of points
+
+  Points are kept with the A-Res scheme of Efraimidis and Spirakis: each
+  point of weight w gets a key u<sup>1/w</sup> with u uniform in (0,1), and
+  the points with the largest keys are kept. Keys are stored as log(u)/w to
+  avoid underflow. Once the reservoir is full, A-ExpJ exponential jumps skip
+  over the points that would not enter it, so only points that do enter
+  consume random numbers.
+
+  Since the keys are independent of each other, the union of two reservoirs
+  truncated to the largest keys is a valid sample of the union of their
+  inputs, so reservoirs filled in separate threads are merged exactly. In
+  reproducible mode, keys are hashed from the point, an identifier of its
+  event and its position within the event instead of drawn, so the sample
+  does not depend on the order in which points arrive or on how they were
+  split between reservoirs. The event identifier keeps identical points, as
+  are common for integer-valued axes, from being kept or dropped together.
+
+  Sample() weights each kept point by the inverse of its inclusion
+  probability given the smallest kept key, rescaled so the sample carries
+  the full positive weight offered. Points with non-positive weight are not
+  sampled.
+*/
+
+/*!\brief Constructs an empty reservoir
+
+  \param[in] capacity Maximum number of kept points. Negative for no limit.
+
+  \param[in] seed Seed of the random keys
+*/
+Reservoir::Reservoir(long capacity, uint64_t seed):
+  heap_(),
+  capacity_(capacity),
+  num_seen_(0),
+  total_weight_(0.),
+  skip_(0.),
+  reproducible_(false),
+  prng_(seed){
+}
+
+/*!\brief Offers a point to the sample
+
+  \param[in] p Point to offer
+
+  \param[in] event_tag Identifier of the event the point comes from, hashed
+  into its key in reproducible mode
+
+  \param[in] index Position of the point within its event
+*/
+void Reservoir::Add(const Point &p, uint64_t event_tag, uint64_t index){
+  if(!(p.w_ > 0.f)) return;
+  ++num_seen_;
+  total_weight_ += p.w_;
+  if(!Full()){
+    Push(log(reproducible_ ? HashUniform(p, event_tag, index) : Uniform())/p.w_, p);
+    if(Full()) DrawSkip();
+    return;
+  }
+  if(heap_.empty()) return;
+
+  if(reproducible_){
+    double key = log(HashUniform(p, event_tag, index))/p.w_;
+    if(key > heap_.front().key_) Replace(key, p);
+    return;
+  }
+
+  skip_ -= p.w_;
+  if(skip_ > 0.) return;
+  //Draw the key conditioned on exceeding the smallest kept key
+  double t_w = exp(heap_.front().key_*p.w_);
+  double r = t_w + (1.-t_w)*Uniform();
+  Replace(log(r)/p.w_, p);
+  DrawSkip();
+}
+
+/*!\brief Adds the points sampled by another reservoir
+
+  \param[in] other Reservoir filled from a disjoint set of points
+*/
+void Reservoir::Merge(const Reservoir &other){
+  num_seen_ += other.num_seen_;
+  total_weight_ += other.total_weight_;
+  for(const auto &entry: other.heap_){
+    if(!Full()){
+      Push(entry.key_, entry.point_);
+    }else if(!heap_.empty() && entry.key_ > heap_.front().key_){
+      Replace(entry.key_, entry.point_);
+    }
+  }
+  if(Full()) DrawSkip();
+}
+
+/*!\brief Removes all points
+
+  \param[in] seed New seed of the random keys
+*/
+void Reservoir::Clear(uint64_t seed){
+  vector<Entry>().swap(heap_);
+  num_seen_ = 0;
+  total_weight_ = 0.;
+  skip_ = 0.;
+  prng_.seed(seed);
+}
+
+/*!\brief Get the sampled points
+
+  \return All offered points if none was dropped, otherwise the kept points
+  with weights estimating the offered weight they stand for
+*/
+vector<Point> Reservoir::Sample() const{
+  vector<Point> points(heap_.size());
+  for(size_t i = 0; i < heap_.size(); ++i){
+    points.at(i) = heap_.at(i).point_;
+  }
+  if(static_cast<long>(heap_.size()) == num_seen_ || heap_.empty()) return points;
+
+  double threshold = heap_.front().key_;
+  double sumw = 0.;
+  for(auto &p: points){
+    p.w_ = p.w_/(-expm1(threshold*p.w_));
+    sumw += p.w_;
+  }
+  double scale = total_weight_/sumw;
+  for(auto &p: points){
+    p.w_ *= scale;
+  }
+  return points;
+}
+
+/*!\brief Get the maximum number of kept points
+
+  \return Capacity, negative for no limit
+*/
+long Reservoir::Capacity() const{
+  return capacity_;
+}
+
+/*!\brief Sets the maximum number of kept points
+
+  Points with the smallest keys are dropped if more are already kept.
+
+  \param[in] capacity New capacity, negative for no limit
+*/
+void Reservoir::Capacity(long capacity){
+  capacity_ = capacity;
+  if(capacity_ < 0) return;
+  while(heap_.size() > static_cast<size_t>(capacity_)){
+    pop_heap(heap_.begin(), heap_.end(), KeyGreater);
+    heap_.pop_back();
+  }
+  if(Full()) DrawSkip();
+}
+
+/*!\brief Selects hashed keys, which make the sample independent of the order
+  of the points
+
+  \param[in] reproducible If true, hash keys from the points
+*/
+void Reservoir::Reproducible(bool reproducible){
+  reproducible_ = reproducible;
+}
+
+/*!\brief Get memory used by kept points
+
+  \return Number of bytes beyond sizeof(Reservoir)
+*/
+size_t Reservoir::MemoryUsage() const{
+  return heap_.capacity()*sizeof(Entry);
+}
+
+/*!\brief Get memory used by each kept point
+
+  \return Number of bytes per point, including its key
+*/
+size_t Reservoir::BytesPerPoint(){
+  return sizeof(Entry);
+}
+
+/*!\brief Writes the kept points with their keys and the offered totals
+
+  \param[in,out] out Stream to write to
+*/
+void Reservoir::SaveState(ostream &out) const{
+  Checkpoint::Write(out, heap_);
+  Checkpoint::Write(out, num_seen_);
+  Checkpoint::Write(out, total_weight_);
+}
+
+/*!\brief Replaces the sample with one written by SaveState()
+
+  The capacity is kept, and the saved points are truncated to it.
+
+  \param[in,out] in Stream to read from
+*/
+void Reservoir::LoadState(istream &in){
+  Checkpoint::Read(in, heap_);
+  Checkpoint::Read(in, num_seen_);
+  Checkpoint::Read(in, total_weight_);
+  Capacity(capacity_);
+}
+
+bool Reservoir::KeyGreater(const Entry &a, const Entry &b){
+  return a.key_ > b.key_;
+}
+
+double Reservoir::Uniform(){
+  return ToUnit(prng_());
+}
+
+double Reservoir::HashUniform(const Point &p, uint64_t event_tag, uint64_t index) const{
+  uint64_t point = SplitMix(Bits(p.x_) ^ SplitMix(Bits(p.y_) ^ SplitMix(Bits(p.w_))));
+  return ToUnit(SplitMix(point ^ SplitMix(event_tag ^ SplitMix(index))));
+}
+
+void Reservoir::Push(double key, const Point &p){
+  heap_.push_back(Entry{key, p});
+  push_heap(heap_.begin(), heap_.end(), KeyGreater);
+}
+
+void Reservoir::Replace(double key, const Point &p){
+  pop_heap(heap_.begin(), heap_.end(), KeyGreater);
+  heap_.back() = Entry{key, p};
+  push_heap(heap_.begin(), heap_.end(), KeyGreater);
+}
+
+void Reservoir::DrawSkip(){
+  skip_ = heap_.empty() ? 0. : log(Uniform())/heap_.front().key_;
+}
+
+bool Reservoir::Full() const{
+  return capacity_ >= 0 && heap_.size() >= static_cast<size_t>(capacity_);
+}
+
 mt19937_64 Clusterizer::prng_ = InitializePRNG();
 uniform_real_distribution<float> Clusterizer::urd_(0., 1.);
 
@@ -65,46 +321,80 @@ Clusterizer::Clusterizer(const TH2D &hist_template, long max_points):
   max_points_(max_points),
   hist_mode_(max_points == 0),
   hist_(hist_template),
-  orig_points_(),
+  reservoir_(max_points),
   nodes_(),
   final_points_(),
   clustered_lumi_(-1.){
   if(max_points_ >= 0 && max_points_ < hist_.GetNcells()){
     max_points_ = hist_.GetNcells();
   }
+  reservoir_.Capacity(max_points_);
 }
 
-void Clusterizer::AddPoint(float x, float y, float w){
+/*!\brief Adds a point to the histogram and offers it to the sample
+
+  \param[in] x Horizontal coordinate
+
+  \param[in] y Vertical coordinate
+
+  \param[in] w Weight
+
+  \param[in] event_tag Identifier of the event the point comes from, used in
+  reproducible mode
+
+  \param[in] index Position of the point within its event
+*/
+void Clusterizer::AddPoint(float x, float y, float w,
+                           uint64_t event_tag, uint64_t index){
   clustered_lumi_ = -1.;
-  if(orig_points_.size() >= static_cast<size_t>(max_points_)
-     && max_points_ >= 0){
-    hist_mode_ = true;
-    orig_points_.clear();
-  }
   hist_.Fill(x, y, w);
   if(!hist_mode_){
-    orig_points_.emplace_back(x, y, w);
+    reservoir_.Add(Point(x, y, w), event_tag, index);
   }
 }
 
-void Clusterizer::SetPoints(const vector<Point> &points){
+/*!\brief Adds the histogram and sampled points of another clusterizer
+
+  \param[in] other Clusterizer with the same binning, filled from other
+  points, e.g. in another thread
+*/
+void Clusterizer::Merge(const Clusterizer &other){
   clustered_lumi_ = -1.;
-  EmptyHistogram();
-  if(points.size() > static_cast<size_t>(max_points_) && max_points_ >= 0){
-    hist_mode_ = true;
-    orig_points_.clear();
+  hist_.Add(&other.hist_);
+  hist_mode_ = hist_mode_ || other.hist_mode_;
+  if(hist_mode_){
+    reservoir_.Clear();
   }else{
-    hist_mode_ = false;
-    orig_points_ = points;
+    reservoir_.Merge(other.reservoir_);
   }
+}
+
+/*!\brief Empties the histogram and sampled points
+
+  \param[in] seed New seed of the random keys used for sampling
+*/
+void Clusterizer::Clear(uint64_t seed){
+  clustered_lumi_ = -1.;
+  EmptyHistogram();
+  reservoir_.Clear(seed);
+  nodes_.clear();
+  vector<Point>().swap(final_points_);
+}
+
+void Clusterizer::SetPoints(const vector<Point> &points){
+  clustered_lumi_ = -1.;
+  EmptyHistogram();
+  reservoir_.Clear();
   for(const auto &p: points){
     hist_.Fill(p.x_, p.y_, p.w_);
+    if(!hist_mode_) reservoir_.Add(p);
   }
 }
 
 void Clusterizer::SetPoints(const TH2D &h){
   clustered_lumi_ = -1.;
   EmptyHistogram();
+  reservoir_.Clear();
   hist_mode_ = true;
   hist_ = h;
   if(max_points_ >= 0 && max_points_ < hist_.GetNcells()){
@@ -112,6 +402,73 @@ void Clusterizer::SetPoints(const TH2D &h){
   }
 }
 
+/*!\brief Get the maximum number of sampled points
+
+  \return Maximum number of points. Negative for no limit, 0 if points are
+  spread within the histogram bins.
+*/
+long Clusterizer::MaxPoints() const{
+  return hist_mode_ ? 0 : max_points_;
+}
+
+/*!\brief Sets the maximum number of sampled points
+
+  \param[in] max_points Maximum number of points. Negative for no limit, 0 to
+  draw points spread within the histogram bins instead of sampling them.
+*/
+void Clusterizer::MaxPoints(long max_points){
+  max_points_ = max_points;
+  hist_mode_ = max_points_ == 0;
+  if(max_points_ >= 0 && max_points_ < hist_.GetNcells()){
+    max_points_ = hist_.GetNcells();
+  }
+  clustered_lumi_ = -1.;
+  if(hist_mode_){
+    reservoir_.Clear();
+  }
+  reservoir_.Capacity(max_points_);
+}
+
+/*!\brief Makes the sampled points independent of the order of AddPoint calls
+
+  \param[in] reproducible If true, sample with keys hashed from the points
+*/
+void Clusterizer::Reproducible(bool reproducible){
+  reservoir_.Reproducible(reproducible);
+}
+
+size_t Clusterizer::MemoryUsage() const{
+  return sizeof(*this)
+    + hist_.GetNcells()*sizeof(double)*(hist_.GetSumw2N() ? 2 : 1)
+    + reservoir_.MemoryUsage()
+    + final_points_.capacity()*sizeof(Point)
+    + nodes_.size()*(sizeof(Node)+2*sizeof(void*));
+}
+
+/*!\brief Writes the histogram and sampled points
+
+  \param[in,out] out Stream to write to
+*/
+void Clusterizer::SaveState(ostream &out) const{
+  Checkpoint::WriteHist(out, hist_);
+  Checkpoint::Write(out, static_cast<uint8_t>(hist_mode_));
+  reservoir_.SaveState(out);
+}
+
+/*!\brief Replaces the histogram and sampled points with a state written by
+  SaveState()
+
+  \param[in,out] in Stream to read from
+*/
+void Clusterizer::LoadState(istream &in){
+  clustered_lumi_ = -1.;
+  uint8_t hist_mode = 0;
+  Checkpoint::ReadHist(in, hist_);
+  Checkpoint::Read(in, hist_mode);
+  reservoir_.LoadState(in);
+  hist_mode_ = hist_mode;
+}
+
 TH2D Clusterizer::GetHistogram(double luminosity) const{
   TH2D h = hist_;
   h.Scale(luminosity);
@@ -318,7 +675,7 @@ void Clusterizer::SetupNodes(double luminosity) const{
       }
     }
   }else{
-    for(const auto &p: orig_points_){
+    for(const auto &p: reservoir_.Sample()){
       float w = luminosity * p.w_;
       if(w <= 0.) continue;
       if(w == 1.){
@@ -0,0 +1,477 @@
+/*! \class ColumnCache
+
+  \brief Memory-mapped columnar copies of baby ntuples
+
+  Reading a baby through ROOT decompresses and streams every basket on each
+  pass, even if the same files are analyzed many times from local disk.
+  ColumnCache::Convert() instead stores the selected branches of a file
+  uncompressed as one contiguous array per branch: fixed-width arrays for
+  scalar branches, and an array of offsets plus an array of values for vector
+  branches. The resulting file is memory-mapped when read, so scalar values are
+  accessed in place with no copy and vector values with a single copy into the
+  vector returned by the Baby accessor.
+
+  Caches live in ColumnCache::Directory(), which defaults to the
+  BABY_COLUMN_CACHE environment variable, and are named from the source file's
+  name and full path. Each cache records the size and modification time of its
+  source, so a cache is silently ignored once the source changes. When a Baby
+  is activated, it calls ColumnCache::Open() for its files. If every file has a
+  valid cache, all variables present in the cache are read from the mapped
+  columns. Variables missing from the cache are still read from the TChain.
+*/
+
+/*! \class ColumnCache::File
+
+  \brief A single memory-mapped cache file
+*/
+#include "core/column_cache.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <climits>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const char cache_magic[4] = {'B', 'C', 'O', 'L'};
+  const uint32_t cache_version = 1;
+
+  bool SourceStat(const string &path, uint64_t &size, int64_t &mtime){
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) return false;
+    size = info.st_size;
+    mtime = info.st_mtime;
+    return true;
+  }
+
+  template<typename T>
+  bool ReadValue(const char *&pos, const char *end, T &value){
+    if(static_cast<size_t>(end-pos) < sizeof(T)) return false;
+    memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+
+  template<typename T>
+  void WriteValue(ofstream &file, const T &value){
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void Pad(ofstream &file){
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    long pos = file.tellp();
+    if(pos%8 != 0) file.write(zeros, 8-pos%8);
+  }
+
+  struct ColumnInfo{
+    string name_;
+    ColumnCache::Type type_;
+    bool is_vector_;
+    uint64_t offsets_pos_;
+    uint64_t values_pos_;
+    uint64_t num_values_;
+  };
+
+  bool ParseType(string type_name, ColumnCache::Type &type, bool &is_vector){
+    is_vector = false;
+    ReplaceAll(type_name, "std::", "");
+    if(StartsWith(type_name, "vector<")){
+      is_vector = true;
+      type_name = type_name.substr(7, type_name.rfind('>')-7);
+    }
+    type_name = Strip(type_name);
+    if(type_name == "bool" || type_name == "Bool_t") type = ColumnCache::Type::kBool;
+    else if(type_name == "int" || type_name == "Int_t") type = ColumnCache::Type::kInt;
+    else if(type_name == "Long64_t" || type_name == "long long") type = ColumnCache::Type::kLong;
+    else if(type_name == "float" || type_name == "Float_t") type = ColumnCache::Type::kFloat;
+    else if(type_name == "double" || type_name == "Double_t") type = ColumnCache::Type::kDouble;
+    else return false;
+    return true;
+  }
+
+  template<typename T>
+  void ReadColumn(TTree &tree, const string &name, bool is_vector,
+                  vector<uint64_t> &offsets, vector<char> &values){
+    long num_entries = tree.GetEntries();
+    TBranch *branch = nullptr;
+    if(is_vector){
+      vector<T> *vec = nullptr;
+      tree.SetBranchAddress(name.c_str(), &vec, &branch);
+      offsets.assign(1, 0);
+      for(long entry = 0; entry < num_entries; ++entry){
+        branch->GetEntry(entry);
+        for(size_t i = 0; vec != nullptr && i < vec->size(); ++i){
+          T value = vec->at(i);
+          const char *bytes = reinterpret_cast<const char*>(&value);
+          values.insert(values.end(), bytes, bytes+sizeof(T));
+        }
+        offsets.push_back(values.size()/sizeof(T));
+      }
+      tree.ResetBranchAddresses();
+      delete vec;
+    }else{
+      T value = T();
+      tree.SetBranchAddress(name.c_str(), &value, &branch);
+      values.reserve(num_entries*sizeof(T));
+      for(long entry = 0; entry < num_entries; ++entry){
+        branch->GetEntry(entry);
+        const char *bytes = reinterpret_cast<const char*>(&value);
+        values.insert(values.end(), bytes, bytes+sizeof(T));
+      }
+      tree.ResetBranchAddresses();
+    }
+  }
+}
+
+string ColumnCache::directory_ = getenv("BABY_COLUMN_CACHE") == nullptr ? "" : getenv("BABY_COLUMN_CACHE");
+
+/*!\brief Maps a cache file into memory and reads its column table
+
+  \param[in] path Path to cache file
+*/
+ColumnCache::File::File(const string &path):
+  map_(nullptr),
+  size_(0),
+  num_entries_(0),
+  source_size_(0),
+  source_mtime_(0),
+  columns_(){
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return;
+  struct stat info;
+  if(fstat(fd, &info) == 0 && info.st_size > 0){
+    size_ = info.st_size;
+    map_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if(map_ == MAP_FAILED) map_ = nullptr;
+  }
+  close(fd);
+  if(map_ == nullptr) return;
+
+  const char *begin = static_cast<const char*>(map_);
+  const char *end = begin+size_;
+  const char *pos = begin;
+  char magic[4];
+  uint32_t version;
+  uint64_t num_entries, num_columns;
+  if(!ReadValue(pos, end, magic) || memcmp(magic, cache_magic, sizeof(magic)) != 0
+     || !ReadValue(pos, end, version) || version != cache_version
+     || !ReadValue(pos, end, num_entries)
+     || !ReadValue(pos, end, source_size_)
+     || !ReadValue(pos, end, source_mtime_)
+     || !ReadValue(pos, end, num_columns)){
+    columns_.clear();
+    return;
+  }
+  num_entries_ = num_entries;
+
+  for(uint64_t icol = 0; icol < num_columns; ++icol){
+    uint32_t name_size, type, is_vector;
+    uint64_t offsets_pos, values_pos, num_values;
+    if(!ReadValue(pos, end, name_size) || static_cast<size_t>(end-pos) < name_size){
+      columns_.clear();
+      return;
+    }
+    string name(pos, name_size);
+    pos += name_size;
+    if(!ReadValue(pos, end, type) || !ReadValue(pos, end, is_vector)
+       || !ReadValue(pos, end, offsets_pos) || !ReadValue(pos, end, values_pos)
+       || !ReadValue(pos, end, num_values)
+       || type > static_cast<uint32_t>(Type::kDouble)){
+      columns_.clear();
+      return;
+    }
+    Column column;
+    column.type_ = static_cast<Type>(type);
+    column.is_vector_ = is_vector != 0;
+    column.offsets_ = column.is_vector_ ? reinterpret_cast<const uint64_t*>(begin+offsets_pos) : nullptr;
+    column.values_ = begin+values_pos;
+    if(values_pos+num_values*TypeSize(column.type_) > size_
+       || (column.is_vector_ && offsets_pos+(num_entries+1)*sizeof(uint64_t) > size_)){
+      columns_.clear();
+      return;
+    }
+    columns_[name] = column;
+  }
+}
+
+/*!\brief Unmaps file
+ */
+ColumnCache::File::~File(){
+  if(map_ != nullptr) munmap(map_, size_);
+}
+
+/*!\brief Check if file was mapped and read successfully
+
+  \return True if columns are available
+*/
+bool ColumnCache::File::Valid() const{
+  return map_ != nullptr && !columns_.empty();
+}
+
+/*!\brief Check if cache was made from the current version of a file
+
+  \param[in] source_path Path to ROOT file
+
+  \return True if size and modification time match those recorded in cache
+*/
+bool ColumnCache::File::Matches(const string &source_path) const{
+  uint64_t size;
+  int64_t mtime;
+  if(!SourceStat(source_path, size, mtime)) return false;
+  return size == source_size_ && mtime == source_mtime_;
+}
+
+/*!\brief Get number of entries
+
+  \return Number of entries in each column
+*/
+long ColumnCache::File::NumEntries() const{
+  return num_entries_;
+}
+
+/*!\brief Get column by branch name
+
+  \param[in] name Branch name
+
+  \return Pointer to column, or nullptr if not in cache
+*/
+const ColumnCache::Column * ColumnCache::File::Find(const string &name) const{
+  auto loc = columns_.find(name);
+  return loc == columns_.cend() ? nullptr : &loc->second;
+}
+
+/*!\brief Open caches for all files in a chain
+
+  \param[in] file_names ROOT files in the order in which they are added to the
+  chain
+
+  \return Cache for the whole chain, or nullptr if caching is disabled or any
+  file lacks an up to date cache
+*/
+unique_ptr<ColumnCache> ColumnCache::Open(const set<string> &file_names){
+  if(directory_ == "" || file_names.empty()) return nullptr;
+  unique_ptr<ColumnCache> cache(new ColumnCache());
+  long num_entries = 0;
+  for(const auto &file_name: file_names){
+    string path = CachePath(file_name);
+    if(!FileExists(path)) return nullptr;
+    unique_ptr<File> file(new File(path));
+    if(!file->Valid() || !file->Matches(file_name)) return nullptr;
+    cache->file_starts_.push_back(num_entries);
+    num_entries += file->NumEntries();
+    cache->files_.push_back(move(file));
+  }
+  cache->file_starts_.push_back(num_entries);
+  return cache;
+}
+
+/*!\brief Get directory containing cache files
+
+  \return Cache directory. Empty if caching is disabled.
+*/
+const string & ColumnCache::Directory(){
+  return directory_;
+}
+
+/*!\brief Set directory containing cache files
+
+  Defaults to the BABY_COLUMN_CACHE environment variable.
+
+  \param[in] dir Cache directory. Empty to disable caching.
+*/
+void ColumnCache::Directory(const string &dir){
+  directory_ = dir;
+}
+
+/*!\brief Get path of cache for a ROOT file
+
+  The name combines the file's base name with a hash of its absolute path, so
+  files with the same name in different directories get distinct caches.
+
+  \param[in] source_path Path to ROOT file
+
+  \return Path of cache file in Directory()
+*/
+string ColumnCache::CachePath(const string &source_path){
+  char resolved[PATH_MAX];
+  string full_path = realpath(source_path.c_str(), resolved) == nullptr ? source_path : resolved;
+  ostringstream oss;
+  oss << directory_ << '/' << ChangeExtension(Basename(source_path), "") << '_'
+      << hex << setw(16) << setfill('0') << hash<string>()(full_path) << ".cols";
+  return oss.str();
+}
+
+/*!\brief Get size of one value of a given type
+
+  \param[in] type Column type
+
+  \return Size in bytes
+*/
+size_t ColumnCache::TypeSize(Type type){
+  switch(type){
+  case Type::kBool: return sizeof(bool);
+  case Type::kInt: return sizeof(int);
+  case Type::kLong: return sizeof(long long);
+  case Type::kFloat: return sizeof(float);
+  case Type::kDouble: return sizeof(double);
+  default: ERROR("Unknown column type "+to_string(static_cast<uint32_t>(type)));
+  }
+}
+
+/*!\brief Write cache for a ROOT file
+
+  \param[in] source_path Path to ROOT file containing a TTree named "tree"
+
+  \param[in] branches Branches to store. If empty, all branches of supported
+  types (bool, int, Long64_t, float, double, and vectors thereof) are stored.
+
+  \return Path to written cache
+*/
+string ColumnCache::Convert(const string &source_path,
+                            const vector<string> &branches){
+  if(directory_ == "") ERROR("No cache directory set");
+  uint64_t source_size;
+  int64_t source_mtime;
+  if(!SourceStat(source_path, source_size, source_mtime)) ERROR("Could not stat "+source_path);
+
+  TFile source(source_path.c_str(), "read");
+  if(!source.IsOpen() || source.IsZombie()) ERROR("Could not open "+source_path);
+  TTree *tree = nullptr;
+  source.GetObject("tree", tree);
+  if(tree == nullptr) ERROR("No tree in "+source_path);
+  tree->SetMakeClass(1);
+  long num_entries = tree->GetEntries();
+
+  vector<ColumnInfo> columns;
+  vector<string> names = branches;
+  if(names.empty()){
+    TIter next(tree->GetListOfBranches());
+    while(TBranch *branch = static_cast<TBranch*>(next())){
+      names.push_back(branch->GetName());
+    }
+  }
+  for(const auto &name: names){
+    TBranch *branch = tree->GetBranch(name.c_str());
+    if(branch == nullptr){
+      DBG("Branch " << name << " not found in " << source_path);
+      continue;
+    }
+    string type_name = branch->GetClassName();
+    if(type_name == ""){
+      TLeaf *leaf = static_cast<TLeaf*>(branch->GetListOfLeaves()->At(0));
+      if(leaf == nullptr || leaf->GetLen() != 1 || leaf->GetLeafCount() != nullptr) continue;
+      type_name = leaf->GetTypeName();
+    }
+    ColumnInfo info;
+    info.name_ = name;
+    if(!ParseType(type_name, info.type_, info.is_vector_)) continue;
+    columns.push_back(info);
+  }
+
+  string cache_path = CachePath(source_path);
+  string tmp_path = cache_path+".tmp";
+  ofstream file(tmp_path, ios::binary);
+  if(!file) ERROR("Could not open "+tmp_path+" for writing");
+
+  //Reserve space for the header, then fill it in once data positions are known
+  size_t header_size = sizeof(cache_magic)+sizeof(uint32_t)+5*sizeof(uint64_t);
+  for(const auto &column: columns){
+    header_size += sizeof(uint32_t)+column.name_.size()+2*sizeof(uint32_t)+3*sizeof(uint64_t);
+  }
+  file.write(string(header_size, '\0').data(), header_size);
+
+  tree->SetBranchStatus("*", false);
+  for(auto &column: columns){
+    tree->SetBranchStatus(column.name_.c_str(), true);
+    vector<uint64_t> offsets;
+    vector<char> values;
+    switch(column.type_){
+    case Type::kBool: ReadColumn<bool>(*tree, column.name_, column.is_vector_, offsets, values); break;
+    case Type::kInt: ReadColumn<int>(*tree, column.name_, column.is_vector_, offsets, values); break;
+    case Type::kLong: ReadColumn<long long>(*tree, column.name_, column.is_vector_, offsets, values); break;
+    case Type::kFloat: ReadColumn<float>(*tree, column.name_, column.is_vector_, offsets, values); break;
+    case Type::kDouble: ReadColumn<double>(*tree, column.name_, column.is_vector_, offsets, values); break;
+    default: ERROR("Unknown column type");
+    }
+    tree->SetBranchStatus(column.name_.c_str(), false);
+
+    column.offsets_pos_ = 0;
+    if(column.is_vector_){
+      Pad(file);
+      column.offsets_pos_ = file.tellp();
+      file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size()*sizeof(uint64_t));
+    }
+    Pad(file);
+    column.values_pos_ = file.tellp();
+    column.num_values_ = values.size()/TypeSize(column.type_);
+    file.write(values.data(), values.size());
+  }
+
+  file.seekp(0);
+  file.write(cache_magic, sizeof(cache_magic));
+  WriteValue(file, cache_version);
+  WriteValue(file, static_cast<uint64_t>(num_entries));
+  WriteValue(file, source_size);
+  WriteValue(file, source_mtime);
+  WriteValue(file, static_cast<uint64_t>(columns.size()));
+  for(const auto &column: columns){
+    WriteValue(file, static_cast<uint32_t>(column.name_.size()));
+    file.write(column.name_.data(), column.name_.size());
+    WriteValue(file, static_cast<uint32_t>(column.type_));
+    WriteValue(file, static_cast<uint32_t>(column.is_vector_));
+    WriteValue(file, column.offsets_pos_);
+    WriteValue(file, column.values_pos_);
+    WriteValue(file, column.num_values_);
+  }
+  file.close();
+  if(!file) ERROR("Failed writing "+tmp_path);
+  if(rename(tmp_path.c_str(), cache_path.c_str()) != 0) ERROR("Could not move "+tmp_path+" to "+cache_path);
+  return cache_path;
+}
+
+ColumnCache::ColumnCache():
+  files_(),
+  file_starts_(),
+  file_(0),
+  first_entry_(0),
+  last_entry_(0),
+  entry_(0){
+}
+
+bool ColumnCache::Seek(long entry){
+  auto next = upper_bound(file_starts_.cbegin(), file_starts_.cend(), entry);
+  if(entry < 0 || next == file_starts_.cbegin() || next == file_starts_.cend()){
+    ERROR("Entry "+to_string(entry)+" out of range");
+  }
+  file_ = next-file_starts_.cbegin()-1;
+  first_entry_ = *(next-1);
+  last_entry_ = *next;
+  entry_ = entry-first_entry_;
+  return true;
+}
+
+const ColumnCache::Column * ColumnCache::Find(const string &name, Type type, bool is_vector) const{
+  if(file_ >= files_.size()) return nullptr;
+  const Column *column = files_.at(file_)->Find(name);
+  if(column == nullptr || column->type_ != type || column->is_vector_ != is_vector) return nullptr;
+  return column;
+}
@@ -0,0 +1,124 @@
+// Combines event lists written by EventList (or "run lumiblock event" text
+// lists) with set operations. Each list argument is a glob pattern, and all
+// files matching one pattern, e.g. the lists of every sample, are merged before
+// the operation is applied from left to right.
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <getopt.h>
+
+#include "core/event_index.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  string output = "";
+  bool text = false;
+  string operation = "";
+  vector<string> patterns;
+}
+
+void GetOptions(int argc, char *argv[]);
+EventIndex ReadPattern(const string &pattern);
+
+int main(int argc, char *argv[]){
+  GetOptions(argc, argv);
+  if(patterns.empty()
+     || (operation != "and" && operation != "or" && operation != "not" && operation != "overlap")){
+    cout << "Usage: " << argv[0] << " [-o output] [-t] {and|or|not|overlap} list1 [list2 ...]" << endl;
+    cout << "  and:     events in every list" << endl;
+    cout << "  or:      events in any list" << endl;
+    cout << "  not:     events in the first list but none of the others" << endl;
+    cout << "  overlap: print number of events shared by each pair of lists" << endl;
+    return 1;
+  }
+
+  vector<EventIndex> indices;
+  for(const auto &pattern: patterns){
+    indices.push_back(ReadPattern(pattern));
+    cout << pattern << ": " << indices.back().Size() << " events" << endl;
+  }
+
+  if(operation == "overlap"){
+    for(size_t i = 0; i < indices.size(); ++i){
+      for(size_t j = 0; j < indices.size(); ++j){
+        cout << setw(10) << indices.at(i).Intersection(indices.at(j)).Size();
+      }
+      cout << "  " << patterns.at(i) << endl;
+    }
+    return 0;
+  }
+
+  EventIndex result = indices.front();
+  for(size_t i = 1; i < indices.size(); ++i){
+    if(operation == "and") result = result.Intersection(indices.at(i));
+    else if(operation == "or") result = result.Union(indices.at(i));
+    else result = result.Difference(indices.at(i));
+  }
+  cout << "Result: " << result.Size() << " events" << endl;
+
+  if(output != ""){
+    result.Write(output, text);
+    cout << "Wrote " << output << endl;
+  }else if(text){
+    for(const auto &key: result.Keys()){
+      cout << setw(10) << key.run_ << ' ' << setw(10) << key.lumiblock_ << ' ' << setw(12) << key.event_ << '\n';
+    }
+    cout << flush;
+  }
+}
+
+EventIndex ReadPattern(const string &pattern){
+  EventIndex index;
+  set<string> files = Glob(pattern);
+  if(files.empty()) ERROR("No event lists match "+pattern);
+  for(const auto &file: files){
+    index.Insert(EventIndex(file));
+  }
+  index.Sort();
+  return index;
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"output", required_argument, 0, 'o'},
+      {"text", no_argument, 0, 't'},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "o:t", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'o':
+      output = optarg;
+      break;
+    case 't':
+      text = true;
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      printf("Bad option! Found option name %s\n", optname.c_str());
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+  if(optind < argc) operation = argv[optind];
+  for(int argi = optind+1; argi < argc; ++argi){
+    patterns.push_back(argv[argi]);
+  }
+}
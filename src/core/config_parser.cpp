@@ -6,35 +6,53 @@
 #include <unistd.h>
 
 #include "core/utilities.hpp"
+#include "core/config_registry.hpp"
 
 using namespace std;
 
+namespace{
+  struct ParsedConfig{
+    vector<string> opt_sets_;//!<Option sets in file order
+    map<string, vector<pair<string, string> > > options_;//!<Option names and values by option set, in file order
+  };
+
+  ParsedConfig ParseConfig(istream &file){
+    ParsedConfig config;
+    string line, opt_set, opt_name, opt_value;
+    while(getline(file, line)){
+      line = Strip(line);
+
+      //Comment line
+      if(line.size()==0 || line.front() == '#') continue;
+
+      //New option set
+      if(line.front() == '[' && line.back() == ']'){
+        opt_set = Strip(line.substr(1, line.size()-2));
+        config.opt_sets_.push_back(opt_set);
+        continue;
+      }
+
+      //Option
+      auto eq_pos = line.find('=');
+      opt_name = Strip(line.substr(0, eq_pos));
+      opt_value = Strip(line.substr(eq_pos+1));
+      config.options_[opt_set].emplace_back(opt_name, opt_value);
+    }
+    return config;
+  }
+}
+
 ConfigParser::ConfigParser():
   options_(){
 }
 
 ConfigParser & ConfigParser::Load(const string &file_path,
                                   const string &option_set){
-  ifstream file(file_path.c_str());
-  string line, opt_set, opt_name, opt_value;
-  while(getline(file, line)){
-    line = Strip(line);
-
-    //Comment line
-    if(line.size()==0 || line.front() == '#') continue;
-    
-    //New option set
-    if(line.front() == '[' && line.back() == ']'){
-      opt_set = Strip(line.substr(1, line.size()-2));
-      continue;
-    }
-
-    //Option
-    if(opt_set != option_set) continue;
-    auto eq_pos = line.find('=');
-    opt_name = Strip(line.substr(0, eq_pos));
-    opt_value = Strip(line.substr(eq_pos+1));
-    options_[opt_name] = opt_value;
+  auto config = ConfigRegistry::Get<ParsedConfig>(file_path, "config_parser", ParseConfig);
+  auto options = config->options_.find(option_set);
+  if(options == config->options_.cend()) return *this;
+  for(const auto &option: options->second){
+    options_[option.first] = option.second;
   }
   return *this;
 }
@@ -78,6 +96,7 @@ void ConfigParser::Save(const string &file_path,
     ofstream out_file(file_path.c_str());
     WriteToStream(out_file, option_set);
   }
+  ConfigRegistry::Invalidate(file_path);
 }
 
 bool ConfigParser::HaveOpt(const std::string &option) const{
@@ -85,21 +104,7 @@ bool ConfigParser::HaveOpt(const std::string &option) const{
 }
 
 vector<string> ConfigParser::GetOptSets(const string &file_path){
-  ifstream file(file_path.c_str());
-  string line;
-  vector<string> opt_sets;
-  while(getline(file, line)){
-    line = Strip(line);
-
-    //Comment line
-    if(line.size()==0 || line.front()=='#') continue;
-
-    //Option set
-    if(line.front() == '[' && line.back() == ']'){
-      opt_sets.push_back(Strip(line.substr(1, line.size()-2)));
-    }
-  }
-  return opt_sets;
+  return ConfigRegistry::Get<ParsedConfig>(file_path, "config_parser", ParseConfig)->opt_sets_;
 }
 
 const map<string, string> & ConfigParser::Options() const{
@@ -0,0 +1,102 @@
+/*! \class ConfigRegistry
+
+  \brief Process-wide cache of parsed text configuration files
+
+  Palette, PlotOpt and ConfigParser used to reopen and reparse their files on
+  every lookup, which adds up when thousands of colors, styles or weights are
+  requested during setup. They now get the parsed contents from this registry,
+  which parses each file once per format and reuses the result until the
+  file's size or modification time changes.
+*/
+#include "core/config_registry.hpp"
+
+#include <fstream>
+
+#include <sys/stat.h>
+
+#include "core/setup_profiler.hpp"
+
+using namespace std;
+
+/*!\brief Lock protecting the registry
+
+  Function-local so that PlotOpt and Palette objects at namespace scope in
+  other translation units can use the registry during static initialization.
+
+  \return Mutex protecting Entries()
+*/
+mutex & ConfigRegistry::Mutex(){
+  static mutex registry_mutex;
+  return registry_mutex;
+}
+
+/*!\brief Parsed contents by path and format
+
+  \return Map from (path, format) to parsed contents
+*/
+map<pair<string, string>, ConfigRegistry::Entry> & ConfigRegistry::Entries(){
+  static map<pair<string, string>, Entry> entries;
+  return entries;
+}
+
+/*!\brief Forgets parsed contents of a file, e.g. after writing it
+
+  \param[in] path Path to file
+*/
+void ConfigRegistry::Invalidate(const string &path){
+  lock_guard<mutex> lock(Mutex());
+  auto &entries = Entries();
+  for(auto entry = entries.begin(); entry != entries.end(); ){
+    if(entry->first.first == path){
+      entry = entries.erase(entry);
+    }else{
+      ++entry;
+    }
+  }
+}
+
+/*!\brief Forgets parsed contents of all files
+ */
+void ConfigRegistry::Clear(){
+  lock_guard<mutex> lock(Mutex());
+  Entries().clear();
+}
+
+/*!\brief Get parsed contents of a file, parsing it if needed
+
+  \param[in] path Path to file
+
+  \param[in] format Name distinguishing parsers of the same file
+
+  \param[in] parse Type-erased parser
+
+  \return Parsed contents
+*/
+shared_ptr<const void> ConfigRegistry::Lookup(const string &path,
+                                              const string &format,
+                                              const function<Parser> &parse){
+  struct stat info;
+  Entry current{0, 0, -1, nullptr};
+  if(stat(path.c_str(), &info) == 0){
+    current.mtime_ = info.st_mtim.tv_sec;
+    current.mtime_nsec_ = info.st_mtim.tv_nsec;
+    current.size_ = info.st_size;
+  }
+
+  lock_guard<mutex> lock(Mutex());
+  auto &entries = Entries();
+  auto key = make_pair(path, format);
+  auto entry = entries.find(key);
+  if(entry != entries.end()
+     && entry->second.mtime_ == current.mtime_
+     && entry->second.mtime_nsec_ == current.mtime_nsec_
+     && entry->second.size_ == current.size_){
+    return entry->second.parsed_;
+  }
+
+  SetupProfiler::Scope scope("config");
+  ifstream file(path);
+  current.parsed_ = parse(file);
+  entries[key] = current;
+  return current.parsed_;
+}
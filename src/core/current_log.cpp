@@ -0,0 +1,612 @@
+/*! \class CurrentLog
+
+  \brief Loads Maraton current logs into per-channel time series
+
+  The logs are CSV files with one reading per line in the format
+
+  CHANGE_DATE,MARATON_ID,CHANNEL,CURRENT
+  13-AUG-17 12.06.22.695000000 AM,19,7,46.0399971008301
+
+  Each file is read into memory in one go and split into chunks at line
+  boundaries, which are parsed in parallel with a ThreadPool. Timestamps are
+  converted to hours since the Unix epoch while parsing, reusing the day offset
+  as long as consecutive lines share the same date. The readings are then
+  collected into contiguous (time, value) columns for each (Maraton, channel)
+  pair, with a hash index for direct channel lookup.
+
+  If a cache directory is set, the columns parsed from each file are stored
+  there in a binary format, tagged with the size and modification time of the
+  source, and are read back instead of reparsing on later loads.
+
+  For plotting, CurrentLog::Channel::Window() finds the readings in a time
+  interval by binary search, and CurrentLog::Channel::Downsample() reduces them
+  to the minimum and maximum reading per time bin, preserving the visible
+  envelope of the curve with a bounded number of points.
+*/
+#include "core/current_log.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "core/thread_pool.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const char cache_magic[4] = {'C', 'L', 'O', 'G'};
+  const uint32_t cache_version = 1;
+  const size_t min_chunk_size = 1 << 20;
+  const char * const month_names[12] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                        "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+
+  //Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+  long DaysFromCivil(long year, long month, long day){
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year-399)/400;
+    long yoe = year-era*400;
+    long doy = (153*(month+(month > 2 ? -3 : 9))+2)/5+day-1;
+    long doe = yoe*365+yoe/4-yoe/100+doy;
+    return era*146097+doe-719468;
+  }
+
+  //Inverse of DaysFromCivil
+  void CivilFromDays(long days, long &year, long &month, long &day){
+    days += 719468;
+    long era = (days >= 0 ? days : days-146096)/146097;
+    long doe = days-era*146097;
+    long yoe = (doe-doe/1460+doe/36524-doe/146096)/365;
+    long doy = doe-(365*yoe+yoe/4-yoe/100);
+    long mp = (5*doy+2)/153;
+    day = doy-(153*mp+2)/5+1;
+    month = mp < 10 ? mp+3 : mp-9;
+    year = yoe+era*400+(month <= 2);
+  }
+
+  bool ParseLong(const char *&pos, const char *end, long &value){
+    if(pos >= end || !isdigit(static_cast<unsigned char>(*pos))) return false;
+    value = 0;
+    while(pos < end && isdigit(static_cast<unsigned char>(*pos))){
+      value = 10*value + (*pos-'0');
+      ++pos;
+    }
+    return true;
+  }
+
+  bool Expect(const char *&pos, const char *end, char c){
+    if(pos >= end || *pos != c) return false;
+    ++pos;
+    return true;
+  }
+
+  //Parses "13-AUG-17" into hours since the epoch
+  bool ParseDate(const char *pos, const char *end, double &hours){
+    long day, month = -1, year;
+    if(!ParseLong(pos, end, day) || !Expect(pos, end, '-') || end-pos < 4) return false;
+    for(long imonth = 0; imonth < 12; ++imonth){
+      bool match = true;
+      for(size_t ichar = 0; ichar < 3 && match; ++ichar){
+        match = toupper(static_cast<unsigned char>(pos[ichar])) == month_names[imonth][ichar];
+      }
+      if(match) month = imonth+1;
+    }
+    if(month < 0) return false;
+    pos += 3;
+    if(!Expect(pos, end, '-') || !ParseLong(pos, end, year)) return false;
+    if(year < 100) year += 2000;
+    hours = 24.*DaysFromCivil(year, month, day);
+    return true;
+  }
+
+  //Parses "12.06.22.695000000 AM" into hours since midnight
+  bool ParseTime(const char *&pos, const char *end, double &hours){
+    long hour, minute, second;
+    if(!ParseLong(pos, end, hour) || !Expect(pos, end, '.')
+       || !ParseLong(pos, end, minute) || !Expect(pos, end, '.')
+       || !ParseLong(pos, end, second)) return false;
+    double fraction = 0., scale = 0.1;
+    if(Expect(pos, end, '.')){
+      while(pos < end && isdigit(static_cast<unsigned char>(*pos))){
+        fraction += scale*(*pos-'0');
+        scale *= 0.1;
+        ++pos;
+      }
+    }
+    while(pos < end && *pos == ' ') ++pos;
+    if(pos >= end) return false;
+    bool am = toupper(static_cast<unsigned char>(*pos)) == 'A';
+    while(pos < end && *pos != ',') ++pos;
+
+    if(am){
+      if(hour == 12) hour = 0;
+    }else if(hour < 12){
+      hour += 12;
+    }
+    hours = hour + minute/60. + (second+fraction)/3600.;
+    return true;
+  }
+
+  template<typename T>
+  void WriteValue(ofstream &file, const T &value){
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<typename T>
+  bool ReadValue(ifstream &file, T &value){
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(file);
+  }
+
+  bool SourceStat(const string &path, uint64_t &size, int64_t &mtime){
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) return false;
+    size = info.st_size;
+    mtime = info.st_mtime;
+    return true;
+  }
+}
+
+/*!\brief Constructs empty time series for a channel
+
+  \param[in] maraton Maraton ID
+
+  \param[in] channel Channel number within the Maraton
+*/
+CurrentLog::Channel::Channel(int maraton, int channel):
+  maraton_(maraton),
+  channel_(channel),
+  times_(),
+  values_(){
+}
+
+/*!\brief Get number of readings
+
+  \return Number of readings
+*/
+size_t CurrentLog::Channel::Size() const{
+  return times_.size();
+}
+
+/*!\brief Find readings within a time interval
+
+  \param[in] t_min Start of interval in hours since the epoch
+
+  \param[in] t_max End of interval in hours since the epoch
+
+  \return Half-open range [first, last) of reading indices with t_min <= t <=
+  t_max
+*/
+pair<size_t, size_t> CurrentLog::Channel::Window(double t_min, double t_max) const{
+  auto first = lower_bound(times_.cbegin(), times_.cend(), t_min);
+  auto last = upper_bound(first, times_.cend(), t_max);
+  return make_pair(first-times_.cbegin(), last-times_.cbegin());
+}
+
+/*!\brief Reduce readings within a time interval to the smallest and largest
+  reading in each of num_bins equal time bins
+
+  The selected readings are returned in time order, so the result can be drawn
+  directly as a TGraph. If the interval contains few readings, all are returned.
+
+  \param[in] t_min Start of interval in hours since the epoch
+
+  \param[in] t_max End of interval in hours since the epoch
+
+  \param[in] num_bins Number of time bins, typically the width of the plot in
+  pixels
+
+  \param[out] times Times of selected readings
+
+  \param[out] values Values of selected readings
+*/
+void CurrentLog::Channel::Downsample(double t_min, double t_max, size_t num_bins,
+                                     vector<double> &times, vector<double> &values) const{
+  times.clear();
+  values.clear();
+  auto range = Window(t_min, t_max);
+  if(num_bins == 0 || t_max <= t_min || range.second-range.first <= 2*num_bins){
+    times.assign(times_.cbegin()+range.first, times_.cbegin()+range.second);
+    values.assign(values_.cbegin()+range.first, values_.cbegin()+range.second);
+    return;
+  }
+
+  const size_t none = numeric_limits<size_t>::max();
+  vector<size_t> imin(num_bins, none), imax(num_bins, none);
+  double bins_per_hour = num_bins/(t_max-t_min);
+  for(size_t i = range.first; i < range.second; ++i){
+    size_t bin = min(num_bins-1, static_cast<size_t>((times_[i]-t_min)*bins_per_hour));
+    if(imin[bin] == none || values_[i] < values_[imin[bin]]) imin[bin] = i;
+    if(imax[bin] == none || values_[i] > values_[imax[bin]]) imax[bin] = i;
+  }
+
+  times.reserve(2*num_bins);
+  values.reserve(2*num_bins);
+  for(size_t bin = 0; bin < num_bins; ++bin){
+    if(imin[bin] == none) continue;
+    size_t first = min(imin[bin], imax[bin]);
+    size_t second = max(imin[bin], imax[bin]);
+    times.push_back(times_[first]);
+    values.push_back(values_[first]);
+    if(second == first) continue;
+    times.push_back(times_[second]);
+    values.push_back(values_[second]);
+  }
+}
+
+/*!\brief Standard constructor
+
+  \param[in] num_threads Number of threads used for parsing. 0 uses all
+  available cores.
+*/
+CurrentLog::CurrentLog(size_t num_threads):
+  channels_(),
+  index_(),
+  cache_dir_(),
+  num_threads_(0){
+  NumThreads(num_threads);
+}
+
+/*!\brief Load readings from a single log file
+
+  \param[in] path Path to CSV log
+
+  \return Reference to *this
+*/
+CurrentLog & CurrentLog::Load(const string &path){
+  return Load(vector<string>{path});
+}
+
+/*!\brief Load readings from several log files
+
+  Readings for the same (Maraton, channel) in different files are merged into
+  a single time-ordered series.
+
+  \param[in] paths Paths to CSV logs
+
+  \return Reference to *this
+*/
+CurrentLog & CurrentLog::Load(const vector<string> &paths){
+  vector<vector<Channel> > parsed(paths.size());
+  vector<bool> cached(paths.size(), false);
+  vector<string> texts(paths.size());
+  vector<vector<future<vector<Row> > > > chunks(paths.size());
+  {
+    ThreadPool tp(num_threads_);
+    for(size_t ifile = 0; ifile < paths.size(); ++ifile){
+      const string &path = paths.at(ifile);
+      if(cache_dir_ != "" && ReadCache(path, parsed.at(ifile))){
+        cached.at(ifile) = true;
+        continue;
+      }
+
+      ifstream file(path, ios::binary);
+      if(!file) ERROR("Could not open "+path);
+      file.seekg(0, ios::end);
+      string &text = texts.at(ifile);
+      text.resize(file.tellg());
+      file.seekg(0, ios::beg);
+      file.read(&text[0], text.size());
+
+      size_t chunk_size = max(min_chunk_size, text.size()/(4*num_threads_)+1);
+      size_t begin = 0;
+      while(begin < text.size()){
+        size_t end = text.find('\n', min(text.size(), begin+chunk_size));
+        end = end == string::npos ? text.size() : end+1;
+        chunks.at(ifile).push_back(tp.Push(ParseChunk, cref(text), begin, end));
+        begin = end;
+      }
+    }
+
+    for(size_t ifile = 0; ifile < paths.size(); ++ifile){
+      if(cached.at(ifile)) continue;
+      vector<vector<Row> > rows;
+      for(auto &chunk: chunks.at(ifile)){
+        rows.push_back(chunk.get());
+      }
+      parsed.at(ifile) = BuildChannels(rows);
+      string().swap(texts.at(ifile));
+      if(cache_dir_ != "") WriteCache(paths.at(ifile), parsed.at(ifile));
+    }
+  }
+
+  for(const auto &channels: parsed){
+    Merge(channels);
+  }
+  for(auto &channel: channels_){
+    SortChannel(channel);
+  }
+  return *this;
+}
+
+/*!\brief Get all channels in order of first appearance
+
+  \return Time series of all channels
+*/
+const vector<CurrentLog::Channel> & CurrentLog::Channels() const{
+  return channels_;
+}
+
+/*!\brief Find a channel
+
+  \param[in] maraton Maraton ID
+
+  \param[in] channel Channel number within the Maraton
+
+  \return Pointer to time series, or nullptr if the channel has no readings
+*/
+const CurrentLog::Channel * CurrentLog::Find(int maraton, int channel) const{
+  auto loc = index_.find(MakeKey(maraton, channel));
+  if(loc == index_.cend()) return nullptr;
+  return &channels_.at(loc->second);
+}
+
+/*!\brief Get a channel, which must have been loaded
+
+  \param[in] maraton Maraton ID
+
+  \param[in] channel Channel number within the Maraton
+
+  \return Time series of channel
+*/
+const CurrentLog::Channel & CurrentLog::Get(int maraton, int channel) const{
+  const Channel *found = Find(maraton, channel);
+  if(found == nullptr) ERROR("No readings for Maraton "+to_string(maraton)+" channel "+to_string(channel));
+  return *found;
+}
+
+/*!\brief Get time of earliest reading
+
+  \return Time in hours since the epoch
+*/
+double CurrentLog::StartTime() const{
+  double start = numeric_limits<double>::infinity();
+  for(const auto &channel: channels_){
+    if(channel.Size() > 0) start = min(start, channel.times_.front());
+  }
+  if(std::isinf(start)) ERROR("No readings loaded");
+  return start;
+}
+
+/*!\brief Get time of latest reading
+
+  \return Time in hours since the epoch
+*/
+double CurrentLog::EndTime() const{
+  double end = -numeric_limits<double>::infinity();
+  for(const auto &channel: channels_){
+    if(channel.Size() > 0) end = max(end, channel.times_.back());
+  }
+  if(std::isinf(end)) ERROR("No readings loaded");
+  return end;
+}
+
+/*!\brief Get directory used to cache parsed files
+
+  \return Cache directory, empty if caching is disabled
+*/
+const string & CurrentLog::CacheDir() const{
+  return cache_dir_;
+}
+
+/*!\brief Set directory used to cache parsed files
+
+  \param[in] cache_dir Existing directory, or empty string to disable caching
+
+  \return Reference to *this
+*/
+CurrentLog & CurrentLog::CacheDir(const string &cache_dir){
+  cache_dir_ = cache_dir;
+  return *this;
+}
+
+/*!\brief Get number of threads used for parsing
+
+  \return Number of threads
+*/
+size_t CurrentLog::NumThreads() const{
+  return num_threads_;
+}
+
+/*!\brief Set number of threads used for parsing
+
+  \param[in] num_threads Number of threads. 0 uses all available cores.
+
+  \return Reference to *this
+*/
+CurrentLog & CurrentLog::NumThreads(size_t num_threads){
+  num_threads_ = num_threads == 0 ? max(1u, thread::hardware_concurrency()) : num_threads;
+  return *this;
+}
+
+/*!\brief Format a time as a date in the style of the logs
+
+  \param[in] time Time in hours since the epoch
+
+  \return Date formatted as e.g. "13-AUG-17"
+*/
+string CurrentLog::FormatDate(double time){
+  long year, month, day;
+  CivilFromDays(static_cast<long>(floor(time/24.)), year, month, day);
+  ostringstream oss;
+  oss << setfill('0') << setw(2) << day << '-' << month_names[month-1]
+      << '-' << setw(2) << year%100;
+  return oss.str();
+}
+
+void CurrentLog::Merge(const vector<Channel> &channels){
+  for(const auto &channel: channels){
+    uint64_t key = MakeKey(channel.maraton_, channel.channel_);
+    auto loc = index_.find(key);
+    if(loc == index_.end()){
+      index_[key] = channels_.size();
+      channels_.push_back(channel);
+    }else{
+      Channel &merged = channels_.at(loc->second);
+      merged.times_.insert(merged.times_.end(), channel.times_.cbegin(), channel.times_.cend());
+      merged.values_.insert(merged.values_.end(), channel.values_.cbegin(), channel.values_.cend());
+    }
+  }
+}
+
+string CurrentLog::CachePath(const string &path) const{
+  return cache_dir_+"/"+Basename(path)+".clog";
+}
+
+bool CurrentLog::ReadCache(const string &path, vector<Channel> &channels) const{
+  uint64_t source_size;
+  int64_t source_mtime;
+  if(!SourceStat(path, source_size, source_mtime)) return false;
+
+  ifstream file(CachePath(path), ios::binary);
+  if(!file) return false;
+  char magic[4];
+  uint32_t version;
+  uint64_t size, num_channels;
+  int64_t mtime;
+  file.read(magic, sizeof(magic));
+  if(!file || memcmp(magic, cache_magic, sizeof(magic)) != 0) return false;
+  if(!ReadValue(file, version) || version != cache_version) return false;
+  if(!ReadValue(file, size) || size != source_size) return false;
+  if(!ReadValue(file, mtime) || mtime != source_mtime) return false;
+  if(!ReadValue(file, num_channels)) return false;
+
+  channels.clear();
+  for(uint64_t ichannel = 0; ichannel < num_channels; ++ichannel){
+    int32_t maraton, channel;
+    uint64_t num_readings;
+    if(!ReadValue(file, maraton) || !ReadValue(file, channel)
+       || !ReadValue(file, num_readings)) return false;
+    channels.emplace_back(maraton, channel);
+    Channel &series = channels.back();
+    series.times_.resize(num_readings);
+    series.values_.resize(num_readings);
+    file.read(reinterpret_cast<char*>(series.times_.data()), num_readings*sizeof(double));
+    file.read(reinterpret_cast<char*>(series.values_.data()), num_readings*sizeof(double));
+    if(!file) return false;
+  }
+  return true;
+}
+
+void CurrentLog::WriteCache(const string &path, const vector<Channel> &channels) const{
+  uint64_t source_size;
+  int64_t source_mtime;
+  if(!SourceStat(path, source_size, source_mtime)) return;
+
+  string cache_path = CachePath(path);
+  string tmp_path = cache_path+".tmp";
+  {
+    ofstream file(tmp_path, ios::binary);
+    if(!file){
+      DBG("Could not write cache " << tmp_path);
+      return;
+    }
+    file.write(cache_magic, sizeof(cache_magic));
+    WriteValue(file, cache_version);
+    WriteValue(file, source_size);
+    WriteValue(file, source_mtime);
+    WriteValue(file, static_cast<uint64_t>(channels.size()));
+    for(const auto &channel: channels){
+      WriteValue(file, static_cast<int32_t>(channel.maraton_));
+      WriteValue(file, static_cast<int32_t>(channel.channel_));
+      WriteValue(file, static_cast<uint64_t>(channel.Size()));
+      file.write(reinterpret_cast<const char*>(channel.times_.data()), channel.Size()*sizeof(double));
+      file.write(reinterpret_cast<const char*>(channel.values_.data()), channel.Size()*sizeof(double));
+    }
+  }
+  rename(tmp_path.c_str(), cache_path.c_str());
+}
+
+uint64_t CurrentLog::MakeKey(int maraton, int channel){
+  return (static_cast<uint64_t>(static_cast<uint32_t>(maraton)) << 32)
+    | static_cast<uint32_t>(channel);
+}
+
+vector<CurrentLog::Row> CurrentLog::ParseChunk(const string &text,
+                                               size_t begin,
+                                               size_t end){
+  vector<Row> rows;
+  const char *data = text.data();
+  size_t line_begin = begin;
+  string last_date;
+  double day_hours = 0.;
+  while(line_begin < end){
+    size_t line_end = text.find('\n', line_begin);
+    if(line_end == string::npos || line_end > end) line_end = end;
+    const char *pos = data+line_begin;
+    const char *stop = data+line_end;
+    line_begin = line_end+1;
+
+    //Date is shared by consecutive lines, so only parse it when it changes
+    const char *date_end = static_cast<const char*>(memchr(pos, ' ', stop-pos));
+    if(date_end == nullptr) continue;
+    if(last_date.size() != static_cast<size_t>(date_end-pos)
+       || last_date.compare(0, string::npos, pos, date_end-pos) != 0){
+      if(!ParseDate(pos, date_end, day_hours)){
+        last_date.clear();
+        continue;
+      }
+      last_date.assign(pos, date_end);
+    }
+    pos = date_end+1;
+
+    Row row;
+    long maraton, channel;
+    if(!ParseTime(pos, stop, row.time_)
+       || !Expect(pos, stop, ',') || !ParseLong(pos, stop, maraton)
+       || !Expect(pos, stop, ',') || !ParseLong(pos, stop, channel)
+       || !Expect(pos, stop, ',')) continue;
+    char *value_end = nullptr;
+    row.value_ = strtod(pos, &value_end);
+    if(value_end == pos || value_end > stop) continue;
+    row.time_ += day_hours;
+    row.maraton_ = maraton;
+    row.channel_ = channel;
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+vector<CurrentLog::Channel> CurrentLog::BuildChannels(const vector<vector<Row> > &chunks){
+  vector<Channel> channels;
+  unordered_map<uint64_t, size_t> index;
+  for(const auto &rows: chunks){
+    for(const auto &row: rows){
+      uint64_t key = MakeKey(row.maraton_, row.channel_);
+      auto loc = index.find(key);
+      size_t ichannel;
+      if(loc == index.end()){
+        ichannel = channels.size();
+        index[key] = ichannel;
+        channels.emplace_back(row.maraton_, row.channel_);
+      }else{
+        ichannel = loc->second;
+      }
+      channels[ichannel].times_.push_back(row.time_);
+      channels[ichannel].values_.push_back(row.value_);
+    }
+  }
+  for(auto &channel: channels){
+    SortChannel(channel);
+  }
+  return channels;
+}
+
+void CurrentLog::SortChannel(Channel &channel){
+  if(is_sorted(channel.times_.cbegin(), channel.times_.cend())) return;
+  vector<size_t> perm = SortPermutation(channel.times_);
+  channel.times_ = ApplyPermutation(channel.times_, perm);
+  channel.values_ = ApplyPermutation(channel.values_, perm);
+}
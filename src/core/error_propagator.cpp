@@ -0,0 +1,323 @@
+/*! \class ErrorPropagator
+
+  \brief Propagates fit uncertainties to many workspace functions with a single
+  sweep over the fit parameters
+
+  For each floating parameter of a RooFitResult, the parameter is shifted up and
+  down in the workspace and every requested yield function is re-evaluated,
+  producing the full Jacobian of the yields with respect to the parameters. The
+  errors and covariance of all yields then follow from one matrix product with
+  the parameter correlation matrix, instead of repeating the parameter loop for
+  each yield separately.
+
+  The sweep is split into contiguous ranges of parameters, each processed on its
+  own thread with its own clone of the workspace, so that parameter shifts in
+  one thread do not affect the yields evaluated in another.
+
+  How far each parameter is shifted is given by a ShiftFunc, which receives the
+  fitted parameter and returns the (up, down) values to set. ErrorShift()
+  reproduces the shifts of the per-function GetError in extract_yields, and
+  CovarianceShift() those used to build the yield covariance matrix.
+*/
+#include "core/error_propagator.hpp"
+
+#include <cmath>
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "TMatrixDSym.h"
+
+#include "RooAbsReal.h"
+#include "RooArgList.h"
+
+#include "core/thread_pool.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Standard constructor
+
+  \param[in] w Workspace with variables already set to their fitted values
+
+  \param[in] f Fit result providing floating parameters and correlations
+
+  \param[in] num_threads Number of threads to use. 0 uses all available cores.
+*/
+ErrorPropagator::ErrorPropagator(RooWorkspace &w,
+                                 const RooFitResult &f,
+                                 size_t num_threads):
+  w_(&w),
+  f_(&f),
+  num_threads_(num_threads),
+  yield_names_(),
+  par_names_(),
+  jacobian_(),
+  correlation_(){
+  if(num_threads_ == 0) num_threads_ = max(1u, thread::hardware_concurrency());
+  const RooArgList &fpf = f.floatParsFinal();
+  for(int ipar = 0; ipar < fpf.getSize(); ++ipar){
+    par_names_.push_back(fpf.at(ipar)->GetName());
+  }
+  FillCorrelation();
+}
+
+/*!\brief Computes the Jacobian of the given yields with respect to all fit
+  parameters
+
+  \param[in] yield_names Names of functions (or variables) in the workspace
+
+  \param[in] shift Returns the (up, down) values to which a fitted parameter is
+  set
+
+  \param[in] scale Factor by which yield differences are multiplied
+
+  \return Reference to *this
+*/
+ErrorPropagator & ErrorPropagator::Compute(const vector<string> &yield_names,
+                                           const function<ShiftFunc> &shift,
+                                           double scale){
+  yield_names_ = yield_names;
+  jacobian_.assign(par_names_.size(), vector<double>(yield_names_.size(), 0.));
+
+  size_t num_threads = min(num_threads_, par_names_.size());
+  if(num_threads <= 1){
+    ComputeRange(*w_, 0, par_names_.size(), shift, scale);
+    return *this;
+  }
+
+  vector<unique_ptr<RooWorkspace> > clones(num_threads);
+  {
+    lock_guard<mutex> lock(Multithreading::root_mutex);
+    for(auto &clone: clones){
+      clone.reset(static_cast<RooWorkspace*>(w_->Clone()));
+    }
+  }
+
+  vector<future<void> > done(num_threads);
+  {
+    ThreadPool tp(num_threads);
+    size_t per_thread = (par_names_.size()+num_threads-1)/num_threads;
+    for(size_t ithread = 0; ithread < num_threads; ++ithread){
+      size_t first_par = min(ithread*per_thread, par_names_.size());
+      size_t last_par = min(first_par+per_thread, par_names_.size());
+      done.at(ithread) = tp.Push(bind(&ErrorPropagator::ComputeRange, this,
+                                      ref(*clones.at(ithread)), first_par, last_par,
+                                      cref(shift), scale));
+    }
+    for(auto &d: done) d.get();
+  }
+
+  lock_guard<mutex> lock(Multithreading::root_mutex);
+  clones.clear();
+  return *this;
+}
+
+/*!\brief Get names of yields in the order of the Jacobian columns
+
+  \return Yield names
+*/
+const vector<string> & ErrorPropagator::YieldNames() const{
+  return yield_names_;
+}
+
+/*!\brief Get names of fit parameters in the order of the Jacobian rows
+
+  \return Parameter names
+*/
+const vector<string> & ErrorPropagator::ParameterNames() const{
+  return par_names_;
+}
+
+/*!\brief Get shift of each yield for each parameter
+
+  \return Matrix indexed as [parameter][yield]
+*/
+const vector<vector<double> > & ErrorPropagator::Jacobian() const{
+  return jacobian_;
+}
+
+/*!\brief Get parameter correlation matrix from the fit result
+
+  \return Matrix indexed as [parameter][parameter]
+*/
+const vector<vector<double> > & ErrorPropagator::Correlation() const{
+  return correlation_;
+}
+
+/*!\brief Get covariance of the yields, J^T C J
+
+  \return Matrix indexed as [yield][yield]
+*/
+vector<vector<double> > ErrorPropagator::Covariance() const{
+  size_t npar = par_names_.size();
+  size_t nyield = yield_names_.size();
+  vector<vector<double> > right(npar, vector<double>(nyield, 0.));
+  for(size_t ipar = 0; ipar < npar; ++ipar){
+    const vector<double> &corr_row = correlation_.at(ipar);
+    vector<double> &right_row = right.at(ipar);
+    for(size_t jpar = 0; jpar < npar; ++jpar){
+      double corr = corr_row.at(jpar);
+      if(corr == 0.) continue;
+      const vector<double> &jac_row = jacobian_.at(jpar);
+      for(size_t iyield = 0; iyield < nyield; ++iyield){
+        right_row.at(iyield) += corr*jac_row.at(iyield);
+      }
+    }
+  }
+
+  vector<vector<double> > covar(nyield, vector<double>(nyield, 0.));
+  for(size_t ipar = 0; ipar < npar; ++ipar){
+    const vector<double> &jac_row = jacobian_.at(ipar);
+    const vector<double> &right_row = right.at(ipar);
+    for(size_t irow = 0; irow < nyield; ++irow){
+      if(jac_row.at(irow) == 0.) continue;
+      for(size_t icol = 0; icol < nyield; ++icol){
+        covar.at(irow).at(icol) += jac_row.at(irow)*right_row.at(icol);
+      }
+    }
+  }
+  return covar;
+}
+
+/*!\brief Get uncertainty of each yield, the square root of the diagonal of the
+  covariance
+
+  \return Uncertainties in the order of YieldNames()
+*/
+vector<double> ErrorPropagator::Errors() const{
+  size_t npar = par_names_.size();
+  size_t nyield = yield_names_.size();
+  vector<double> sum(nyield, 0.);
+  for(size_t ipar = 0; ipar < npar; ++ipar){
+    const vector<double> &corr_row = correlation_.at(ipar);
+    const vector<double> &jac_i = jacobian_.at(ipar);
+    for(size_t jpar = 0; jpar < npar; ++jpar){
+      double corr = corr_row.at(jpar);
+      if(corr == 0.) continue;
+      const vector<double> &jac_j = jacobian_.at(jpar);
+      for(size_t iyield = 0; iyield < nyield; ++iyield){
+        sum.at(iyield) += jac_i.at(iyield)*corr*jac_j.at(iyield);
+      }
+    }
+  }
+  for(auto &s: sum){
+    s = sqrt(s);
+  }
+  return sum;
+}
+
+/*!\brief Get number of threads used for the parameter sweep
+
+  \return Number of threads
+*/
+size_t ErrorPropagator::NumThreads() const{
+  return num_threads_;
+}
+
+/*!\brief Set number of threads used for the parameter sweep
+
+  \param[in] num_threads Number of threads. 0 uses all available cores.
+
+  \return Reference to *this
+*/
+ErrorPropagator & ErrorPropagator::NumThreads(size_t num_threads){
+  num_threads_ = num_threads == 0 ? max(1u, thread::hardware_concurrency()) : num_threads;
+  return *this;
+}
+
+/*!\brief Shifts matching GetError in extract_yields
+
+  \param[in] errtype 0 for symmetric +-0.5 sigma shifts, 1 for +1 sigma (up
+  error), -1 for -1 sigma (down error)
+
+  \return Function giving (up, down) parameter values
+*/
+function<ErrorPropagator::ShiftFunc> ErrorPropagator::ErrorShift(int errtype){
+  return [errtype](const RooRealVar &par){
+    double cen_val = par.getVal();
+    switch(errtype){
+    case 1: return make_pair(cen_val+par.getErrorHi(), cen_val);
+    case -1: return make_pair(cen_val, cen_val+par.getErrorLo());
+    default: return make_pair(cen_val+0.5*par.getError(), cen_val-0.5*par.getError());
+    }
+  };
+}
+
+/*!\brief One-sided shifts by a fraction of the asymmetric errors, kept inside
+  the parameter range
+
+  Use with scale=1/lambda to obtain derivatives in units of the parameter error.
+
+  \param[in] lambda Fraction of the parameter error by which to shift
+
+  \return Function giving (up, down) parameter values
+*/
+function<ErrorPropagator::ShiftFunc> ErrorPropagator::CovarianceShift(double lambda){
+  return [lambda](const RooRealVar &par){
+    double cen_val = par.getVal();
+    double min_val = par.getMin();
+    double max_val = par.getMax();
+    double down_val = cen_val-lambda*fabs(par.getErrorLo());
+    double up_val = cen_val+lambda*fabs(par.getErrorHi());
+    if(up_val-down_val >= max_val-min_val){
+      //Error bars bigger than variable range
+      up_val = max_val;
+    }else if(down_val < min_val){
+      up_val += min_val - down_val;
+    }else if(up_val > max_val){
+      up_val = max_val;
+    }
+    return make_pair(up_val, cen_val);
+  };
+}
+
+void ErrorPropagator::FillCorrelation(){
+  const TMatrixDSym &corr = f_->correlationMatrix();
+  size_t npar = par_names_.size();
+  correlation_.assign(npar, vector<double>(npar, 0.));
+  for(size_t ipar = 0; ipar < npar; ++ipar){
+    for(size_t jpar = 0; jpar < npar; ++jpar){
+      correlation_.at(ipar).at(jpar) = corr(ipar, jpar);
+    }
+  }
+}
+
+void ErrorPropagator::ComputeRange(RooWorkspace &w,
+                                   size_t first_par,
+                                   size_t last_par,
+                                   const function<ShiftFunc> &shift,
+                                   double scale){
+  vector<RooAbsReal*> yields(yield_names_.size(), nullptr);
+  for(size_t iyield = 0; iyield < yields.size(); ++iyield){
+    const char *name = yield_names_.at(iyield).c_str();
+    yields.at(iyield) = w.function(name);
+    if(yields.at(iyield) == nullptr) yields.at(iyield) = w.var(name);
+  }
+
+  const RooArgList &fpf = f_->floatParsFinal();
+  vector<double> up_vals(yields.size());
+  for(size_t ipar = first_par; ipar < last_par; ++ipar){
+    RooRealVar *w_par = w.var(par_names_.at(ipar).c_str());
+    if(w_par == nullptr) continue;
+    const RooRealVar &fit_par = static_cast<const RooRealVar&>(*fpf.at(ipar));
+    double cen_val = fit_par.getVal();
+    auto shifts = shift(fit_par);
+
+    w_par->setVal(shifts.first);
+    for(size_t iyield = 0; iyield < yields.size(); ++iyield){
+      if(yields.at(iyield) == nullptr) continue;
+      up_vals.at(iyield) = yields.at(iyield)->getVal();
+    }
+    w_par->setVal(shifts.second);
+    vector<double> &jac_row = jacobian_.at(ipar);
+    for(size_t iyield = 0; iyield < yields.size(); ++iyield){
+      if(yields.at(iyield) == nullptr) continue;
+      jac_row.at(iyield) = scale*(up_vals.at(iyield)-yields.at(iyield)->getVal());
+    }
+    w_par->setVal(cen_val);
+  }
+}
@@ -0,0 +1,328 @@
+/*! \class EventCache
+
+  \brief Keeps a few quantities of selected events in memory so that later
+  passes can run without reopening the babies
+
+  Some results need a first pass over the events to define the weights of a
+  second one, e.g. pileup reweighting from the N<sub>PV</sub> distribution or
+  data/MC normalizations. An EventCache is added to the PlotMaker of the first
+  stage like any other figure. While the first stage runs, it stores the
+  values of its columns for every event passing its cut. Once the first stage
+  is done, Replayed() gives a stand-in for each process which can be used in
+  the figures of a second PlotMaker. Instead of reading babies, the second
+  PlotMaker replays the cached rows to those figures, whose cuts, weights and
+  variables are built from Column() and from anything derived from the first
+  stage results.
+
+  Figures replaying a cache may only use its columns. Baby variables are not
+  read during replay, so using them gives meaningless values.
+
+  If the PlotMaker memory budget limits the cache, rows beyond the limit are
+  spilled to a temporary scratch file and read back during replay.
+*/
+
+/*! \class EventCache::SingleCache
+
+  \brief Cached rows of one process
+*/
+#include "core/event_cache.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+mutex EventCache::sources_mutex_{};
+map<const Process*, const EventCache::SingleCache*> EventCache::sources_{};
+thread_local const EventCache * EventCache::current_cache_ = nullptr;
+thread_local const double * EventCache::current_row_ = nullptr;
+
+namespace{
+  const size_t replay_chunk_bytes = 1 << 22;
+}
+
+EventCache::SingleCache::SingleCache(const EventCache &event_cache,
+                                     const shared_ptr<Process> &process):
+  FigureComponent(event_cache, process),
+  full_cut_(event_cache.cut_ && process->cut_),
+  values_(),
+  num_rows_(0),
+  num_spilled_(0),
+  memory_limit_(0),
+  scratch_(nullptr),
+  baby_(nullptr){
+}
+
+EventCache::SingleCache::~SingleCache(){
+  if(scratch_ != nullptr) fclose(scratch_);
+}
+
+void EventCache::SingleCache::RecordEvent(const Baby &baby){
+  if(full_cut_.IsScalar()){
+    if(!full_cut_.GetScalar(baby)) return;
+  }else{
+    if(!HavePass(full_cut_.GetVector(baby))) return;
+  }
+
+  const EventCache &cache = static_cast<const EventCache&>(figure_);
+  if(baby_ == nullptr) baby_ = &baby;
+  for(const auto &column: cache.columns_){
+    values_.push_back(column.GetScalar(baby));
+  }
+  ++num_rows_;
+  if(memory_limit_ > 0 && values_.size()*sizeof(double) > memory_limit_) Spill();
+}
+
+size_t EventCache::SingleCache::MemoryUsage() const{
+  return sizeof(*this) + values_.capacity()*sizeof(double);
+}
+
+/*!\brief Limit the memory used by rows kept in memory
+
+  \param[in] bytes Maximum number of bytes before rows are spilled to scratch
+
+  \param[in] num_threads Ignored, since rows are recorded under a lock
+*/
+void EventCache::SingleCache::MemoryLimit(size_t bytes, size_t /*num_threads*/){
+  memory_limit_ = bytes;
+}
+
+/*!\brief Rows beyond the memory limit are spilled to scratch
+
+  \return True
+*/
+bool EventCache::SingleCache::MemoryLimited() const{
+  return true;
+}
+
+/*!\brief Get number of cached events
+
+  \return Number of rows
+*/
+long EventCache::SingleCache::NumRows() const{
+  return num_rows_;
+}
+
+/*!\brief Calls a function once for every cached row
+
+  While the function runs, EventCache::Column() of the owning cache returns
+  the values of the current row in the calling thread.
+
+  \param[in] callback Function to call. Gets the baby the rows were recorded
+  from, whose variables are not loaded.
+
+  \return Number of rows replayed
+*/
+long EventCache::SingleCache::Replay(const function<void(const Baby &)> &callback) const{
+  if(num_rows_ == 0) return 0;
+  const EventCache &cache = static_cast<const EventCache&>(figure_);
+  size_t width = cache.columns_.size();
+
+  struct ReplayGuard{
+    explicit ReplayGuard(const EventCache &replayed){
+      current_cache_ = &replayed;
+    }
+    ~ReplayGuard(){
+      current_cache_ = nullptr;
+      current_row_ = nullptr;
+    }
+  } guard(cache);
+
+  if(num_spilled_ > 0){
+    long rows_per_chunk = max(static_cast<size_t>(1), replay_chunk_bytes/max(static_cast<size_t>(1), width*sizeof(double)));
+    vector<double> chunk;
+    for(long first = 0; first < num_spilled_; first += rows_per_chunk){
+      long num_chunk = min(rows_per_chunk, num_spilled_-first);
+      chunk.resize(num_chunk*width);
+      size_t bytes = chunk.size()*sizeof(double);
+      if(bytes > 0
+         && pread(fileno(scratch_), chunk.data(), bytes, first*width*sizeof(double)) != static_cast<ssize_t>(bytes)){
+        ERROR("Could not read spilled rows of "+cache.name_+" for "+process_->name_);
+      }
+      for(long row = 0; row < num_chunk; ++row){
+        current_row_ = chunk.data()+row*width;
+        callback(*baby_);
+      }
+    }
+  }
+  for(long row = 0; row < num_rows_-num_spilled_; ++row){
+    current_row_ = values_.data()+row*width;
+    callback(*baby_);
+  }
+  return num_rows_;
+}
+
+/*!\brief Moves the rows kept in memory to the scratch file
+ */
+void EventCache::SingleCache::Spill(){
+  const EventCache &cache = static_cast<const EventCache&>(figure_);
+  if(scratch_ == nullptr){
+    scratch_ = tmpfile();
+    if(scratch_ == nullptr) ERROR("Could not open scratch file for "+cache.name_);
+  }
+  if(fwrite(values_.data(), sizeof(double), values_.size(), scratch_) != values_.size()
+     || fflush(scratch_) != 0){
+    ERROR("Could not spill rows of "+cache.name_+" for "+process_->name_);
+  }
+  num_spilled_ = num_rows_;
+  values_.clear();
+}
+
+/*!\brief Standard constructor
+
+  \param[in] name Name of cache, used in printout and column names
+
+  \param[in] cut Cut selecting cached events
+
+  \param[in] columns Scalar quantities to store for each selected event
+
+  \param[in] processes Processes whose events are cached
+*/
+EventCache::EventCache(const string &name,
+                       const NamedFunc &cut,
+                       const vector<NamedFunc> &columns,
+                       const vector<shared_ptr<Process> > &processes):
+  name_(name),
+  cut_(cut),
+  columns_(columns),
+  caches_(),
+  replayed_(){
+  for(const auto &column: columns_){
+    if(column.IsVector()) ERROR("EventCache only stores scalars, but "+column.Name()+" is a vector.");
+  }
+  for(const auto& proc: processes){
+    caches_.emplace_back(new SingleCache(*this, proc));
+  }
+}
+
+EventCache::~EventCache(){
+  lock_guard<mutex> lock(sources_mutex_);
+  for(const auto &process: replayed_){
+    sources_.erase(process.get());
+  }
+}
+
+void EventCache::Print(double /*luminosity*/,
+                       const string & /*subdir*/){
+  for(const auto &cache: caches_){
+    cout << name_ << ": cached " << cache->NumRows() << " events with "
+         << columns_.size() << " columns for " << cache->process_->name_ << endl;
+  }
+}
+
+set<const Process*> EventCache::GetProcesses() const{
+  set<const Process *> processes;
+  for(const auto &cache: caches_){
+    processes.insert(cache->process_.get());
+  }
+  return processes;
+}
+
+Figure::FigureComponent * EventCache::GetComponent(const Process *process){
+  for(const auto &cache: caches_){
+    if(cache->process_.get() == process){
+      return cache.get();
+    }
+  }
+  DBG("Could not find cache for process "+process->name_+".");
+  return nullptr;
+}
+
+/*!\brief Get a cached quantity as a function usable while replaying
+
+  \param[in] icolumn Index of column in EventCache::columns_
+
+  \return NamedFunc returning the column value of the row being replayed
+*/
+NamedFunc EventCache::Column(size_t icolumn) const{
+  if(icolumn >= columns_.size()){
+    ERROR("Column "+to_string(icolumn)+" requested from "+name_+", which has "
+          +to_string(columns_.size())+" columns.");
+  }
+  const EventCache *cache = this;
+  string column_name = columns_.at(icolumn).Name();
+  return NamedFunc(name_+"."+column_name, [cache, icolumn, column_name](const Baby &){
+      if(current_cache_ != cache){
+        ERROR("Column "+column_name+" of "+cache->name_+" used outside of its replay.");
+      }
+      return current_row_[icolumn];
+    });
+}
+
+/*!\brief Get a cached quantity as a function usable while replaying
+
+  \param[in] name Name of the cached NamedFunc
+
+  \return NamedFunc returning the column value of the row being replayed
+*/
+NamedFunc EventCache::Column(const string &name) const{
+  string cleaned = CopyReplaceAll(name, " ", "");
+  for(size_t icolumn = 0; icolumn < columns_.size(); ++icolumn){
+    if(columns_.at(icolumn).Name() == cleaned) return Column(icolumn);
+  }
+  ERROR("No column "+name+" in "+name_+".");
+  return NamedFunc(0.);
+}
+
+/*!\brief Get a stand-in process whose events are the cached rows of a process
+
+  The new process has the name, type and style of the original, no babies,
+  and no cut, since the cached rows already passed the cut of the original.
+
+  \param[in] process Process whose rows are replayed
+
+  \return Process to use in figures of a later stage
+*/
+shared_ptr<Process> EventCache::Replayed(const shared_ptr<Process> &process){
+  const SingleCache *source = nullptr;
+  for(const auto &cache: caches_){
+    if(cache->process_ == process) source = cache.get();
+  }
+  if(source == nullptr) ERROR("Process "+process->name_+" is not cached in "+name_+".");
+
+  auto replayed = Process::MakeShared<Baby>(process->name_, process->type_, process->color_,
+                                            set<string>{}, true);
+  static_cast<TAttFill&>(*replayed) = static_cast<const TAttFill&>(*process);
+  static_cast<TAttLine&>(*replayed) = static_cast<const TAttLine&>(*process);
+  static_cast<TAttMarker&>(*replayed) = static_cast<const TAttMarker&>(*process);
+  replayed_.push_back(replayed);
+  lock_guard<mutex> lock(sources_mutex_);
+  sources_[replayed.get()] = source;
+  return replayed;
+}
+
+/*!\brief Get the cached rows replayed by a process
+
+  \param[in] process Process, typically from Replayed()
+
+  \return Cached rows, or nullptr if process does not replay a cache
+*/
+const EventCache::SingleCache * EventCache::Source(const Process *process){
+  lock_guard<mutex> lock(sources_mutex_);
+  auto source = sources_.find(process);
+  return source == sources_.end() ? nullptr : source->second;
+}
+
+/*!\brief Get a hash of the row being replayed in this thread
+
+  Rows are cached in whatever order threads select their events, so the hash
+  of the column values is the only identifier of a row's event that does not
+  depend on scheduling.
+
+  \return 64-bit FNV-1a hash of the column values, or 0 outside of a replay
+*/
+uint64_t EventCache::RowHash(){
+  if(current_cache_ == nullptr || current_row_ == nullptr) return 0;
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(current_row_);
+  size_t num_bytes = current_cache_->columns_.size()*sizeof(double);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for(size_t i = 0; i < num_bytes; ++i){
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
@@ -0,0 +1,337 @@
+/*! \class EventIndex
+
+  \brief Sorted set of (run, lumiblock, event) keys supporting fast lookup and
+  set operations
+
+  Keys are kept in a flat sorted vector, so lookups are a binary search and
+  intersections, unions, and differences between two indices are a single
+  linear merge. Indices are written either as a compact binary file (magic
+  "EVLS", version, number of keys, then the packed keys) or as a text file
+  with one "run lumiblock event" line per event, the format used by older
+  event lists. EventIndex(const std::string &path) reads either format.
+
+  An index can be turned back into a cut with EventIndex::Cut(), which selects
+  events whose key is in the index.
+*/
+
+/*! \struct EventIndex::Key
+
+  \brief Identifies a single collision event
+*/
+#include "core/event_index.hpp"
+
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+
+#include "core/baby.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const char index_magic[4] = {'E', 'V', 'L', 'S'};
+  const uint32_t index_version = 1;
+}
+
+/*!\brief Orders keys by run, then lumiblock, then event
+
+  \param[in] other Key to compare to
+
+  \return True if *this precedes other
+*/
+bool EventIndex::Key::operator<(const Key &other) const{
+  if(run_ != other.run_) return run_ < other.run_;
+  if(lumiblock_ != other.lumiblock_) return lumiblock_ < other.lumiblock_;
+  return event_ < other.event_;
+}
+
+/*!\brief Check if two keys identify the same event
+
+  \param[in] other Key to compare to
+
+  \return True if run, lumiblock, and event all match
+*/
+bool EventIndex::Key::operator==(const Key &other) const{
+  return run_ == other.run_ && lumiblock_ == other.lumiblock_ && event_ == other.event_;
+}
+
+/*!\brief Constructs an empty index
+ */
+EventIndex::EventIndex():
+  keys_(),
+  sorted_(true){
+}
+
+/*!\brief Reads an index from a binary or text event list
+
+  \param[in] path File to read
+*/
+EventIndex::EventIndex(const string &path):
+  keys_(),
+  sorted_(true){
+  ifstream file(path, ios::binary);
+  if(!file) ERROR("Could not open event list "+path);
+  char magic[sizeof(index_magic)] = {};
+  file.read(magic, sizeof(magic));
+  if(file && memcmp(magic, index_magic, sizeof(magic)) == 0){
+    ReadBinary(file, path);
+  }else{
+    file.clear();
+    file.seekg(0);
+    ReadText(file);
+  }
+  Sort();
+}
+
+/*!\brief Adds an event to the index
+
+  Lookups and set operations require a call to Sort() afterwards.
+
+  \param[in] key Event to add
+
+  \return Reference to *this
+*/
+EventIndex & EventIndex::Insert(const Key &key){
+  if(sorted_ && !keys_.empty() && !(keys_.back() < key)) sorted_ = false;
+  keys_.push_back(key);
+  return *this;
+}
+
+/*!\brief Adds all events in another index
+
+  \param[in] other Index whose events to add
+
+  \return Reference to *this
+*/
+EventIndex & EventIndex::Insert(const EventIndex &other){
+  keys_.insert(keys_.end(), other.keys_.cbegin(), other.keys_.cend());
+  sorted_ = false;
+  return *this;
+}
+
+/*!\brief Sorts keys and removes duplicates
+
+  \return Reference to *this
+*/
+EventIndex & EventIndex::Sort(){
+  if(sorted_) return *this;
+  sort(keys_.begin(), keys_.end());
+  keys_.erase(unique(keys_.begin(), keys_.end()), keys_.end());
+  sorted_ = true;
+  return *this;
+}
+
+/*!\brief Check if an event is in the index
+
+  \param[in] key Event to look up
+
+  \return True if key is in the index
+*/
+bool EventIndex::Contains(const Key &key) const{
+  if(!sorted_) ERROR("EventIndex must be sorted before lookup");
+  return binary_search(keys_.cbegin(), keys_.cend(), key);
+}
+
+/*!\brief Check if an event is in the index
+
+  \param[in] run Run number
+
+  \param[in] lumiblock Luminosity block
+
+  \param[in] event Event number
+
+  \return True if the event is in the index
+*/
+bool EventIndex::Contains(int32_t run, int32_t lumiblock, int64_t event) const{
+  Key key;
+  key.run_ = run;
+  key.lumiblock_ = lumiblock;
+  key.event_ = event;
+  return Contains(key);
+}
+
+/*!\brief Get number of events in index
+
+  \return Number of keys, counting duplicates if not yet sorted
+*/
+size_t EventIndex::Size() const{
+  return keys_.size();
+}
+
+/*!\brief Get all keys
+
+  \return Keys, in sorted order if Sort() has been called since the last
+  Insert()
+*/
+const vector<EventIndex::Key> & EventIndex::Keys() const{
+  return keys_;
+}
+
+/*!\brief Get approximate memory held by the index
+
+  \return Number of bytes
+*/
+size_t EventIndex::MemoryUsage() const{
+  return sizeof(*this) + keys_.capacity()*sizeof(Key);
+}
+
+/*!\brief Get events present in both indices
+
+  \param[in] other Index to intersect with
+
+  \return Sorted index of events in both *this and other
+*/
+EventIndex EventIndex::Intersection(const EventIndex &other) const{
+  if(!sorted_ || !other.sorted_) ERROR("EventIndex must be sorted before set operations");
+  EventIndex result;
+  set_intersection(keys_.cbegin(), keys_.cend(), other.keys_.cbegin(), other.keys_.cend(),
+                   back_inserter(result.keys_));
+  return result;
+}
+
+/*!\brief Get events present in either index
+
+  \param[in] other Index to merge with
+
+  \return Sorted index of events in *this or other
+*/
+EventIndex EventIndex::Union(const EventIndex &other) const{
+  if(!sorted_ || !other.sorted_) ERROR("EventIndex must be sorted before set operations");
+  EventIndex result;
+  result.keys_.reserve(keys_.size()+other.keys_.size());
+  set_union(keys_.cbegin(), keys_.cend(), other.keys_.cbegin(), other.keys_.cend(),
+            back_inserter(result.keys_));
+  return result;
+}
+
+/*!\brief Get events present in this index but not another
+
+  \param[in] other Index whose events to remove
+
+  \return Sorted index of events in *this but not other
+*/
+EventIndex EventIndex::Difference(const EventIndex &other) const{
+  if(!sorted_ || !other.sorted_) ERROR("EventIndex must be sorted before set operations");
+  EventIndex result;
+  set_difference(keys_.cbegin(), keys_.cend(), other.keys_.cbegin(), other.keys_.cend(),
+                 back_inserter(result.keys_));
+  return result;
+}
+
+/*!\brief Writes the index to a file
+
+  \param[in] path File to write
+
+  \param[in] text If true, write one "run lumiblock event" line per event
+  instead of the binary format
+*/
+void EventIndex::Write(const string &path, bool text) const{
+  ofstream file(path, text ? ios::out : ios::out | ios::binary);
+  if(!file) ERROR("Could not open "+path+" for writing");
+  if(text){
+    for(const auto &key: keys_){
+      file << key.run_ << ' ' << key.lumiblock_ << ' ' << key.event_ << '\n';
+    }
+  }else{
+    uint64_t num_keys = keys_.size();
+    file.write(index_magic, sizeof(index_magic));
+    file.write(reinterpret_cast<const char*>(&index_version), sizeof(index_version));
+    file.write(reinterpret_cast<const char*>(&num_keys), sizeof(num_keys));
+    for(const auto &key: keys_){
+      file.write(reinterpret_cast<const char*>(&key.run_), sizeof(key.run_));
+      file.write(reinterpret_cast<const char*>(&key.lumiblock_), sizeof(key.lumiblock_));
+      file.write(reinterpret_cast<const char*>(&key.event_), sizeof(key.event_));
+    }
+  }
+  if(!file) ERROR("Failed writing "+path);
+}
+
+/*!\brief Get cut selecting events in the index
+
+  The cut holds its own sorted copy of the index, so *this may be modified or
+  destroyed afterwards.
+
+  \param[in] name Name of returned NamedFunc. If empty, the name is derived
+  from a hash of the keys, so cuts from different indices never share a name.
+
+  \return NamedFunc that is true for events in the index
+*/
+NamedFunc EventIndex::Cut(const string &name) const{
+  shared_ptr<EventIndex> index = make_shared<EventIndex>(*this);
+  index->Sort();
+  string cut_name = name;
+  if(cut_name == ""){
+    uint64_t hash = 14695981039346656037ULL;
+    for(const auto &key: index->keys_){
+      const char *bytes[3] = {reinterpret_cast<const char*>(&key.run_),
+                              reinterpret_cast<const char*>(&key.lumiblock_),
+                              reinterpret_cast<const char*>(&key.event_)};
+      const size_t sizes[3] = {sizeof(key.run_), sizeof(key.lumiblock_), sizeof(key.event_)};
+      for(size_t i = 0; i < 3; ++i){
+        for(size_t ibyte = 0; ibyte < sizes[i]; ++ibyte){
+          hash ^= static_cast<unsigned char>(bytes[i][ibyte]);
+          hash *= 1099511628211ULL;
+        }
+      }
+    }
+    ostringstream oss;
+    oss << "in_event_list_" << hex << setw(16) << setfill('0') << hash;
+    cut_name = oss.str();
+  }
+  return NamedFunc(cut_name, [index](const Baby &b){
+      return index->Contains(b.run(), b.lumiblock(), b.event());
+    });
+}
+
+/*!\brief Get cut selecting events in an event list file
+
+  \param[in] path Binary or text event list to read
+
+  \param[in] name Name of returned NamedFunc. If empty, derived from the
+  content of the list as in Cut(const std::string &name).
+
+  \return NamedFunc that is true for events in the list
+*/
+NamedFunc EventIndex::Cut(const string &path, const string &name){
+  return EventIndex(path).Cut(name);
+}
+
+void EventIndex::ReadBinary(ifstream &file, const string &path){
+  uint32_t version = 0;
+  uint64_t num_keys = 0;
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&num_keys), sizeof(num_keys));
+  if(!file || version != index_version) ERROR("Bad event list header in "+path);
+  const uint64_t key_bytes = sizeof(Key::run_)+sizeof(Key::lumiblock_)+sizeof(Key::event_);
+  streampos begin = file.tellg();
+  file.seekg(0, ios::end);
+  streampos end = file.tellg();
+  file.seekg(begin);
+  if(!file || end < begin || num_keys > static_cast<uint64_t>(end-begin)/key_bytes){
+    ERROR("Truncated event list "+path+": header claims "+to_string(num_keys)+" events.");
+  }
+  keys_.resize(num_keys);
+  for(auto &key: keys_){
+    file.read(reinterpret_cast<char*>(&key.run_), sizeof(key.run_));
+    file.read(reinterpret_cast<char*>(&key.lumiblock_), sizeof(key.lumiblock_));
+    file.read(reinterpret_cast<char*>(&key.event_), sizeof(key.event_));
+  }
+  if(!file) ERROR("Truncated event list "+path);
+  sorted_ = false;
+}
+
+void EventIndex::ReadText(ifstream &file){
+  string line;
+  while(getline(file, line)){
+    istringstream iss(line);
+    Key key;
+    if(!(iss >> key.run_ >> key.lumiblock_ >> key.event_)) continue;
+    Insert(key);
+  }
+}
@@ -0,0 +1,129 @@
+/*! \class EventList
+
+  \brief Records the (run, lumiblock, event) keys of selected events for each
+  process
+
+  Unlike EventScan, which prints one text row per event, EventList only keeps
+  the event keys in an EventIndex, which is sorted and written to
+  name_LIST_process.evl once the event loop is done. The resulting files can be
+  combined with the combine_event_lists tool, or turned back into a cut with
+  EventIndex::Cut().
+*/
+#include "core/event_list.hpp"
+
+#include <iostream>
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+EventList::SingleList::SingleList(const EventList &event_list,
+                                  const shared_ptr<Process> &process):
+  FigureComponent(event_list, process),
+  index_(),
+  full_cut_(event_list.cut_ && process->cut_){
+}
+
+void EventList::SingleList::RecordEvent(const Baby &baby){
+  if(full_cut_.IsScalar()){
+    if(!full_cut_.GetScalar(baby)) return;
+  }else{
+    bool pass = false;
+    for(const auto &result: full_cut_.GetVector(baby)){
+      if(result){
+        pass = true;
+        break;
+      }
+    }
+    if(!pass) return;
+  }
+
+  EventIndex::Key key;
+  key.run_ = baby.run();
+  key.lumiblock_ = baby.lumiblock();
+  key.event_ = baby.event();
+  index_.Insert(key);
+}
+
+size_t EventList::SingleList::MemoryUsage() const{
+  return sizeof(*this) + index_.MemoryUsage() - sizeof(index_);
+}
+
+EventList::EventList(const string &name,
+                     const NamedFunc &cut,
+                     const vector<shared_ptr<Process> > &processes):
+  name_(name),
+  cut_(cut),
+  lists_(),
+  text_(false){
+  for(const auto& proc: processes){
+    lists_.emplace_back(new SingleList(*this, proc));
+  }
+}
+
+void EventList::Print(double /*luminosity*/,
+                      const std::string & /*subdir*/){
+  for(const auto &list: lists_){
+    list->index_.Sort();
+    string file_name = FileName(list->process_.get());
+    list->index_.Write(file_name, text_);
+    cout << file_name << ": " << list->index_.Size() << " events" << endl;
+  }
+}
+
+set<const Process*> EventList::GetProcesses() const{
+  set<const Process *> processes;
+  for(const auto &list: lists_){
+    processes.insert(list->process_.get());
+  }
+  return processes;
+}
+
+Figure::FigureComponent * EventList::GetComponent(const Process *process){
+  for(const auto &list: lists_){
+    if(list->process_.get() == process) return list.get();
+  }
+  return nullptr;
+}
+
+/*!\brief Get union of selected events across all processes
+
+  \return Sorted index of all selected events
+*/
+EventIndex EventList::Merged() const{
+  EventIndex merged;
+  for(const auto &list: lists_){
+    merged.Insert(list->index_);
+  }
+  merged.Sort();
+  return merged;
+}
+
+/*!\brief Get file to which the list for a process is written
+
+  \param[in] process Process whose list to locate
+
+  \return File name
+*/
+string EventList::FileName(const Process *process) const{
+  return CodeToPlainText(name_+"_LIST_"+process->name_)+(text_ ? ".txt" : ".evl");
+}
+
+/*!\brief Check whether lists are written as text
+
+  \return True if lists are written as "run lumiblock event" text
+*/
+bool EventList::Text() const{
+  return text_;
+}
+
+/*!\brief Set whether lists are written as text or binary
+
+  \param[in] text If true, write "run lumiblock event" text lists
+
+  \return Reference to *this
+*/
+EventList & EventList::Text(bool text){
+  text_ = text;
+  return *this;
+}
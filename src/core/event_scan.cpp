@@ -1,7 +1,36 @@
+/*! \class EventScan
+
+  \brief Prints the values of a set of columns for each selected event or
+  object
+
+  In the default text mode, each process writes a table to
+  name_SCAN_process.txt as events are read, repeating the column header every
+  8 rows. Since the table is formatted under the component lock, this
+  serializes threads and is slow for large scans.
+
+  In binary mode (EventScan::Binary(true)), each thread appends the values to
+  its own buffer without locking, and the buffers are merged and written as a
+  columnar file, name_SCAN_process.scan, when the figure is printed. The file
+  holds the magic "ESCN", a version, the number of columns and rows, the column
+  names, then one array of row numbers, one of instance numbers, and one of
+  values per column. Missing entries of vector columns are stored as NaN.
+  EventScan::Render() (or the render_event_scan executable) converts the file
+  into the same text table produced in text mode.
+
+  EventScan::MaxRows() limits the number of rows recorded per process. Once
+  every scan of a process is full, PlotMaker stops reading that process.
+*/
 #include "core/event_scan.hpp"
 
+#include <cstring>
+#include <cmath>
+
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
 
 #include <sys/stat.h>
 
@@ -9,53 +38,213 @@
 
 using namespace std;
 
+namespace{
+  const char scan_magic[4] = {'E', 'S', 'C', 'N'};
+  const uint32_t scan_version = 1;
+
+  atomic<size_t> next_scan_id(0);
+
+  template<typename T>
+    void WriteArray(ofstream &file, const vector<T> &values, const vector<size_t> &order){
+    for(const auto &i: order){
+      file.write(reinterpret_cast<const char*>(&values.at(i)), sizeof(T));
+    }
+  }
+
+  template<typename T>
+    void ReadArray(ifstream &file, vector<T> &values, size_t size){
+    values.resize(size);
+    file.read(reinterpret_cast<char*>(values.data()), size*sizeof(T));
+  }
+
+  void PrintHeader(ostream &out, const vector<string> &names, unsigned width){
+    out << "      Row Instance";
+    for(const auto &name: names){
+      out << ' ' << setw(width) << name.substr(0,width);
+    }
+    out.put('\n');
+  }
+}
+
+EventScan::SingleScan::Buffer::Buffer(size_t num_columns):
+  rows_(),
+  instances_(),
+  values_(num_columns),
+  cut_vector_(),
+  val_vectors_(num_columns){
+}
+
 EventScan::SingleScan::SingleScan(const EventScan &event_scan,
                                   const shared_ptr<Process> &process):
   FigureComponent(event_scan, process),
-  out_((CodeToPlainText(event_scan.name_+"_SCAN_"+process->name_)+".txt").c_str()),
+  out_(),
   full_cut_(event_scan.cut_ && process->cut_),
   cut_vector_(),
   val_vectors_(event_scan.columns_.size()),
-  row_(0){
+  row_(0),
+  id_(next_scan_id++),
+  buffers_mutex_(),
+  buffers_(){
   out_.precision(event_scan.Precision());
 }
 
 void EventScan::SingleScan::RecordEvent(const Baby &baby){
   const EventScan &scan = static_cast<const EventScan&>(figure_);
-  int w = scan.width_;
+  if(scan.binary_){
+    RecordBinary(baby);
+  }else{
+    RecordText(baby);
+  }
+}
 
+size_t EventScan::SingleScan::MemoryUsage() const{
+  size_t bytes = sizeof(*this) + cut_vector_.capacity()*sizeof(NamedFunc::ScalarType);
+  for(const auto &val_vector: val_vectors_){
+    bytes += sizeof(val_vector) + val_vector.capacity()*sizeof(NamedFunc::ScalarType);
+  }
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    bytes += sizeof(*buffer)
+      + buffer->rows_.capacity()*sizeof(uint64_t)
+      + buffer->instances_.capacity()*sizeof(uint32_t);
+    for(const auto &values: buffer->values_){
+      bytes += sizeof(values) + values.capacity()*sizeof(NamedFunc::ScalarType);
+    }
+  }
+  return bytes;
+}
+
+/*!\brief Binary scans keep one buffer per thread and need no lock
+
+  \return True in binary mode
+*/
+bool EventScan::SingleScan::Concurrent() const{
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
+  return scan.binary_;
+}
+
+/*!\brief Check if the maximum number of rows has been reached
+
+  \return True if no further rows will be recorded
+*/
+bool EventScan::SingleScan::Done() const{
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
+  return scan.max_rows_ != 0 && row_.load(memory_order_relaxed) >= scan.max_rows_;
+}
+
+void EventScan::SingleScan::Precision(unsigned precision){
+  out_.precision(precision);
+}
+
+/*!\brief Merges the per-thread buffers and writes them as a columnar file
+
+  Rows are written in increasing row number.
+
+  \param[in] path File to write
+*/
+void EventScan::SingleScan::WriteBinary(const string &path){
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
+  lock_guard<mutex> lock(buffers_mutex_);
+
+  Buffer merged(scan.columns_.size());
+  for(const auto &buffer: buffers_){
+    merged.rows_.insert(merged.rows_.end(), buffer->rows_.cbegin(), buffer->rows_.cend());
+    merged.instances_.insert(merged.instances_.end(), buffer->instances_.cbegin(), buffer->instances_.cend());
+    for(size_t icol = 0; icol < merged.values_.size(); ++icol){
+      merged.values_.at(icol).insert(merged.values_.at(icol).end(),
+                                     buffer->values_.at(icol).cbegin(),
+                                     buffer->values_.at(icol).cend());
+    }
+  }
+  vector<size_t> order(merged.rows_.size());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&merged](size_t a, size_t b){
+      if(merged.rows_.at(a) != merged.rows_.at(b)) return merged.rows_.at(a) < merged.rows_.at(b);
+      return merged.instances_.at(a) < merged.instances_.at(b);
+    });
+
+  ofstream file(path, ios::binary);
+  if(!file) ERROR("Could not open "+path+" for writing");
+  uint64_t num_columns = scan.columns_.size();
+  uint64_t num_values = order.size();
+  file.write(scan_magic, sizeof(scan_magic));
+  file.write(reinterpret_cast<const char*>(&scan_version), sizeof(scan_version));
+  file.write(reinterpret_cast<const char*>(&num_columns), sizeof(num_columns));
+  file.write(reinterpret_cast<const char*>(&num_values), sizeof(num_values));
+  for(const auto &col: scan.columns_){
+    string name = col.Name();
+    uint32_t name_size = name.size();
+    file.write(reinterpret_cast<const char*>(&name_size), sizeof(name_size));
+    file.write(name.data(), name.size());
+  }
+  WriteArray(file, merged.rows_, order);
+  WriteArray(file, merged.instances_, order);
+  for(const auto &values: merged.values_){
+    WriteArray(file, values, order);
+  }
+  if(!file) ERROR("Failed writing "+path);
+}
+
+/*!\brief Evaluates the cut and vector columns for the current event
+
+  \param[in] baby Baby containing the current event
+
+  \param[out] cut_vector Cut results if the cut is a vector
+
+  \param[out] val_vectors Values of vector columns
+
+  \return Number of instances to record, or 0 if the event fails the cut
+*/
+size_t EventScan::SingleScan::Evaluate(const Baby &baby,
+                                       NamedFunc::VectorType &cut_vector,
+                                       vector<NamedFunc::VectorType> &val_vectors) const{
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
   if(full_cut_.IsScalar()){
-    if(!full_cut_.GetScalar(baby)) return;
+    if(!full_cut_.GetScalar(baby)) return 0;
   }else{
-    cut_vector_ = full_cut_.GetVector(baby);
+    cut_vector = full_cut_.GetVector(baby);
   }
-  
+
   size_t max_size = 0;
   for(size_t icol = 0; icol < scan.columns_.size(); ++icol){
     const NamedFunc& col = scan.columns_.at(icol);
     if(col.IsScalar()){
       if(max_size < 1) max_size = 1;
     }else{
-      val_vectors_.at(icol) = col.GetVector(baby);
-      if(val_vectors_.at(icol).size() > max_size){
-	max_size = val_vectors_.at(icol).size();
+      val_vectors.at(icol) = col.GetVector(baby);
+      if(val_vectors.at(icol).size() > max_size){
+	max_size = val_vectors.at(icol).size();
       }
     }
   }
-  if(full_cut_.IsVector() && max_size > cut_vector_.size()){
-    max_size = cut_vector_.size();
+  if(full_cut_.IsVector() && max_size > cut_vector.size()){
+    max_size = cut_vector.size();
   }
+  return max_size;
+}
 
-  if(max_size > 0 && !(row_ & 0x7)){
-    out_ << "      Row Instance";
+void EventScan::SingleScan::RecordText(const Baby &baby){
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
+  int w = scan.width_;
+  size_t row = row_.load(memory_order_relaxed);
+  if(scan.max_rows_ != 0 && row >= scan.max_rows_) return;
+
+  size_t max_size = Evaluate(baby, cut_vector_, val_vectors_);
+  if(max_size == 0) return;
+
+  if(!out_.is_open()){
+    out_.open(scan.FileName(process_.get()).c_str());
+  }
+  if(!(row & 0x7)){
+    vector<string> names;
     for(const auto &col: scan.columns_){
-      out_ << ' ' << setw(w) << col.Name().substr(0,scan.width_);
+      names.push_back(col.Name());
     }
-    out_.put('\n');
+    PrintHeader(out_, names, scan.width_);
   }
 
   for(size_t instance = 0; instance < max_size; ++instance){
-    out_ << setw(9) << row_ << ' ' << setw(8) << instance;
+    out_ << setw(9) << row << ' ' << setw(8) << instance;
     for(size_t icol = 0; icol < scan.columns_.size(); ++icol){
       const NamedFunc& col = scan.columns_.at(icol);
       if(col.IsScalar()){
@@ -71,11 +260,52 @@ void EventScan::SingleScan::RecordEvent(const Baby &baby){
     out_.put('\n');
   }
 
-  if(max_size > 0) ++row_;
+  row_.store(row+1, memory_order_relaxed);
 }
 
-void EventScan::SingleScan::Precision(unsigned precision){
-  out_.precision(precision);
+void EventScan::SingleScan::RecordBinary(const Baby &baby){
+  const EventScan &scan = static_cast<const EventScan&>(figure_);
+  if(Done()) return;
+
+  Buffer &buffer = ThreadBuffer();
+  size_t max_size = Evaluate(baby, buffer.cut_vector_, buffer.val_vectors_);
+  if(max_size == 0) return;
+
+  size_t row = row_.fetch_add(1, memory_order_relaxed);
+  if(scan.max_rows_ != 0 && row >= scan.max_rows_) return;
+
+  for(size_t icol = 0; icol < scan.columns_.size(); ++icol){
+    const NamedFunc& col = scan.columns_.at(icol);
+    if(!col.IsScalar()) continue;
+    buffer.val_vectors_.at(icol).assign(1, col.GetScalar(baby));
+  }
+  for(size_t instance = 0; instance < max_size; ++instance){
+    buffer.rows_.push_back(row);
+    buffer.instances_.push_back(instance);
+    for(size_t icol = 0; icol < scan.columns_.size(); ++icol){
+      const NamedFunc::VectorType &vals = buffer.val_vectors_.at(icol);
+      size_t i = scan.columns_.at(icol).IsScalar() ? 0 : instance;
+      buffer.values_.at(icol).push_back(i < vals.size()
+                                        ? vals.at(i)
+                                        : numeric_limits<NamedFunc::ScalarType>::quiet_NaN());
+    }
+  }
+}
+
+/*!\brief Get the append buffer belonging to the calling thread
+
+  \return Buffer used only by the calling thread
+*/
+EventScan::SingleScan::Buffer & EventScan::SingleScan::ThreadBuffer(){
+  static thread_local unordered_map<size_t, Buffer*> thread_buffers;
+  Buffer *&buffer = thread_buffers[id_];
+  if(buffer == nullptr){
+    const EventScan &scan = static_cast<const EventScan&>(figure_);
+    lock_guard<mutex> lock(buffers_mutex_);
+    buffers_.emplace_back(new Buffer(scan.columns_.size()));
+    buffer = buffers_.back().get();
+  }
+  return *buffer;
 }
 
 EventScan::EventScan(const string &name,
@@ -88,7 +318,9 @@ EventScan::EventScan(const string &name,
   columns_(columns),
   scans_(),
   precision_(precision),
-  width_(precision+6){
+  width_(precision+6),
+  binary_(false),
+  max_rows_(0){
   for(const auto& proc: processes){
     scans_.emplace_back(new SingleScan(*this, proc));
   }
@@ -97,7 +329,13 @@ EventScan::EventScan(const string &name,
 void EventScan::Print(double /*luminosity*/,
                       const std::string & /*subdir*/){
   for(const auto &scan: scans_){
-    cout << "less " << (CodeToPlainText(name_+"_SCAN_"+scan->process_->name_)+".txt") << endl;
+    string file_name = FileName(scan->process_.get());
+    if(binary_){
+      scan->WriteBinary(file_name);
+      cout << "render_event_scan -p " << precision_ << ' ' << file_name << endl;
+    }else{
+      cout << "less " << file_name << endl;
+    }
   }
 }
 
@@ -128,3 +366,114 @@ EventScan & EventScan::Precision(unsigned precision){
   }
   return *this;
 }
+
+/*!\brief Check if scan is written in binary columnar format
+
+  \return True if binary mode is enabled
+*/
+bool EventScan::Binary() const{
+  return binary_;
+}
+
+/*!\brief Select binary columnar or text output
+
+  \param[in] binary If true, record into per-thread buffers and write a binary
+  file when printing
+
+  \return Reference to *this
+*/
+EventScan & EventScan::Binary(bool binary){
+  binary_ = binary;
+  return *this;
+}
+
+/*!\brief Get maximum number of rows recorded per process
+
+  \return Maximum number of rows, or 0 if unlimited
+*/
+size_t EventScan::MaxRows() const{
+  return max_rows_;
+}
+
+/*!\brief Limit the number of rows recorded per process
+
+  \param[in] max_rows Maximum number of rows, or 0 for no limit
+
+  \return Reference to *this
+*/
+EventScan & EventScan::MaxRows(size_t max_rows){
+  max_rows_ = max_rows;
+  return *this;
+}
+
+/*!\brief Get file to which the scan of a process is written
+
+  \param[in] process Process whose scan to locate
+
+  \return File name
+*/
+string EventScan::FileName(const Process *process) const{
+  return CodeToPlainText(name_+"_SCAN_"+process->name_)+(binary_ ? ".scan" : ".txt");
+}
+
+/*!\brief Converts a binary scan into the text table written in text mode
+
+  \param[in] binary_path Binary scan to read
+
+  \param[in] text_path Text file to write
+
+  \param[in] precision Number of significant digits to print
+*/
+void EventScan::Render(const string &binary_path,
+                       const string &text_path,
+                       unsigned precision){
+  ifstream file(binary_path, ios::binary);
+  if(!file) ERROR("Could not open "+binary_path);
+  char magic[sizeof(scan_magic)] = {};
+  uint32_t version = 0;
+  uint64_t num_columns = 0, num_values = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&num_columns), sizeof(num_columns));
+  file.read(reinterpret_cast<char*>(&num_values), sizeof(num_values));
+  if(!file || memcmp(magic, scan_magic, sizeof(magic)) != 0 || version != scan_version){
+    ERROR(binary_path+" is not a binary event scan");
+  }
+  vector<string> names(num_columns);
+  for(auto &name: names){
+    uint32_t name_size = 0;
+    file.read(reinterpret_cast<char*>(&name_size), sizeof(name_size));
+    name.resize(name_size);
+    if(name_size > 0) file.read(&name.at(0), name_size);
+  }
+  vector<uint64_t> rows;
+  vector<uint32_t> instances;
+  vector<vector<NamedFunc::ScalarType> > values(num_columns);
+  ReadArray(file, rows, num_values);
+  ReadArray(file, instances, num_values);
+  for(auto &column: values){
+    ReadArray(file, column, num_values);
+  }
+  if(!file) ERROR("Truncated event scan "+binary_path);
+
+  ofstream out(text_path);
+  if(!out) ERROR("Could not open "+text_path+" for writing");
+  out.precision(precision);
+  int w = precision+6;
+  size_t num_rows = 0;
+  for(size_t i = 0; i < num_values; ++i){
+    if(i == 0 || rows.at(i) != rows.at(i-1)){
+      if(!(num_rows & 0x7)) PrintHeader(out, names, w);
+      ++num_rows;
+    }
+    out << setw(9) << rows.at(i) << ' ' << setw(8) << instances.at(i);
+    for(const auto &column: values){
+      if(std::isnan(column.at(i))){
+        out << ' ' << setw(w) << ' ';
+      }else{
+        out << ' ' << setw(w) << column.at(i);
+      }
+    }
+    out.put('\n');
+  }
+}
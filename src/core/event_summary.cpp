@@ -0,0 +1,920 @@
+/*! \class EventSummary
+
+  \brief Collapses the events of each process into weighted records of a few
+  discretized quantities, so that tables can be refilled without the babies
+
+  Jobs such as table predictions and datacards read every event only to add
+  its weights into a few hundred bins, and repeat this for every change of a
+  systematic. An EventSummary declares the discretized quantities (Key)
+  defining those bins, e.g. N<sub>leps</sub>, N<sub>jets</sub>,
+  N<sub>b</sub>, and MET and m<sub>T</sub> bins, and the weights of interest,
+  e.g. the nominal weight and its variations. Added to a PlotMaker like any
+  other figure, it stores for each process one record per occupied bin with
+  the sum and the sum of squares of every weight, and writes them to
+  file_name_ when printed.
+
+  Once the file holds an up-to-date summary of a process, it is read back in
+  the constructor and the component needs no events. Tables calling
+  Table::Summarized() then fill every row whose cut can be evaluated from the
+  keys alone and whose weight is one of the summed weights from the records,
+  and only read events for the remaining rows. If all figures of a Baby are
+  served this way, the Baby is not opened at all.
+
+  A cut is expressible if it combines comparisons of a key with a constant,
+  and keys used as booleans, with "&&", "||", "!" and parentheses, and if
+  each comparison has the same result throughout every bin of its key, so
+  served rows equal the rows filled from events. Keys and weights are matched
+  to cuts and rows by name. Bins include their lower edge, unless
+  Key::IncludeInLowerBin() puts the values on an edge into the bin below, so
+  "met>=200" is expressible with a plain edge at 200, while "met>200" needs
+  that edge in the lower bin. NaN values go to a bin of their own, in which
+  every comparison has its IEEE result, false except for "!=", as it does
+  when the cut is evaluated on the event.
+
+  Summaries in the file are identified by the process name, cut, and the
+  names, sizes and modification times of its files, so a summary is rebuilt
+  when any of them changes. The keys and weights are checked for the whole
+  file.
+*/
+
+/*! \class EventSummary::Key
+
+  \brief Scalar quantity split into bins forming part of the record key
+*/
+
+/*! \class EventSummary::Selection
+
+  \brief Cut compiled to a function of the record key
+*/
+
+/*! \class EventSummary::SingleSummary
+
+  \brief Records of one process
+*/
+#include "core/event_summary.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <iomanip>
+#include <utility>
+
+#include <sys/stat.h>
+
+#include "core/checkpoint.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const char summary_magic[4] = {'P', 'M', 'E', 'S'};
+  const uint32_t summary_version = 2;
+
+  using Node = EventSummary::Selection::Node;
+
+  /*!\brief Describes a file by name, size and modification time
+
+    \param[in] path Path to file
+
+    \return Text changing whenever the file changes
+  */
+  string FileStamp(const string &path){
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) return path;
+    return path+' '+to_string(info.st_size)+' '+to_string(info.st_mtime);
+  }
+
+  bool Compare(double a, const string &op, double b);
+
+  /*!\brief Evaluates a comparison for all values in a bin
+
+    \param[in] key Key whose bin is tested
+
+    \param[in] ibin Index of bin
+
+    \param[in] op Comparison operator
+
+    \param[in] cut Constant compared to
+
+    \return 1 or 0 if the comparison is true or false throughout the bin, -1
+    if it depends on the value
+  */
+  int Decide(const EventSummary::Key &key, size_t ibin, const string &op, double cut){
+    // The bin of NaN values decides like the comparison in the event loop
+    if(key.IsNaNBin(ibin)) return Compare(numeric_limits<double>::quiet_NaN(), op, cut);
+    double low = key.Low(ibin), high = key.High(ibin);
+    bool low_in = key.LowIncluded(ibin), high_in = key.HighIncluded(ibin);
+    if(key.integer_){
+      // Only the integers in the bin occur, and comparisons are monotonic
+      double min = low_in ? ceil(low) : floor(low)+1.;
+      double max = high_in ? floor(high) : ceil(high)-1.;
+      if(min > max) return 0;
+      bool at_min = Compare(min, op, cut), at_max = Compare(max, op, cut);
+      if(op == "==" || op == "!="){
+        if(min == max) return at_min;
+        bool inside = cut == floor(cut) && cut >= min && cut <= max;
+        if(!inside) return op == "!=";
+        return -1;
+      }
+      if(at_min == at_max) return at_min;
+      return -1;
+    }
+    if(op == "==" || op == "!="){
+      bool outside = cut < low || cut > high || (cut == low && !low_in) || (cut == high && !high_in);
+      if(!outside) return -1;
+      return op == "!=";
+    }
+    // Every other comparison is value>cut, value>=cut or their negation
+    bool strict = op == ">" || op == "<=";
+    int above;
+    if(low > cut || (low == cut && (!strict || !low_in))) above = 1;
+    else if(high < cut || (high == cut && (strict || !high_in))) above = 0;
+    else return -1;
+    return (op == "<" || op == "<=") ? 1-above : above;
+  }
+
+  bool Compare(double a, const string &op, double b){
+    if(op == "==") return a == b;
+    if(op == "!=") return a != b;
+    if(op == ">") return a > b;
+    if(op == ">=") return a >= b;
+    if(op == "<") return a < b;
+    return a <= b;
+  }
+
+  string Flip(const string &op){
+    if(op == ">") return "<";
+    if(op == ">=") return "<=";
+    if(op == "<") return ">";
+    if(op == "<=") return ">=";
+    return op;
+  }
+
+  /*!\brief Recursive descent parser compiling the name of a cut into
+    EventSummary::Selection nodes
+  */
+  class CutParser{
+  public:
+    CutParser(const string &text,
+              const vector<EventSummary::Key> &keys,
+              const vector<uint64_t> &strides):
+      text_(text),
+      pos_(0),
+      keys_(keys),
+      strides_(strides),
+      nodes_(),
+      ok_(true){
+    }
+
+    bool Parse(vector<Node> &nodes){
+      Or();
+      Skip();
+      if(!ok_ || pos_ != text_.size() || nodes_.empty()) return false;
+      nodes = move(nodes_);
+      return true;
+    }
+
+  private:
+    struct Operand{
+      bool is_key_;
+      size_t key_;
+      double value_;
+    };
+
+    size_t Or(){
+      size_t left = And();
+      while(ok_ && Accept("||")){
+        size_t right = And();
+        left = Logical(Node::Type::logical_or, left, right);
+      }
+      return left;
+    }
+
+    size_t And(){
+      size_t left = Unary();
+      while(ok_ && Accept("&&")){
+        size_t right = Unary();
+        left = Logical(Node::Type::logical_and, left, right);
+      }
+      return left;
+    }
+
+    size_t Unary(){
+      Skip();
+      if(pos_+1 < text_.size() && text_.at(pos_) == '!' && text_.at(pos_+1) != '='){
+        ++pos_;
+        size_t operand = Unary();
+        return Logical(Node::Type::logical_not, operand, operand);
+      }
+      return Primary();
+    }
+
+    size_t Primary(){
+      if(Accept("(")){
+        size_t inner = Or();
+        if(!Accept(")")) ok_ = false;
+        return inner;
+      }
+      Operand left, right;
+      if(!ParseOperand(left)) return Fail();
+      string op = ParseComparison();
+      if(op == ""){
+        if(left.is_key_) return Atom(left.key_, "!=", 0.);
+        return Constant(left.value_ != 0.);
+      }
+      if(!ParseOperand(right) || (left.is_key_ && right.is_key_)) return Fail();
+      if(!left.is_key_ && !right.is_key_) return Constant(Compare(left.value_, op, right.value_));
+      if(right.is_key_){
+        swap(left, right);
+        op = Flip(op);
+      }
+      return Atom(left.key_, op, right.value_);
+    }
+
+    bool ParseOperand(Operand &operand){
+      Skip();
+      if(pos_ >= text_.size()) return false;
+      char c = text_.at(pos_);
+      if(isalpha(static_cast<unsigned char>(c)) || c == '_'){
+        size_t start = pos_;
+        while(pos_ < text_.size() && (isalnum(static_cast<unsigned char>(text_.at(pos_))) || text_.at(pos_) == '_')) ++pos_;
+        while(pos_ < text_.size() && text_.at(pos_) == '['){
+          size_t close = text_.find(']', pos_);
+          if(close == string::npos) return false;
+          pos_ = close+1;
+        }
+        string name = text_.substr(start, pos_-start);
+        for(size_t ikey = 0; ikey < keys_.size(); ++ikey){
+          if(keys_.at(ikey).var_.Name() != name) continue;
+          operand.is_key_ = true;
+          operand.key_ = ikey;
+          return true;
+        }
+        return false;
+      }
+      const char *start = text_.c_str()+pos_;
+      char *end = nullptr;
+      if(!(isdigit(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '+')) return false;
+      operand.is_key_ = false;
+      operand.value_ = strtod(start, &end);
+      if(end == start) return false;
+      pos_ += end-start;
+      return true;
+    }
+
+    string ParseComparison(){
+      for(const auto &op: {"==", "!=", ">=", "<=", ">", "<"}){
+        if(Accept(op)) return op;
+      }
+      return "";
+    }
+
+    size_t Atom(size_t ikey, const string &op, double cut){
+      const EventSummary::Key &key = keys_.at(ikey);
+      Node node = NewNode(Node::Type::atom);
+      node.stride_ = strides_.at(ikey);
+      node.num_bins_ = key.NumBins();
+      for(size_t ibin = 0; ibin < key.NumBins(); ++ibin){
+        int result = Decide(key, ibin, op, cut);
+        if(result < 0) return Fail();
+        node.truth_.push_back(result == 1);
+      }
+      nodes_.push_back(move(node));
+      return nodes_.size()-1;
+    }
+
+    size_t Constant(bool value){
+      Node node = NewNode(Node::Type::constant);
+      node.value_ = value;
+      nodes_.push_back(move(node));
+      return nodes_.size()-1;
+    }
+
+    size_t Logical(Node::Type type, size_t left, size_t right){
+      if(!ok_) return 0;
+      Node node = NewNode(type);
+      node.left_ = left;
+      node.right_ = right;
+      nodes_.push_back(move(node));
+      return nodes_.size()-1;
+    }
+
+    static Node NewNode(Node::Type type){
+      Node node;
+      node.type_ = type;
+      node.value_ = false;
+      node.stride_ = 1;
+      node.num_bins_ = 1;
+      node.left_ = 0;
+      node.right_ = 0;
+      return node;
+    }
+
+    size_t Fail(){
+      ok_ = false;
+      return 0;
+    }
+
+    bool Accept(const string &token){
+      Skip();
+      if(text_.compare(pos_, token.size(), token) != 0) return false;
+      pos_ += token.size();
+      return true;
+    }
+
+    void Skip(){
+      while(pos_ < text_.size() && isspace(static_cast<unsigned char>(text_.at(pos_)))) ++pos_;
+    }
+
+    const string &text_;//!<Cut being parsed
+    size_t pos_;//!<Position of next character to parse
+    const vector<EventSummary::Key> &keys_;//!<Keys that may appear in the cut
+    const vector<uint64_t> &strides_;//!<Stride of each key in the record key
+    vector<Node> nodes_;//!<Compiled nodes, with each node after its operands
+    bool ok_;//!<False once something not expressible in the keys was found
+  };
+}
+
+/*!\brief Standard constructor
+
+  \param[in] var Scalar quantity to discretize
+
+  \param[in] edges Increasing bin edges. Values below the first edge and at
+  or above the last edge go to an underflow and an overflow bin.
+
+  \param[in] integer True if var only takes integer values and all edges are
+  integers
+*/
+EventSummary::Key::Key(const NamedFunc &var,
+                       const vector<double> &edges,
+                       bool integer):
+  var_(var),
+  edges_(edges),
+  integer_(integer),
+  in_lower_bin_(edges.size(), false){
+  if(var_.IsVector()) ERROR("EventSummary keys must be scalar, but "+var_.Name()+" is a vector.");
+  for(size_t i = 0; i < edges_.size(); ++i){
+    if(i > 0 && !(edges_.at(i-1) < edges_.at(i))) ERROR("Bin edges of "+var_.Name()+" are not increasing.");
+    if(integer_ && edges_.at(i) != floor(edges_.at(i))) ERROR("Integer key "+var_.Name()+" has a non-integer edge.");
+  }
+}
+
+/*!\brief Get key with one bin for each integer value in a range
+
+  \param[in] var Integer-valued quantity, e.g. a number of jets
+
+  \param[in] min Lowest value with its own bin. Smaller values share the
+  underflow bin.
+
+  \param[in] max Values at or above max share the overflow bin
+
+  \return Key distinguishing the values min, min+1, ..., max-1 and >=max
+*/
+EventSummary::Key EventSummary::Key::Integer(const NamedFunc &var, int min, int max){
+  if(max < min) ERROR("Empty range for key "+var.Name()+".");
+  vector<double> edges;
+  for(int value = min; value <= max; ++value){
+    edges.push_back(value);
+  }
+  return Key(var, edges, true);
+}
+
+/*!\brief Puts values exactly on some edges into the bin below them
+
+  By default each bin includes its lower edge, which makes cuts such as
+  "met>=200" and "met<200" expressible. Moving the edge at 200 into the bin
+  below makes "met>200" and "met<=200" expressible instead.
+
+  \param[in] edges Edges whose values belong to the bin below them. Each must
+  be one of edges_.
+
+  \return Reference to *this
+*/
+EventSummary::Key & EventSummary::Key::IncludeInLowerBin(const vector<double> &edges){
+  for(const auto &edge: edges){
+    auto found = lower_bound(edges_.cbegin(), edges_.cend(), edge);
+    if(found == edges_.cend() || *found != edge){
+      ERROR("Key "+var_.Name()+" has no edge at "+to_string(edge)+".");
+    }
+    in_lower_bin_.at(found-edges_.cbegin()) = true;
+  }
+  return *this;
+}
+
+/*!\brief Get number of bins including underflow, overflow and NaN
+
+  \return Number of bins
+*/
+size_t EventSummary::Key::NumBins() const{
+  return edges_.size()+2;
+}
+
+/*!\brief Find bin containing a value
+
+  \param[in] value Value of Key::var_
+
+  \return Index of bin, 0 for underflow, NumBins()-2 for overflow and
+  NumBins()-1 for NaN
+*/
+size_t EventSummary::Key::Bin(NamedFunc::ScalarType value) const{
+  if(std::isnan(value)) return edges_.size()+1;
+  size_t ibin = upper_bound(edges_.cbegin(), edges_.cend(), value) - edges_.cbegin();
+  if(ibin > 0 && edges_.at(ibin-1) == value && in_lower_bin_.at(ibin-1)) --ibin;
+  return ibin;
+}
+
+/*!\brief Get lower edge of a bin
+
+  \param[in] ibin Index of bin
+
+  \return Lower edge of bin, -infinity for the underflow bin, NaN for the NaN
+  bin
+*/
+double EventSummary::Key::Low(size_t ibin) const{
+  if(IsNaNBin(ibin)) return numeric_limits<double>::quiet_NaN();
+  return ibin == 0 ? -numeric_limits<double>::infinity() : edges_.at(ibin-1);
+}
+
+/*!\brief Get upper edge of a bin
+
+  \param[in] ibin Index of bin
+
+  \return Upper edge of bin, infinity for the overflow bin, NaN for the NaN
+  bin
+*/
+double EventSummary::Key::High(size_t ibin) const{
+  if(IsNaNBin(ibin)) return numeric_limits<double>::quiet_NaN();
+  return ibin == edges_.size() ? numeric_limits<double>::infinity() : edges_.at(ibin);
+}
+
+/*!\brief Check if values on the lower edge of a bin belong to it
+
+  \param[in] ibin Index of bin
+
+  \return True if the bin includes Low(ibin)
+*/
+bool EventSummary::Key::LowIncluded(size_t ibin) const{
+  if(IsNaNBin(ibin)) return false;
+  return ibin == 0 || !in_lower_bin_.at(ibin-1);
+}
+
+/*!\brief Check if values on the upper edge of a bin belong to it
+
+  \param[in] ibin Index of bin
+
+  \return True if the bin includes High(ibin)
+*/
+bool EventSummary::Key::HighIncluded(size_t ibin) const{
+  return ibin < edges_.size() && in_lower_bin_.at(ibin);
+}
+
+/*!\brief Check if a bin holds the NaN values
+
+  \param[in] ibin Index of bin
+
+  \return True for the last bin
+*/
+bool EventSummary::Key::IsNaNBin(size_t ibin) const{
+  return ibin == edges_.size()+1;
+}
+
+/*!\brief Get text describing quantity and binning
+
+  \return Name of quantity followed by bin edges, with "]" after edges
+  belonging to the bin below
+*/
+string EventSummary::Key::Definition() const{
+  ostringstream oss;
+  oss << setprecision(17) << var_.Name() << (integer_ ? " integer" : "");
+  for(size_t i = 0; i < edges_.size(); ++i){
+    oss << ' ' << edges_.at(i) << (in_lower_bin_.at(i) ? "]" : "");
+  }
+  return oss.str();
+}
+
+/*!\brief Check if a record passes the selection
+
+  \param[in] record Bin key of record
+
+  \return True if all events of the record pass the cut
+*/
+bool EventSummary::Selection::Pass(uint64_t record) const{
+  return !nodes_.empty() && Evaluate(nodes_.size()-1, record);
+}
+
+bool EventSummary::Selection::Evaluate(size_t inode, uint64_t record) const{
+  const Node &node = nodes_.at(inode);
+  switch(node.type_){
+  case Node::Type::constant:
+    return node.value_;
+  case Node::Type::atom:
+    return node.truth_.at((record/node.stride_)%node.num_bins_);
+  case Node::Type::logical_not:
+    return !Evaluate(node.left_, record);
+  case Node::Type::logical_and:
+    return Evaluate(node.left_, record) && Evaluate(node.right_, record);
+  case Node::Type::logical_or:
+    return Evaluate(node.left_, record) || Evaluate(node.right_, record);
+  default:
+    return false;
+  }
+}
+
+EventSummary::SingleSummary::SingleSummary(const EventSummary &event_summary,
+                                           const shared_ptr<Process> &process):
+  FigureComponent(event_summary, process),
+  identity_(process->name_+'\n'+process->cut_.Name()),
+  keys_(),
+  sums_(),
+  exact_sums_(),
+  index_(),
+  reproducible_(false),
+  loaded_(false){
+  set<string> files;
+  for(const auto &baby: process->Babies()){
+    files.insert(baby->FileNames().cbegin(), baby->FileNames().cend());
+  }
+  for(const auto &file: files){
+    identity_ += '\n'+FileStamp(file);
+  }
+}
+
+void EventSummary::SingleSummary::RecordEvent(const Baby &baby){
+  if(loaded_) return;
+  const EventSummary &summary = static_cast<const EventSummary&>(figure_);
+  uint64_t key = 0;
+  for(size_t ikey = 0; ikey < summary.keys_.size(); ++ikey){
+    const Key &summary_key = summary.keys_.at(ikey);
+    key += summary.strides_.at(ikey)*summary_key.Bin(summary_key.var_.GetScalar(baby));
+  }
+  size_t num_weights = summary.weights_.size();
+  size_t first = 2*num_weights*Record(key);
+  for(size_t iweight = 0; iweight < num_weights; ++iweight){
+    NamedFunc::ScalarType wgt = summary.weights_.at(iweight).GetScalar(baby);
+    size_t isum = first+2*iweight;
+    if(reproducible_){
+      exact_sums_.at(isum) += wgt;
+      exact_sums_.at(isum+1) += wgt*wgt;
+    }else{
+      sums_.at(isum) += wgt;
+      sums_.at(isum+1) += wgt*wgt;
+    }
+  }
+}
+
+size_t EventSummary::SingleSummary::MemoryUsage() const{
+  return sizeof(*this)
+    + keys_.capacity()*sizeof(uint64_t)
+    + sums_.capacity()*sizeof(double)
+    + exact_sums_.capacity()*sizeof(ExactSum)
+    + index_.size()*(sizeof(uint64_t)+sizeof(size_t)+sizeof(void*));
+}
+
+/*!\brief Check if the records were read from file
+
+  \return True if no further events are needed
+*/
+bool EventSummary::SingleSummary::Done() const{
+  return loaded_;
+}
+
+/*!\brief Accumulate sums exactly, so they do not depend on the order in
+  which babies are processed
+
+  \param[in] reproducible If true, use ExactSum for the sums
+*/
+void EventSummary::SingleSummary::Reproducible(bool reproducible){
+  reproducible_ = reproducible;
+  if(reproducible_) exact_sums_.resize(sums_.size());
+}
+
+/*!\brief Folds the exact sums into the records and orders them by bin key
+ */
+void EventSummary::SingleSummary::Finalize(){
+  if(loaded_) return;
+  if(reproducible_){
+    for(size_t isum = 0; isum < sums_.size(); ++isum){
+      ExactSum sum = exact_sums_.at(isum);
+      sum += sums_.at(isum);
+      sums_.at(isum) = sum.Value();
+      exact_sums_.at(isum).Clear();
+    }
+  }
+
+  size_t width = sums_.size()/max(keys_.size(), static_cast<size_t>(1));
+  vector<size_t> order(keys_.size());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [this](size_t a, size_t b){return keys_.at(a) < keys_.at(b);});
+  vector<uint64_t> keys(keys_.size());
+  vector<double> sums(sums_.size());
+  for(size_t irecord = 0; irecord < order.size(); ++irecord){
+    keys.at(irecord) = keys_.at(order.at(irecord));
+    copy(sums_.cbegin()+order.at(irecord)*width, sums_.cbegin()+(order.at(irecord)+1)*width,
+         sums.begin()+irecord*width);
+  }
+  keys_ = move(keys);
+  sums_ = move(sums);
+  Index();
+}
+
+string EventSummary::SingleSummary::Definition() const{
+  const EventSummary &summary = static_cast<const EventSummary&>(figure_);
+  return "EventSummary;"+summary.Definition()+';'+identity_;
+}
+
+bool EventSummary::SingleSummary::SaveState(ostream &out) const{
+  Checkpoint::Write(out, keys_);
+  Checkpoint::Write(out, sums_);
+  Checkpoint::Write(out, exact_sums_);
+  return true;
+}
+
+void EventSummary::SingleSummary::LoadState(istream &in){
+  Checkpoint::Read(in, keys_);
+  Checkpoint::Read(in, sums_);
+  Checkpoint::Read(in, exact_sums_);
+  Index();
+}
+
+/*!\brief Check if the records were read from file
+
+  \return True if the summary can serve table rows
+*/
+bool EventSummary::SingleSummary::Loaded() const{
+  return loaded_;
+}
+
+/*!\brief Get number of occupied bins
+
+  \return Number of records
+*/
+size_t EventSummary::SingleSummary::NumRecords() const{
+  return keys_.size();
+}
+
+/*!\brief Adds up a weight over the records passing a selection
+
+  Records are visited in order of their bin key, so the result does not
+  depend on how the summary was filled.
+
+  \param[in] selection Cut compiled by EventSummary::Compile()
+
+  \param[in] iweight Index of weight from EventSummary::WeightIndex()
+
+  \param[in,out] sumw Sum of weights, to which the records are added
+
+  \param[in,out] sumw2 Sum of squared weights, to which the records are
+  added
+*/
+void EventSummary::SingleSummary::Sum(const Selection &selection, size_t iweight,
+                                      double &sumw, double &sumw2) const{
+  const EventSummary &summary = static_cast<const EventSummary&>(figure_);
+  size_t num_weights = summary.weights_.size();
+  for(size_t irecord = 0; irecord < keys_.size(); ++irecord){
+    if(!selection.Pass(keys_.at(irecord))) continue;
+    size_t isum = 2*(irecord*num_weights+iweight);
+    sumw += sums_.at(isum);
+    sumw2 += sums_.at(isum+1);
+  }
+}
+
+/*!\brief Get record of a bin key, adding an empty one if needed
+
+  \param[in] key Bin key
+
+  \return Index of record
+*/
+size_t EventSummary::SingleSummary::Record(uint64_t key){
+  auto found = index_.find(key);
+  if(found != index_.end()) return found->second;
+  const EventSummary &summary = static_cast<const EventSummary&>(figure_);
+  size_t irecord = keys_.size();
+  keys_.push_back(key);
+  sums_.resize(sums_.size()+2*summary.weights_.size(), 0.);
+  if(reproducible_) exact_sums_.resize(sums_.size());
+  index_.emplace(key, irecord);
+  return irecord;
+}
+
+/*!\brief Rebuilds the lookup from bin key to record
+ */
+void EventSummary::SingleSummary::Index(){
+  index_.clear();
+  for(size_t irecord = 0; irecord < keys_.size(); ++irecord){
+    index_.emplace(keys_.at(irecord), irecord);
+  }
+}
+
+/*!\brief Standard constructor
+
+  Summaries already in file_name for the same keys, weights and processes
+  are read immediately.
+
+  \param[in] file_name File holding the summaries
+
+  \param[in] keys Discretized quantities forming the bins
+
+  \param[in] weights Scalar weights summed in each bin, e.g. the nominal
+  weight and its variations
+
+  \param[in] processes Processes to summarize
+*/
+EventSummary::EventSummary(const string &file_name,
+                           const vector<Key> &keys,
+                           const vector<NamedFunc> &weights,
+                           const vector<shared_ptr<Process> > &processes):
+  Figure(),
+  file_name_(file_name),
+  keys_(keys),
+  weights_(weights),
+  summaries_(),
+  other_sections_(),
+  strides_(){
+  uint64_t stride = 1;
+  for(const auto &key: keys_){
+    strides_.push_back(stride);
+    if(key.NumBins() > numeric_limits<uint64_t>::max()/stride){
+      ERROR("Too many bins in the keys of event summary "+file_name_+".");
+    }
+    stride *= key.NumBins();
+  }
+  for(const auto &weight: weights_){
+    if(weight.IsVector()) ERROR("EventSummary weights must be scalar, but "+weight.Name()+" is a vector.");
+  }
+  for(const auto &process: processes){
+    summaries_.emplace_back(new SingleSummary(*this, process));
+  }
+  Load();
+}
+
+/*!\brief Reports the records of each process and writes the summaries built
+  from events to file_name_
+*/
+void EventSummary::Print(double /*luminosity*/,
+                         const string & /*subdir*/){
+  bool built = false;
+  for(const auto &summary: summaries_){
+    if(!summary->loaded_) built = true;
+    cout << "Event summary " << file_name_ << ": " << summary->NumRecords() << " records for "
+         << summary->process_->name_ << (summary->loaded_ ? " read from file" : " built from events") << endl;
+  }
+  if(built) Save();
+}
+
+set<const Process*> EventSummary::GetProcesses() const{
+  set<const Process*> processes;
+  for(const auto &summary: summaries_){
+    processes.insert(summary->process_.get());
+  }
+  return processes;
+}
+
+Figure::FigureComponent * EventSummary::GetComponent(const Process *process){
+  for(const auto &summary: summaries_){
+    if(summary->process_.get() == process){
+      return summary.get();
+    }
+  }
+  DBG("Could not find summary for process "+process->name_+".");
+  return nullptr;
+}
+
+/*!\brief Get the summary of a process if it was read from file
+
+  \param[in] process Process to look up
+
+  \return Summary able to serve table rows, or nullptr
+*/
+const EventSummary::SingleSummary * EventSummary::Loaded(const Process *process) const{
+  for(const auto &summary: summaries_){
+    if(summary->process_.get() == process && summary->loaded_) return summary.get();
+  }
+  return nullptr;
+}
+
+/*!\brief Find a summed weight by name
+
+  \param[in] weight Weight to look up
+
+  \return Index in weights_, or -1 if the weight is not summed
+*/
+long EventSummary::WeightIndex(const NamedFunc &weight) const{
+  for(size_t iweight = 0; iweight < weights_.size(); ++iweight){
+    if(weights_.at(iweight).Name() == weight.Name()) return iweight;
+  }
+  return -1;
+}
+
+/*!\brief Compiles a cut to a function of the record key
+
+  \param[in] cut Cut to compile, typically the cut of a table row
+
+  \param[out] selection Compiled cut, if expressible
+
+  \return True if the cut is expressible in the keys
+*/
+bool EventSummary::Compile(const NamedFunc &cut, Selection &selection) const{
+  if(cut.IsVector()) return false;
+  vector<Node> nodes;
+  CutParser parser(cut.Name(), keys_, strides_);
+  if(!parser.Parse(nodes)) return false;
+  selection.nodes_ = move(nodes);
+  return true;
+}
+
+/*!\brief Get text describing the keys and weights
+
+  \return Definition shared by all summaries in file_name_
+*/
+string EventSummary::Definition() const{
+  string definition = "keys";
+  for(const auto &key: keys_){
+    definition += ';'+key.Definition();
+  }
+  definition += ";weights";
+  for(const auto &weight: weights_){
+    definition += ';'+weight.Name();
+  }
+  return definition;
+}
+
+/*!\brief Reads the summaries in file_name_ matching the processes
+ */
+void EventSummary::Load(){
+  ifstream file(file_name_, ios::binary);
+  if(!file.is_open()) return;
+
+  char magic[4];
+  uint32_t version = 0;
+  string definition;
+  uint64_t num_sections = 0;
+  file.read(magic, sizeof(magic));
+  Checkpoint::Read(file, version);
+  if(!file || !equal(magic, magic+4, summary_magic) || version != summary_version){
+    cout << "Ignoring unreadable event summary " << file_name_ << '.' << endl;
+    return;
+  }
+  Checkpoint::Read(file, definition);
+  Checkpoint::Read(file, num_sections);
+  if(definition != Definition()){
+    cout << "Ignoring event summary " << file_name_ << ": keys or weights have changed." << endl;
+    return;
+  }
+
+  for(uint64_t isection = 0; isection < num_sections; ++isection){
+    Section section;
+    Checkpoint::Read(file, section.identity_);
+    Checkpoint::Read(file, section.keys_);
+    Checkpoint::Read(file, section.sums_);
+    if(!file || section.sums_.size() != 2*weights_.size()*section.keys_.size()){
+      ERROR("Event summary "+file_name_+" is truncated.");
+    }
+    bool matched = false;
+    for(auto &summary: summaries_){
+      if(summary->loaded_ || summary->identity_ != section.identity_) continue;
+      summary->keys_ = move(section.keys_);
+      summary->sums_ = move(section.sums_);
+      summary->Index();
+      summary->loaded_ = true;
+      matched = true;
+      break;
+    }
+    if(!matched) other_sections_.push_back(move(section));
+  }
+}
+
+/*!\brief Writes all summaries to file_name_, through a temporary file
+ */
+void EventSummary::Save() const{
+  string temp_path = file_name_+".tmp";
+  {
+    ofstream file(temp_path, ios::binary | ios::trunc);
+    file.write(summary_magic, sizeof(summary_magic));
+    Checkpoint::Write(file, summary_version);
+    Checkpoint::Write(file, Definition());
+    Checkpoint::Write(file, static_cast<uint64_t>(summaries_.size()+other_sections_.size()));
+    for(const auto &summary: summaries_){
+      Checkpoint::Write(file, summary->identity_);
+      Checkpoint::Write(file, summary->keys_);
+      Checkpoint::Write(file, summary->sums_);
+    }
+    for(const auto &section: other_sections_){
+      Checkpoint::Write(file, section.identity_);
+      Checkpoint::Write(file, section.keys_);
+      Checkpoint::Write(file, section.sums_);
+    }
+    file.close();
+    if(!file) ERROR("Could not write event summary "+temp_path+".");
+  }
+  if(rename(temp_path.c_str(), file_name_.c_str()) != 0){
+    ERROR("Could not move event summary to "+file_name_+".");
+  }
+}
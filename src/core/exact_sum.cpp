@@ -0,0 +1,207 @@
+/*! \class ExactSum
+
+  \brief Sum of doubles whose value does not depend on the order of the
+  additions
+
+  Every addend is split exactly into fixed-point limbs of 32 bits spanning the
+  full range of double, so the sum is held without rounding and integer
+  additions make the result independent of the order in which values (or
+  other ExactSums) are added. Value() rounds the exact sum back to a double
+  from its unique normalized form, so any two ExactSums holding the same
+  addends return bitwise identical results.
+
+  Only the limbs touched by the addends are stored, so a sum of values spread
+  over a few orders of magnitude takes a handful of limbs. Infinite and NaN
+  addends are summed separately and dominate the result, as they would in
+  ordinary floating point.
+*/
+#include "core/exact_sum.hpp"
+
+#include <cmath>
+
+#include "core/checkpoint.hpp"
+
+using namespace std;
+
+namespace{
+  const int64_t limb_mask = 0xffffffff;
+}
+
+/*!\brief Constructs a sum equal to zero
+ */
+ExactSum::ExactSum():
+  limbs_(),
+  first_(0),
+  special_(0.),
+  pending_(0){
+}
+
+/*!\brief Adds a value to the sum
+
+  \param[in] x Value to add
+
+  \return Reference to *this
+*/
+ExactSum & ExactSum::operator+=(double x){
+  if(x == 0.) return *this;
+  if(!isfinite(x)){
+    special_ += x;
+    return *this;
+  }
+
+  // x = mantissa * 2^(shift+min_exponent_), with |mantissa| < 2^53 and shift >= 0
+  int exponent = 0;
+  int64_t mantissa = static_cast<int64_t>(ldexp(frexp(x, &exponent), 53));
+  int shift = exponent - 53 - min_exponent_;
+  size_t index = shift/limb_bits_;
+  int offset = shift%limb_bits_;
+
+  uint64_t magnitude = static_cast<uint64_t>(mantissa < 0 ? -mantissa : mantissa);
+  uint64_t low = (magnitude & limb_mask) << offset;
+  uint64_t high = (magnitude >> limb_bits_) << offset;
+  int64_t parts[3] = {static_cast<int64_t>(low & limb_mask),
+                      static_cast<int64_t>((low >> limb_bits_) + (high & limb_mask)),
+                      static_cast<int64_t>(high >> limb_bits_)};
+
+  Reserve(index, index+2);
+  for(size_t i = 0; i < 3; ++i){
+    limbs_.at(index-first_+i) += mantissa < 0 ? -parts[i] : parts[i];
+  }
+  if(++pending_ >= max_pending_) Compact();
+  return *this;
+}
+
+/*!\brief Adds another sum to this one
+
+  \param[in] other Sum to add
+
+  \return Reference to *this
+*/
+ExactSum & ExactSum::operator+=(const ExactSum &other){
+  special_ += other.special_;
+  if(other.limbs_.empty()) return *this;
+
+  ExactSum addend(other);
+  addend.Compact();
+  Compact();
+  Reserve(addend.first_, addend.first_+addend.limbs_.size()-1);
+  for(size_t i = 0; i < addend.limbs_.size(); ++i){
+    limbs_.at(addend.first_-first_+i) += addend.limbs_.at(i);
+  }
+  ++pending_;
+  return *this;
+}
+
+/*!\brief Get the sum rounded to a double
+
+  \return Sum of all addends
+*/
+double ExactSum::Value() const{
+  if(special_ != 0.) return special_;
+
+  vector<int64_t> limbs = limbs_;
+  int64_t carry = Propagate(limbs);
+  bool negative = carry < 0;
+  if(negative){
+    limbs = limbs_;
+    for(auto &limb: limbs) limb = -limb;
+    carry = Propagate(limbs);
+  }
+  for(; carry > 0; carry >>= limb_bits_){
+    limbs.push_back(carry & limb_mask);
+  }
+
+  double value = 0.;
+  for(size_t i = limbs.size(); i-- > 0; ){
+    value += ldexp(static_cast<double>(limbs.at(i)),
+                   limb_bits_*static_cast<int>(first_+i) + min_exponent_);
+  }
+  return negative ? -value : value;
+}
+
+/*!\brief Resets the sum to zero
+ */
+void ExactSum::Clear(){
+  limbs_.clear();
+  first_ = 0;
+  special_ = 0.;
+  pending_ = 0;
+}
+
+/*!\brief Get approximate memory used by the sum
+
+  \return Number of bytes
+*/
+size_t ExactSum::MemoryUsage() const{
+  return sizeof(*this) + limbs_.capacity()*sizeof(int64_t);
+}
+
+/*!\brief Writes the exact state of the sum
+
+  \param[in,out] out Stream to write to
+*/
+void ExactSum::SaveState(ostream &out) const{
+  Checkpoint::Write(out, limbs_);
+  Checkpoint::Write(out, static_cast<uint64_t>(first_));
+  Checkpoint::Write(out, special_);
+  Checkpoint::Write(out, pending_);
+}
+
+/*!\brief Replaces the sum with a state written by SaveState()
+
+  \param[in,out] in Stream to read from
+*/
+void ExactSum::LoadState(istream &in){
+  uint64_t first = 0;
+  Checkpoint::Read(in, limbs_);
+  Checkpoint::Read(in, first);
+  Checkpoint::Read(in, special_);
+  Checkpoint::Read(in, pending_);
+  first_ = first;
+}
+
+/*!\brief Makes sure limbs first through last are stored
+
+  \param[in] first Index of lowest limb needed
+
+  \param[in] last Index of highest limb needed
+*/
+void ExactSum::Reserve(size_t first, size_t last){
+  if(limbs_.empty()){
+    first_ = first;
+    limbs_.assign(last-first+1, 0);
+    return;
+  }
+  if(first < first_){
+    limbs_.insert(limbs_.begin(), first_-first, 0);
+    first_ = first;
+  }
+  if(last >= first_+limbs_.size()){
+    limbs_.resize(last-first_+1, 0);
+  }
+}
+
+/*!\brief Propagates carries so that limbs regain headroom for further
+  additions
+*/
+void ExactSum::Compact(){
+  int64_t carry = Propagate(limbs_);
+  if(carry != 0) limbs_.push_back(carry);
+  pending_ = 0;
+}
+
+/*!\brief Brings every limb into [0, 2^32) by moving carries to the next limb
+
+  \param[in,out] limbs Limbs to normalize
+
+  \return Carry out of the highest limb, possibly negative
+*/
+int64_t ExactSum::Propagate(vector<int64_t> &limbs){
+  int64_t carry = 0;
+  for(auto &limb: limbs){
+    limb += carry;
+    carry = limb >= 0 ? limb >> limb_bits_ : -((-limb-1) >> limb_bits_) - 1;
+    limb -= carry*(limb_mask+1);
+  }
+  return carry;
+}
@@ -4,9 +4,151 @@
 
 using namespace std;
 
+/*!\brief Standard constructor
+ */
+Figure::Figure():
+  output_stage_(nullptr){
+}
+
+/*!\brief Hand tables and plots to an OutputStage instead of writing them
+  immediately
+
+  Figures that do not support batching ignore the stage.
+
+  \param[in] output_stage Stage collecting outputs, or nullptr to write outputs
+  immediately
+*/
+void Figure::UseOutputStage(OutputStage *output_stage){
+  output_stage_ = output_stage;
+}
+
 Figure::FigureComponent::FigureComponent(const Figure &figure,
                                          const shared_ptr<Process> &process):
   figure_(figure),
   process_(process),
   mutex_(){
 }
+
+/*!\brief Get approximate memory used to store this component's results
+
+  \return Number of bytes
+*/
+size_t Figure::FigureComponent::MemoryUsage() const{
+  return 0;
+}
+
+/*!\brief Limit the memory this component may use for storing results
+
+  Components whose memory does not grow with the number of events ignore the
+  limit.
+
+  \param[in] bytes Maximum number of bytes
+
+  \param[in] num_threads Number of threads that may call RecordEvent() at once
+*/
+void Figure::FigureComponent::MemoryLimit(size_t /*bytes*/, size_t /*num_threads*/){
+}
+
+/*!\brief Check if MemoryLimit() changes how the component stores its results
+
+  PlotMaker::ApplyMemoryBudget shares the budget only among components that
+  return true.
+
+  \return True if the component overrides MemoryLimit()
+*/
+bool Figure::FigureComponent::MemoryLimited() const{
+  return false;
+}
+
+/*!\brief Check if RecordEvent may be called from several threads at once
+
+  PlotMaker locks mutex_ around RecordEvent for components that return false.
+
+  \return True if the component synchronizes its own results
+*/
+bool Figure::FigureComponent::Concurrent() const{
+  return false;
+}
+
+/*!\brief Check if the component needs no further events
+
+  \return True if RecordEvent would ignore all further events
+*/
+bool Figure::FigureComponent::Done() const{
+  return false;
+}
+
+/*!\brief Request results that do not depend on the order of the events
+
+  Components whose results are not sums, or are insensitive to the order of
+  the events, ignore the request.
+
+  \param[in] reproducible If true, accumulate sums exactly
+*/
+void Figure::FigureComponent::Reproducible(bool /*reproducible*/){
+}
+
+/*!\brief Moves results accumulated during the event loop into their final
+  form
+
+  Called by PlotMaker once all events have been recorded.
+*/
+void Figure::FigureComponent::Finalize(){
+}
+
+/*!\brief Prepares functions specialized to the file-level constants of a Baby
+
+  Called by PlotMaker, with mutex_ held, before recording the events of baby.
+  Components that do not specialize their functions ignore the call and keep
+  evaluating the general ones.
+
+  \param[in] baby Baby whose events are about to be recorded
+
+  \see NamedFunc::Specialized()
+*/
+void Figure::FigureComponent::Specialize(const Baby &/*baby*/){
+}
+
+/*!\brief Releases functions prepared by Specialize()
+
+  Called by PlotMaker, with mutex_ held, once all events of baby are recorded.
+
+  \param[in] baby Baby whose events have been recorded
+*/
+void Figure::FigureComponent::Unspecialize(const Baby &/*baby*/){
+}
+
+/*!\brief Get a description of everything determining the results
+
+  Used by Checkpoint to reject saved states from a different configuration.
+
+  \return Figure type, variables, binning, cuts, weights and process of the
+  component
+*/
+string Figure::FigureComponent::Definition() const{
+  return process_->name_;
+}
+
+/*!\brief Writes the results accumulated so far
+
+  Called by PlotMaker between babies, while no events are being recorded.
+  Components whose results cannot be saved return false, which disables
+  checkpointing.
+
+  \param[in,out] out Stream to which the state is written
+
+  \return True if the state was written
+*/
+bool Figure::FigureComponent::SaveState(ostream &/*out*/) const{
+  return false;
+}
+
+/*!\brief Replaces the accumulated results with a state written by SaveState()
+
+  Called by PlotMaker before the event loop.
+
+  \param[in,out] in Stream from which the state is read
+*/
+void Figure::FigureComponent::LoadState(istream &/*in*/){
+  ERROR("Cannot restore the state of a component for process "+process_->name_+".");
+}
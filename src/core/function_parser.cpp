@@ -26,6 +26,7 @@
 #include "core/utilities.hpp"
 #include "core/named_func.hpp"
 #include "core/functions.hpp"
+#include "core/setup_profiler.hpp"
 
 using namespace std;
 
@@ -224,10 +225,7 @@ void FunctionParser::ResolveVariables() const{
     }else if(token.type_ == Token::Type::number){
       char *cp = nullptr;
       NamedFunc::ScalarType val = strtod(&token.string_rep_[0], &cp);
-      token.function_ = NamedFunc(token.string_rep_,
-                                  [val](const Baby &){
-                                    return val;
-                                  });
+      token.function_ = NamedFunc(val).Name(token.string_rep_);
       token.type_ = Token::Type::resolved_scalar;
     }
   }
@@ -594,6 +592,7 @@ void FunctionParser::CleanupName() const{
  */
 void FunctionParser::Solve() const{
   if(solved_) return;
+  SetupProfiler::Scope scope("parsing");
   Tokenize();
   CheckForUnknowns();
   ResolveVariables();
@@ -87,10 +87,54 @@ namespace Functions{
     else return 0.;
   });
 
-  const NamedFunc wgt_run2("wgt_run2", [](const Baby &b) -> NamedFunc::ScalarType{
+  namespace{
+    using BabyScalar = NamedFunc::ScalarType (*)(const Baby &);
+
+    // Weight of each simulated year, used both by wgt_run2 and by its
+    // specializations so that they cannot drift apart
+    BabyScalar WgtRun2Year(int sample_type){
+      if (sample_type==2016){
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.weight();
+          return wgt*b.w_prefire()*35.9;
+        };
+      } else if (sample_type==2017){
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.weight();
+          return wgt*b.w_prefire()*wnpv2017(b)*41.5;
+        };
+      } else {
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.weight();
+          return wgt*59.6;
+        };
+      }
+    }
+
+    // Same as WgtRun2Year, omitting SFs to allow calculating systematic variations
+    BabyScalar WgtRun2NosfYear(int sample_type){
+      if (sample_type==2016){
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.w_lumi();
+          return wgt*b.w_prefire()*35.9;
+        };
+      } else if (sample_type==2017){
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.w_lumi();
+          return wgt*b.w_prefire()*wnpv2017(b)*41.5;
+        };
+      } else {
+        return [](const Baby &b) -> NamedFunc::ScalarType{
+          double wgt = b.w_lumi();
+          return wgt*59.6;
+        };
+      }
+    }
+  }
+
+  const NamedFunc wgt_run2 = NamedFunc("wgt_run2", [](const Baby &b) -> NamedFunc::ScalarType{
     if (b.SampleType()<0) return 1.;
 
-    double wgt = b.weight();
     // if (b.type()==101000) {
     //   // if (b.mgluino()<401) wgt *= 0.5;
     //   if (b.mgluino()==200) wgt *= 0.146e3/0.755e2; 
@@ -99,19 +143,16 @@ namespace Functions{
     //   else if (b.mgluino()==350) wgt *= 0.657e1/0.443e1;
     //   else if (b.mgluino()==400) wgt *= 0.306e1/0.215e1;
     // }
-    if (b.SampleType()==2016){
-      return wgt*b.w_prefire()*35.9;
-    } else if (b.SampleType()==2017){
-      return wgt*b.w_prefire()*wnpv2017(b)*41.5;
-    } else {
-      return wgt*59.6;
-    }
+    return WgtRun2Year(b.SampleType())(b);
+  }).Specializer([](const Baby &b) -> NamedFunc{
+    if (b.SampleType()<0) return NamedFunc(1.);
+    return NamedFunc("wgt_run2", WgtRun2Year(b.SampleType()));
   });
 
-  const NamedFunc wgt_run2_nosf("wgt_run2_nosf", [](const Baby &b) -> NamedFunc::ScalarType{
+  const NamedFunc wgt_run2_nosf = NamedFunc("wgt_run2_nosf", [](const Baby &b) -> NamedFunc::ScalarType{
     if (b.SampleType()<0) return 1.;
 
-    double wgt = b.w_lumi(); //omit SFs to allow calculating systematic variations
+    //omit SFs to allow calculating systematic variations
     // if (b.type()==101000) {
     //   // if (b.mgluino()<401) wgt *= 0.5; 
     //   if (b.mgluino()==200) wgt *= 0.146e3/0.755e2; 
@@ -120,13 +161,10 @@ namespace Functions{
     //   else if (b.mgluino()==350) wgt *= 0.657e1/0.443e1;
     //   else if (b.mgluino()==400) wgt *= 0.306e1/0.215e1;
     // }
-    if (b.SampleType()==2016){
-      return wgt*b.w_prefire()*35.9;
-    } else if (b.SampleType()==2017){
-      return wgt*b.w_prefire()*wnpv2017(b)*41.5;
-    } else {
-      return wgt*59.6;
-    }
+    return WgtRun2NosfYear(b.SampleType())(b);
+  }).Specializer([](const Baby &b) -> NamedFunc{
+    if (b.SampleType()<0) return NamedFunc(1.);
+    return NamedFunc("wgt_run2_nosf", WgtRun2NosfYear(b.SampleType()));
   });
 
   const NamedFunc mht_ratio("mht_ratio", [](const Baby &b) -> NamedFunc::ScalarType{
@@ -143,26 +181,23 @@ namespace Functions{
     return 10*wnpv2017(b);
   });
 
-  const NamedFunc trig_run2("trig_run2", [](const Baby &b) -> NamedFunc::ScalarType{
+  const TriggerMenu trig_menu_run2 = TriggerMenu("run2")
+    .Add(-2016, {3, 4, 34, 7, 8, 36, 14, 15, 30, 31, 19, 55, 20, 21, 40, 41})
+    .Add({2, 3, 22, 6, 7, 30, 9, 10, 15, 13, 19, 20, 21, 26, 23, 24}); // 2017 or 2018
+
+  const NamedFunc trig_run2 = NamedFunc("trig_run2", [](const Baby &b) -> NamedFunc::ScalarType{
     if (b.SampleType()>0) return 1.;
     
-    int _pass(0);
-    if (b.SampleType()==-2016){
-      _pass = b.trig()->at(3) || b.trig()->at(4) || b.trig()->at(34) || b.trig()->at(7) || 
-              b.trig()->at(8) || b.trig()->at(36) || b.trig()->at(14) || b.trig()->at(15) || 
-              b.trig()->at(30) || b.trig()->at(31) || b.trig()->at(19) || b.trig()->at(55) || 
-              b.trig()->at(20) || b.trig()->at(21) || b.trig()->at(40) || b.trig()->at(41);
-
-    } else { // 2017 or 2018
-      _pass = b.trig()->at(2) || b.trig()->at(3) || b.trig()->at(22) || b.trig()->at(6) || 
-              b.trig()->at(7) || b.trig()->at(30) || b.trig()->at(9) || b.trig()->at(10) || 
-              b.trig()->at(15) || b.trig()->at(13) || b.trig()->at(19) || b.trig()->at(20) || 
-              b.trig()->at(21) || b.trig()->at(26) || b.trig()->at(23) || b.trig()->at(24);
-    }
-    return _pass;
+    return trig_menu_run2.Pass(b);
+  }).Specializer([](const Baby &b) -> NamedFunc{
+    if (b.SampleType()>0) return NamedFunc(1.);
+    const TriggerMenu::Mask &mask = trig_menu_run2.GetMask(b.SampleType());
+    return NamedFunc("trig_run2", [&mask](const Baby &baby) -> NamedFunc::ScalarType{
+      return TriggerMenu::Test(mask, baby.trig_bits());
+    });
   });
 
-  const NamedFunc eff_trig_run2("eff_trig_run2", [](const Baby &b) -> NamedFunc::ScalarType{
+  const NamedFunc eff_trig_run2 = NamedFunc("eff_trig_run2", [](const Baby &b) -> NamedFunc::ScalarType{
     if (b.SampleType()<0) return 1.;
     double _met = b.met();
     if (b.SampleType()==2016) {
@@ -255,6 +290,9 @@ namespace Functions{
         return 0.;
       }
     }
+  }).Specializer([](const Baby &b) -> NamedFunc{
+    if (b.SampleType()<0) return NamedFunc(1.);
+    return eff_trig_run2;
   });
 
   const NamedFunc hem_veto("hem_veto",[](const Baby &b) -> NamedFunc::ScalarType{
@@ -38,7 +38,7 @@ int main(int argc, char *argv[]){
 
   set<Variable> vars = GetVariables(files);
   WriteBaseHeader(vars, files);
-  WriteBaseSource(vars);
+  WriteBaseSource(vars, files);
   for(const auto &file: files){
     WriteSpecializedHeader(vars, file);
     WriteSpecializedSource(vars, file);
@@ -248,6 +248,17 @@ bool Variable::EverythingIn(const string &baby_type) const{
   return NotInBase() && Type(baby_type)!="";
 }
 
+/*!\brief Check if Baby should also expose the variable as packed bits
+
+  Boolean vectors such as trig are packed into 64-bit words when read, so
+  that an OR over many indices reduces to a few mask-and-test operations.
+
+  \return True if variable is a std::vector<bool> implemented in Baby
+*/
+bool Variable::PackedInBase() const{
+  return ImplementInBase() && Type() == "std::vector<bool>";
+}
+
 /*!\brief Comparison operator allows storing Variable in set
 
   Sorts alphabetically by name
@@ -413,14 +424,19 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "#ifndef H_BABY\n";
   file << "#define H_BABY\n\n";
 
+  file << "#include <cstdint>\n\n";
+
   file << "#include <vector>\n";
   file << "#include <set>\n";
   file << "#include <memory>\n";
   file << "#include <string>\n\n";
 
-  file << "#include \"TChain.h\"\n\n";
+  file << "#include \"TChain.h\"\n";
+  file << "#include \"TBranch.h\"\n";
   file << "#include \"TString.h\"\n\n";
 
+  file << "#include \"core/column_cache.hpp\"\n\n";
+
   file << "class Process;\n";
   file << "class NamedFunc;\n\n";
 
@@ -452,7 +468,7 @@ void WriteBaseHeader(const set<Variable> &vars,
 
   file << "  const std::set<std::string> & FileNames() const;\n\n";
   file << "  int SampleType() const;\n";
-  file << "  int SetSampleType(const TString &filename);\n\n";
+  file << "  static int SetSampleType(const TString &filename);\n\n";
 
   file << "  std::set<const Process*> processes_;\n\n";
 
@@ -461,6 +477,10 @@ void WriteBaseHeader(const set<Variable> &vars,
       file << "  "
            << var.DecoratedType() << " const & "
            << var.Name() << "() const;\n";
+      if(var.PackedInBase()){
+        file << "  std::vector<std::uint64_t> const & "
+             << var.Name() << "_bits() const;\n";
+      }
     }else if(var.VirtualInBase()){
       file << "  virtual "
            << var.DecoratedType() << " const & "
@@ -476,10 +496,14 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "  std::unique_ptr<Activator> Activate();\n\n";
 
   file << "protected:\n";
-  file << "  virtual void Initialize();\n\n";
+  file << "  virtual void Initialize();\n";
+  file << "  virtual void LinkColumns();\n";
+  file << "  void LoadTree() const;\n\n";
 
-  file << "  std::unique_ptr<TChain> chain_;//!<Chain to load variables from\n";
-  file << "  long entry_;//!<Current entry\n\n";
+  file << "  std::unique_ptr<TChain> chain_;//!<Chain to load variables from. Only created once needed if there is a column cache\n";
+  file << "  long entry_;//!<Current entry of the chain\n";
+  file << "  mutable long tree_entry_;//!<Current entry within the tree of the chain, or -1 if the chain has not been moved to entry_\n";
+  file << "  std::unique_ptr<ColumnCache> columns_;//!<Memory-mapped columns, if every file has a cache\n\n";
 
   file << "private:\n";
   file << "  friend class Activator;\n\n";
@@ -494,6 +518,7 @@ void WriteBaseHeader(const set<Variable> &vars,
   file << "  mutable bool cached_total_entries_;//!<Flag if cached event count up to date\n\n";
 
   file << "  void ActivateChain();\n";
+  file << "  void LoadChain();\n";
   file << "  void DeactivateChain();\n\n";
 
   for(const auto &var: vars){
@@ -503,11 +528,30 @@ void WriteBaseHeader(const set<Variable> &vars,
          << var.Name() << "_;//!<Cached value of " << var.Name() << '\n';
     file << "  TBranch *b_" << var.Name() << "_;//!<Branch from which "
          << var.Name() << " is read\n";
+    file << "  const ColumnCache::Column *k_" << var.Name() << "_;//!<Mapped column from which "
+         << var.Name() << " is read\n";
     file << "  mutable bool c_" << var.Name() << "_;//!<Flag if cached "
          << var.Name() << " up to date\n";
+    if(var.PackedInBase()){
+      file << "  mutable std::vector<std::uint64_t> " << var.Name() << "_bits_;//!<"
+           << var.Name() << " packed into 64-bit words\n";
+      file << "  mutable bool c_" << var.Name() << "_bits_;//!<Flag if "
+           << var.Name() << "_bits_ up to date\n";
+    }
   }
   file << "};\n\n";
 
+  for(const auto &var: vars){
+    if(!var.ImplementInBase()) continue;
+    file << "/*! \\brief Get " << var.Name() << " for current event and cache it\n\n";
+
+    file << "  \\return " << var.Name() << " for current event\n";
+    file << "*/\n";
+    file << "inline " << var.DecoratedType() << " const & Baby::" << var.Name() << "() const{\n";
+    WriteAccessorBody(file, var.Type(), var.Name());
+    file << "}\n\n";
+  }
+
   for(const auto &type: types){
     file << "#include \"core/baby_" << type << ".hpp\"\n";
   }
@@ -520,8 +564,11 @@ void WriteBaseHeader(const set<Variable> &vars,
 /*!\brief Writes src/baby.cpp
 
   \param[in] vars All variables for all Baby classes, with type information
+
+  \param[in] types Names of derived Baby classes (basic, full, etc.)
 */
-void WriteBaseSource(const set<Variable> &vars){
+void WriteBaseSource(const set<Variable> &vars,
+                     const set<string> &types){
   ofstream file("src/core/baby.cpp");
   file << "/*! \\class Baby\n\n";
 
@@ -565,62 +612,67 @@ void WriteBaseSource(const set<Variable> &vars){
 
   file << "    \\return Dummy NamedFunc that always returns 0\n";
   file << "  */\n";
-  file << "  template<typename T>\n";
+  file << "  template<typename T, typename Accessor>\n";
   file << "    NamedFunc GetFunction(T,\n";
-  file << "                          const string &name){\n";
+  file << "                          const string &name,\n";
+  file << "                          Accessor){\n";
   file << "    DBG(\"Could not find appropriate type for \\\"\" << name << \".\\\"\");\n";
-  file << "    return NamedFunc(name, [](const Baby &){return 0.;}, false);\n";
+  file << "    return NamedFunc(name, [](const Baby &){return 0.;});\n";
   file << "  }\n\n";
 
   file << "  /*!\\brief Get NamedFunc for a function returning a scalar\n\n";
 
-  file << "    \\param[in] baby_func Member function pointer to variable accessor\n\n";
-
   file << "    \\param[in] name Name of function/variable\n\n";
 
+  file << "    \\param[in] accessor Callable reading the variable from a Baby. Called\n";
+  file << "    directly, so that inline accessors are inlined.\n\n";
+
   file << "    \\return NamedFunc that returns appropriate scalar\n";
   file << "  */\n";
-  file << "  template<typename T>\n";
-  file << "    NamedFunc GetFunction(T const &(Baby::*baby_func)() const,\n";
-  file << "                          const string &name){\n";
+  file << "  template<typename T, typename Accessor>\n";
+  file << "    NamedFunc GetFunction(T const &(Baby::*)() const,\n";
+  file << "                          const string &name,\n";
+  file << "                          Accessor accessor){\n";
   file << "    return NamedFunc(name,\n";
-  file << "                     [baby_func](const Baby &b){\n";
-  file << "                       return ScalarType((b.*baby_func)());\n";
+  file << "                     [accessor](const Baby &b){\n";
+  file << "                       return ScalarType(accessor(b));\n";
   file << "                     });\n";
   file << "  }\n\n";
 
   file << "  /*!\\brief Get NamedFunc for a function returning a vector\n\n";
 
-  file << "    \\param[in] baby_func Member function pointer to variable accessor\n\n";
-
   file << "    \\param[in] name Name of function/variable\n\n";
 
+  file << "    \\param[in] accessor Callable reading the variable from a Baby. Called\n";
+  file << "    directly, so that inline accessors are inlined.\n\n";
+
   file << "    \\return NamedFunc that returns appropriate vectorr\n";
   file << "  */\n";
-  file << "  template<typename T>\n";
-  file << "    NamedFunc GetFunction(vector<T>* const &(Baby::*baby_func)() const,\n";
-  file << "                          const string &name){\n";
+  file << "  template<typename T, typename Accessor>\n";
+  file << "    NamedFunc GetFunction(vector<T>* const &(Baby::*)() const,\n";
+  file << "                          const string &name,\n";
+  file << "                          Accessor accessor){\n";
   file << "    return NamedFunc(name,\n";
-  file << "                     [baby_func](const Baby &b){\n";
-  file << "                       const auto &raw = (b.*baby_func)();\n";
+  file << "                     [accessor](const Baby &b){\n";
+  file << "                       const auto &raw = accessor(b);\n";
   file << "                       return VectorType(raw->cbegin(), raw->cend());\n";
   file << "                     });\n";
   file << "  }\n\n";
 
-  bool have_vector_double = false;
-  for(auto var = vars.cbegin(); var != vars.cend() && !have_vector_double; ++var){
-    if(var->Type().find("vector<double>") != string::npos){
-      have_vector_double = true;
-    }
-  }
+  file << "  /*!\\brief Get NamedFunc for a function returning a vector of doubles\n\n";
 
-  if(have_vector_double){
-    file << "    template<>\n";
-    file << "      NamedFunc GetFunction<vector<double>* const &(Baby::*)() const>(vector<double>* const &(Baby::*baby_func)() const,\n";
-    file << "                                                                      const string &name){\n";
-    file << "      return NamedFunc(name, [baby_func](const Baby &b){return *((b.*baby_func)());}, true);\n";
-    file << "  }\n";
-  }
+  file << "    \\param[in] name Name of function/variable\n\n";
+
+  file << "    \\param[in] accessor Callable reading the variable from a Baby\n\n";
+
+  file << "    \\return NamedFunc that returns the vector without conversion\n";
+  file << "  */\n";
+  file << "  template<typename Accessor>\n";
+  file << "    NamedFunc GetFunction(vector<double>* const &(Baby::*)() const,\n";
+  file << "                          const string &name,\n";
+  file << "                          Accessor accessor){\n";
+  file << "    return NamedFunc(name, [accessor](const Baby &b){return *accessor(b);}, true);\n";
+  file << "  }\n";
   file << "}\n\n";
 
   file << "Baby::Activator::Activator(Baby &baby):\n";
@@ -640,30 +692,28 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "           const set<const Process*> &processes):\n";
   file << "  processes_(processes),\n";
   file << "  chain_(nullptr),\n";
+  file << "  entry_(0),\n";
+  file << "  tree_entry_(-1),\n";
+  file << "  columns_(nullptr),\n";
   file << "  file_names_(file_names),\n";
   file << "  total_entries_(0),\n";
-  auto last_base = vars.cbegin();
-  bool found_in_base = false;
-  for(auto iter = vars.cbegin(); iter != vars.cend(); ++iter){
-    if(iter->ImplementInBase()){
-      last_base = iter;
-      found_in_base = true;
+  vector<string> inits;
+  for(const auto &var: vars){
+    if(!var.ImplementInBase()) continue;
+    inits.push_back(var.Name()+"_{}");
+    inits.push_back("b_"+var.Name()+"_(nullptr)");
+    inits.push_back("k_"+var.Name()+"_(nullptr)");
+    inits.push_back("c_"+var.Name()+"_(false)");
+    if(var.PackedInBase()){
+      inits.push_back(var.Name()+"_bits_{}");
+      inits.push_back("c_"+var.Name()+"_bits_(false)");
     }
   }
-  if(vars.size() == 0 || !found_in_base){
-    file << "  cached_total_entries_(false){\n";
-  }else{
-    file << "  cached_total_entries_(false),\n";
-    for(auto var = vars.cbegin(); var != last_base; ++var){
-      if(!var->ImplementInBase()) continue;
-      file << "  " << var->Name() << "_{},\n";
-      file << "  b_" << var->Name() << "_(nullptr),\n";
-      file << "  c_" << var->Name() << "_(false),\n";
-    }
-    file << "  " << last_base->Name() << "_{},\n";
-    file << "  b_" << last_base->Name() << "_(nullptr),\n";
-    file << "  c_" << last_base->Name() << "_(false){\n";
+  file << "  cached_total_entries_(false)";
+  for(const auto &init: inits){
+    file << ",\n  " << init;
   }
+  file << "{\n";
   file << "  TString filename=\"\";\n";
   file << "  if(file_names_.size()) filename = *file_names_.cbegin();\n";
   file << "  sample_type_ = SetSampleType(filename);\n";
@@ -676,6 +726,10 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "long Baby::GetEntries() const{\n";
   file << "  if(!cached_total_entries_){\n";
   file << "    cached_total_entries_ = true;\n";
+  file << "    if(!chain_ && columns_){\n";
+  file << "      total_entries_ = columns_->NumEntries();\n";
+  file << "      return total_entries_;\n";
+  file << "    }\n";
   file << "    lock_guard<mutex> lock(Multithreading::root_mutex);\n";
   file << "    total_entries_ = chain_->GetEntries();\n";
   file << "  }\n";
@@ -684,15 +738,31 @@ void WriteBaseSource(const set<Variable> &vars){
 
   file << "/*!\\brief Change current entry\n\n";
 
+  file << "  The chain is only moved to the entry when a variable missing from the\n";
+  file << "  column cache is read, so events served entirely from the cache do not\n";
+  file << "  take Multithreading::root_mutex.\n\n";
+
   file << "  \\param[in] entry Entry number to load\n";
   file << "*/\n";
   file << "void Baby::GetEntry(long entry){\n";
   for(const auto &var: vars){
     if(!var.ImplementInBase()) continue;
     file << "  c_" << var.Name() << "_ = false;\n";
+    if(var.PackedInBase()) file << "  c_" << var.Name() << "_bits_ = false;\n";
   }
+  file << "  if(columns_ && columns_->Load(entry)) LinkColumns();\n";
+  file << "  entry_ = entry;\n";
+  file << "  tree_entry_ = -1;\n";
+  file << "}\n\n";
+
+  file << "/*!\\brief Moves the chain to the current entry, creating it first if the\n";
+  file << "  column cache made it unnecessary so far\n";
+  file << "*/\n";
+  file << "void Baby::LoadTree() const{\n";
+  file << "  if(tree_entry_ >= 0) return;\n";
+  file << "  if(!chain_) const_cast<Baby*>(this)->LoadChain();\n";
   file << "  lock_guard<mutex> lock(Multithreading::root_mutex);\n";
-  file << "  entry_ = chain_->LoadTree(entry);\n";
+  file << "  tree_entry_ = chain_->LoadTree(entry_);\n";
   file << "}\n\n";
 
   file << "const std::set<std::string> & Baby::FileNames() const{\n";
@@ -736,13 +806,11 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "  \\return NamedFunc which returns specified variable from a Baby\n";
   file << "*/\n";
   file << "NamedFunc Baby::GetFunction(const std::string &var_name){\n";
+  for(auto var = vars.cbegin(); var != vars.cend(); ++var){
+    file << (var == vars.cbegin() ? "  if" : "  }else if") << "(var_name == \"" << var->Name() << "\"){\n";
+    WriteFunctionLookup(file, *var, types);
+  }
   if(vars.size() != 0){
-    file << "  if(var_name == \"" << vars.cbegin()->Name() << "\"){\n";
-    file << "    return ::GetFunction(&Baby::" << vars.cbegin()->Name() << ", \"" << vars.cbegin()->Name() << "\");\n";
-    for(auto var = ++vars.cbegin(); var != vars.cend(); ++var){
-      file << "  }else if(var_name == \"" << var->Name() << "\"){\n";
-      file << "    return ::GetFunction(&Baby::" << var->Name() << ", \"" << var->Name() << "\");\n";
-    }
     file << "  }else{\n";
     file << "    DBG(\"Function lookup failed for \\\"\" << var_name << \"\\\"\");\n";
     file << "    return NamedFunc(var_name,\n";
@@ -773,8 +841,28 @@ void WriteBaseSource(const set<Variable> &vars){
   }
   file << "}\n\n";
 
+  file << "/*! \\brief Point accessors at mapped columns of the current cache file, if any\n";
+  file << "*/\n";
+  file << "void Baby::LinkColumns(){\n";
+  for(const auto &var: vars){
+    if(!var.ImplementInBase()) continue;
+    file << "  k_" << var.Name() << "_ = columns_ ? columns_->Find(\"" << var.Name() << "\", "
+         << var.Name() << "_) : nullptr;\n";
+  }
+  file << "}\n\n";
+
+  file << "/*! \\brief Open the column cache, or the chain if some file has no cache\n";
+  file << "*/\n";
   file << "void Baby::ActivateChain(){\n";
-  file << "  if(chain_) ERROR(\"Chain has already been initialized\");\n";
+  file << "  if(chain_ || columns_) ERROR(\"Chain has already been initialized\");\n";
+  file << "  columns_ = ColumnCache::Open(file_names_);\n";
+  file << "  tree_entry_ = -1;\n";
+  file << "  if(!columns_) LoadChain();\n";
+  file << "}\n\n";
+
+  file << "/*! \\brief Create the chain and set its branch addresses\n";
+  file << "*/\n";
+  file << "void Baby::LoadChain(){\n";
   file << "  lock_guard<mutex> lock(Multithreading::root_mutex);\n";
   file << "  chain_ = unique_ptr<TChain>(new TChain(\"tree\"));\n";
   file << "  for(const auto &file: file_names_){\n";
@@ -784,22 +872,21 @@ void WriteBaseSource(const set<Variable> &vars){
   file << "}\n\n";
 
   file << "void Baby::DeactivateChain(){\n";
+  file << "  columns_.reset();\n";
+  file << "  LinkColumns();\n";
+  file << "  tree_entry_ = -1;\n";
   file << "  lock_guard<mutex> lock(Multithreading::root_mutex);\n";
   file << "  chain_.reset();\n";
   file << "}\n\n";
 
   for(const auto &var: vars){
-    if(!var.ImplementInBase()) continue;
-    file << "/*! \\brief Get " << var.Name() << " for current event and cache it\n\n";
+    if(!var.PackedInBase()) continue;
+    file << "/*! \\brief Get " << var.Name() << " for current event packed into 64-bit words\n\n";
 
-    file << "  \\return " << var.Name() << " for current event\n";
+    file << "  \\return Words whose bit i%64 of word i/64 is " << var.Name() << "()->at(i)\n";
     file << "*/\n";
-    file << var.DecoratedType() << " const & Baby::" << var.Name() << "() const{\n";
-    file << "  if(!c_" << var.Name() << "_ && b_" << var.Name() << "_){\n";
-    file << "    b_" << var.Name() << "_->GetEntry(entry_);\n";
-    file << "    c_" << var.Name() << "_ = true;\n";
-    file << "  }\n";
-    file << "  return " << var.Name() << "_;\n";
+    file << "std::vector<std::uint64_t> const & Baby::" << var.Name() << "_bits() const{\n";
+    WritePackedAccessorBody(file, var.Name());
     file << "}\n\n";
   }
   file << flush;
@@ -819,20 +906,20 @@ void WriteSpecializedHeader(const set<Variable> &vars, const string &type){
 
   file << "#include \"core/baby.hpp\"\n\n";
 
-  file << "class Baby_" << type << ": virtual public Baby{\n";
+  file << "class Baby_" << type << " final: virtual public Baby{\n";
   file << "public:\n";
   file << "  explicit Baby_" << type << "(const std::set<std::string> &file_names, const std::set<const Process*> &processes = std::set<const Process*>{});\n";
   file << "  virtual ~Baby_" << type << "() = default;\n\n";
 
-  file << "  virtual void GetEntry(long entry);\n\n";
+  file << "  void GetEntry(long entry) final;\n\n";
 
   for(const auto &var: vars){
     if(var.VirtualInBase()){
       if(var.ImplementIn(type)){
-        file << "  virtual " << var.DecoratedType() << " const & " << var.Name() << "() const;\n";
+        file << "  " << var.DecoratedType() << " const & " << var.Name() << "() const final;\n";
       }else{
-        file << "  __attribute__((noreturn)) virtual " << var.DecoratedType()
-             << " const & " << var.Name() << "() const;\n";
+        file << "  __attribute__((noreturn)) " << var.DecoratedType()
+             << " const & " << var.Name() << "() const final;\n";
       }
     }else if(var.EverythingIn(type)){
       file << "  " << var.DecoratedType(type) << " const & " << var.Name() << "() const;\n";
@@ -847,7 +934,8 @@ void WriteSpecializedHeader(const set<Variable> &vars, const string &type){
   file << "  Baby_" << type << "(Baby_" << type << " &&) = delete;\n";
   file << "  Baby_" << type << "& operator=(Baby_" << type << " &&) = delete;\n";
 
-  file << "  virtual void Initialize();\n\n";
+  file << "  void Initialize() final;\n";
+  file << "  void LinkColumns() final;\n\n";
 
   for(const auto &var: vars){
     if(var.ImplementIn(type) || var.EverythingIn(type)){
@@ -855,12 +943,26 @@ void WriteSpecializedHeader(const set<Variable> &vars, const string &type){
            << var.Name() << "_;//!<Cached value of " << var.Name() << '\n';
       file << "  TBranch *b_" << var.Name() << "_;\n//!<Branch from which "
            << var.Name() << " is read\n";
+      file << "  const ColumnCache::Column *k_" << var.Name() << "_;//!<Mapped column from which "
+           << var.Name() << " is read\n";
       file << "  mutable bool c_" << var.Name() << "_;//!<Flag if cached "
            << var.Name() << " up to date\n";
     }
   }
   file << "};\n\n";
 
+  for(const auto &var: vars){
+    if(var.ImplementIn(type) || var.EverythingIn(type)){
+      file << "/*!\\brief Get " << var.Name() << " for current event and cache it\n\n";
+
+      file << "  \\return " << var.Name() << " for current event\n";
+      file << "*/\n";
+      file << "inline " << var.DecoratedType(type) << " const & Baby_" << type << "::" << var.Name() << "() const{\n";
+      WriteAccessorBody(file, var.Type(type), var.Name());
+      file << "}\n\n";
+    }
+  }
+
   file << "#endif" << endl;
   file.close();
 }
@@ -913,6 +1015,7 @@ void WriteSpecializedSource(const set<Variable> &vars, const string &type){
       if(var->ImplementIn(type) || var->EverythingIn(type)){
         file << "  " << var->Name() << "_{},\n";
         file << "  b_" << var->Name() << "_(nullptr),\n";
+        file << "  k_" << var->Name() << "_(nullptr),\n";
         if(var != last){
           file << "  c_" << var->Name() << "_(false),\n";
         }else{
@@ -946,22 +1049,22 @@ void WriteSpecializedSource(const set<Variable> &vars, const string &type){
            << var.Name() << "_, &b_" << var.Name() << "_);\n";
     }
   }
-  file << "}\n";
+  file << "}\n\n";
 
+  file << "/*! \\brief Point accessors at mapped columns of the current cache file, if any\n";
+  file << "*/\n";
+  file << "void Baby_" << type << "::LinkColumns(){\n";
+  file << "  Baby::LinkColumns();\n";
   for(const auto &var: vars){
     if(var.ImplementIn(type) || var.EverythingIn(type)){
-      file << "/*!\\brief Get " << var.Name() << " for current event and cache it\n\n";
+      file << "  k_" << var.Name() << "_ = columns_ ? columns_->Find(\"" << var.Name() << "\", "
+           << var.Name() << "_) : nullptr;\n";
+    }
+  }
+  file << "}\n";
 
-      file << "  \\return " << var.Name() << " for current event\n";
-      file << "*/\n";
-      file << var.DecoratedType(type) << " const & Baby_" << type << "::" << var.Name() << "() const{\n";
-      file << "  if(!c_" << var.Name() << "_ && b_" << var.Name() << "_){\n";
-      file << "    b_" << var.Name() << "_->GetEntry(entry_);\n";
-      file << "    c_" << var.Name() << "_ = true;\n";
-      file << "  }\n";
-      file << "  return " << var.Name() << "_;\n";
-      file << "}\n\n";
-    }else if(var.VirtualInBase()){
+  for(const auto &var: vars){
+    if(var.VirtualInBase() && !var.ImplementIn(type)){
       file << "/*!\\brief Dummy getter for " << var.Name() << ". Throws error\n\n";
 
       file << "  \\return Never returns. Throws error.\n";
@@ -976,3 +1079,92 @@ void WriteSpecializedSource(const set<Variable> &vars, const string &type){
   file << flush;
   file.close();
 }
+
+/*!\brief Writes the branch of Baby::GetFunction returning a variable
+
+  The NamedFunc calls the accessor directly instead of through a member
+  function pointer, so inline accessors are inlined into it. Accessors that
+  are virtual in Baby are specialized to each Baby, binding the NamedFunc to
+  the final derived class so the call is no longer virtual.
+
+  \param[in,out] file File to which to write
+
+  \param[in] var Variable to return
+
+  \param[in] types Names of derived Baby classes (basic, full, etc.)
+*/
+void WriteFunctionLookup(ofstream &file, const Variable &var, const set<string> &types){
+  const string &name = var.Name();
+  if(!var.ImplementInBase() && !var.VirtualInBase()){
+    file << "    return ::GetFunction(0, \"" << name << "\", 0);\n";
+    return;
+  }
+  string get = "::GetFunction(&Baby::"+name+", \""+name+"\", ";
+  file << "    return " << get << "[](const Baby &b) -> decltype(b." << name << "()) {return b." << name << "();})";
+  if(var.ImplementInBase()){
+    file << ";\n";
+    return;
+  }
+  file << "\n";
+  file << "      .Specializer([](const Baby &b) -> NamedFunc {\n";
+  for(const auto &type: types){
+    if(!var.ImplementIn(type)) continue;
+    file << "          if(const Baby_" << type << " *typed = dynamic_cast<const Baby_" << type << "*>(&b)){\n";
+    file << "            return " << get << "[typed](const Baby &) -> decltype(typed->" << name << "()) {return typed->"
+         << name << "();});\n";
+    file << "          }\n";
+  }
+  file << "          return " << get << "[](const Baby &bb) -> decltype(bb." << name << "()) {return bb." << name << "();});\n";
+  file << "        });\n";
+}
+
+/*!\brief Writes body of a variable accessor
+
+  Scalars are returned directly from the mapped column when the variable is in
+  the column cache. Vectors are copied from the mapped column into the cached
+  vector. Otherwise, the chain is first moved to the current entry if that has
+  not happened yet, and the variable is read from its branch.
+
+  \param[in,out] file File to which to write
+
+  \param[in] type Type of variable (e.g., int, std::vector<float>)
+
+  \param[in] name Name of variable
+*/
+void WriteAccessorBody(ofstream &file, const string &type, const string &name){
+  if(type.find("vector") == string::npos){
+    file << "  if(k_" << name << "_) return k_" << name << "_->Scalar<" << type << ">(columns_->Entry());\n";
+    file << "  if(!c_" << name << "_) LoadTree();\n";
+    file << "  if(!c_" << name << "_ && b_" << name << "_){\n";
+    file << "    b_" << name << "_->GetEntry(tree_entry_);\n";
+  }else{
+    file << "  if(!c_" << name << "_ && !k_" << name << "_) LoadTree();\n";
+    file << "  if(!c_" << name << "_ && (b_" << name << "_ || k_" << name << "_)){\n";
+    file << "    if(k_" << name << "_) k_" << name << "_->Read(columns_->Entry(), " << name << "_);\n";
+    file << "    else b_" << name << "_->GetEntry(tree_entry_);\n";
+  }
+  file << "    c_" << name << "_ = true;\n";
+  file << "  }\n";
+  file << "  return " << name << "_;\n";
+}
+
+/*!\brief Writes body of a packed boolean vector accessor
+
+  The vector is read through its ordinary accessor and packed once per entry.
+
+  \param[in,out] file File to which to write
+
+  \param[in] name Name of variable
+*/
+void WritePackedAccessorBody(ofstream &file, const string &name){
+  file << "  if(!c_" << name << "_bits_){\n";
+  file << "    const vector<bool> *unpacked = " << name << "();\n";
+  file << "    size_t size = unpacked ? unpacked->size() : 0;\n";
+  file << "    " << name << "_bits_.assign((size+63)/64, 0);\n";
+  file << "    for(size_t i = 0; i < size; ++i){\n";
+  file << "      if((*unpacked)[i]) " << name << "_bits_[i/64] |= static_cast<uint64_t>(1) << (i%64);\n";
+  file << "    }\n";
+  file << "    c_" << name << "_bits_ = true;\n";
+  file << "  }\n";
+  file << "  return " << name << "_bits_;\n";
+}
@@ -28,12 +28,25 @@
   without disturbing the data in the main TH1D.
 */
 
+/*! \class Hist1D::Bank
+
+  \brief Group of Hist1D::SingleHist1D for one process sharing variable,
+  binning and weight
+
+  Many plots differ only by their cut, e.g. the same distribution in several
+  analysis regions. A Bank built by PlotMaker for such histograms evaluates
+  the variable and weight and looks up the bin once per event. Each member
+  then only checks its own cut and increments the precomputed bin. Functions
+  are matched by name, as elsewhere in the figures.
+*/
+
 #include "core/hist1d.hpp"
 
 #include <cmath>
 
 #include <algorithm>
 #include <sstream>
+#include <tuple>
 
 #include <sys/stat.h>
 
@@ -45,6 +58,7 @@
 #include "TLegendEntry.h"
 
 #include "core/utilities.hpp"
+#include "core/checkpoint.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
@@ -153,7 +167,17 @@ Hist1D::SingleHist1D::SingleHist1D(const Hist1D &figure,
   proc_and_hist_cut_(figure.cut_ && process->cut_),
   cut_vector_(),
   wgt_vector_(),
-  val_vector_(){
+  val_vector_(),
+  reproducible_(false),
+  exact_sumw_(),
+  exact_sumw2_(),
+  banked_sumw_(),
+  banked_sumw2_(),
+  banked_stats_(),
+  num_fills_(0),
+  specializations_(),
+  current_baby_(nullptr),
+  current_(nullptr){
   raw_hist_.Sumw2();
   scaled_hist_.Sumw2();
   raw_hist_.SetBinErrorOption(TH1::kPoisson);
@@ -165,7 +189,8 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
   size_t min_vec_size;
   bool have_vec = false;
 
-  const NamedFunc &cut = proc_and_hist_cut_;
+  const Specialization *spec = GetSpecialization(baby);
+  const NamedFunc &cut = spec ? spec->cut_ : proc_and_hist_cut_;
   if(cut.IsScalar()){
     if(!cut.GetScalar(baby)) return;
   }else{
@@ -174,7 +199,7 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
     have_vec = true;
     min_vec_size = cut_vector_.size();
   }
-  const NamedFunc &wgt = stack.weight_;
+  const NamedFunc &wgt = spec ? spec->weight_ : stack.weight_;
   NamedFunc::ScalarType wgt_scalar = 0.;
   if(wgt.IsScalar()){
     wgt_scalar = wgt.GetScalar(baby);
@@ -186,7 +211,7 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
     }
   }
 
-  const NamedFunc &val = stack.xaxis_.var_;
+  const NamedFunc &val = spec ? spec->var_ : stack.xaxis_.var_;
   NamedFunc::ScalarType val_scalar = 0.;
   if(val.IsScalar()){
     val_scalar = val.GetScalar(baby);
@@ -199,16 +224,213 @@ void Hist1D::SingleHist1D::RecordEvent(const Baby &baby){
   }
 
   if(!have_vec){
-    raw_hist_.Fill(val_scalar, wgt_scalar);
+    Fill(val_scalar, wgt_scalar);
   }else{
     for(size_t i = 0; i < min_vec_size; ++i){
       if(cut.IsVector() && !cut_vector_.at(i)) continue;
-      raw_hist_.Fill(val.IsScalar() ? val_scalar : val_vector_.at(i),
-                     wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(i));
+      Fill(val.IsScalar() ? val_scalar : val_vector_.at(i),
+           wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(i));
     }
   }
 }
 
+/*!\brief Specializes cut, weight and variable to a Baby
+
+  \param[in] baby Baby whose events are about to be recorded
+*/
+void Hist1D::SingleHist1D::Specialize(const Baby &baby){
+  const Hist1D& stack = static_cast<const Hist1D&>(figure_);
+  if(!proc_and_hist_cut_.IsSpecializable()
+     && !stack.weight_.IsSpecializable()
+     && !stack.xaxis_.var_.IsSpecializable()) return;
+  specializations_.erase(&baby);
+  specializations_.emplace(&baby, Specialization{proc_and_hist_cut_.Specialized(baby),
+        stack.weight_.Specialized(baby),
+        stack.xaxis_.var_.Specialized(baby)});
+  current_baby_ = nullptr;
+}
+
+/*!\brief Drops the functions specialized to a Baby
+
+  \param[in] baby Baby whose events have been recorded
+*/
+void Hist1D::SingleHist1D::Unspecialize(const Baby &baby){
+  specializations_.erase(&baby);
+  current_baby_ = nullptr;
+}
+
+string Hist1D::SingleHist1D::Definition() const{
+  const Hist1D &stack = static_cast<const Hist1D&>(figure_);
+  ostringstream oss;
+  oss.precision(17);
+  oss << "Hist1D;" << stack.xaxis_.var_.Name() << ';';
+  for(const auto &edge: stack.xaxis_.Bins()) oss << edge << ',';
+  oss << ';' << proc_and_hist_cut_.Name() << ';' << stack.weight_.Name() << ';' << process_->name_;
+  return oss.str();
+}
+
+bool Hist1D::SingleHist1D::SaveState(ostream &out) const{
+  Checkpoint::WriteHist(out, raw_hist_);
+  Checkpoint::Write(out, exact_sumw_);
+  Checkpoint::Write(out, exact_sumw2_);
+  Checkpoint::Write(out, banked_sumw_);
+  Checkpoint::Write(out, banked_sumw2_);
+  Checkpoint::Write(out, banked_stats_);
+  Checkpoint::Write(out, num_fills_);
+  return true;
+}
+
+void Hist1D::SingleHist1D::LoadState(istream &in){
+  Checkpoint::ReadHist(in, raw_hist_);
+  Checkpoint::Read(in, exact_sumw_);
+  Checkpoint::Read(in, exact_sumw2_);
+  Checkpoint::Read(in, banked_sumw_);
+  Checkpoint::Read(in, banked_sumw2_);
+  Checkpoint::Read(in, banked_stats_);
+  Checkpoint::Read(in, num_fills_);
+}
+
+/*!\brief Get functions specialized to the Baby of the current event
+
+  \param[in] baby Baby containing the current event
+
+  \return Specialized functions, or nullptr to use the general ones
+*/
+const Hist1D::SingleHist1D::Specialization * Hist1D::SingleHist1D::GetSpecialization(const Baby &baby){
+  if(&baby != current_baby_){
+    current_baby_ = &baby;
+    auto spec = specializations_.find(&baby);
+    current_ = spec == specializations_.end() ? nullptr : &spec->second;
+  }
+  return current_;
+}
+
+/*!\brief Adds a value to the histogram
+
+  \param[in] val Value on x-axis
+
+  \param[in] wgt Weight of entry
+*/
+void Hist1D::SingleHist1D::Fill(NamedFunc::ScalarType val, NamedFunc::ScalarType wgt){
+  if(!reproducible_){
+    raw_hist_.Fill(val, wgt);
+    return;
+  }
+  FillBin(raw_hist_.FindFixBin(val), val, wgt);
+}
+
+/*!\brief Get number of entries the current event adds to the histogram
+
+  Used by Hist1D::Bank, which evaluates the variable and weight itself.
+
+  \param[in] baby Baby containing the current event
+
+  \return Number of entries passing proc_and_hist_cut_. 0 or 1 for a scalar
+  cut.
+*/
+long Hist1D::SingleHist1D::NumPassing(const Baby &baby){
+  const Specialization *spec = GetSpecialization(baby);
+  const NamedFunc &cut = spec ? spec->cut_ : proc_and_hist_cut_;
+  if(cut.IsScalar()) return cut.GetScalar(baby) ? 1 : 0;
+  cut_vector_ = cut.GetVector(baby);
+  return count_if(cut_vector_.cbegin(), cut_vector_.cend(),
+                  [](NamedFunc::ScalarType pass){return static_cast<bool>(pass);});
+}
+
+/*!\brief Adds a value to an already known bin
+
+  Outside reproducible mode, contents go to plain per-bin sums along with the
+  running sums TH1::Fill would keep, and are added to raw_hist_ by Finalize().
+
+  \param[in] bin Global bin number of val in raw_hist_
+
+  \param[in] val Value on x-axis
+
+  \param[in] wgt Weight of entry
+*/
+void Hist1D::SingleHist1D::FillBin(int bin, NamedFunc::ScalarType val, NamedFunc::ScalarType wgt){
+  ++num_fills_;
+  if(reproducible_){
+    exact_sumw_.at(bin) += wgt;
+    exact_sumw2_.at(bin) += wgt*wgt;
+    return;
+  }
+  if(banked_sumw_.empty()){
+    banked_sumw_.assign(raw_hist_.GetNcells(), 0.);
+    banked_sumw2_.assign(raw_hist_.GetNcells(), 0.);
+  }
+  banked_sumw_.at(bin) += wgt;
+  banked_sumw2_.at(bin) += wgt*wgt;
+  if(bin < 1 || bin > raw_hist_.GetNbinsX()) return;
+  banked_stats_[0] += wgt;
+  banked_stats_[1] += wgt*wgt;
+  banked_stats_[2] += wgt*val;
+  banked_stats_[3] += wgt*val*val;
+}
+
+/*!\brief Accumulate bin contents exactly, so they do not depend on the order
+  in which babies are processed
+
+  \param[in] reproducible If true, use ExactSum for the bin contents
+*/
+void Hist1D::SingleHist1D::Reproducible(bool reproducible){
+  reproducible_ = reproducible;
+  if(reproducible_){
+    exact_sumw_.resize(raw_hist_.GetNcells());
+    exact_sumw2_.resize(raw_hist_.GetNcells());
+  }
+}
+
+/*!\brief Copies bin contents accumulated outside raw_hist_ into it
+
+  In reproducible mode, the histogram statistics (mean, RMS) are recomputed
+  from the bin contents, since the order-dependent running sums kept by
+  TH1::Fill are not available. Contents from FillBin() otherwise carry their
+  own running sums, which are added to those of raw_hist_.
+*/
+void Hist1D::SingleHist1D::Finalize(){
+  if(num_fills_ == 0) return;
+  double entries = raw_hist_.GetEntries()+num_fills_;
+  TArrayD &sumw2 = *raw_hist_.GetSumw2();
+  if(reproducible_){
+    for(int bin = 0; bin < raw_hist_.GetNcells(); ++bin){
+      ExactSum content = exact_sumw_.at(bin), error = exact_sumw2_.at(bin);
+      content += raw_hist_.GetBinContent(bin);
+      error += sumw2[bin];
+      raw_hist_.SetBinContent(bin, content.Value());
+      sumw2[bin] = error.Value();
+      exact_sumw_.at(bin).Clear();
+      exact_sumw2_.at(bin).Clear();
+    }
+    raw_hist_.ResetStats();
+  }else{
+    double stats[4];
+    raw_hist_.GetStats(stats);
+    for(size_t bin = 0; bin < banked_sumw_.size(); ++bin){
+      raw_hist_.AddBinContent(bin, banked_sumw_.at(bin));
+      sumw2[bin] += banked_sumw2_.at(bin);
+    }
+    for(size_t i = 0; i < 4; ++i){
+      stats[i] += banked_stats_[i];
+      banked_stats_[i] = 0.;
+    }
+    raw_hist_.PutStats(stats);
+    banked_sumw_.clear();
+    banked_sumw2_.clear();
+  }
+  raw_hist_.SetEntries(entries);
+  num_fills_ = 0;
+}
+
+size_t Hist1D::SingleHist1D::MemoryUsage() const{
+  return sizeof(*this)
+    + raw_hist_.GetNcells()*sizeof(double)*(raw_hist_.GetSumw2N() ? 2 : 1)
+    + scaled_hist_.GetNcells()*sizeof(double)*(scaled_hist_.GetSumw2N() ? 2 : 1)
+    + (cut_vector_.capacity()+wgt_vector_.capacity()+val_vector_.capacity())*sizeof(NamedFunc::ScalarType)
+    + (exact_sumw_.capacity()+exact_sumw2_.capacity())*sizeof(ExactSum)
+    + (banked_sumw_.capacity()+banked_sumw2_.capacity())*sizeof(double);
+}
+
 /*! Get the maximum of the histogram
 
   \param[in] max_bound Returns the highest bin content c satisfying
@@ -271,6 +493,78 @@ double Hist1D::SingleHist1D::GetMin(double min_bound,
   return the_min;
 }
 
+/*!\brief Moves histograms that can share their per-event work into banks
+
+  Scalar histograms of the same process with identical variable, weight and
+  binning are grouped. Groups of a single histogram are left alone.
+
+  \param[in,out] components Components filled from a Baby. Banked histograms
+  are removed.
+
+  \param[in] baby Baby whose events the banks will record
+
+  \return Banks recording the removed histograms
+*/
+vector<unique_ptr<Hist1D::Bank> > Hist1D::Bank::Group(set<Figure::FigureComponent*> &components,
+                                                      const Baby &baby){
+  map<tuple<string, string, vector<double> >, vector<SingleHist1D*> > groups;
+  for(const auto &component: components){
+    SingleHist1D *hist = dynamic_cast<SingleHist1D*>(component);
+    if(hist == nullptr) continue;
+    const Hist1D &stack = static_cast<const Hist1D&>(hist->figure_);
+    if(stack.xaxis_.var_.IsVector() || stack.weight_.IsVector()) continue;
+    groups[make_tuple(stack.xaxis_.var_.Name(), stack.weight_.Name(), stack.xaxis_.Bins())].push_back(hist);
+  }
+
+  vector<unique_ptr<Bank> > banks;
+  for(const auto &group: groups){
+    const vector<SingleHist1D*> &members = group.second;
+    if(members.size() < 2) continue;
+    const Hist1D &stack = static_cast<const Hist1D&>(members.front()->figure_);
+    banks.emplace_back(new Bank(stack.xaxis_.var_.Specialized(baby),
+                                stack.weight_.Specialized(baby),
+                                members));
+    for(const auto &member: members){
+      components.erase(member);
+    }
+  }
+  return banks;
+}
+
+/*!\brief Fills every member passing its cut with the current event
+
+  The variable, weight and bin are only computed if at least one member
+  passes.
+
+  \param[in] baby Baby containing the current event
+*/
+void Hist1D::Bank::RecordEvent(const Baby &baby){
+  bool have_value = false;
+  NamedFunc::ScalarType val = 0., wgt = 0.;
+  int bin = 0;
+  for(const auto &member: members_){
+    lock_guard<mutex> lock(member->mutex_);
+    long num_passing = member->NumPassing(baby);
+    if(num_passing == 0) continue;
+    if(!have_value){
+      val = var_.GetScalar(baby);
+      wgt = weight_.GetScalar(baby);
+      bin = member->raw_hist_.FindFixBin(val);
+      have_value = true;
+    }
+    for(long i = 0; i < num_passing; ++i){
+      member->FillBin(bin, val, wgt);
+    }
+  }
+}
+
+Hist1D::Bank::Bank(const NamedFunc &var, const NamedFunc &weight,
+                   const vector<SingleHist1D*> &members):
+  var_(var),
+  weight_(weight),
+  members_(members){
+}
+
 /*! \brief Standard constructor
 
   \param[in] processes List of process for the component histograms
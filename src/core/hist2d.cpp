@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <atomic>
+#include <unordered_map>
 
 #include <sys/stat.h>
 
@@ -16,24 +18,60 @@
 #include "TColor.h"
 #include "TArrow.h"
 #include "core/named_func.hpp"
+#include "core/utilities.hpp"
+#include "core/checkpoint.hpp"
+#include "core/event_cache.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
 
+namespace{
+  atomic<size_t> next_hist2d_id(0);
+  atomic<uint64_t> next_buffer_seed(1);
+}
+
+/*! \class Hist2D::SingleHist2D
+
+  \brief Histogram and scatter sample of one process
+
+  The binned TH2D holds the exact totals, while the points drawn in scatter
+  mode come from a weighted reservoir of at most Hist2D::MaxPoints() points
+  (10000 by default), so memory stays bounded however many points pass the
+  cut. Each thread records into its own buffer without locking, and
+  Finalize() merges the buffers' histograms and reservoirs.
+*/
+
+Hist2D::SingleHist2D::Buffer::Buffer(const Clustering::Clusterizer &empty,
+                                     uint64_t seed):
+  clusterizer_(empty),
+  cut_vector_(),
+  wgt_vector_(),
+  xval_vector_(),
+  yval_vector_(){
+  clusterizer_.Clear(seed);
+}
+
 Hist2D::SingleHist2D::SingleHist2D(const Hist2D &figure,
                                    const std::shared_ptr<Process> &process,
                                    const TH2D &hist_template):
   FigureComponent(figure, process),
   clusterizer_(hist_template, 10000),
   proc_and_hist_cut_(figure.cut_ && process->cut_),
-  cut_vector_(),
-  wgt_vector_(),
-  xval_vector_(),
-  yval_vector_(){
+  id_(next_hist2d_id++),
+  reproducible_(false),
+  replayed_(EventCache::Source(process.get()) != nullptr),
+  buffers_mutex_(),
+  buffers_(){
 }
 
 void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   const Hist2D& hist = static_cast<const Hist2D&>(figure_);
+  Buffer &buffer = ThreadBuffer();
+  Clustering::Clusterizer &clusterizer = buffer.clusterizer_;
+  NamedFunc::VectorType &cut_vector = buffer.cut_vector_;
+  NamedFunc::VectorType &wgt_vector = buffer.wgt_vector_;
+  NamedFunc::VectorType &xval_vector = buffer.xval_vector_;
+  NamedFunc::VectorType &yval_vector = buffer.yval_vector_;
   size_t min_vec_size;
   bool have_vec = false;
 
@@ -41,10 +79,10 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(cut.IsScalar()){
     if(!cut.GetScalar(baby)) return;
   }else{
-    cut_vector_ = cut.GetVector(baby);
-    if(!HavePass(cut_vector_)) return;
+    cut_vector = cut.GetVector(baby);
+    if(!HavePass(cut_vector)) return;
     have_vec = true;
-    min_vec_size = cut_vector_.size();
+    min_vec_size = cut_vector.size();
   }
 
   const NamedFunc &wgt = hist.weight_;
@@ -52,10 +90,10 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(wgt.IsScalar()){
     wgt_scalar = wgt.GetScalar(baby);
   }else{
-    wgt_vector_ = wgt.GetVector(baby);
-    if(!have_vec || wgt_vector_.size() < min_vec_size){
+    wgt_vector = wgt.GetVector(baby);
+    if(!have_vec || wgt_vector.size() < min_vec_size){
       have_vec = true;
-      min_vec_size = wgt_vector_.size();
+      min_vec_size = wgt_vector.size();
     }
   }
 
@@ -64,10 +102,10 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(xval.IsScalar()){
     xval_scalar = xval.GetScalar(baby);
   }else{
-    xval_vector_ = xval.GetVector(baby);
-    if(!have_vec || xval_vector_.size() < min_vec_size){
+    xval_vector = xval.GetVector(baby);
+    if(!have_vec || xval_vector.size() < min_vec_size){
       have_vec = true;
-      min_vec_size = xval_vector_.size();
+      min_vec_size = xval_vector.size();
     }
   }
 
@@ -76,25 +114,189 @@ void Hist2D::SingleHist2D::RecordEvent(const Baby &baby){
   if(yval.IsScalar()){
     yval_scalar = yval.GetScalar(baby);
   }else{
-    yval_vector_ = yval.GetVector(baby);
-    if(!have_vec || yval_vector_.size() < min_vec_size){
+    yval_vector = yval.GetVector(baby);
+    if(!have_vec || yval_vector.size() < min_vec_size){
       have_vec = true;
-      min_vec_size = yval_vector_.size();
+      min_vec_size = yval_vector.size();
     }
   }
 
+  uint64_t event_tag = 0;
+  if(reproducible_ && replayed_){
+    event_tag = EventCache::RowHash();
+  }else if(reproducible_){
+    event_tag = static_cast<uint64_t>(baby.event())
+      ^ (static_cast<uint64_t>(baby.lumiblock()) << 40)
+      ^ (static_cast<uint64_t>(baby.run()) << 20);
+  }
+
   if(!have_vec){
-    clusterizer_.AddPoint(xval_scalar, yval_scalar, wgt_scalar);
+    clusterizer.AddPoint(xval_scalar, yval_scalar, wgt_scalar, event_tag);
   }else{
     for(size_t i = 0; i < min_vec_size; ++i){
-      if(cut.IsVector() && !cut_vector_.at(i)) continue;
-      clusterizer_.AddPoint(xval.IsScalar() ? xval_scalar : xval_vector_.at(i),
-                            yval.IsScalar() ? yval_scalar : yval_vector_.at(i),
-                            wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(i));
+      if(cut.IsVector() && !cut_vector.at(i)) continue;
+      clusterizer.AddPoint(xval.IsScalar() ? xval_scalar : xval_vector.at(i),
+                           yval.IsScalar() ? yval_scalar : yval_vector.at(i),
+                           wgt.IsScalar() ? wgt_scalar : wgt_vector.at(i),
+                           event_tag, i);
     }
   }
 }
 
+size_t Hist2D::SingleHist2D::MemoryUsage() const{
+  size_t bytes = sizeof(*this) + clusterizer_.MemoryUsage();
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    bytes += sizeof(*buffer) + buffer->clusterizer_.MemoryUsage()
+      + (buffer->cut_vector_.capacity()+buffer->wgt_vector_.capacity()
+         +buffer->xval_vector_.capacity()+buffer->yval_vector_.capacity())*sizeof(NamedFunc::ScalarType);
+  }
+  return bytes;
+}
+
+/*!\brief Limits the number of sampled points so that they fit in bytes
+
+  Each thread keeps a reservoir of up to the same size until they are
+  merged into clusterizer_, so the bytes are split between num_threads+1
+  reservoirs.
+
+  \param[in] bytes Maximum number of bytes
+
+  \param[in] num_threads Number of threads that may record at once
+*/
+void Hist2D::SingleHist2D::MemoryLimit(size_t bytes, size_t num_threads){
+  long max_points = bytes/(num_threads+1)/Clustering::Reservoir::BytesPerPoint();
+  if(clusterizer_.MaxPoints() < 0 || max_points < clusterizer_.MaxPoints()){
+    MaxPoints(max_points);
+  }
+}
+
+/*!\brief Points beyond the memory limit are only kept as histogram bins
+
+  \return True
+*/
+bool Hist2D::SingleHist2D::MemoryLimited() const{
+  return true;
+}
+
+/*!\brief Threads record into their own buffers and need no lock
+
+  \return True
+*/
+bool Hist2D::SingleHist2D::Concurrent() const{
+  return true;
+}
+
+/*!\brief Samples points independently of the order in which events are read
+
+  \param[in] reproducible If true, sample with keys hashed from the points and
+  their events
+*/
+void Hist2D::SingleHist2D::Reproducible(bool reproducible){
+  reproducible_ = reproducible;
+  clusterizer_.Reproducible(reproducible);
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    buffer->clusterizer_.Reproducible(reproducible);
+  }
+}
+
+/*!\brief Merges the per-thread histograms and samples into clusterizer_
+
+  The buffers are emptied but kept, since threads hold on to them.
+*/
+void Hist2D::SingleHist2D::Finalize(){
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    clusterizer_.Merge(buffer->clusterizer_);
+    buffer->clusterizer_.Clear(next_buffer_seed++);
+  }
+}
+
+string Hist2D::SingleHist2D::Definition() const{
+  const Hist2D& hist = static_cast<const Hist2D&>(figure_);
+  ostringstream oss;
+  oss.precision(17);
+  oss << "Hist2D;";
+  for(const auto &axis: {&hist.xaxis_, &hist.yaxis_}){
+    oss << axis->var_.Name() << ';';
+    for(const auto &edge: axis->Bins()) oss << edge << ',';
+    oss << ';';
+  }
+  oss << proc_and_hist_cut_.Name() << ';' << hist.weight_.Name() << ';' << process_->name_;
+  return oss.str();
+}
+
+/*!\brief Writes the histogram and sample merged over all threads
+
+  \param[in,out] out Stream to write to
+
+  \return True
+*/
+bool Hist2D::SingleHist2D::SaveState(ostream &out) const{
+  lock_guard<mutex> lock(buffers_mutex_);
+  if(buffers_.empty()){
+    clusterizer_.SaveState(out);
+    return true;
+  }
+  unique_ptr<Clustering::Clusterizer> merged;
+  {
+    lock_guard<mutex> root_lock(Multithreading::root_mutex);
+    merged.reset(new Clustering::Clusterizer(clusterizer_));
+  }
+  for(const auto &buffer: buffers_){
+    merged->Merge(buffer->clusterizer_);
+  }
+  merged->SaveState(out);
+  return true;
+}
+
+/*!\brief Replaces the histogram and sample with a state written by
+  SaveState()
+
+  \param[in,out] in Stream to read from
+*/
+void Hist2D::SingleHist2D::LoadState(istream &in){
+  clusterizer_.LoadState(in);
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    buffer->clusterizer_.Clear(next_buffer_seed++);
+  }
+}
+
+/*!\brief Sets the maximum number of points sampled for drawing
+
+  \param[in] max_points Maximum number of points. Negative for no limit, 0 to
+  draw points spread within the histogram bins.
+*/
+void Hist2D::SingleHist2D::MaxPoints(long max_points){
+  clusterizer_.MaxPoints(max_points);
+  lock_guard<mutex> lock(buffers_mutex_);
+  for(const auto &buffer: buffers_){
+    buffer->clusterizer_.MaxPoints(max_points);
+  }
+}
+
+/*!\brief Get the buffer belonging to the calling thread
+
+  \return Buffer created on first use by this thread
+*/
+Hist2D::SingleHist2D::Buffer & Hist2D::SingleHist2D::ThreadBuffer(){
+  static thread_local unordered_map<size_t, Buffer*> thread_buffers;
+  Buffer *&buffer = thread_buffers[id_];
+  if(buffer == nullptr){
+    unique_ptr<Buffer> new_buffer;
+    {
+      lock_guard<mutex> lock(Multithreading::root_mutex);
+      new_buffer.reset(new Buffer(clusterizer_, next_buffer_seed++));
+    }
+    buffer = new_buffer.get();
+    lock_guard<mutex> lock(buffers_mutex_);
+    buffers_.push_back(move(new_buffer));
+  }
+  return *buffer;
+}
+
 Hist2D::Hist2D(const Axis &xaxis, const Axis &yaxis, const NamedFunc &cut,
                const std::vector<std::shared_ptr<Process> > &processes,
                const std::vector<PlotOpt> &plot_options):
@@ -426,6 +628,25 @@ Hist2D & Hist2D::Tag(const std::string &tag){
   return *this;
 }
 
+/*!\brief Sets the number of points sampled per process for scatter plots
+
+  Totals always come from the full histogram. Only the drawn points are
+  sampled.
+
+  \param[in] max_points Maximum number of points per process. Negative to
+  keep all points, 0 to draw points spread within the histogram bins.
+
+  \return Reference to *this
+*/
+Hist2D & Hist2D::MaxPoints(long max_points){
+  for(const auto &components: {&backgrounds_, &signals_, &datas_}){
+    for(const auto &component: *components){
+      component->MaxPoints(max_points);
+    }
+  }
+  return *this;
+}
+
 void Hist2D::AddEntry(TLegend &l, const SingleHist2D &h, const TGraph &g) const{
   string name = h.process_->name_;
   ostringstream oss;
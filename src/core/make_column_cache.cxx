@@ -0,0 +1,90 @@
+// Writes memory-mapped column caches for baby files, which Baby then reads
+// instead of the ROOT files when BABY_COLUMN_CACHE points to the cache directory
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <sstream>
+
+#include <unistd.h>
+#include <getopt.h>
+
+#include "TError.h"
+
+#include "core/column_cache.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  string cache_dir = ColumnCache::Directory();
+  vector<string> branches;
+  vector<string> file_patterns;
+}
+
+void GetOptions(int argc, char *argv[]);
+
+int main(int argc, char *argv[]){
+  gErrorIgnoreLevel = 6000;
+  GetOptions(argc, argv);
+  if(cache_dir == "" || file_patterns.empty()){
+    cout << "Usage: " << argv[0] << " [-o cache_dir] [-b branch1,branch2,...] files..." << endl;
+    cout << "The cache directory defaults to $BABY_COLUMN_CACHE." << endl;
+    return 1;
+  }
+  ColumnCache::Directory(cache_dir);
+
+  set<string> files;
+  for(const auto &pattern: file_patterns){
+    for(const auto &file: Glob(pattern)){
+      files.insert(file);
+    }
+  }
+
+  for(const auto &file: files){
+    cout << file << " -> " << ColumnCache::Convert(file, branches) << endl;
+  }
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"output", required_argument, 0, 'o'},
+      {"branches", required_argument, 0, 'b'},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "o:b:", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'o':
+      cache_dir = optarg;
+      break;
+    case 'b':{
+      string list = optarg;
+      ReplaceAll(list, ",", " ");
+      istringstream iss(list);
+      string branch;
+      while(iss >> branch) branches.push_back(branch);
+      break;
+    }
+    case 0:
+      optname = long_options[option_index].name;
+      printf("Bad option! Found option name %s\n", optname.c_str());
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+  for(int argi = optind; argi < argc; ++argi){
+    file_patterns.push_back(argv[argi]);
+  }
+}
@@ -0,0 +1,148 @@
+/*! \class MemoryMonitor
+
+  \brief Reports resident memory of the process, and its peak during each
+  phase of a job
+
+  Memory is read from /proc/self/status (VmRSS for current and VmHWM for peak
+  resident set size). At the start of each phase, the kernel's peak counter is
+  reset by writing to /proc/self/clear_refs, so the peak recorded at the end of
+  the phase belongs to that phase alone. On systems where the peak cannot be
+  reset, the recorded value is the peak since the start of the process.
+
+  Work done before the monitor existed, such as setting up a job, is recorded
+  with RecordPeak(), which takes the peak since the start of the process or
+  the last reset.
+*/
+#include "core/memory_monitor.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+namespace{
+  size_t ReadStatusField(const string &field){
+    ifstream status("/proc/self/status");
+    string line;
+    while(getline(status, line)){
+      if(line.compare(0, field.size(), field) != 0) continue;
+      istringstream iss(line.substr(field.size()));
+      size_t kilobytes = 0;
+      iss >> kilobytes;
+      return 1024*kilobytes;
+    }
+    return 0;
+  }
+}
+
+/*!\brief Standard constructor
+ */
+MemoryMonitor::MemoryMonitor():
+  phases_(),
+  current_phase_(){
+}
+
+/*!\brief Ends phase in progress, if any, and starts a new one
+
+  \param[in] name Name of phase to start
+
+  \return Reference to *this
+*/
+MemoryMonitor & MemoryMonitor::StartPhase(const string &name){
+  EndPhase();
+  ResetPeak();
+  current_phase_ = name;
+  return *this;
+}
+
+/*!\brief Records peak resident memory of phase in progress
+
+  \return Reference to *this
+*/
+MemoryMonitor & MemoryMonitor::EndPhase(){
+  if(current_phase_ == "") return *this;
+  phases_.emplace_back(current_phase_, PeakResidentBytes());
+  current_phase_ = "";
+  return *this;
+}
+
+/*!\brief Ends phase in progress, if any, and records the peak resident
+  memory since the last reset as a finished phase
+
+  \param[in] name Name of the phase that just ended, e.g. "setup"
+
+  \return Reference to *this
+*/
+MemoryMonitor & MemoryMonitor::RecordPeak(const string &name){
+  EndPhase();
+  phases_.emplace_back(name, PeakResidentBytes());
+  return *this;
+}
+
+/*!\brief Get peak resident memory of each finished phase
+
+  \return List of (phase name, peak bytes)
+*/
+const vector<pair<string, size_t> > & MemoryMonitor::Phases() const{
+  return phases_;
+}
+
+/*!\brief Get one-line summary of peak memory per phase
+
+  \return Summary, e.g. "Peak memory: setup 1.2 GB, loop 3.4 GB"
+*/
+string MemoryMonitor::Summary() const{
+  ostringstream oss;
+  oss << "Peak memory:";
+  for(size_t i = 0; i < phases_.size(); ++i){
+    oss << (i == 0 ? " " : ", ") << phases_.at(i).first << ' ' << FormatBytes(phases_.at(i).second);
+  }
+  return oss.str();
+}
+
+/*!\brief Get current resident memory of the process
+
+  \return Resident set size in bytes, or 0 if unavailable
+*/
+size_t MemoryMonitor::ResidentBytes(){
+  return ReadStatusField("VmRSS:");
+}
+
+/*!\brief Get peak resident memory since start of process or last ResetPeak()
+
+  \return Peak resident set size in bytes, or 0 if unavailable
+*/
+size_t MemoryMonitor::PeakResidentBytes(){
+  return ReadStatusField("VmHWM:");
+}
+
+/*!\brief Reset peak resident memory to current resident memory
+
+  \return True if the peak could be reset
+*/
+bool MemoryMonitor::ResetPeak(){
+  ofstream clear_refs("/proc/self/clear_refs");
+  if(!clear_refs) return false;
+  clear_refs << "5" << flush;
+  return static_cast<bool>(clear_refs);
+}
+
+/*!\brief Format a number of bytes with a suitable unit
+
+  \param[in] bytes Number of bytes
+
+  \return String such as "512 kB" or "3.4 GB"
+*/
+string MemoryMonitor::FormatBytes(size_t bytes){
+  const char * const units[] = {"B", "kB", "MB", "GB", "TB"};
+  double value = bytes;
+  size_t unit = 0;
+  while(value >= 1024. && unit < 4){
+    value /= 1024.;
+    ++unit;
+  }
+  ostringstream oss;
+  oss << fixed << setprecision(unit == 0 ? 0 : 1) << value << ' ' << units[unit];
+  return oss.str();
+}
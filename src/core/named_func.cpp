@@ -38,6 +38,21 @@
   extra vectors being constructed (and often copied if care is not taken with
   results) even when evaluating a simple scalar value.
 
+  Many functions branch on quantities that are fixed for a whole Baby, such as
+  Baby::SampleType(). Such a function can be given a specializer with
+  NamedFunc::Specializer(), which builds an equivalent function for the
+  constants of a given Baby. PlotMaker calls NamedFunc::Specialized() once per
+  Baby, and the operators above pass the request on to their operands, so a
+  combined cut or weight is rebuilt from the specialized pieces. Constant
+  operands are folded while combining: a data-only trigger requirement
+  specialized to 1 on simulation disappears from "trig&&cuts", and a weight
+  specialized to 0 removes the terms it multiplies.
+
+  The same mechanism binds functions to the concrete Baby type. Variables
+  found by name and functions built with NamedFunc::Typed() are specialized to
+  call the accessors of the final derived Baby class directly, so those calls
+  are not virtual and can be inlined.
+
   \see FunctionParser for allowed expression syntax for constructing a
   NamedFunc.
 */
@@ -299,6 +314,215 @@ namespace{
     }
     return make_pair(sfo, vfo);
   }
+
+  using Recombiner = function<NamedFunc(const NamedFunc &, const NamedFunc &)>;
+  using Folder = bool (*)(const NamedFunc &, const NamedFunc &, NamedFunc &);
+
+  ScalarType Truth(ScalarType x){
+    return x != 0.;
+  }
+
+  bool IsConstant(const NamedFunc &f, ScalarType x){
+    return f.IsConstant() && f.ConstantValue() == x;
+  }
+
+  /*!\brief Replaces result by a constant, keeping its name
+
+    \param[in,out] result Function to replace
+
+    \param[in] x Constant value
+  */
+  void MakeConstant(NamedFunc &result, ScalarType x){
+    string name = result.Name();
+    result = NamedFunc(x);
+    result.Name(name);
+  }
+
+  /*!\brief Sets the function of result to that of f
+
+    \param[in,out] result Function to modify
+
+    \param[in] f Function to copy
+  */
+  void CopyFunction(NamedFunc &result, const NamedFunc &f){
+    if(f.IsScalar()) result.Function(f.ScalarFunction());
+    else result.Function(f.VectorFunction());
+  }
+
+  /*!\brief Sets the function of result to the truth value of f
+
+    \param[in,out] result Function to modify
+
+    \param[in] f Function whose truth value is taken
+  */
+  void CopyTruth(NamedFunc &result, const NamedFunc &f){
+    if(f.IsScalar()) result.Function(ApplyOp(f.ScalarFunction(), Truth));
+    else result.Function(ApplyOp(f.VectorFunction(), Truth));
+  }
+
+  bool FoldSum(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(IsConstant(g, 0.)){
+      CopyFunction(result, f);
+      return true;
+    }else if(IsConstant(f, 0.)){
+      CopyFunction(result, g);
+      return true;
+    }
+    return false;
+  }
+
+  bool FoldDifference(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(!IsConstant(g, 0.)) return false;
+    CopyFunction(result, f);
+    return true;
+  }
+
+  bool FoldProduct(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(IsConstant(g, 1.)){
+      CopyFunction(result, f);
+      return true;
+    }else if(IsConstant(f, 1.)){
+      CopyFunction(result, g);
+      return true;
+    }else if((IsConstant(f, 0.) && g.IsScalar()) || (IsConstant(g, 0.) && f.IsScalar())){
+      MakeConstant(result, 0.);
+      return true;
+    }
+    return false;
+  }
+
+  bool FoldQuotient(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(!IsConstant(g, 1.)) return false;
+    CopyFunction(result, f);
+    return true;
+  }
+
+  bool FoldAnd(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(f.IsConstant()){
+      if(!f.ConstantValue()){
+        if(!g.IsScalar()) return false;
+        MakeConstant(result, 0.);
+      }else{
+        CopyTruth(result, g);
+      }
+      return true;
+    }else if(g.IsConstant()){
+      if(!g.ConstantValue()){
+        if(!f.IsScalar()) return false;
+        MakeConstant(result, 0.);
+      }else{
+        CopyTruth(result, f);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool FoldOr(const NamedFunc &f, const NamedFunc &g, NamedFunc &result){
+    if(f.IsConstant()){
+      if(f.ConstantValue()){
+        if(!g.IsScalar()) return false;
+        MakeConstant(result, 1.);
+      }else{
+        CopyTruth(result, g);
+      }
+      return true;
+    }else if(g.IsConstant()){
+      if(g.ConstantValue()){
+        if(!f.IsScalar()) return false;
+        MakeConstant(result, 1.);
+      }else{
+        CopyTruth(result, f);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  /*!\brief Get a NamedFunc applying binary operator op to f and g
+
+    Constant operands are folded. If f or g can be specialized, so can the
+    result, by recombining the specialized operands.
+
+    \param[in] name Name of result
+
+    \param[in] f Left hand operand
+
+    \param[in] g Right hand operand
+
+    \param[in] op Operator to apply to the results of f and g
+
+    \param[in] fold Simplifies the result when f or g is constant, or nullptr
+
+    \param[in] recombine Applies the operator to two \link NamedFunc
+    NamedFuncs\endlink
+
+    \return NamedFunc returning result of op applied to f and g
+  */
+  template<typename Operator>
+    NamedFunc Combine(const string &name,
+                      const NamedFunc &f,
+                      const NamedFunc &g,
+                      const Operator &op,
+                      Folder fold,
+                      const Recombiner &recombine){
+    if(f.IsConstant() && g.IsConstant()){
+      function<ScalarType(ScalarType,ScalarType)> op_c(op);
+      NamedFunc result(op_c(f.ConstantValue(), g.ConstantValue()));
+      result.Name(name);
+      return result;
+    }
+    NamedFunc result(f);
+    result.Name(name);
+    if(fold == nullptr || !fold(f, g, result)){
+      auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
+                        g.ScalarFunction(), g.VectorFunction(),
+                        op);
+      result.Function(fp.first);
+      result.Function(fp.second);
+    }
+    if(!result.IsConstant() && (f.IsSpecializable() || g.IsSpecializable())){
+      result.Specializer([f, g, recombine](const Baby &b){
+          return recombine(f.Specialized(b), g.Specialized(b));
+        });
+    }
+    return result;
+  }
+
+  /*!\brief Get a NamedFunc applying unary operator op to f
+
+    \param[in] name Name of result
+
+    \param[in] f Operand
+
+    \param[in] op Operator to apply to the result of f
+
+    \param[in] reapply Applies the operator to a NamedFunc
+
+    \return NamedFunc returning result of op applied to f
+  */
+  template<typename Operator>
+    NamedFunc Transform(const string &name,
+                        const NamedFunc &f,
+                        const Operator &op,
+                        const function<NamedFunc(const NamedFunc &)> &reapply){
+    if(f.IsConstant()){
+      function<ScalarType(ScalarType)> op_c(op);
+      NamedFunc result(op_c(f.ConstantValue()));
+      result.Name(name);
+      return result;
+    }
+    NamedFunc result(f);
+    result.Name(name);
+    result.Function(ApplyOp(f.ScalarFunction(), op));
+    result.Function(ApplyOp(f.VectorFunction(), op));
+    if(f.IsSpecializable()){
+      result.Specializer([f, reapply](const Baby &b){
+          return reapply(f.Specialized(b));
+        });
+    }
+    return result;
+  }
 }
 
 /*!\brief Constructor of a scalar NamedFunc
@@ -311,7 +535,10 @@ NamedFunc::NamedFunc(const std::string &name,
                      const std::function<ScalarFunc> &function):
   name_(name),
   scalar_func_(function),
-  vector_func_(){
+  vector_func_(),
+  specializer_(),
+  is_constant_(false),
+  constant_(0.){
   CleanName();
 }
 
@@ -325,7 +552,10 @@ NamedFunc::NamedFunc(const std::string &name,
                      const std::function<VectorFunc> &function):
   name_(name),
   scalar_func_(),
-  vector_func_(function){
+  vector_func_(function),
+  specializer_(),
+  is_constant_(false),
+  constant_(0.){
   CleanName();
   }
 
@@ -366,7 +596,10 @@ NamedFunc::NamedFunc(const TString &function):
 NamedFunc::NamedFunc(ScalarType x):
   name_(ToString(x)),
   scalar_func_([x](const Baby&){return x;}),
-  vector_func_(){
+  vector_func_(),
+  specializer_(),
+  is_constant_(true),
+  constant_(x){
 }
 
 /*!\brief Get the string representation of this function
@@ -390,7 +623,7 @@ NamedFunc & NamedFunc::Name(const string &name){
 /*!\brief Set function to given scalar function
 
   This function overwrites the scalar function and invalidates the vector
-  function if set.
+  function if set. Any specializer is dropped.
 
   \param[in] f Valid function taking a Baby and returning a scalar
 
@@ -400,13 +633,15 @@ NamedFunc & NamedFunc::Function(const std::function<ScalarFunc> &f){
   if(!static_cast<bool>(f)) return *this;
   scalar_func_ = f;
   vector_func_ = function<VectorFunc>();
+  specializer_.reset();
+  is_constant_ = false;
   return *this;
 }
 
 /*!\brief Set function to given vector function
 
   This function overwrites the vector function and invalidates the scalar
-  function if set.
+  function if set. Any specializer is dropped.
 
   \param[in] f Valid function taking a Baby and returning a vector
 
@@ -416,6 +651,8 @@ NamedFunc & NamedFunc::Function(const std::function<VectorFunc> &f){
   if(!static_cast<bool>(f)) return *this;
   scalar_func_ = function<ScalarFunc>();
   vector_func_ = f;
+  specializer_.reset();
+  is_constant_ = false;
   return *this;
 }
 
@@ -451,6 +688,78 @@ bool NamedFunc::IsVector() const{
   return static_cast<bool>(vector_func_);
 }
 
+/*!\brief Set function building an equivalent NamedFunc for the file-level
+  constants of a Baby
+
+  The specializer may use anything that is fixed for the whole Baby, such as
+  Baby::SampleType() or Baby::FileNames(), but no event content. It must
+  return a function giving the same results as *this for every event of that
+  Baby, e.g. NamedFunc(1.) for a data-only requirement on simulation.
+
+  \param[in] specializer Function taking a Baby and returning the specialized
+  NamedFunc. An empty function removes the specializer.
+
+  \return Reference to *this
+*/
+NamedFunc & NamedFunc::Specializer(const function<SpecializerFunc> &specializer){
+  if(static_cast<bool>(specializer)){
+    specializer_ = make_shared<const function<SpecializerFunc> >(specializer);
+  }else{
+    specializer_.reset();
+  }
+  return *this;
+}
+
+/*!\brief Reports a NamedFunc::Typed() function called with another Baby type
+
+  \param[in] name Name of function
+*/
+void NamedFunc::BadBabyType(const string &name){
+  ERROR("Function "+name+" requires a different type of Baby.");
+}
+
+/*!\brief Check if function has a specializer
+
+  \return True if Specialized() may return something other than *this
+*/
+bool NamedFunc::IsSpecializable() const{
+  return static_cast<bool>(specializer_);
+}
+
+/*!\brief Get function specialized to the file-level constants of a Baby
+
+  \param[in] b Baby whose events will be evaluated
+
+  \return Equivalent NamedFunc for events of b, with the same name as *this
+*/
+NamedFunc NamedFunc::Specialized(const Baby &b) const{
+  if(!specializer_) return *this;
+  NamedFunc result = (*specializer_)(b);
+  if(result.IsScalar() != IsScalar()){
+    ERROR("Specialization of "+name_+" does not match its scalar/vector type.");
+  }
+  result.name_ = name_;
+  result.specializer_.reset();
+  return result;
+}
+
+/*!\brief Check if function returns the same scalar for every event
+
+  \return True if function was constructed from a constant or folded to one
+*/
+bool NamedFunc::IsConstant() const{
+  return is_constant_;
+}
+
+/*!\brief Get value of a constant function
+
+  \return Value returned for every event
+*/
+ScalarType NamedFunc::ConstantValue() const{
+  if(!is_constant_) ERROR("NamedFunc "+name_+" is not constant.");
+  return constant_;
+}
+
 /*!\brief Evaluate scalar function with b as argument
 
   \param[in] b Baby to pass to scalar function
@@ -478,12 +787,9 @@ VectorType NamedFunc::GetVector(const Baby &b) const{
   \return Reference to *this
 */
 NamedFunc & NamedFunc::operator += (const NamedFunc &func){
-  name_ = "("+name_ + ")+(" + func.name_ + ")";
-  auto fp = ApplyOp(scalar_func_, vector_func_,
-                    func.scalar_func_, func.vector_func_,
-                    plus<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  *this = Combine("("+name_ + ")+(" + func.name_ + ")", *this, func,
+                  plus<ScalarType>(), FoldSum,
+                  [](const NamedFunc &f, const NamedFunc &g){return f+g;});
   return *this;
 }
 
@@ -494,12 +800,9 @@ NamedFunc & NamedFunc::operator += (const NamedFunc &func){
   \return Reference to *this
 */
 NamedFunc & NamedFunc::operator -= (const NamedFunc &func){
-  name_ = "("+name_ + ")-(" + func.name_ + ")";
-  auto fp = ApplyOp(scalar_func_, vector_func_,
-                    func.scalar_func_, func.vector_func_,
-                    minus<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  *this = Combine("("+name_ + ")-(" + func.name_ + ")", *this, func,
+                  minus<ScalarType>(), FoldDifference,
+                  [](const NamedFunc &f, const NamedFunc &g){return f-g;});
   return *this;
 }
 
@@ -510,12 +813,9 @@ NamedFunc & NamedFunc::operator -= (const NamedFunc &func){
   \return Reference to *this
 */
 NamedFunc & NamedFunc::operator *= (const NamedFunc &func){
-  name_ = "("+name_ + ")*(" + func.name_ + ")";
-  auto fp = ApplyOp(scalar_func_, vector_func_,
-                    func.scalar_func_, func.vector_func_,
-                    multiplies<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  *this = Combine("("+name_ + ")*(" + func.name_ + ")", *this, func,
+                  multiplies<ScalarType>(), FoldProduct,
+                  [](const NamedFunc &f, const NamedFunc &g){return f*g;});
   return *this;
 }
 
@@ -526,12 +826,9 @@ NamedFunc & NamedFunc::operator *= (const NamedFunc &func){
   \return Reference to *this
 */
 NamedFunc & NamedFunc::operator /= (const NamedFunc &func){
-  name_ = "("+name_ + ")/(" + func.name_ + ")";
-  auto fp = ApplyOp(scalar_func_, vector_func_,
-                    func.scalar_func_, func.vector_func_,
-                    divides<ScalarType>());
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  *this = Combine("("+name_ + ")/(" + func.name_ + ")", *this, func,
+                  divides<ScalarType>(), FoldQuotient,
+                  [](const NamedFunc &f, const NamedFunc &g){return f/g;});
   return *this;
 }
 
@@ -542,12 +839,9 @@ NamedFunc & NamedFunc::operator /= (const NamedFunc &func){
   \return Reference to *this
 */
 NamedFunc & NamedFunc::operator %= (const NamedFunc &func){
-  name_ = "("+name_ + ")%(" + func.name_ + ")";
-  auto fp = ApplyOp(scalar_func_, vector_func_,
-                    func.scalar_func_, func.vector_func_,
-                    static_cast<ScalarType (*)(ScalarType ,ScalarType)>(fmod));
-  scalar_func_ = fp.first;
-  vector_func_ = fp.second;
+  *this = Combine("("+name_ + ")%(" + func.name_ + ")", *this, func,
+                  static_cast<ScalarType (*)(ScalarType ,ScalarType)>(fmod), nullptr,
+                  [](const NamedFunc &f, const NamedFunc &g){return f%g;});
   return *this;
 }
 
@@ -558,9 +852,16 @@ NamedFunc NamedFunc::operator [] (const NamedFunc &func) const{
   if(func.IsVector()) ERROR("Cannot use vector "+func.Name()+" as index");
   const auto &vec = VectorFunction();
   const auto &index = func.ScalarFunction();
-  return NamedFunc("("+Name()+")["+func.Name()+"]", [vec, index](const Baby &b){
+  NamedFunc result("("+Name()+")["+func.Name()+"]", [vec, index](const Baby &b){
       return vec(b).at(index(b));
     });
+  if(IsSpecializable() || func.IsSpecializable()){
+    NamedFunc vec_func(*this);
+    result.Specializer([vec_func, func](const Baby &b){
+        return vec_func.Specialized(b)[func.Specialized(b)];
+      });
+  }
+  return result;
 }
 
 /*!\brief Strip spaces from name
@@ -648,10 +949,8 @@ NamedFunc operator + (NamedFunc f){
   \return NamedFunc returing the negative of the result of f
 */
 NamedFunc operator - (NamedFunc f){
-  f.Name("-(" + f.Name() + ")");
-  f.Function(ApplyOp(f.ScalarFunction(), negate<ScalarType>()));
-  f.Function(ApplyOp(f.VectorFunction(), negate<ScalarType>()));
-  return f;
+  return Transform("-(" + f.Name() + ")", f, negate<ScalarType>(),
+                   [](const NamedFunc &g){return -g;});
 }
 
 /*!\brief Gets NamedFunc which tests for equality of results of f and g
@@ -663,13 +962,9 @@ NamedFunc operator - (NamedFunc f){
   \return NamedFunc returning whether the results of f and g are equal
 */
 NamedFunc operator == (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")==(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    equal_to<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")==(" + g.Name() + ")", f, g,
+                 equal_to<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a==b;});
 }
 
 /*!\brief Gets NamedFunc which tests for inequality of results of f and g
@@ -681,13 +976,9 @@ NamedFunc operator == (NamedFunc f, NamedFunc g){
   \return NamedFunc returning whether the results of f and g are not equal
 */
 NamedFunc operator != (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")!=(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    not_equal_to<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")!=(" + g.Name() + ")", f, g,
+                 not_equal_to<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a!=b;});
 }
 
 /*!\brief Gets NamedFunc which tests if result of f is greater than result of g
@@ -700,13 +991,9 @@ NamedFunc operator != (NamedFunc f, NamedFunc g){
   g
 */
 NamedFunc operator > (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")>(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    greater<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")>(" + g.Name() + ")", f, g,
+                 greater<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a>b;});
 }
 
 /*!\brief Gets NamedFunc which tests if result of f is less than result of g
@@ -718,13 +1005,9 @@ NamedFunc operator > (NamedFunc f, NamedFunc g){
   \return NamedFunc returning whether the results of f is less than result of g
 */
 NamedFunc operator < (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")<(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    less<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")<(" + g.Name() + ")", f, g,
+                 less<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a<b;});
 }
 
 /*!\brief Gets NamedFunc which tests if result of f is greater than or equal to
@@ -738,13 +1021,9 @@ NamedFunc operator < (NamedFunc f, NamedFunc g){
   to result of g
 */
 NamedFunc operator >= (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")>=(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    greater_equal<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")>=(" + g.Name() + ")", f, g,
+                 greater_equal<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a>=b;});
 }
 
 /*!\brief Gets NamedFunc which tests if result of f is less than or equal to
@@ -758,13 +1037,9 @@ NamedFunc operator >= (NamedFunc f, NamedFunc g){
   result of g
 */
 NamedFunc operator <= (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")<=(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    less_equal<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")<=(" + g.Name() + ")", f, g,
+                 less_equal<ScalarType>(), nullptr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a<=b;});
 }
 
 /*!\brief Gets NamedFunc which tests if results of both f and g are true
@@ -776,13 +1051,9 @@ NamedFunc operator <= (NamedFunc f, NamedFunc g){
   \return NamedFunc returning whether the results of both f and g are true
 */
 NamedFunc operator && (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")&&(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    logical_and<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")&&(" + g.Name() + ")", f, g,
+                 logical_and<ScalarType>(), FoldAnd,
+                 [](const NamedFunc &a, const NamedFunc &b){return a&&b;});
 }
 
 /*!\brief Gets NamedFunc which tests if result of f or g is true
@@ -794,13 +1065,9 @@ NamedFunc operator && (NamedFunc f, NamedFunc g){
   \return NamedFunc returning whether the results of f or g is true
 */
 NamedFunc operator || (NamedFunc f, NamedFunc g){
-  f.Name("(" + f.Name() + ")||(" + g.Name() + ")");
-  auto fp = ApplyOp(f.ScalarFunction(), f.VectorFunction(),
-                    g.ScalarFunction(), g.VectorFunction(),
-                    logical_or<ScalarType>());
-  f.Function(fp.first);
-  f.Function(fp.second);
-  return f;
+  return Combine("(" + f.Name() + ")||(" + g.Name() + ")", f, g,
+                 logical_or<ScalarType>(), FoldOr,
+                 [](const NamedFunc &a, const NamedFunc &b){return a||b;});
 }
 
 /*!\brief Gets NamedFunct returning logical inverse of result of f
@@ -810,10 +1077,8 @@ NamedFunc operator || (NamedFunc f, NamedFunc g){
   \return NamedFunc returning logical inverse of result of f
 */
 NamedFunc operator ! (NamedFunc f){
-  f.Name("!(" + f.Name() + ")");
-  f.Function(ApplyOp(f.ScalarFunction(), logical_not<ScalarType>()));
-  f.Function(ApplyOp(f.VectorFunction(), logical_not<ScalarType>()));
-  return f;
+  return Transform("!(" + f.Name() + ")", f, logical_not<ScalarType>(),
+                   [](const NamedFunc &g){return !g;});
 }
 
 /*!\brief Print NamedFunc to output stream
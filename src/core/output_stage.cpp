@@ -0,0 +1,480 @@
+/*! \class OutputStage
+
+  \brief Collects the tables and plots produced by figures and renders them in
+  a batch
+
+  Figures that support batching hand their outputs to the stage instead of
+  writing them immediately. Tables are written right away, but only if their
+  content changed, so their modification time is kept otherwise. Plots are
+  queued as render tasks along with a string describing every input that
+  determines them, and OutputStage::Run() renders the queued plots in a pool
+  of forked worker processes, since ROOT graphics cannot be drawn from several
+  threads at once. A child forked from a multithreaded process can deadlock on
+  locks held by threads that do not exist in the child, so the plots are
+  rendered one by one in this process instead if any other thread is still
+  running. If requested with OutputStage::Compile(), the tables are also
+  compiled concurrently with pdflatex.
+
+  The hash of the inputs of every output is kept in a manifest file in the
+  directory of the output. A render or compilation is skipped if all its
+  outputs exist and the hash matches the one recorded when they were last
+  produced. The manifest is reread and merged when written, so several stages
+  writing to the same directory, e.g. the makers of a PlotSession, keep each
+  other's entries.
+*/
+
+/*! \struct OutputStage::Task
+
+  \brief A render or compilation producing one or more files
+*/
+#include "core/output_stage.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <future>
+#include <thread>
+#include <set>
+#include <utility>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+#include "core/thread_pool.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  //Splits a path into its directory, empty if there is none, and file name
+  pair<string, string> SplitPath(const string &path){
+    auto slash = path.rfind('/');
+    if(slash == string::npos) return make_pair(string(), path);
+    return make_pair(path.substr(0, slash), path.substr(slash+1));
+  }
+
+  //Number of threads of this process, or 0 if it cannot be determined
+  size_t NumProcessThreads(){
+    DIR *dir = opendir("/proc/self/task");
+    if(dir == nullptr) return 0;
+    size_t num_threads = 0;
+    while(dirent *entry = readdir(dir)){
+      if(entry->d_name[0] != '.') ++num_threads;
+    }
+    closedir(dir);
+    return num_threads;
+  }
+}
+
+/*!\brief Standard constructor
+
+  \param[in] manifest Name of the file recording the input hash of each
+  output, kept in the directory of the outputs
+*/
+OutputStage::OutputStage(const string &manifest):
+  manifest_name_(manifest),
+  manifest_(),
+  renders_(),
+  compiles_(),
+  tables_(),
+  compile_(false),
+  num_workers_(max(1u, thread::hardware_concurrency())){
+}
+
+/*!\brief Writes a LaTeX table if its content changed and queues its
+  compilation
+
+  \param[in] tex_path Path of .tex file
+
+  \param[in] content Full content of .tex file
+*/
+void OutputStage::AddTable(const string &tex_path, const string &content){
+  ifstream old_file(tex_path);
+  ostringstream old_content;
+  old_content << old_file.rdbuf();
+  if(!old_file || old_content.str() != content){
+    ofstream file(tex_path);
+    file << content << flush;
+    if(!file) ERROR("Could not write "+tex_path);
+  }
+  tables_.push_back(tex_path);
+
+  string dir = ".", name = tex_path;
+  auto slash = tex_path.rfind('/');
+  if(slash != string::npos){
+    dir = tex_path.substr(0, slash);
+    name = tex_path.substr(slash+1);
+  }
+  string pdf_path = ChangeExtension(tex_path, ".pdf");
+  Task task;
+  task.outputs_ = {pdf_path};
+  task.hash_ = Hash(content);
+  task.run_ = [dir, name, pdf_path](){
+    remove(pdf_path.c_str());
+    execute("cd "+dir+" && pdflatex -interaction=nonstopmode "+name+" > /dev/null 2>&1");
+  };
+  compiles_.push_back(task);
+}
+
+/*!\brief Queues a plot to be rendered by Run()
+
+  \param[in] outputs Files written by render
+
+  \param[in] inputs Description of everything that determines the outputs,
+  used to skip renders whose outputs are up to date
+
+  \param[in] render Function producing the outputs. Runs in a separate process.
+*/
+void OutputStage::AddRender(const vector<string> &outputs,
+                            const string &inputs,
+                            const function<void()> &render){
+  Task task;
+  task.outputs_ = outputs;
+  task.hash_ = Hash(inputs);
+  task.run_ = render;
+  renders_.push_back(task);
+}
+
+/*!\brief Renders all queued plots, compiles tables if requested, and updates
+  the manifest
+*/
+void OutputStage::Run(){
+  set<string> directories;
+  for(const auto &task: renders_){
+    for(const auto &output: task.outputs_) directories.insert(SplitPath(output).first);
+  }
+  if(compile_){
+    for(const auto &task: compiles_){
+      for(const auto &output: task.outputs_) directories.insert(SplitPath(output).first);
+    }
+  }
+  ReadManifest(directories);
+
+  vector<const Task*> todo;
+  size_t num_skipped = 0;
+  for(const auto &task: renders_){
+    if(UpToDate(task)) ++num_skipped;
+    else todo.push_back(&task);
+  }
+  size_t num_workers = min(num_workers_, todo.size());
+  if(num_workers > 1 && NumProcessThreads() != 1){
+    DBG("Other threads are running, so plots are rendered in this process instead of forked workers.");
+    num_workers = 1;
+  }
+  vector<bool> success = RunRenders(todo, num_workers);
+  for(size_t i = 0; i < todo.size(); ++i){
+    for(const auto &output: todo.at(i)->outputs_){
+      if(success.at(i)){
+        manifest_[output] = todo.at(i)->hash_;
+        cout << " open " << output << endl;
+      }else{
+        manifest_.erase(output);
+        cout << "Failed to render " << output << endl;
+      }
+    }
+  }
+  if(!renders_.empty()){
+    cout << "Rendered " << todo.size() << " plots with " << num_workers
+         << " workers, " << num_skipped << " unchanged" << endl;
+  }
+
+  if(compile_){
+    todo.clear();
+    num_skipped = 0;
+    for(const auto &task: compiles_){
+      if(UpToDate(task)) ++num_skipped;
+      else todo.push_back(&task);
+    }
+    success = RunCompiles(todo);
+    size_t num_failed = 0;
+    for(size_t i = 0; i < todo.size(); ++i){
+      const string &output = todo.at(i)->outputs_.front();
+      if(success.at(i)){
+        manifest_[output] = todo.at(i)->hash_;
+      }else{
+        manifest_.erase(output);
+        cout << "Failed to compile " << ChangeExtension(output, ".tex") << endl;
+        ++num_failed;
+      }
+    }
+    if(!compiles_.empty()){
+      cout << "Compiled " << (todo.size()-num_failed) << " tables, " << num_skipped << " unchanged";
+      if(num_failed) cout << ", " << num_failed << " failed";
+      cout << endl;
+    }
+  }else{
+    for(const auto &table: tables_){
+      cout << "pdflatex " << table << " &> /dev/null; #./python/texify.py tables" << endl;
+    }
+  }
+
+  WriteManifest(directories);
+  renders_.clear();
+  compiles_.clear();
+  tables_.clear();
+}
+
+/*!\brief Check whether tables are compiled by Run()
+
+  \return True if tables are compiled
+*/
+bool OutputStage::Compile() const{
+  return compile_;
+}
+
+/*!\brief Set whether tables are compiled by Run()
+
+  \param[in] compile If true, compile tables with pdflatex
+
+  \return Reference to *this
+*/
+OutputStage & OutputStage::Compile(bool compile){
+  compile_ = compile;
+  return *this;
+}
+
+/*!\brief Get number of concurrent renders or compilations
+
+  \return Number of workers
+*/
+size_t OutputStage::NumWorkers() const{
+  return num_workers_;
+}
+
+/*!\brief Set number of concurrent renders or compilations
+
+  \param[in] num_workers Number of workers. 1 renders in this process.
+
+  \return Reference to *this
+*/
+OutputStage & OutputStage::NumWorkers(size_t num_workers){
+  num_workers_ = max(static_cast<size_t>(1), num_workers);
+  return *this;
+}
+
+/*!\brief 64-bit FNV-1a hash
+
+  \param[in] data Bytes to hash
+
+  \return Hash of data
+*/
+uint64_t OutputStage::Hash(const string &data){
+  uint64_t hash = 14695981039346656037ULL;
+  for(const auto &c: data){
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool OutputStage::UpToDate(const Task &task) const{
+  for(const auto &output: task.outputs_){
+    auto entry = manifest_.find(output);
+    if(entry == manifest_.cend() || entry->second != task.hash_ || !FileExists(output)) return false;
+  }
+  return true;
+}
+
+/*!\brief Runs render tasks in forked worker processes
+
+  Worker i runs tasks i, i+N, i+2N, ... for N workers, so each worker starts
+  from the same state of ROOT left by the event loop. Each worker reports
+  every task it completed through a pipe.
+
+  \param[in] tasks Tasks to run
+
+  \param[in,out] num_workers Number of worker processes. Only forked if more
+  than 1, which the caller must only request if this process has no other
+  threads. Set to 1 if the workers cannot be set up.
+
+  \return Whether each task finished successfully
+*/
+vector<bool> OutputStage::RunRenders(const vector<const Task*> &tasks,
+                                     size_t &num_workers) const{
+  int status_pipe[2] = {-1, -1};
+  if(num_workers > 1 && pipe(status_pipe) != 0){
+    DBG("Could not create pipe for render workers, so plots are rendered in this process.");
+    num_workers = 1;
+  }
+  if(num_workers <= 1){
+    vector<bool> success(tasks.size(), true);
+    for(size_t i = 0; i < tasks.size(); ++i){
+      try{
+        tasks.at(i)->run_();
+      }catch(const exception &e){
+        DBG(e.what());
+        success.at(i) = false;
+      }
+    }
+    return success;
+  }
+
+  cout << flush;
+  cerr << flush;
+  vector<pid_t> pids(num_workers, -1);
+  for(size_t worker = 0; worker < num_workers; ++worker){
+    pid_t pid = fork();
+    if(pid == 0){
+      close(status_pipe[0]);
+      int status = 0;
+      for(size_t i = worker; i < tasks.size(); i += num_workers){
+        try{
+          tasks.at(i)->run_();
+        }catch(const exception &e){
+          DBG(e.what());
+          status = 1;
+          continue;
+        }
+        cout << flush;
+        cerr << flush;
+        uint64_t done = i;
+        if(write(status_pipe[1], &done, sizeof(done)) != sizeof(done)) status = 1;
+      }
+      close(status_pipe[1]);
+      _exit(status);
+    }
+    pids.at(worker) = pid;
+    if(pid < 0) DBG("Could not fork render worker "+to_string(worker));
+  }
+  close(status_pipe[1]);
+
+  vector<bool> success(tasks.size(), false);
+  uint64_t done = 0;
+  while(true){
+    ssize_t num_read = read(status_pipe[0], &done, sizeof(done));
+    if(num_read < 0 && errno == EINTR) continue;
+    if(num_read != sizeof(done)) break;
+    if(done < success.size()) success.at(done) = true;
+  }
+  close(status_pipe[0]);
+
+  for(size_t worker = 0; worker < num_workers; ++worker){
+    if(pids.at(worker) < 0) continue;
+    int status = 0;
+    while(waitpid(pids.at(worker), &status, 0) < 0 && errno == EINTR){
+    }
+  }
+  return success;
+}
+
+/*!\brief Runs LaTeX compilations concurrently
+
+  \param[in] tasks Tasks to run
+
+  \return Whether each task produced all its outputs
+*/
+vector<bool> OutputStage::RunCompiles(const vector<const Task*> &tasks) const{
+  vector<future<bool> > results;
+  {
+    ThreadPool tp(min(num_workers_, max(static_cast<size_t>(1), tasks.size())));
+    for(const auto &task: tasks){
+      results.push_back(tp.Push([task](){
+            task->run_();
+            for(const auto &output: task->outputs_){
+              if(!FileExists(output)) return false;
+            }
+            return true;
+          }));
+    }
+  }
+  vector<bool> success;
+  for(auto &result: results){
+    success.push_back(result.get());
+  }
+  return success;
+}
+
+/*!\brief Get path of the manifest of a directory
+
+  \param[in] directory Directory of the outputs. Empty for the current
+  directory.
+
+  \return Path of manifest file
+*/
+string OutputStage::ManifestPath(const string &directory) const{
+  return directory == "" ? manifest_name_ : directory+'/'+manifest_name_;
+}
+
+/*!\brief Reads the hashes recorded in the manifest of a directory
+
+  \param[in] directory Directory of the outputs
+
+  \return Input hash by file name
+*/
+map<string, uint64_t> OutputStage::ReadManifest(const string &directory) const{
+  map<string, uint64_t> hashes;
+  ifstream file(ManifestPath(directory));
+  string line;
+  while(getline(file, line)){
+    istringstream iss(line);
+    uint64_t hash;
+    string name;
+    if(!(iss >> hex >> hash)) continue;
+    getline(iss >> ws, name);
+    if(name != "") hashes[name] = hash;
+  }
+  return hashes;
+}
+
+/*!\brief Loads the manifests of the directories of the queued outputs
+
+  \param[in] directories Directories of the queued outputs
+*/
+void OutputStage::ReadManifest(const set<string> &directories){
+  manifest_.clear();
+  for(const auto &directory: directories){
+    for(const auto &entry: ReadManifest(directory)){
+      manifest_[directory == "" ? entry.first : directory+'/'+entry.first] = entry.second;
+    }
+  }
+}
+
+/*!\brief Records the hashes of the outputs of this stage in the manifests of
+  their directories
+
+  The manifest is reread first, so entries written by other stages since it
+  was loaded are kept. The file is replaced through a temporary file unique
+  to this process.
+
+  \param[in] directories Directories of the queued outputs
+*/
+void OutputStage::WriteManifest(const set<string> &directories) const{
+  vector<string> outputs;
+  for(const auto &task: renders_){
+    outputs.insert(outputs.end(), task.outputs_.cbegin(), task.outputs_.cend());
+  }
+  if(compile_){
+    for(const auto &task: compiles_){
+      outputs.insert(outputs.end(), task.outputs_.cbegin(), task.outputs_.cend());
+    }
+  }
+
+  for(const auto &directory: directories){
+    map<string, uint64_t> hashes = ReadManifest(directory);
+    for(const auto &output: outputs){
+      auto split = SplitPath(output);
+      if(split.first != directory) continue;
+      auto entry = manifest_.find(output);
+      if(entry == manifest_.cend()) hashes.erase(split.second);
+      else hashes[split.second] = entry->second;
+    }
+
+    string manifest_path = ManifestPath(directory);
+    string tmp_path = manifest_path+".tmp."+to_string(getpid());
+    ofstream file(tmp_path);
+    for(const auto &entry: hashes){
+      file << hex << setw(16) << setfill('0') << entry.second << ' ' << entry.first << '\n';
+    }
+    file.close();
+    if(!file || rename(tmp_path.c_str(), manifest_path.c_str()) != 0){
+      remove(tmp_path.c_str());
+      DBG("Could not write "+manifest_path);
+    }
+  }
+}
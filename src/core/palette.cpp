@@ -10,15 +10,60 @@
 */
 #include "core/palette.hpp"
 
-#include <fstream>
 #include <sstream>
+#include <map>
+#include <vector>
 
 #include "TColor.h"
 
 #include "core/utilities.hpp"
+#include "core/config_registry.hpp"
 
 using namespace std;
 
+namespace{
+  using ColorTable = map<string, map<string, vector<Int_t> > >;
+
+  /*!\brief Reads the RGB values of all colors in all palettes of a file
+
+    \param[in,out] file Stream with the contents of the color file
+
+    \return RGB values by palette and color name. The first definition of a
+    color in a palette is kept.
+  */
+  ColorTable ParseColors(istream &file){
+    ColorTable colors;
+    string line;
+    string current_palette = "";
+    int line_num = 0;
+    while(getline(file, line)){
+      ++line_num;
+      ReplaceAll(line, "=", " ");
+      ReplaceAll(line, "\t", " ");
+      auto start  = line.find('[');
+      auto end = line.find(']');
+      if(start==string::npos && end!=string::npos){
+        ERROR("Could not find opening brace in line "+to_string(line_num));
+      }
+      if(start!=string::npos && end==string::npos){
+        ERROR("Could not find closing brace in line "+to_string(line_num));
+      }
+      if(start<end && start != string::npos && end != string::npos){
+        current_palette = line.substr(start+1, end-start-1);
+      }else if(line.size()
+               && line.at(0)!='#'){
+        istringstream iss(line);
+        string color;
+        iss >> color;
+        Int_t r = 0, g = 0, b = 0;
+        iss >> r >> g >> b;
+        colors[current_palette].emplace(color, vector<Int_t>{r, g, b});
+      }
+    }
+    return colors;
+  }
+}
+
 /*!\brief Construct from file and palette names
 
   \param[in] file File from which to read colors
@@ -102,34 +147,12 @@ Palette & Palette::PaletteName(const string &file,
   \return Number of color as used by ROOT's TColor system
 */
 Int_t Palette::operator()(const string &color_name) const{
-  ifstream file(file_);
-  string line;
-  string current_palette_ = "";
-  int line_num = 0;
-  while(getline(file, line)){
-    ++line_num;
-    ReplaceAll(line, "=", " ");
-    ReplaceAll(line, "\t", " ");
-    auto start  = line.find('[');
-    auto end = line.find(']');
-    if(start==string::npos && end!=string::npos){
-      ERROR("Could not find opening brace in line "+to_string(line_num));
-    }
-    if(start!=string::npos && end==string::npos){
-      ERROR("Could not find closing brace in line "+to_string(line_num));
-    }
-    if(start<end && start != string::npos && end != string::npos){
-      current_palette_ = line.substr(start+1, end-start-1);
-    }else if(current_palette_ == palette_
-             && line.size()
-             && line.at(0)!='#'){
-      istringstream iss(line);
-      string color;
-      iss >> color;
-      if(color != color_name) continue;
-      Int_t r, g, b;
-      iss >> r >> g >> b;
-      return RGB(r, g, b);
+  auto colors = ConfigRegistry::Get<ColorTable>(file_, "palette", ParseColors);
+  auto palette = colors->find(palette_);
+  if(palette != colors->cend()){
+    auto color = palette->second.find(color_name);
+    if(color != palette->second.cend()){
+      return RGB(color->second.at(0), color->second.at(1), color->second.at(2));
     }
   }
   DBG("No color " << color_name << " in palette " << palette_ << " in file " << file_);
@@ -0,0 +1,144 @@
+/*! \class ParamWeight
+
+  \brief Event weight depending on a few parameters through a sum of
+  separable terms
+
+  The weight is \f$w(\vec{p}) = \sum_k b_k(\textrm{event})\,c_k(\vec{p})\f$,
+  where the basis terms \f$b_k\f$ are scalar NamedFuncs evaluated once per
+  event and the coefficients \f$c_k\f$ only depend on the parameters. Any
+  weight polynomial in the parameters can be written this way, with one term
+  per monomial. Figures accepting a ParamWeight accumulate the sums of
+  \f$b_k\f$ and \f$b_kb_l\f$ in each bin during the event loop, so yields and
+  uncertainties for any parameter values are obtained afterwards without
+  rerunning, e.g. to scan a branching fraction in a single pass.
+*/
+#include "core/param_weight.hpp"
+
+#include <cmath>
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Constructs a weight with no terms
+
+  \param[in] parameters Names of the parameters
+*/
+ParamWeight::ParamWeight(const vector<string> &parameters):
+  parameters_(parameters),
+  basis_(),
+  coefficients_(){
+}
+
+/*!\brief Adds a term
+
+  \param[in] basis Scalar per-event factor
+
+  \param[in] coefficient Factor depending on the parameter values, given in
+  the order of ParamWeight::Parameters()
+
+  \return Reference to *this
+*/
+ParamWeight & ParamWeight::Add(const NamedFunc &basis,
+                               const function<ParamFunc> &coefficient){
+  if(basis.IsVector()) ERROR("ParamWeight basis terms must be scalar, but "+basis.Name()+" is a vector.");
+  basis_.push_back(basis);
+  coefficients_.push_back(coefficient);
+  return *this;
+}
+
+/*!\brief Adds a monomial term
+
+  \param[in] basis Scalar per-event factor
+
+  \param[in] powers Power of each parameter in the monomial
+
+  \param[in] factor Constant multiplying the monomial
+
+  \return Reference to *this
+*/
+ParamWeight & ParamWeight::Add(const NamedFunc &basis,
+                               const vector<unsigned> &powers,
+                               double factor){
+  if(powers.size() != parameters_.size()){
+    ERROR("Monomial has "+to_string(powers.size())+" powers for "
+          +to_string(parameters_.size())+" parameters.");
+  }
+  return Add(basis, [powers, factor](const vector<double> &values){
+      double coefficient = factor;
+      for(size_t i = 0; i < powers.size(); ++i){
+        coefficient *= pow(values.at(i), powers.at(i));
+      }
+      return coefficient;
+    });
+}
+
+/*!\brief Get parameter names
+
+  \return Names of the parameters, in the order values are given
+*/
+const vector<string> & ParamWeight::Parameters() const{
+  return parameters_;
+}
+
+/*!\brief Get number of terms
+
+  \return Number of basis terms
+*/
+size_t ParamWeight::NumTerms() const{
+  return basis_.size();
+}
+
+/*!\brief Get per-event factor of a term
+
+  \param[in] iterm Index of term
+
+  \return Basis NamedFunc of the term
+*/
+const NamedFunc & ParamWeight::Basis(size_t iterm) const{
+  return basis_.at(iterm);
+}
+
+/*!\brief Evaluates the parameter-dependent factor of every term
+
+  \param[in] values Parameter values
+
+  \return Coefficient of each term
+*/
+vector<double> ParamWeight::Coefficients(const vector<double> &values) const{
+  CheckValues(values);
+  vector<double> coefficients(coefficients_.size());
+  for(size_t iterm = 0; iterm < coefficients_.size(); ++iterm){
+    coefficients.at(iterm) = coefficients_.at(iterm)(values);
+  }
+  return coefficients;
+}
+
+/*!\brief Get the weight at fixed parameter values as an ordinary NamedFunc
+
+  \param[in] values Parameter values
+
+  \return NamedFunc returning the weight of each event
+*/
+NamedFunc ParamWeight::Evaluated(const vector<double> &values) const{
+  vector<double> coefficients = Coefficients(values);
+  vector<NamedFunc> basis = basis_;
+  string name = "param_weight";
+  for(size_t i = 0; i < values.size(); ++i){
+    name += "_"+parameters_.at(i)+"_"+ToString(values.at(i));
+  }
+  return NamedFunc(name, [basis, coefficients](const Baby &b){
+      NamedFunc::ScalarType weight = 0.;
+      for(size_t iterm = 0; iterm < basis.size(); ++iterm){
+        weight += coefficients.at(iterm)*basis.at(iterm).GetScalar(b);
+      }
+      return weight;
+    });
+}
+
+void ParamWeight::CheckValues(const vector<double> &values) const{
+  if(values.size() != parameters_.size()){
+    ERROR("Got "+to_string(values.size())+" values for "
+          +to_string(parameters_.size())+" parameters.");
+  }
+}
@@ -8,6 +8,11 @@
   PlotMaker::MakePlots() determines the full set of \link Process
   Processes\endlink used by all plots, loops once over each Process to fill all
   histograms using that Process, and then prints the plots.
+
+  Workflows needing several passes run one PlotMaker per stage. An EventCache
+  filled by an earlier stage provides processes, via EventCache::Replayed(),
+  whose events are the cached rows. Figures of a later stage using those
+  processes are filled by replaying the rows instead of reading babies.
 */
 #include "core/plot_maker.hpp"
 
@@ -15,15 +20,27 @@
 #include <mutex>
 #include <chrono>
 #include <map>
+#include <deque>
+#include <algorithm>
 #include <iomanip>  // setw
 
 #include "TLegend.h"
+#include "TROOT.h"
+#include "TChain.h"
+#include "RConfigure.h"
 
 #include "core/utilities.hpp"
-#include "core/timer.hpp"
+#include "core/progress_tracker.hpp"
+#include "core/memory_monitor.hpp"
+#include "core/setup_profiler.hpp"
+#include "core/output_stage.hpp"
+#include "core/event_cache.hpp"
+#include "core/hist1d.hpp"
 #include "core/thread_pool.hpp"
+#include "core/checkpoint.hpp"
 #include "core/named_func.hpp"
 #include "core/process.hpp"
+#include "core/work_planner.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
@@ -37,6 +54,15 @@ using Clock = chrono::steady_clock;
 
 namespace{
   mutex print_mutex;
+
+  bool AllDone(const vector<pair<const Process*, set<Figure::FigureComponent*> > > &proc_figs){
+    for(const auto &proc_fig: proc_figs){
+      for(const auto &component: proc_fig.second){
+        if(!component->Done()) return false;
+      }
+    }
+    return true;
+  }
 }
 
 /*!\brief Standard constructor
@@ -44,20 +70,51 @@ namespace{
 PlotMaker::PlotMaker():
   multithreaded_(true),
   min_print_(false),
+  status_file_(),
+  memory_budget_(0),
+  baby_memory_(256*1024*1024),
+  pipeline_readers_(0),
+  pipeline_cache_(64*1024*1024),
+  batch_output_(false),
+  compile_tables_(false),
+  reproducible_(false),
+  checkpoint_file_(),
+  checkpoint_interval_(600.),
   figures_(){
 }
 
 /*!\brief Prints all added plots with given luminosity
 
+  The time spent before this call is broken down by SetupProfiler. The peak
+  resident memory is reported separately for the setup before this call, the
+  event loop, and the printing of the figures.
+
+  If reproducible_ is set, tables and histograms accumulate their sums
+  exactly, so the results are bitwise identical regardless of the number of
+  threads or the order in which babies are processed.
+
+  If checkpoint_file_ is set, the accumulated results and the list of
+  completed babies are saved there at least checkpoint_interval_ seconds
+  apart. A rerun with the same figures restores them and only reads the
+  remaining babies. The file is deleted once the event loop completes.
+
   \param[in] luminosity Integrated luminosity with which to draw plots
 */
 void PlotMaker::MakePlots(double luminosity,
                           const string &subdir){
+  if(!min_print_) cout << SetupProfiler::Summary() << endl;
+  MemoryMonitor memory;
+  memory.RecordPeak("setup");
+  memory.StartPhase("loop");
   GetYields();
+  if(!min_print_) PrintComponentMemory();
 
-  for(auto &figure: figures_){
-    figure->Print(luminosity, subdir);
-  }
+  memory.StartPhase("print");
+  OutputStage output;
+  PrintFigures(luminosity, subdir, output);
+  if(batch_output_) output.Run();
+  memory.EndPhase();
+  if(!min_print_) cout << memory.Summary() << endl;
 }
 
 const vector<unique_ptr<Figure> > & PlotMaker::Figures() const{
@@ -70,46 +127,161 @@ void PlotMaker::Clear(){
   figures_.clear();
 }
 
+/*!\brief Prints all figures, handing batched outputs to a stage
+
+  \param[in] luminosity Integrated luminosity with which to draw plots
+
+  \param[in] subdir Subdirectory in which to save plots
+
+  \param[in,out] output Stage collecting the outputs if batch_output_ is set.
+  Rendered by the caller with OutputStage::Run().
+
+  Each figure holds Multithreading::root_mutex only while it is drawn, so
+  babies read by other threads, e.g. for other makers of a PlotSession, can
+  load entries between figures.
+*/
+void PlotMaker::PrintFigures(double luminosity, const string &subdir,
+                             OutputStage &output){
+  output.Compile(compile_tables_);
+  if(!multithreaded_) output.NumWorkers(1);
+  for(auto &figure: figures_){
+    lock_guard<mutex> lock(Multithreading::root_mutex);
+    if(batch_output_) figure->UseOutputStage(&output);
+    figure->Print(luminosity, subdir);
+    figure->UseOutputStage(nullptr);
+  }
+}
+
+/*!\brief Prepares all figure components for the event loop
+ */
+void PlotMaker::StartYields(){
+  for(auto &component: GetComponents()){
+    component->Reproducible(reproducible_);
+  }
+}
+
+/*!\brief Completes all figure components after the event loop
+
+  Each component holds Multithreading::root_mutex while it merges its
+  per-thread results, since they may be ROOT histograms.
+*/
+void PlotMaker::FinishYields(){
+  for(auto &component: GetComponents()){
+    lock_guard<mutex> lock(Multithreading::root_mutex);
+    component->Finalize();
+  }
+}
+
 void PlotMaker::GetYields(){
   auto start_time = Clock::now();
 
   auto babies = GetBabies();
-  size_t num_threads = multithreaded_ ? min(babies.size(), static_cast<size_t>(thread::hardware_concurrency())) : 1;
-  cout << "Processing " << babies.size() << " babies with " << num_threads << " threads." << endl;
+  auto replays = GetReplays();
+  StartYields();
+
+  unique_ptr<Checkpoint> checkpoint;
+  if(checkpoint_file_ != ""){
+    //Which files share a Baby depends on WorkPlanner::TargetBytes() and the
+    //number of cores, so the units are part of the key: a checkpoint of
+    //differently packed units cannot tell which files were read
+    vector<string> all_units;
+    for(const auto &baby: babies) all_units.push_back(Checkpoint::UnitName(*baby));
+    for(const auto &replay: replays) all_units.push_back(Checkpoint::UnitName(*replay));
+    sort(all_units.begin(), all_units.end());
+    string configuration = reproducible_ ? "reproducible" : "";
+    configuration += ";target_bytes="+to_string(WorkPlanner::TargetBytes());
+    for(const auto &unit: all_units) configuration += ';'+unit;
+    checkpoint.reset(new Checkpoint(checkpoint_file_, checkpoint_interval_, GetOrderedComponents(),
+                                    configuration));
+    checkpoint->Restore();
+  }
+
+  vector<Baby*> todo_babies;
+  vector<const Process*> todo_replays;
+  vector<string> unit_names;
+  for(const auto &baby: babies){
+    string name = checkpoint ? Checkpoint::UnitName(*baby) : "";
+    if(checkpoint && checkpoint->Done(name)) continue;
+    todo_babies.push_back(baby);
+    unit_names.push_back(name);
+  }
+  for(const auto &replay: replays){
+    string name = checkpoint ? Checkpoint::UnitName(*replay) : "";
+    if(checkpoint && checkpoint->Done(name)) continue;
+    todo_replays.push_back(replay);
+    unit_names.push_back(name);
+  }
+  size_t num_skipped = babies.size()+replays.size()-unit_names.size();
+
+  ProgressTracker progress(unit_names.size(), !min_print_, status_file_);
+  vector<function<long()> > units;
+  for(const auto &baby: todo_babies){
+    units.push_back(bind(&PlotMaker::GetYield, this, baby, ref(progress)));
+  }
+  for(const auto &replay: todo_replays){
+    units.push_back(bind(&PlotMaker::ReplayYield, this, replay, ref(progress)));
+  }
+
+  size_t num_threads = multithreaded_ ? min(units.size(), static_cast<size_t>(thread::hardware_concurrency())) : 1;
+  num_threads = max(num_threads, static_cast<size_t>(1));
+  ImplicitMTScope implicit_mt(pipeline_readers_);
+  num_threads = SetupPipeline(num_threads);
+  num_threads = ApplyMemoryBudget(num_threads);
+  cout << "Processing " << babies.size() << " babies";
+  if(!replays.empty()) cout << " and " << replays.size() << " cached processes";
+  if(num_skipped > 0) cout << " (" << num_skipped << " restored from checkpoint)";
+  cout << " with " << num_threads << " threads." << endl;
 
   long num_entries = 0;
 
+  progress.Start();
+  size_t Nbabies = units.size();
+  size_t Nfiles = 0;
+  long printStep = Nbabies/20+1; // Print up to 20 lines of info
+  auto start_entries_time = Clock::now();
+  auto unit_done = [&](size_t iunit, long unit_entries){
+    num_entries += unit_entries;
+    if(checkpoint) checkpoint->Complete(unit_names.at(iunit));
+    Nfiles++;
+    if(min_print_ && ((Nfiles-1)%printStep==0 || Nfiles==Nbabies)){
+      double seconds = chrono::duration<double>(Clock::now()-start_entries_time).count();
+      cout<<"Done "<<setw(log10(Nbabies)+1)<<Nfiles<<"/"<<Nbabies<<" files: "<<setw(10)<<AddCommas(num_entries)
+	  <<" entries in "<<HoursMinSec(seconds)<<"  ->  "<<setw(5)<<RoundNumber(num_entries/1000.,1,seconds)
+	  <<" kHz "<<endl;
+    }
+  };
   if(multithreaded_ && num_threads>1){
-    vector<future<long> > num_entries_future(babies.size());
-
+    // Keep up to two units per thread queued. While a checkpoint is due, stop
+    // queueing so that it is saved once no unit is being processed.
     ThreadPool tp(num_threads);
-    size_t Nbabies = 0;
-    for(const auto &baby: babies){
-      num_entries_future.at(Nbabies) = tp.Push(bind(&PlotMaker::GetYield, this, ref(baby)));
-      ++Nbabies;
-    }
-    size_t Nfiles=0;
-    long printStep=Nbabies/20+1; // Print up to 20 lines of info
-    auto start_entries_time = Clock::now();
-    for(auto& entries: num_entries_future){
-      num_entries += entries.get();
-      Nfiles++;
-      if(min_print_ && ((Nfiles-1)%printStep==0 || Nfiles==Nbabies)){
-	double seconds = chrono::duration<double>(Clock::now()-start_entries_time).count();
-	cout<<"Done "<<setw(log10(Nbabies)+1)<<Nfiles<<"/"<<Nbabies<<" files: "<<setw(10)<<AddCommas(num_entries)
-	    <<" entries in "<<HoursMinSec(seconds)<<"  ->  "<<setw(5)<<RoundNumber(num_entries/1000.,1,seconds)
-	    <<" kHz "<<endl;
+    deque<pair<size_t, future<long> > > in_flight;
+    size_t next = 0;
+    while(next < units.size() || !in_flight.empty()){
+      bool hold = checkpoint && checkpoint->Due();
+      if(!hold && next < units.size() && in_flight.size() < 2*num_threads){
+        in_flight.emplace_back(next, tp.Push(units.at(next)));
+        ++next;
+        continue;
+      }
+      if(!in_flight.empty()){
+        unit_done(in_flight.front().first, in_flight.front().second.get());
+        in_flight.pop_front();
       }
+      if(hold && in_flight.empty()) checkpoint->Save();
     }
   }else{
-    for(const auto &baby: babies){
-      num_entries += GetYield(ref(baby));
+    for(size_t iunit = 0; iunit < units.size(); ++iunit){
+      unit_done(iunit, units.at(iunit)());
+      if(checkpoint && checkpoint->Due()) checkpoint->Save();
     }
   }
+  progress.Stop();
+  FinishYields();
+  if(checkpoint) checkpoint->Remove();
   auto end_time = Clock::now();
   double num_seconds = chrono::duration<double>(end_time-start_time).count();
   if(!min_print_) cout << endl << num_threads << " threads processed "
-		       << babies.size() << " babies with "
+		       << todo_babies.size() << " babies with "
 		       << AddCommas(num_entries) << " events in "
 		       << num_seconds << " seconds = "
 		       << 0.001*num_entries/num_seconds << " kHz."
@@ -117,15 +289,204 @@ void PlotMaker::GetYields(){
   cout << endl;
 }
 
-long PlotMaker::GetYield(Baby *baby_ptr){
+/*!\brief Restricts number of open babies and stored Hist2D points to fit
+  within memory_budget_
+
+  \param[in] num_threads Number of threads that would be used without a budget
+
+  \return Number of threads (babies open at once) allowed by the budget
+*/
+size_t PlotMaker::ApplyMemoryBudget(size_t num_threads){
+  return ApplyMemoryBudget(num_threads, memory_budget_, baby_memory_, GetComponents());
+}
+
+/*!\brief Restricts number of open babies and stored Hist2D points of a set of
+  components, possibly from several PlotMakers, to fit within a memory budget
+
+  Half of the budget not already in use is reserved for babies being
+  processed, each assumed to need baby_memory bytes for its chain and read
+  buffers. The other half is split evenly among the components whose
+  MemoryLimited() is true, which limits how many individual points Hist2D
+  keeps before switching to a histogram and how many rows EventCache keeps
+  before spilling to scratch. Components that ignore the limit do not dilute
+  the share of the others.
+
+  \param[in] num_threads Number of threads that would be used without a budget
+
+  \param[in] memory_budget Resident memory allowed for the whole process. 0
+  for no limit.
+
+  \param[in] baby_memory Memory assumed for each baby being processed
+
+  \param[in] components Figure components sharing the budget
+
+  \return Number of threads (babies open at once) allowed by the budget
+*/
+size_t PlotMaker::ApplyMemoryBudget(size_t num_threads,
+                                    size_t memory_budget,
+                                    size_t baby_memory,
+                                    const set<Figure::FigureComponent*> &components){
+  if(memory_budget == 0) return num_threads;
+  size_t used = MemoryMonitor::ResidentBytes();
+  size_t available = memory_budget > used ? memory_budget-used : 0;
+
+  size_t max_babies = max(static_cast<size_t>(1), available/2/max(baby_memory, static_cast<size_t>(1)));
+  if(max_babies < num_threads){
+    cout << "Memory budget of " << MemoryMonitor::FormatBytes(memory_budget)
+         << " (" << MemoryMonitor::FormatBytes(used) << " in use) limits processing to "
+         << max_babies << (max_babies == 1 ? " baby" : " babies") << " at a time." << endl;
+    num_threads = max_babies;
+  }
+
+  size_t num_limited = 0;
+  for(const auto &component: components){
+    if(component->MemoryLimited()) ++num_limited;
+  }
+  for(auto &component: components){
+    if(!component->MemoryLimited()) continue;
+    component->MemoryLimit(available/2/num_limited, num_threads);
+  }
+  return num_threads;
+}
+
+/*!\brief Prints memory used to store results of all figure components
+ */
+void PlotMaker::PrintComponentMemory() const{
+  auto components = GetComponents();
+  size_t total = 0, largest = 0;
+  const Figure::FigureComponent *largest_component = nullptr;
+  for(const auto &component: components){
+    size_t bytes = component->MemoryUsage();
+    total += bytes;
+    if(largest_component == nullptr || bytes > largest){
+      largest = bytes;
+      largest_component = component;
+    }
+  }
+  cout << components.size() << " figure components use " << MemoryMonitor::FormatBytes(total);
+  if(largest_component != nullptr){
+    cout << " (largest: " << MemoryMonitor::FormatBytes(largest)
+         << " for process " << largest_component->process_->name_ << ")";
+  }
+  cout << '.' << endl;
+}
+
+/*!\brief Splits the available cores between I/O and event processing
+
+  With pipeline_readers_ > 0, ROOT's implicit multithreading, enabled by an
+  ImplicitMTScope around the event loop, provides that many threads, which
+  read and decompress baskets ahead of the event loop (see
+  SetupPipeline(Baby&)). The remaining cores process babies.
+
+  \param[in] num_threads Number of threads that would be used without the
+  pipeline
+
+  \return Number of threads processing babies
+*/
+size_t PlotMaker::SetupPipeline(size_t num_threads) const{
+  if(pipeline_readers_ == 0) return num_threads;
+#ifdef R__USE_IMT
+  size_t num_cores = max(1u, thread::hardware_concurrency());
+  size_t num_workers = num_cores > pipeline_readers_ ? num_cores-pipeline_readers_ : 1;
+  if(!min_print_) cout << "Pipelined I/O with " << pipeline_readers_ << " reader threads and "
+                       << min(num_threads, num_workers) << " worker threads." << endl;
+  return min(num_threads, num_workers);
+#else
+  DBG("ROOT was built without implicit multithreading. Pipelined I/O disabled.");
+  return num_threads;
+#endif
+}
+
+/*!\brief Enables ROOT's implicit multithreading for the lifetime of the scope
+
+  Nothing is changed if num_threads is 0 or implicit multithreading is already
+  enabled, so a setting made by the script is left alone.
+
+  \param[in] num_threads Number of threads, e.g. PlotMaker::pipeline_readers_
+*/
+PlotMaker::ImplicitMTScope::ImplicitMTScope(size_t num_threads):
+  enabled_(false){
+  if(num_threads == 0) return;
+#ifdef R__USE_IMT
+  if(!ROOT::IsImplicitMTEnabled()){
+    ROOT::EnableImplicitMT(num_threads);
+    enabled_ = true;
+  }
+#endif
+}
+
+/*!\brief Disables implicit multithreading again if this scope enabled it
+ */
+PlotMaker::ImplicitMTScope::~ImplicitMTScope(){
+#ifdef R__USE_IMT
+  if(enabled_) ROOT::DisableImplicitMT();
+#endif
+}
+
+/*!\brief Configures a baby's chain to prefetch and decompress ahead of the
+  event loop
+
+  Each chain gets a TTreeCache of pipeline_cache_ bytes, which learns the
+  branches used during the first entries. Baskets for upcoming entries are then
+  read in large blocks and decompressed in parallel by the reader threads, so
+  the worker only waits for I/O when it gets ahead of the cache.
+
+  \param[in,out] baby Activated baby whose chain is configured
+*/
+void PlotMaker::SetupPipeline(Baby &baby) const{
+  if(pipeline_readers_ == 0) return;
+  lock_guard<mutex> lock(Multithreading::root_mutex);
+  TChain *chain = baby.GetTree().get();
+  if(chain == nullptr) return;
+  chain->SetCacheSize(pipeline_cache_);
+  chain->SetCacheLearnEntries(100);
+  chain->SetParallelUnzip(true);
+}
+
+long PlotMaker::GetYield(Baby *baby_ptr, ProgressTracker &progress){
+  return GetSharedYield(baby_ptr, progress, {this});
+}
+
+/*!\brief Fills the figure components of several PlotMakers from one Baby
+
+  Used by PlotSession, so that a Baby shared by several makers is read once.
+  Pipeline settings and printout follow *this. The printout splits the time
+  into setup, from activating the Baby to its first entry, and reading. A
+  Baby whose components are all Done() is not activated.
+
+  \param[in] baby_ptr Baby to read
+
+  \param[in,out] progress Tracker to which read entries are reported
+
+  \param[in] makers PlotMakers whose components are filled
+
+  \return Number of entries in the Baby
+*/
+long PlotMaker::GetSharedYield(Baby *baby_ptr, ProgressTracker &progress,
+                               const vector<const PlotMaker*> &makers){
   auto start_time = Clock::now();
   Baby &baby = *baby_ptr;
+  bool all_done = true;
+  for(const auto &proc: baby.processes_){
+    for(const auto &maker: makers){
+      for(const auto &component: maker->GetComponents(proc)){
+        all_done = all_done && component->Done();
+      }
+    }
+  }
+  if(all_done){
+    // E.g. every table row is served by an EventSummary
+    progress.StartTask(0);
+    progress.FinishTask();
+    return 0;
+  }
   auto activator = baby.Activate();
+  SetupPipeline(baby);
   string tag = "";
   if(baby.FileNames().size() == 1){
     tag = Basename(*baby.FileNames().cbegin());
   }else{
-    tag = "Baby for processes";
+    tag = Basename(*baby.FileNames().cbegin())+" and "+to_string(baby.FileNames().size()-1)+" more files";
   }
   ostringstream oss;
   oss << " [";
@@ -139,42 +500,125 @@ long PlotMaker::GetYield(Baby *baby_ptr){
   long num_entries = baby.GetEntries();
 
   vector<pair<const Process*, set<Figure::FigureComponent*> > > proc_figs(baby.processes_.size());
+  vector<NamedFunc> proc_cuts;
+  vector<set<Figure::FigureComponent*> > unbanked(baby.processes_.size());
+  vector<vector<unique_ptr<Hist1D::Bank> > > banks(baby.processes_.size());
   size_t iproc = 0;
   for(const auto &proc: baby.processes_){
     proc_figs.at(iproc).first = proc;
-    proc_figs.at(iproc).second = GetComponents(proc);
+    for(const auto &maker: makers){
+      auto maker_components = maker->GetComponents(proc);
+      proc_figs.at(iproc).second.insert(maker_components.cbegin(), maker_components.cend());
+    }
+    proc_cuts.push_back(proc->cut_.Specialized(baby));
+    for(const auto &component: proc_figs.at(iproc).second){
+      lock_guard<mutex> lock(component->mutex_);
+      component->Specialize(baby);
+    }
+    unbanked.at(iproc) = proc_figs.at(iproc).second;
+    banks.at(iproc) = Hist1D::Bank::Group(unbanked.at(iproc), baby);
     ++iproc;
   }
+  bool none_pass = true;
+  for(const auto &proc_cut: proc_cuts){
+    if(!proc_cut.IsConstant() || proc_cut.ConstantValue()) none_pass = false;
+  }
 
-  Timer timer(tag, num_entries, 10.);
+  auto read_time = Clock::now();
+  progress.StartTask(num_entries);
+  ProgressTracker::Counter counter(progress);
   for(long entry = 0; entry < num_entries; ++entry){
-    if(!min_print_) timer.Iterate();
+    if(!(entry & 0xff) && (none_pass || AllDone(proc_figs))){
+      counter.Skip(num_entries-entry);
+      break;
+    }
+    counter.Iterate();
     baby.GetEntry(entry);
 
-    for(const auto &proc_fig: proc_figs){
-      if(proc_fig.first->cut_.IsScalar()){
-        if(!proc_fig.first->cut_.GetScalar(baby)) continue;
+    for(size_t ifig = 0; ifig < proc_figs.size(); ++ifig){
+      const NamedFunc &proc_cut = proc_cuts.at(ifig);
+      if(proc_cut.IsScalar()){
+        if(!proc_cut.GetScalar(baby)) continue;
       }else{
-        if(!HavePass(proc_fig.first->cut_.GetVector(baby))) continue;
+        if(!HavePass(proc_cut.GetVector(baby))) continue;
       }
-      for(const auto &component: proc_fig.second){
+      for(const auto &bank: banks.at(ifig)){
+        bank->RecordEvent(baby);
+      }
+      for(const auto &component: unbanked.at(ifig)){
+        if(component->Concurrent()){
+          component->RecordEvent(baby);
+          continue;
+        }
 	lock_guard<mutex> lock(component->mutex_);
         component->RecordEvent(baby);
       }
     }
   }
 
+  counter.Flush();
+  progress.FinishTask();
+  for(const auto &proc_fig: proc_figs){
+    for(const auto &component: proc_fig.second){
+      lock_guard<mutex> lock(component->mutex_);
+      component->Unspecialize(baby);
+    }
+  }
+
   auto end_time = Clock::now();
   double num_seconds = chrono::duration<double>(end_time - start_time).count();
+  double setup_seconds = chrono::duration<double>(read_time - start_time).count();
   {
     lock_guard<mutex> lock(print_mutex);
     if(!min_print_) cout << setw(9) << num_entries << " entries/"
                          << setw(10) << num_seconds << " sec.="
-                         << setw(10) << 0.001*num_entries/num_seconds << " kHz for " << tag << endl;
+                         << setw(10) << 0.001*num_entries/num_seconds << " kHz ("
+                         << setw(8) << setup_seconds << " sec. setup, "
+                         << setw(10) << num_seconds-setup_seconds << " sec. read) for " << tag << endl;
   }
   return num_entries;
 }
 
+/*!\brief Fills the figure components of a process replaying an EventCache
+
+  \param[in] process Process obtained from EventCache::Replayed()
+
+  \param[in,out] progress Tracker to which replayed rows are reported
+
+  \return Number of rows replayed
+*/
+long PlotMaker::ReplayYield(const Process *process, ProgressTracker &progress){
+  auto start_time = Clock::now();
+  const EventCache::SingleCache *source = EventCache::Source(process);
+  auto components = GetComponents(process);
+
+  progress.StartTask(source->NumRows());
+  ProgressTracker::Counter counter(progress);
+  long num_rows = source->Replay([&](const Baby &baby){
+      counter.Iterate();
+      for(const auto &component: components){
+        if(component->Concurrent()){
+          component->RecordEvent(baby);
+          continue;
+        }
+        lock_guard<mutex> lock(component->mutex_);
+        component->RecordEvent(baby);
+      }
+    });
+  counter.Flush();
+  progress.FinishTask();
+
+  double num_seconds = chrono::duration<double>(Clock::now() - start_time).count();
+  {
+    lock_guard<mutex> lock(print_mutex);
+    if(!min_print_) cout << setw(9) << num_rows << " entries/"
+                         << setw(10) << num_seconds << " sec.="
+                         << setw(10) << 0.001*num_rows/num_seconds << " kHz for cached "
+                         << process->name_ << endl;
+  }
+  return num_rows;
+}
+
 set<Baby*> PlotMaker::GetBabies() const{
   set<Baby*> babies;
   for(auto &proc: GetProcesses()){
@@ -195,6 +639,14 @@ set<const Process*> PlotMaker::GetProcesses() const{
   return processes;
 }
 
+vector<const Process*> PlotMaker::GetReplays() const{
+  vector<const Process*> replays;
+  for(const auto &process: GetProcesses()){
+    if(EventCache::Source(process) != nullptr) replays.push_back(process);
+  }
+  return replays;
+}
+
 set<Figure::FigureComponent*> PlotMaker::GetComponents(const Process *process) const{
   set<Figure::FigureComponent*> figure_components;
   for(auto &figure: figures_){
@@ -205,3 +657,38 @@ set<Figure::FigureComponent*> PlotMaker::GetComponents(const Process *process) c
   }
   return figure_components;
 }
+
+set<Figure::FigureComponent*> PlotMaker::GetComponents() const{
+  set<Figure::FigureComponent*> figure_components;
+  for(const auto &process: GetProcesses()){
+    auto process_components = GetComponents(process);
+    figure_components.insert(process_components.cbegin(), process_components.cend());
+  }
+  return figure_components;
+}
+
+/*!\brief Get all figure components in an order that only depends on the
+  figures and their definitions
+
+  \return Components of each figure in turn, sorted by
+  FigureComponent::Definition() within a figure
+*/
+vector<Figure::FigureComponent*> PlotMaker::GetOrderedComponents() const{
+  vector<Figure::FigureComponent*> components;
+  for(const auto &figure: figures_){
+    vector<pair<string, Figure::FigureComponent*> > figure_components;
+    for(const auto &process: figure->GetProcesses()){
+      Figure::FigureComponent *component = figure->GetComponent(process);
+      if(component != nullptr) figure_components.emplace_back(component->Definition(), component);
+    }
+    stable_sort(figure_components.begin(), figure_components.end(),
+                [](const pair<string, Figure::FigureComponent*> &a,
+                   const pair<string, Figure::FigureComponent*> &b){
+                  return a.first < b.first;
+                });
+    for(const auto &component: figure_components){
+      components.push_back(component.second);
+    }
+  }
+  return components;
+}
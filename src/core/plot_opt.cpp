@@ -3,13 +3,53 @@
 #include <cmath>
 
 #include <algorithm>
-#include <fstream>
+#include <map>
 
 #include "core/utilities.hpp"
+#include "core/config_registry.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
 
+namespace{
+  using OptionTable = map<string, vector<pair<string, string> > >;
+
+  /*!\brief Reads the properties of all configurations in a style file
+
+    \param[in,out] file Stream with the contents of the style file
+
+    \return Property names and values by configuration, in file order
+  */
+  OptionTable ParseOptions(istream &file){
+    OptionTable configs;
+    string line;
+    string current_config = "";
+    int line_num = 0;
+    while(getline(file, line)){
+      ++line_num;
+      ReplaceAll(line, " ", "");
+      ReplaceAll(line, "\t", "");
+      auto start  = line.find('[');
+      auto end = line.find(']');
+      if(start==string::npos && end!=string::npos){
+        ERROR("Could not find opening brace in line "+to_string(line_num));
+      }
+      if(start!=string::npos && end==string::npos){
+        ERROR("Could not find closing brace in line "+to_string(line_num));
+      }
+      if(start<end && start != string::npos && end != string::npos){
+        current_config = line.substr(start+1, end-start-1);
+      }else if(line.size()
+               && line.at(0)!='#'){
+        auto pos = line.find("=");
+        if(pos == string::npos) continue;
+        configs[current_config].emplace_back(line.substr(0,pos), line.substr(pos+1));
+      }
+    }
+    return configs;
+  }
+}
+
 PlotOpt::PlotOpt():
   bottom_type_(BottomType::off),
   y_axis_type_(YAxisType::linear),
@@ -60,33 +100,11 @@ PlotOpt PlotOpt::operator()() const{
 
 PlotOpt & PlotOpt::LoadOptions(const string &file_name,
                                const string &config_name){
-  ifstream file(file_name);
-  string line;
-  string current_config = "";
-  int line_num = 0;
-  while(getline(file, line)){
-    ++line_num;
-    ReplaceAll(line, " ", "");
-    ReplaceAll(line, "\t", "");
-    auto start  = line.find('[');
-    auto end = line.find(']');
-    if(start==string::npos && end!=string::npos){
-      ERROR("Could not find opening brace in line "+to_string(line_num));
-    }
-    if(start!=string::npos && end==string::npos){
-      ERROR("Could not find closing brace in line "+to_string(line_num));
-    }
-    if(start<end && start != string::npos && end != string::npos){
-      current_config = line.substr(start+1, end-start-1);
-    }else if(current_config == config_name
-             && line.size()
-             && line.at(0)!='#'){
-      auto pos = line.find("=");
-      if(pos == string::npos) continue;
-      string prop_name = line.substr(0,pos);
-      string value = line.substr(pos+1);
-      SetProperty(prop_name, value);
-    }
+  auto configs = ConfigRegistry::Get<OptionTable>(file_name, "plot_opt", ParseOptions);
+  auto config = configs->find(config_name);
+  if(config == configs->cend()) return *this;
+  for(const auto &property: config->second){
+    SetProperty(property.first, property.second);
   }
   return *this;
 }
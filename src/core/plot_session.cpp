@@ -0,0 +1,193 @@
+/*! \class PlotSession
+
+  \brief Runs the event loops of several PlotMakers on one shared set of
+  threads
+
+  Scripts producing the same figures for several years used to call
+  PlotMaker::MakePlots() once per year, so each call waited for its slowest
+  baby before the next one started. A PlotSession takes all the makers, each
+  with its own luminosity, and schedules all of their babies as tasks of a
+  single TaskGraph. A Baby used by several makers, which Process already
+  shares between them when they read the same file, is read once and fills the
+  figures of every maker using it.
+
+  Each maker finalizes and prints its figures as soon as its own babies are
+  done, while the babies of the other makers are still being processed.
+  Printing takes Multithreading::root_mutex once per figure rather than for
+  the whole maker, so those babies keep loading entries in between. Plots
+  batched in an OutputStage
+  are rendered at the end, since the stage forks its workers and the process
+  must not have other threads reading babies when it does.
+
+  Since the components of all makers are filled at once, the memory budget is
+  applied to all of them together, using the smallest nonzero
+  PlotMaker::memory_budget_ and the largest PlotMaker::baby_memory_. A shared
+  Baby is read only once, with one set of options. The makers must therefore
+  agree on PlotMaker::pipeline_readers_ and PlotMaker::pipeline_cache_, and
+  their PlotMaker::multithreaded_ must match multithreaded_.
+
+  Checkpoints are not written in a session, since a shared Baby completes a
+  unit of several makers at once. Makers with PlotMaker::checkpoint_file_ set
+  are rejected rather than silently run without checkpointing.
+*/
+#include "core/plot_session.hpp"
+
+#include <map>
+#include <set>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+#include "core/progress_tracker.hpp"
+#include "core/output_stage.hpp"
+#include "core/setup_profiler.hpp"
+#include "core/task_graph.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Standard constructor
+ */
+PlotSession::PlotSession():
+  multithreaded_(true),
+  min_print_(false),
+  status_file_(),
+  entries_(){
+}
+
+/*!\brief Adds a PlotMaker to the session
+
+  \param[in] plot_maker Maker whose figures are filled and printed by Run().
+  Must outlive the call to Run().
+
+  \param[in] luminosity Integrated luminosity with which to draw its plots
+
+  \param[in] subdir Subdirectory for its plots
+
+  \return Reference to *this
+*/
+PlotSession & PlotSession::Add(PlotMaker &plot_maker,
+                               double luminosity,
+                               const string &subdir){
+  entries_.push_back(Entry{&plot_maker, luminosity, subdir});
+  return *this;
+}
+
+/*!\brief Fills and prints the figures of all added PlotMakers
+ */
+void PlotSession::Run(){
+  if(entries_.empty()) return;
+  const PlotMaker &front = *entries_.front().plot_maker_;
+  for(const auto &entry: entries_){
+    const PlotMaker &maker = *entry.plot_maker_;
+    if(maker.multithreaded_ != multithreaded_){
+      ERROR("PlotMaker::multithreaded_ must match PlotSession::multithreaded_, which sets the threads of all makers.");
+    }
+    if(maker.checkpoint_file_ != ""){
+      ERROR("PlotMaker::checkpoint_file_ is not supported in a PlotSession. Run the maker with MakePlots() to checkpoint it.");
+    }
+    if(maker.pipeline_readers_ != front.pipeline_readers_
+       || maker.pipeline_cache_ != front.pipeline_cache_){
+      ERROR("All plot makers of a session must have the same pipeline_readers_ and pipeline_cache_, since they share babies.");
+    }
+  }
+  if(!min_print_) cout << SetupProfiler::Summary() << endl;
+  auto start_time = chrono::steady_clock::now();
+
+  map<Baby*, vector<size_t> > baby_makers;
+  size_t num_replays = 0;
+  for(size_t imaker = 0; imaker < entries_.size(); ++imaker){
+    PlotMaker &maker = *entries_.at(imaker).plot_maker_;
+    maker.StartYields();
+    for(const auto &baby: maker.GetBabies()){
+      baby_makers[baby].push_back(imaker);
+    }
+    num_replays += maker.GetReplays().size();
+  }
+  size_t num_shared = 0;
+  for(const auto &baby_maker: baby_makers){
+    if(baby_maker.second.size() > 1) ++num_shared;
+  }
+  size_t num_tasks = baby_makers.size()+num_replays;
+
+  size_t num_threads = multithreaded_ ? min(max(num_tasks, static_cast<size_t>(1)),
+                                            static_cast<size_t>(max(1u, thread::hardware_concurrency()))) : 1;
+  size_t memory_budget = 0, baby_memory = 0;
+  set<Figure::FigureComponent*> components;
+  for(const auto &entry: entries_){
+    const PlotMaker &maker = *entry.plot_maker_;
+    if(maker.memory_budget_ != 0 && (memory_budget == 0 || maker.memory_budget_ < memory_budget)){
+      memory_budget = maker.memory_budget_;
+    }
+    baby_memory = max(baby_memory, maker.baby_memory_);
+    auto maker_components = maker.GetComponents();
+    components.insert(maker_components.cbegin(), maker_components.cend());
+  }
+  num_threads = PlotMaker::ApplyMemoryBudget(num_threads, memory_budget, baby_memory, components);
+  unique_ptr<PlotMaker::ImplicitMTScope> implicit_mt(new PlotMaker::ImplicitMTScope(front.pipeline_readers_));
+  num_threads = front.SetupPipeline(num_threads);
+  cout << "Processing " << baby_makers.size() << " babies (" << num_shared
+       << " shared by several makers)";
+  if(num_replays > 0) cout << " and " << num_replays << " cached processes";
+  cout << " for " << entries_.size() << " plot makers with " << num_threads << " threads." << endl;
+
+  ProgressTracker progress(num_tasks, !min_print_, status_file_);
+  vector<long> num_entries(num_tasks, 0);
+  vector<unique_ptr<OutputStage> > outputs(entries_.size());
+  vector<vector<TaskGraph::TaskId> > maker_tasks(entries_.size());
+  TaskGraph graph;
+  size_t itask = 0;
+  for(const auto &baby_maker: baby_makers){
+    Baby *baby = baby_maker.first;
+    vector<const PlotMaker*> makers;
+    for(const auto &imaker: baby_maker.second){
+      makers.push_back(entries_.at(imaker).plot_maker_);
+    }
+    PlotMaker *first = entries_.at(baby_maker.second.front()).plot_maker_;
+    TaskGraph::TaskId id = graph.Add([first, baby, makers, itask, &progress, &num_entries](){
+        num_entries.at(itask) = first->GetSharedYield(baby, progress, makers);
+      });
+    for(const auto &imaker: baby_maker.second){
+      maker_tasks.at(imaker).push_back(id);
+    }
+    ++itask;
+  }
+  for(size_t imaker = 0; imaker < entries_.size(); ++imaker){
+    PlotMaker *maker = entries_.at(imaker).plot_maker_;
+    for(const auto &replay: maker->GetReplays()){
+      maker_tasks.at(imaker).push_back(graph.Add([maker, replay, itask, &progress, &num_entries](){
+            num_entries.at(itask) = maker->ReplayYield(replay, progress);
+          }));
+      ++itask;
+    }
+  }
+  for(size_t imaker = 0; imaker < entries_.size(); ++imaker){
+    outputs.at(imaker).reset(new OutputStage());
+    graph.Add([this, imaker, &outputs](){
+        const Entry &entry = entries_.at(imaker);
+        entry.plot_maker_->FinishYields();
+        if(!min_print_) entry.plot_maker_->PrintComponentMemory();
+        entry.plot_maker_->PrintFigures(entry.luminosity_, entry.subdir_, *outputs.at(imaker));
+      }, maker_tasks.at(imaker));
+  }
+
+  progress.Start();
+  graph.Run(num_threads);
+  progress.Stop();
+  implicit_mt.reset();
+
+  for(size_t imaker = 0; imaker < entries_.size(); ++imaker){
+    if(entries_.at(imaker).plot_maker_->batch_output_) outputs.at(imaker)->Run();
+  }
+
+  long total_entries = 0;
+  for(const auto &entries: num_entries){
+    total_entries += entries;
+  }
+  double num_seconds = chrono::duration<double>(chrono::steady_clock::now()-start_time).count();
+  if(!min_print_) cout << endl << num_threads << " threads processed "
+                       << baby_makers.size() << " babies with "
+                       << AddCommas(total_entries) << " events for " << entries_.size()
+                       << " plot makers in " << num_seconds << " seconds." << endl;
+}
@@ -0,0 +1,265 @@
+/*! \class ProgressTracker
+
+  \brief Aggregates progress of all worker threads in a PlotMaker run
+
+  Workers report processed entries through a ProgressTracker::Counter, which
+  counts locally and only adds to the shared atomic total every few thousand
+  entries, so the event loop takes no locks and rarely touches shared memory.
+  A separate monitor thread wakes up at a fixed interval, prints a single
+  consolidated status line, and optionally writes the same information as JSON
+  to a status file that can be polled by other programs.
+
+  The total number of entries is only known once every task has started and
+  opened its files, so until then the expected total is extrapolated from the
+  tasks started so far. Bytes read are taken from ROOT's global TFile counter.
+*/
+#include "core/progress_tracker.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "TFile.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Constructs a counter reporting to a tracker
+
+  \param[in] tracker Tracker to which processed entries are added
+*/
+ProgressTracker::Counter::Counter(ProgressTracker &tracker):
+  tracker_(tracker),
+  pending_(0){
+}
+
+/*!\brief Reports any remaining entries
+*/
+ProgressTracker::Counter::~Counter(){
+  Flush();
+}
+
+/*!\brief Counts entries that will not be read as processed
+
+  \param[in] entries Number of entries skipped
+*/
+void ProgressTracker::Counter::Skip(long entries){
+  pending_ += entries;
+  Flush();
+}
+
+/*!\brief Adds locally counted entries to the shared total
+*/
+void ProgressTracker::Counter::Flush(){
+  if(pending_ == 0) return;
+  tracker_.entries_done_.fetch_add(pending_, memory_order_relaxed);
+  pending_ = 0;
+}
+
+/*!\brief Standard constructor
+
+  \param[in] num_tasks Number of tasks (babies) that will be processed
+
+  \param[in] print Whether to print a status line at every interval
+
+  \param[in] status_file Path to which JSON status is written at every
+  interval. Empty to disable.
+
+  \param[in] interval Seconds between status updates
+*/
+ProgressTracker::ProgressTracker(size_t num_tasks,
+                                 bool print,
+                                 const string &status_file,
+                                 double interval):
+  num_tasks_(num_tasks),
+  print_(print),
+  status_file_(status_file),
+  interval_(interval),
+  entries_done_(0),
+  entries_known_(0),
+  tasks_started_(0),
+  tasks_done_(0),
+  start_bytes_(TFile::GetFileBytesRead()),
+  start_time_(Clock::now()),
+  monitor_(),
+  mutex_(),
+  cv_(),
+  stop_(false){
+}
+
+/*!\brief Stops monitor thread if still running
+*/
+ProgressTracker::~ProgressTracker(){
+  Stop();
+}
+
+/*!\brief Resets the clock and starts the monitor thread
+*/
+void ProgressTracker::Start(){
+  start_bytes_ = TFile::GetFileBytesRead();
+  start_time_ = Clock::now();
+  if(monitor_.joinable() || interval_.count() <= 0.) return;
+  if(!print_ && status_file_ == "") return;
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = false;
+  }
+  monitor_ = thread(&ProgressTracker::Monitor, this);
+}
+
+/*!\brief Stops the monitor thread and writes final status
+*/
+void ProgressTracker::Stop(){
+  if(!monitor_.joinable()) return;
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  monitor_.join();
+  WriteStatus("done");
+}
+
+/*!\brief Registers start of a task
+
+  \param[in] num_entries Number of entries the task will process
+*/
+void ProgressTracker::StartTask(long num_entries){
+  entries_known_.fetch_add(num_entries, memory_order_relaxed);
+  tasks_started_.fetch_add(1, memory_order_relaxed);
+}
+
+/*!\brief Registers completion of a task
+*/
+void ProgressTracker::FinishTask(){
+  tasks_done_.fetch_add(1, memory_order_relaxed);
+}
+
+/*!\brief Get number of entries processed so far
+
+  Entries still pending in a Counter are not included.
+
+  \return Number of entries processed
+*/
+long ProgressTracker::EntriesDone() const{
+  return entries_done_.load(memory_order_relaxed);
+}
+
+/*!\brief Get estimated total number of entries
+
+  \return Exact total once all tasks have started, else total of started tasks
+  extrapolated to all tasks
+*/
+long ProgressTracker::EntriesExpected() const{
+  size_t started = tasks_started_.load(memory_order_relaxed);
+  long known = entries_known_.load(memory_order_relaxed);
+  if(started == 0) return 0;
+  if(started >= num_tasks_) return known;
+  return llround(static_cast<double>(known)*num_tasks_/started);
+}
+
+/*!\brief Get number of bytes read from ROOT files since Start()
+
+  \return Number of bytes read
+*/
+long ProgressTracker::BytesRead() const{
+  return TFile::GetFileBytesRead()-start_bytes_;
+}
+
+/*!\brief Get time since Start()
+
+  \return Elapsed time in seconds
+*/
+double ProgressTracker::ElapsedSeconds() const{
+  return chrono::duration<double>(Clock::now()-start_time_).count();
+}
+
+/*!\brief Get average processing rate since Start()
+
+  \return Entries per second
+*/
+double ProgressTracker::Rate() const{
+  double seconds = ElapsedSeconds();
+  return seconds > 0. ? EntriesDone()/seconds : 0.;
+}
+
+/*!\brief Estimate time to completion at the average rate
+
+  \return Remaining time in seconds, or -1 if unknown
+*/
+double ProgressTracker::RemainingSeconds() const{
+  double rate = Rate();
+  long expected = EntriesExpected();
+  if(rate <= 0. || expected <= 0) return -1.;
+  return max(0., (expected-EntriesDone())/rate);
+}
+
+/*!\brief Get human-readable summary of progress
+
+  \return Single line summary
+*/
+string ProgressTracker::StatusLine() const{
+  long done = EntriesDone();
+  long expected = EntriesExpected();
+  double remaining = RemainingSeconds();
+  ostringstream oss;
+  oss << "Progress: " << AddCommas(done) << "/" << AddCommas(expected) << " entries";
+  if(expected > 0) oss << " (" << RoundNumber(100.*done, 1, expected) << "%)";
+  oss << ", " << tasks_done_.load(memory_order_relaxed) << "/" << num_tasks_ << " babies"
+      << ", " << RoundNumber(BytesRead(), 1, 1024.*1024.) << " MB read"
+      << ", " << RoundNumber(Rate(), 1, 1000.) << " kHz"
+      << ", elapsed " << HoursMinSec(ElapsedSeconds());
+  if(remaining >= 0.) oss << ", ETA " << HoursMinSec(remaining);
+  return oss.str();
+}
+
+/*!\brief Get machine-readable summary of progress
+
+  \param[in] state Name of current state, e.g. "running" or "done"
+
+  \return JSON object as a string
+*/
+string ProgressTracker::StatusJSON(const string &state) const{
+  ostringstream oss;
+  oss << setprecision(12)
+      << "{\"state\": \"" << state << "\""
+      << ", \"elapsed_seconds\": " << ElapsedSeconds()
+      << ", \"remaining_seconds\": " << RemainingSeconds()
+      << ", \"entries_done\": " << EntriesDone()
+      << ", \"entries_expected\": " << EntriesExpected()
+      << ", \"tasks_started\": " << tasks_started_.load(memory_order_relaxed)
+      << ", \"tasks_done\": " << tasks_done_.load(memory_order_relaxed)
+      << ", \"tasks_total\": " << num_tasks_
+      << ", \"bytes_read\": " << BytesRead()
+      << ", \"rate_hz\": " << Rate()
+      << "}\n";
+  return oss.str();
+}
+
+void ProgressTracker::Monitor(){
+  unique_lock<mutex> lock(mutex_);
+  while(!cv_.wait_for(lock, interval_, [this]{return stop_;})){
+    if(print_){
+      string line = StatusLine()+"\n";
+      cout << line << flush;
+    }
+    WriteStatus("running");
+  }
+}
+
+void ProgressTracker::WriteStatus(const string &state) const{
+  if(status_file_ == "") return;
+  //Write to a temporary file and rename so readers never see a partial file
+  string tmp_file = status_file_+".tmp";
+  {
+    ofstream file(tmp_file);
+    if(!file) return;
+    file << StatusJSON(state);
+  }
+  rename(tmp_file.c_str(), status_file_.c_str());
+}
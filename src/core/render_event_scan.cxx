@@ -0,0 +1,70 @@
+// Renders binary event scans written by EventScan in binary mode as the text
+// tables written in text mode
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <getopt.h>
+
+#include "core/event_scan.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  unsigned precision = 10;
+  vector<string> scans;
+}
+
+void GetOptions(int argc, char *argv[]);
+
+int main(int argc, char *argv[]){
+  GetOptions(argc, argv);
+  if(scans.empty()){
+    cout << "Usage: " << argv[0] << " [-p precision] scan1.scan [scan2.scan ...]" << endl;
+    return 1;
+  }
+  for(const auto &scan: scans){
+    string text = scan;
+    if(text.size() > 5 && text.substr(text.size()-5) == ".scan") text = text.substr(0, text.size()-5);
+    text += ".txt";
+    EventScan::Render(scan, text, precision);
+    cout << "less " << text << endl;
+  }
+}
+
+void GetOptions(int argc, char *argv[]){
+  while(true){
+    static struct option long_options[] = {
+      {"precision", required_argument, 0, 'p'},
+      {0, 0, 0, 0}
+    };
+
+    char opt = -1;
+    int option_index;
+    opt = getopt_long(argc, argv, "p:", long_options, &option_index);
+
+    if( opt == -1) break;
+
+    string optname;
+    switch(opt){
+    case 'p':
+      precision = atoi(optarg);
+      break;
+    case 0:
+      optname = long_options[option_index].name;
+      printf("Bad option! Found option name %s\n", optname.c_str());
+      break;
+    default:
+      printf("Bad option! getopt_long returned character code 0%o\n", opt);
+      break;
+    }
+  }
+  for(int argi = optind; argi < argc; ++argi){
+    scans.push_back(argv[argi]);
+  }
+}
@@ -1,7 +1,10 @@
 #include "core/table.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <iomanip>
+#include <map>
+#include <utility>
 
 #include <sys/stat.h>
 
@@ -14,7 +17,9 @@
 #include "TStyle.h"
 #include "TString.h"
 
+#include "core/output_stage.hpp"
 #include "core/utilities.hpp"
+#include "core/checkpoint.hpp"
 
 using namespace std;
 
@@ -35,6 +40,64 @@ namespace{
     }
     return x;
   }
+
+  struct PieChart{
+    vector<double> counts_;//!<Yield of each slice
+    vector<int> colors_;//!<Fill color of each slice
+    vector<string> labels_;//!<Process name of each slice
+    string title_;//!<Title drawn above pie, or empty
+    string total_;//!<Total yield drawn next to pie, or empty
+    int width_, height_;//!<Canvas size
+    string legend_name_;//!<File to which legend is saved, or empty
+    string plot_name_;//!<File to which pie is saved
+
+    string Inputs() const{
+      ostringstream oss;
+      oss << setprecision(17) << width_ << ' ' << height_ << '\n' << title_ << '\n' << total_ << '\n';
+      for(size_t i = 0; i < counts_.size(); ++i){
+        oss << counts_.at(i) << ' ' << colors_.at(i) << ' ' << labels_.at(i) << '\n';
+      }
+      oss << legend_name_ << '\n' << plot_name_;
+      return oss.str();
+    }
+
+    void Draw() const{
+      size_t Nbkg = counts_.size();
+      vector<TH1D> histos(Nbkg, TH1D("","",1,-1.,1.));
+      vector<const char*> labels(Nbkg);
+      vector<double> counts = counts_;
+      vector<int> colors = colors_;
+      TLegend leg(0., 0., 1., 1.); leg.SetFillStyle(0); leg.SetBorderSize(0);
+      for(size_t ind = 0; ind < Nbkg; ++ind){
+        histos[ind].SetFillColor(colors_.at(ind));
+        leg.AddEntry(&histos[ind], labels_.at(ind).c_str(), "f");
+        labels.at(ind) = labels_.at(ind).c_str();
+      }
+
+      gStyle->SetTitleW(0.95);
+      TCanvas can("", "", width_, height_);
+      can.SetFillColorAlpha(0, 0.);
+      can.SetFillStyle(4000);
+
+      // Printing legend
+      if(legend_name_ != ""){
+        leg.Draw();
+        can.SaveAs(legend_name_.c_str());
+      }
+
+      // Define piechart
+      TPie pie("", "", Nbkg, &counts.at(0), &colors.at(0), &labels.at(0));
+      pie.SetCircle(0.5, 0.48, 0.35);
+      if(title_ != "") pie.SetTitle(title_.c_str());
+
+      // Printing pie chart with percentages
+      pie.SetLabelFormat("%perc");
+      pie.Draw();
+      TLatex total(0.68,0.5,total_.c_str());
+      if(total_ != "") total.Draw();
+      can.SaveAs(plot_name_.c_str());
+    }
+  };
 }
 
 Table::TableColumn::TableColumn(const Table &table,
@@ -45,15 +108,77 @@ Table::TableColumn::TableColumn(const Table &table,
   proc_and_table_cut_(table.rows_.size(), process->cut_),
   cut_vector_(),
   wgt_vector_(),
-  val_vector_(){
+  val_vector_(),
+  factors_(),
+  row_masks_(table.rows_.size()),
+  known_(),
+  passed_(),
+  reproducible_(false),
+  exact_sumw_(),
+  exact_sumw2_(),
+  basis_values_(),
+  have_basis_(false),
+  param_sumw_(),
+  param_sumw2_(),
+  specializations_(),
+  current_baby_(nullptr),
+  current_(nullptr),
+  summary_(nullptr),
+  served_cuts_(table.rows_.size()),
+  served_weights_(table.rows_.size(), -1){
+  // Rows whose cut factors are all scalar share the evaluation of identical
+  // factors, identified by name, through a per-event bitset
+  map<string, size_t> factor_index;
+  vector<vector<size_t> > row_factors(table.rows_.size());
   for(size_t irow = 0; irow < table.rows_.size(); ++irow){
-    proc_and_table_cut_.at(irow) = table.rows_.at(irow).cut_ && process->cut_;
+    const TableRow &row = table.rows_.at(irow);
+    proc_and_table_cut_.at(irow) = row.cut_ && process->cut_;
+    if(!row.is_data_row_ || process->cut_.IsVector()) continue;
+    bool all_scalar = true;
+    for(const auto &factor: row.factors_){
+      if(factor.IsVector()) all_scalar = false;
+    }
+    if(!all_scalar) continue;
+
+    vector<NamedFunc> factors = row.factors_;
+    factors.insert(factors.begin(), process->cut_);
+    for(const auto &factor: factors){
+      auto found = factor_index.find(factor.Name());
+      if(found == factor_index.end()){
+        found = factor_index.emplace(factor.Name(), factors_.size()).first;
+        factors_.push_back(factor);
+      }
+      row_factors.at(irow).push_back(found->second);
+    }
+  }
+
+  size_t num_words = (factors_.size()+63)/64;
+  known_.assign(num_words, 0);
+  passed_.assign(num_words, 0);
+  for(size_t irow = 0; irow < row_factors.size(); ++irow){
+    if(row_factors.at(irow).empty()) continue;
+    vector<uint64_t> &mask = row_masks_.at(irow);
+    mask.assign(num_words, 0);
+    for(const auto &ifactor: row_factors.at(irow)){
+      mask.at(ifactor/64) |= static_cast<uint64_t>(1) << (ifactor%64);
+    }
   }
 }
 
 void Table::TableColumn::RecordEvent(const Baby &baby){
   const Table& table = static_cast<const Table&>(figure_);
 
+  const Specialization *spec = GetSpecialization(baby);
+  const vector<NamedFunc> &factors = spec ? spec->factors_ : factors_;
+  if(spec){
+    known_ = spec->known_;
+    passed_ = spec->passed_;
+  }else{
+    known_.assign(known_.size(), 0);
+    passed_.assign(passed_.size(), 0);
+  }
+  have_basis_ = false;
+
   bool have_vector;
   size_t min_vec_size;
   for(size_t irow = 0; irow < table.rows_.size(); ++irow){
@@ -61,11 +186,13 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
     min_vec_size = 0;
 
     const TableRow& row = table.rows_.at(irow);
-    if(!row.is_data_row_) continue;
-    const NamedFunc &cut = proc_and_table_cut_.at(irow);
-    const NamedFunc &wgt = row.weight_;
+    if(!row.is_data_row_ || served_weights_.at(irow) >= 0) continue;
+    const NamedFunc &cut = spec ? spec->cuts_.at(irow) : proc_and_table_cut_.at(irow);
+    const NamedFunc &wgt = spec ? spec->weights_.at(irow) : row.weight_;
 
-    if(cut.IsScalar()){
+    if(!row_masks_.at(irow).empty()){
+      if(!PassFactors(baby, irow, factors)) continue;
+    }else if(cut.IsScalar()){
       if(!cut.GetScalar(baby)) continue;
       
     }else{
@@ -88,20 +215,321 @@ void Table::TableColumn::RecordEvent(const Baby &baby){
     }
 
     if(!have_vector){
-      sumw_.at(irow) += wgt_scalar;
-      sumw2_.at(irow) += wgt_scalar*wgt_scalar;
+      Accumulate(baby, irow, wgt_scalar);
     }else{
       for(size_t iobject = 0; iobject < min_vec_size; ++iobject){
        NamedFunc::ScalarType this_cut = cut.IsScalar() ? true : cut_vector_.at(iobject);
        if(!this_cut) continue;
        NamedFunc::ScalarType this_wgt = wgt.IsScalar() ? wgt_scalar : wgt_vector_.at(iobject);
-       sumw_.at(irow) += this_wgt;
-       sumw2_.at(irow) += this_wgt*this_wgt;
+       Accumulate(baby, irow, this_wgt);
       }
     }
   }
 }
 
+/*!\brief Checks whether the current event passes all cut factors of a row
+
+  Factors are evaluated at most once per event. Results are kept in
+  TableColumn::known_ and TableColumn::passed_, so a row sharing a factor that
+  already failed is rejected with a bitwise AND, without evaluating anything.
+
+  \param[in] baby Baby containing the current event
+
+  \param[in] irow Index of a factorized row
+
+  \param[in] factors Factors to evaluate, either factors_ or their
+  specialization to baby
+
+  \return True if the event passes every factor of the row
+*/
+bool Table::TableColumn::PassFactors(const Baby &baby, size_t irow,
+                                     const vector<NamedFunc> &factors){
+  const vector<uint64_t> &mask = row_masks_.at(irow);
+  for(size_t word = 0; word < mask.size(); ++word){
+    if(mask.at(word) & known_.at(word) & ~passed_.at(word)) return false;
+  }
+  for(size_t word = 0; word < mask.size(); ++word){
+    uint64_t todo = mask.at(word) & ~known_.at(word);
+    for(size_t bit = 0; todo != 0; ++bit, todo >>= 1){
+      if(!(todo & 1)) continue;
+      uint64_t flag = static_cast<uint64_t>(1) << bit;
+      known_.at(word) |= flag;
+      if(!factors.at(64*word+bit).GetScalar(baby)) return false;
+      passed_.at(word) |= flag;
+    }
+  }
+  return true;
+}
+
+/*!\brief Specializes cuts, weights and cut factors to a Baby
+
+  Factors folding to constants are marked as already evaluated, so rows
+  sharing a factor that fails for the whole Baby are skipped without
+  evaluating anything.
+
+  \param[in] baby Baby whose events are about to be recorded
+*/
+void Table::TableColumn::Specialize(const Baby &baby){
+  const Table& table = static_cast<const Table&>(figure_);
+  bool specializable = false;
+  for(size_t irow = 0; irow < table.rows_.size(); ++irow){
+    specializable = specializable
+      || proc_and_table_cut_.at(irow).IsSpecializable()
+      || table.rows_.at(irow).weight_.IsSpecializable();
+  }
+  for(const auto &factor: factors_){
+    specializable = specializable || factor.IsSpecializable();
+  }
+  if(!specializable) return;
+
+  Specialization spec;
+  for(size_t irow = 0; irow < table.rows_.size(); ++irow){
+    spec.cuts_.push_back(proc_and_table_cut_.at(irow).Specialized(baby));
+    spec.weights_.push_back(table.rows_.at(irow).weight_.Specialized(baby));
+  }
+  spec.known_.assign(known_.size(), 0);
+  spec.passed_.assign(passed_.size(), 0);
+  for(size_t ifactor = 0; ifactor < factors_.size(); ++ifactor){
+    spec.factors_.push_back(factors_.at(ifactor).Specialized(baby));
+    const NamedFunc &factor = spec.factors_.back();
+    if(!factor.IsConstant()) continue;
+    uint64_t flag = static_cast<uint64_t>(1) << (ifactor%64);
+    spec.known_.at(ifactor/64) |= flag;
+    if(factor.ConstantValue()) spec.passed_.at(ifactor/64) |= flag;
+  }
+  specializations_.erase(&baby);
+  specializations_.emplace(&baby, move(spec));
+  current_baby_ = nullptr;
+}
+
+/*!\brief Drops the functions specialized to a Baby
+
+  \param[in] baby Baby whose events have been recorded
+*/
+void Table::TableColumn::Unspecialize(const Baby &baby){
+  specializations_.erase(&baby);
+  current_baby_ = nullptr;
+}
+
+string Table::TableColumn::Definition() const{
+  const Table& table = static_cast<const Table&>(figure_);
+  string definition = "Table;"+table.name_;
+  for(size_t irow = 0; irow < table.rows_.size(); ++irow){
+    const TableRow &row = table.rows_.at(irow);
+    definition += ';'+proc_and_table_cut_.at(irow).Name()+'*'+row.weight_.Name();
+    for(const auto &factor: row.factors_){
+      definition += '&'+factor.Name();
+    }
+  }
+  if(table.param_weight_){
+    for(size_t iterm = 0; iterm < table.param_weight_->NumTerms(); ++iterm){
+      definition += ";term "+table.param_weight_->Basis(iterm).Name();
+    }
+  }
+  if(summary_ != nullptr){
+    definition += ";served";
+    for(const auto &iweight: served_weights_){
+      definition += ' '+to_string(iweight);
+    }
+  }
+  return definition+';'+process_->name_;
+}
+
+bool Table::TableColumn::SaveState(ostream &out) const{
+  Checkpoint::Write(out, sumw_);
+  Checkpoint::Write(out, sumw2_);
+  Checkpoint::Write(out, exact_sumw_);
+  Checkpoint::Write(out, exact_sumw2_);
+  Checkpoint::Write(out, param_sumw_);
+  Checkpoint::Write(out, param_sumw2_);
+  return true;
+}
+
+void Table::TableColumn::LoadState(istream &in){
+  Checkpoint::Read(in, sumw_);
+  Checkpoint::Read(in, sumw2_);
+  Checkpoint::Read(in, exact_sumw_);
+  Checkpoint::Read(in, exact_sumw2_);
+  Checkpoint::Read(in, param_sumw_);
+  Checkpoint::Read(in, param_sumw2_);
+}
+
+/*!\brief Get functions specialized to the Baby of the current event
+
+  \param[in] baby Baby containing the current event
+
+  \return Specialized functions, or nullptr to use the general ones
+*/
+const Table::TableColumn::Specialization * Table::TableColumn::GetSpecialization(const Baby &baby){
+  if(&baby != current_baby_){
+    current_baby_ = &baby;
+    auto spec = specializations_.find(&baby);
+    current_ = spec == specializations_.end() ? nullptr : &spec->second;
+  }
+  return current_;
+}
+
+/*!\brief Adds a weight to the sums of a row
+
+  With a ParamWeight, the sums of the weight times each basis term (and of
+  the squared weight times each pair of terms) are accumulated instead.
+
+  \param[in] baby Baby containing the current event
+
+  \param[in] irow Index of row
+
+  \param[in] wgt Weight of event or object
+*/
+void Table::TableColumn::Accumulate(const Baby &baby, size_t irow, NamedFunc::ScalarType wgt){
+  const Table& table = static_cast<const Table&>(figure_);
+  if(table.param_weight_){
+    const ParamWeight &param_weight = *table.param_weight_;
+    size_t num_terms = param_weight.NumTerms();
+    if(!have_basis_){
+      basis_values_.resize(num_terms);
+      for(size_t iterm = 0; iterm < num_terms; ++iterm){
+        basis_values_.at(iterm) = param_weight.Basis(iterm).GetScalar(baby);
+      }
+      have_basis_ = true;
+    }
+    if(param_sumw_.empty()){
+      param_sumw_.assign(sumw_.size(), vector<double>(num_terms, 0.));
+      param_sumw2_.assign(sumw_.size(), vector<double>(num_terms*num_terms, 0.));
+    }
+    vector<double> &param_sumw = param_sumw_.at(irow);
+    vector<double> &param_sumw2 = param_sumw2_.at(irow);
+    for(size_t k = 0; k < num_terms; ++k){
+      double wk = wgt*basis_values_[k];
+      param_sumw[k] += wk;
+      for(size_t l = 0; l < num_terms; ++l){
+        param_sumw2[k*num_terms+l] += wk*wgt*basis_values_[l];
+      }
+    }
+  }else if(reproducible_){
+    exact_sumw_.at(irow) += wgt;
+    exact_sumw2_.at(irow) += wgt*wgt;
+  }else{
+    sumw_.at(irow) += wgt;
+    sumw2_.at(irow) += wgt*wgt;
+  }
+}
+
+/*!\brief Accumulate yields exactly, so they do not depend on the order in
+  which babies are processed
+
+  \param[in] reproducible If true, use ExactSum for the yields
+*/
+void Table::TableColumn::Reproducible(bool reproducible){
+  reproducible_ = reproducible;
+  if(reproducible_){
+    exact_sumw_.resize(sumw_.size());
+    exact_sumw2_.resize(sumw2_.size());
+  }
+}
+
+/*!\brief Sets sumw_ and sumw2_ from the parametric sums
+
+  \param[in] coefficients Coefficient of each ParamWeight term
+*/
+void Table::TableColumn::Evaluate(const vector<double> &coefficients){
+  size_t num_terms = coefficients.size();
+  for(size_t irow = 0; irow < param_sumw_.size(); ++irow){
+    double sumw = 0., sumw2 = 0.;
+    for(size_t k = 0; k < num_terms; ++k){
+      sumw += coefficients[k]*param_sumw_.at(irow).at(k);
+      for(size_t l = 0; l < num_terms; ++l){
+        sumw2 += coefficients[k]*coefficients[l]*param_sumw2_.at(irow).at(k*num_terms+l);
+      }
+    }
+    sumw_.at(irow) = sumw;
+    sumw2_.at(irow) = sumw2;
+  }
+}
+
+/*!\brief Fills rows from a summary instead of events where possible
+
+  A row is served if the summary of the process was read from file, its cut
+  is expressible in the keys of the summary and its weight is one of the
+  summed weights. Rows of tables with a ParamWeight or a vector process cut
+  are never served.
+
+  \param[in] summary Summary to use, or nullptr to fill all rows from events
+*/
+void Table::TableColumn::Serve(const EventSummary *summary){
+  const Table& table = static_cast<const Table&>(figure_);
+  summary_ = nullptr;
+  served_cuts_.assign(table.rows_.size(), EventSummary::Selection());
+  served_weights_.assign(table.rows_.size(), -1);
+  if(summary == nullptr || table.param_weight_ || process_->cut_.IsVector()) return;
+  summary_ = summary->Loaded(process_.get());
+  if(summary_ == nullptr) return;
+  for(size_t irow = 0; irow < table.rows_.size(); ++irow){
+    const TableRow &row = table.rows_.at(irow);
+    if(!row.is_data_row_) continue;
+    long iweight = summary->WeightIndex(row.weight_);
+    if(iweight < 0 || !summary->Compile(row.cut_, served_cuts_.at(irow))) continue;
+    served_weights_.at(irow) = iweight;
+  }
+}
+
+/*!\brief Check if every row is served by the summary
+
+  \return True if no events are needed
+*/
+bool Table::TableColumn::Done() const{
+  if(summary_ == nullptr) return false;
+  const Table& table = static_cast<const Table&>(figure_);
+  for(size_t irow = 0; irow < table.rows_.size(); ++irow){
+    if(table.rows_.at(irow).is_data_row_ && served_weights_.at(irow) < 0) return false;
+  }
+  return true;
+}
+
+/*!\brief Adds the rows served by the summary, copies the exact yields into
+  sumw_ and sumw2_ in reproducible mode, or evaluates the parametric sums at
+  the current parameter values
+ */
+void Table::TableColumn::Finalize(){
+  const Table& table = static_cast<const Table&>(figure_);
+  if(table.param_weight_){
+    Evaluate(table.param_weight_->Coefficients(table.param_values_));
+    return;
+  }
+  for(size_t irow = 0; irow < served_weights_.size(); ++irow){
+    if(served_weights_.at(irow) < 0) continue;
+    double sumw = 0., sumw2 = 0.;
+    summary_->Sum(served_cuts_.at(irow), served_weights_.at(irow), sumw, sumw2);
+    if(reproducible_){
+      exact_sumw_.at(irow) += sumw;
+      exact_sumw2_.at(irow) += sumw2;
+    }else{
+      sumw_.at(irow) += sumw;
+      sumw2_.at(irow) += sumw2;
+    }
+  }
+  if(!reproducible_) return;
+  for(size_t irow = 0; irow < sumw_.size(); ++irow){
+    ExactSum sumw = exact_sumw_.at(irow), sumw2 = exact_sumw2_.at(irow);
+    sumw += sumw_.at(irow);
+    sumw2 += sumw2_.at(irow);
+    sumw_.at(irow) = sumw.Value();
+    sumw2_.at(irow) = sumw2.Value();
+    exact_sumw_.at(irow).Clear();
+    exact_sumw2_.at(irow).Clear();
+  }
+}
+
+size_t Table::TableColumn::MemoryUsage() const{
+  return sizeof(*this)
+    + (sumw_.capacity()+sumw2_.capacity())*sizeof(double)
+    + (cut_vector_.capacity()+wgt_vector_.capacity()+val_vector_.capacity())*sizeof(NamedFunc::ScalarType)
+    + factors_.capacity()*sizeof(NamedFunc)
+    + (row_masks_.size()*known_.size()+known_.capacity()+passed_.capacity())*sizeof(uint64_t)
+    + (exact_sumw_.capacity()+exact_sumw2_.capacity())*sizeof(ExactSum)
+    + param_sumw_.size()*(param_sumw_.empty() ? 0 : param_sumw_.front().capacity())*sizeof(double)
+    + param_sumw2_.size()*(param_sumw2_.empty() ? 0 : param_sumw2_.front().capacity())*sizeof(double);
+}
+
 Table::Table(const string &name,
              const vector<TableRow> &rows,
              const vector<shared_ptr<Process> > &processes,
@@ -123,7 +551,9 @@ Table::Table(const string &name,
   plot_options_({PlotOpt("txt/plot_styles.txt", "Pie")}),
   backgrounds_(),
   signals_(),
-  datas_(){
+  datas_(),
+  param_weight_(),
+  param_values_(){
   for(const auto &process: processes){
     switch(process->type_){
     case Process::Type::data:
@@ -151,16 +581,21 @@ void Table::Print(double luminosity,
   string file_name = subdir != ""
     ? "tables/"+subdir+"/"+name_+"_lumi_"+fmt_lumi+".tex"
     : "tables/"+name_+"_lumi_"+fmt_lumi+".tex";
-  std::ofstream file(file_name);
-  if (print_pie_) file << fixed << setprecision(4);
-  else file << fixed << setprecision(4);
+  ostringstream file;
+  file << fixed << setprecision(4);
   PrintHeader(file, luminosity);
   for(size_t i = 0; i < rows_.size(); ++i){
     PrintRow(file, i, luminosity);
   }
   PrintFooter(file);
-  file << flush;
-  file.close();
+
+  if(output_stage_ != nullptr){
+    output_stage_->AddTable(file_name, file.str());
+    return;
+  }
+  std::ofstream out(file_name);
+  out << file.str() << flush;
+  out.close();
   cout << "pdflatex " << file_name << " &> /dev/null; #./python/texify.py tables" << endl;
 }
 
@@ -220,6 +655,73 @@ set<const Process*> Table::GetProcesses() const{
   return processes;
 }
 
+/*!\brief Multiplies the weight of every row by a parameter-dependent weight
+
+  Must be called before the event loop. Yields can then be evaluated at any
+  parameter values with Table::Parameters() once the loop is done. Sums are
+  accumulated in ordinary floating point even in reproducible mode.
+
+  \param[in] weight Weight depending on the parameters
+
+  \param[in] values Parameter values at which yields are initially evaluated
+
+  \return Reference to *this
+*/
+Table & Table::Parametric(const ParamWeight &weight,
+                          const vector<double> &values){
+  param_weight_.reset(new ParamWeight(weight));
+  param_weight_->Coefficients(values);
+  param_values_ = values;
+  for(auto &column: backgrounds_) column->Serve(nullptr);
+  for(auto &column: signals_) column->Serve(nullptr);
+  for(auto &column: datas_) column->Serve(nullptr);
+  return *this;
+}
+
+/*!\brief Fills rows from an EventSummary where possible
+
+  For each process whose summary was read from file, rows whose cut is
+  expressible in the summary keys and whose weight is one of its weights are
+  summed from the records when the event loop finishes. All other rows are
+  filled from events as usual. Babies whose figures are all served are not
+  read.
+
+  \param[in] summary Summary of the processes of the table, which must
+  outlive it
+
+  \return Reference to *this
+*/
+Table & Table::Summarized(const EventSummary &summary){
+  for(auto &column: backgrounds_) column->Serve(&summary);
+  for(auto &column: signals_) column->Serve(&summary);
+  for(auto &column: datas_) column->Serve(&summary);
+  return *this;
+}
+
+/*!\brief Get parameter values at which yields are evaluated
+
+  \return Parameter values, empty if the table has no ParamWeight
+*/
+const vector<double> & Table::Parameters() const{
+  return param_values_;
+}
+
+/*!\brief Re-evaluates all yields at new parameter values
+
+  \param[in] values Parameter values, in the order of ParamWeight::Parameters()
+
+  \return Reference to *this
+*/
+Table & Table::Parameters(const vector<double> &values){
+  if(!param_weight_) ERROR("Table "+name_+" has no parametric weight.");
+  vector<double> coefficients = param_weight_->Coefficients(values);
+  param_values_ = values;
+  for(auto &column: backgrounds_) column->Evaluate(coefficients);
+  for(auto &column: signals_) column->Evaluate(coefficients);
+  for(auto &column: datas_) column->Evaluate(coefficients);
+  return *this;
+}
+
 Figure::FigureComponent * Table::GetComponent(const Process *process){
   const auto &component_list = GetComponentList(process);
   for(const auto &component: component_list){
@@ -244,7 +746,7 @@ const vector<unique_ptr<Table::TableColumn> >& Table::GetComponentList(const Pro
     return backgrounds_;
   }
 }
-void Table::PrintHeader(ofstream &file, double luminosity) const{
+void Table::PrintHeader(ostream &file, double luminosity) const{
   file << "\\documentclass[10pt,oneside]{report}\n";
   file << "\\usepackage{graphicx,xspace,amssymb,amsmath,colordvi,colortbl,verbatim,multicol}\n";
   file << "\\usepackage{multirow, rotating}\n\n";
@@ -321,7 +823,7 @@ void Table::PrintHeader(ofstream &file, double luminosity) const{
   file << "\\hline\n";
 }
 
-void Table::PrintRow(ofstream &file, size_t irow, double luminosity) const{
+void Table::PrintRow(ostream &file, size_t irow, double luminosity) const{
   const TableRow& row = rows_.at(irow);
   if(row.lines_before_ > 0){
     file << "    ";
@@ -443,63 +945,53 @@ void Table::PrintRow(ofstream &file, size_t irow, double luminosity) const{
 void Table::PrintPie(std::size_t irow, double luminosity) const{
   size_t Nbkg = backgrounds_.size();
   float Yield_tt = 0, Yield_tot = luminosity*GetYield(backgrounds_, irow);
-  vector<double> counts(Nbkg);
-  vector<int> colors(Nbkg);
-  vector<const char*> labels(Nbkg);
-  vector<TH1D> histos(Nbkg, TH1D("","",1,-1.,1.));
-  TLegend leg(0., 0., 1., 1.); leg.SetFillStyle(0); leg.SetBorderSize(0);
+  PieChart pie;
+  pie.counts_.resize(Nbkg);
+  pie.colors_.resize(Nbkg);
+  pie.labels_.resize(Nbkg);
   bool print_ttbar = false;
   for(size_t ind = 0; ind < Nbkg; ++ind){
-    counts[ind] = luminosity*backgrounds_.at(ind)->sumw_.at(irow);
-    histos[ind].SetFillColor(backgrounds_.at(ind)->process_->GetFillColor());
-    colors.at(ind) = backgrounds_.at(ind)->process_->GetFillColor();
+    pie.counts_[ind] = luminosity*backgrounds_.at(ind)->sumw_.at(irow);
+    pie.colors_.at(ind) = backgrounds_.at(ind)->process_->GetFillColor();
     string label = backgrounds_.at(ind)->process_->name_;
-    leg.AddEntry(&histos[ind], label.c_str(), "f");
-    labels.at(ind) =  label.c_str();
+    pie.labels_.at(ind) = label;
     if(Contains(label,"t#bar{t}") && !Contains(label,"t#bar{t}V")){
-      Yield_tt += counts[ind];
+      Yield_tt += pie.counts_[ind];
       print_ttbar = true;
     }
   } // Loop over backgrounds
 
   // For now, use only the first PlotOpt in the vector
-  gStyle->SetTitleW(0.95);
-  TCanvas can("", "", plot_options_[0].CanvasWidth(), plot_options_[0].CanvasHeight());
-  can.SetFillColorAlpha(0, 0.);
-  can.SetFillStyle(4000);
-  string plot_name;
-
-  // Printing legend
+  pie.width_ = plot_options_[0].CanvasWidth();
+  pie.height_ = plot_options_[0].CanvasHeight();
   if(irow==0){
-    leg.Draw();
-    plot_name = "plots/pie_"+name_+"_legend_lumi"+RoundNumber(luminosity,0)+".pdf";
-    can.SaveAs(plot_name.c_str());
-    cout<<" open "<<plot_name<<endl;
+    pie.legend_name_ = "plots/pie_"+name_+"_legend_lumi"+RoundNumber(luminosity,0)+".pdf";
   }
-
-  // Define piechart
-  TPie pie("", "", Nbkg, &counts.at(0), &colors.at(0), &labels.at(0));
-  pie.SetCircle(0.5, 0.48, 0.35);
   if(print_titlepie_){
     TString title = CodeToRootTex(rows_.at(irow).cut_.Name())+" (N="+RoundNumber(Yield_tot,1);
     if(print_ttbar) title += ", t#bar{t}="+RoundNumber(Yield_tt*100,1,Yield_tot)+"%";
     title += ")";
-    pie.SetTitle(title);
+    pie.title_ = title.Data();
+    pie.total_ = RoundNumber(Yield_tot,1).Data();
   }
+  pie.plot_name_ = "plots/pie_"+name_+"_"+CodeToPlainText(rows_.at(irow).cut_.Name())+"_perc_lumi"+RoundNumber(luminosity,0).Data()+".pdf";
 
-  // Printing pie chart with percentages
-  pie.SetLabelFormat("%perc");
+  vector<string> outputs;
+  if(pie.legend_name_ != "") outputs.push_back(pie.legend_name_);
+  outputs.push_back(pie.plot_name_);
+  if(output_stage_ != nullptr){
+    output_stage_->AddRender(outputs, pie.Inputs(), [pie](){pie.Draw();});
+    return;
+  }
   pie.Draw();
-  TLatex total(0.68,0.5,RoundNumber(Yield_tot,1));
-  if(print_titlepie_) total.Draw();
-  plot_name = "plots/pie_"+name_+"_"+CodeToPlainText(rows_.at(irow).cut_.Name())+"_perc_lumi"+RoundNumber(luminosity,0).Data()+".pdf";
-  can.SaveAs(plot_name.c_str());
-  cout<<" open "<<plot_name<<endl;
+  for(const auto &output: outputs){
+    cout<<" open "<<output<<endl;
+  }
 
 } // PrintPie
 
 
-void Table::PrintFooter(ofstream &file) const{
+void Table::PrintFooter(ostream &file) const{
   file << "    \\hline\n";
   file << "    ";
 
@@ -6,6 +6,7 @@ TableRow::TableRow(const std::string &label,
   label_(label),
   cut_("1"),
   weight_("1"),
+  factors_(),
   lines_before_(lines_before),
   lines_after_(lines_after),
   is_data_row_(false){
@@ -19,7 +20,24 @@ TableRow::TableRow(const std::string &label,
   label_(label),
   cut_(cut),
   weight_(weight),
+  factors_({cut}),
   lines_before_(lines_before),
   lines_after_(lines_after),
   is_data_row_(true){
   }
+
+TableRow::TableRow(const std::string &label,
+                   const NamedFunc &cut,
+                   const std::vector<NamedFunc> &factors,
+                   std::size_t lines_before,
+                   std::size_t lines_after,
+                   const NamedFunc &weight):
+  label_(label),
+  cut_(cut),
+  weight_(weight),
+  factors_(factors),
+  lines_before_(lines_before),
+  lines_after_(lines_after),
+  is_data_row_(true){
+  if(factors_.empty()) factors_.push_back(cut_);
+  }
@@ -0,0 +1,135 @@
+/*! \class TaskGraph
+
+  \brief Runs a set of tasks with dependencies on a ThreadPool
+
+  Each task starts as soon as all tasks it depends on have finished. Since
+  dependencies can only refer to tasks already added, the graph cannot contain
+  cycles. Tasks that draw or otherwise touch ROOT's global state are marked
+  with uses_root and hold Multithreading::root_mutex while running, so they
+  are serialized with each other while computations keep running in parallel.
+
+  If a task throws, tasks depending on it are skipped, the remaining tasks are
+  allowed to finish, and the first exception is rethrown from Run().
+*/
+
+/*! \struct TaskGraph::Node
+
+  \brief A task and its place in the graph
+*/
+#include "core/task_graph.hpp"
+
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <thread>
+
+#include "core/thread_pool.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Constructs an empty graph
+ */
+TaskGraph::TaskGraph():
+  nodes_(){
+}
+
+/*!\brief Adds a task to the graph
+
+  \param[in] task Work to do
+
+  \param[in] dependencies Tasks that must finish before this one starts
+
+  \param[in] uses_root If true, the task holds Multithreading::root_mutex while
+  running
+
+  \return Identifier of the new task, for use as a dependency of later tasks
+*/
+TaskGraph::TaskId TaskGraph::Add(const function<void()> &task,
+                                 const vector<TaskId> &dependencies,
+                                 bool uses_root){
+  TaskId id = nodes_.size();
+  for(const auto &dependency: dependencies){
+    if(dependency >= id) ERROR("Task "+to_string(id)+" depends on unknown task "+to_string(dependency));
+    nodes_.at(dependency).dependents_.push_back(id);
+  }
+  Node node;
+  node.task_ = task;
+  node.num_dependencies_ = dependencies.size();
+  node.uses_root_ = uses_root;
+  nodes_.push_back(node);
+  return id;
+}
+
+/*!\brief Runs all tasks and empties the graph
+
+  \param[in] num_threads Number of worker threads. 0 uses one per core.
+*/
+void TaskGraph::Run(size_t num_threads){
+  if(num_threads == 0) num_threads = max(1u, thread::hardware_concurrency());
+
+  vector<size_t> waiting_for(nodes_.size());
+  for(size_t i = 0; i < nodes_.size(); ++i){
+    waiting_for.at(i) = nodes_.at(i).num_dependencies_;
+  }
+
+  mutex finished_mutex;
+  condition_variable finished_cv;
+  queue<pair<TaskId, bool> > finished;
+  exception_ptr error = nullptr;
+  size_t num_running = 0;
+
+  ThreadPool tp(min(num_threads, max(static_cast<size_t>(1), nodes_.size())));
+  auto launch = [&](TaskId id){
+    ++num_running;
+    tp.Push([&, id](){
+        bool ok = true;
+        try{
+          const Node &node = nodes_.at(id);
+          if(node.uses_root_){
+            lock_guard<mutex> lock(Multithreading::root_mutex);
+            node.task_();
+          }else{
+            node.task_();
+          }
+        }catch(...){
+          ok = false;
+          lock_guard<mutex> lock(finished_mutex);
+          if(!error) error = current_exception();
+        }
+        lock_guard<mutex> lock(finished_mutex);
+        finished.emplace(id, ok);
+        finished_cv.notify_one();
+      });
+  };
+
+  for(TaskId id = 0; id < nodes_.size(); ++id){
+    if(waiting_for.at(id) == 0) launch(id);
+  }
+  while(num_running > 0){
+    pair<TaskId, bool> done;
+    {
+      unique_lock<mutex> lock(finished_mutex);
+      finished_cv.wait(lock, [&finished](){return !finished.empty();});
+      done = finished.front();
+      finished.pop();
+    }
+    --num_running;
+    if(!done.second) continue;
+    for(const auto &dependent: nodes_.at(done.first).dependents_){
+      if(--waiting_for.at(dependent) == 0) launch(dependent);
+    }
+  }
+
+  nodes_.clear();
+  if(error) rethrow_exception(error);
+}
+
+/*!\brief Get number of tasks waiting to be run
+
+  \return Number of tasks
+*/
+size_t TaskGraph::Size() const{
+  return nodes_.size();
+}
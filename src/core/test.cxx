@@ -24,18 +24,33 @@
 #include "core/hist2d.hpp"
 #include "core/utilities.hpp"
 #include "core/functions.hpp"
+#include "core/abcd_method.hpp"
 
 using namespace std;
 using namespace PlotOptTypes;
 
 namespace{
   bool single_thread = false;
+
+  void CheckSplitFactors(){
+    abcd_method abcd("test", vector<TString>{"1"}, vector<TString>{"1"}, vector<TString>{"1"});
+    vector<TString> factors = abcd.splitFactors("nleps==1 && (met>200||ht>500) && njets>=6");
+    if(factors != vector<TString>{"nleps==1", "(met>200||ht>500)", "njets>=6"}){
+      ERROR("splitFactors did not split a product at its top-level ANDs");
+    }
+    factors = abcd.splitFactors("nleps==1 && met>200 || nleps==2");
+    if(factors != vector<TString>{"nleps==1&&met>200||nleps==2"}){
+      ERROR("splitFactors split a cut with a top-level OR");
+    }
+  }
 }
 
 int main(int argc, char *argv[]){
   gErrorIgnoreLevel = 6000;
   GetOptions(argc, argv);
 
+  CheckSplitFactors();
+
   double lumi = 35.9;
 
   string base_path = "";
@@ -0,0 +1,140 @@
+/*! \class TriggerMenu
+
+  \brief OR of trigger paths stored as bit masks, with one set of paths per
+  SampleType
+
+  Baby::trig_bits() holds the trig decisions packed into 64-bit words, so an
+  OR over any number of paths is evaluated by and-ing one or two words with a
+  precomputed mask instead of looking up each path in a std::vector<bool>.
+
+  Menus are declared once, e.g.
+
+  \code
+  const TriggerMenu menu = TriggerMenu("run2").Add(-2016, {3, 4, 34}).Add({2, 3, 22});
+  \endcode
+
+  where paths added without a sample type apply to every sample type not
+  listed explicitly.
+*/
+#include "core/trigger_menu.hpp"
+
+#include "core/baby.hpp"
+#include "core/utilities.hpp"
+
+using namespace std;
+
+/*!\brief Constructs a menu passing no events
+
+  \param[in] name Name of menu
+*/
+TriggerMenu::TriggerMenu(const string &name):
+  name_(name),
+  masks_(),
+  default_mask_(){
+}
+
+/*!\brief Sets the paths used for one sample type
+
+  \param[in] sample_type Value of Baby::SampleType() to which paths apply
+
+  \param[in] paths Indices in trig of the paths to OR
+
+  \return Reference to *this
+*/
+TriggerMenu & TriggerMenu::Add(int sample_type,
+                               const vector<size_t> &paths){
+  for(const auto &mask: masks_){
+    if(mask.first == sample_type){
+      ERROR("Trigger menu "+name_+" already has paths for sample type "+to_string(sample_type)+".");
+    }
+  }
+  masks_.emplace_back(sample_type, MakeMask(paths));
+  return *this;
+}
+
+/*!\brief Sets the paths used for sample types without their own paths
+
+  \param[in] paths Indices in trig of the paths to OR
+
+  \return Reference to *this
+*/
+TriggerMenu & TriggerMenu::Add(const vector<size_t> &paths){
+  default_mask_ = MakeMask(paths);
+  return *this;
+}
+
+/*!\brief Get menu name
+
+  \return Name of menu
+*/
+const string & TriggerMenu::Name() const{
+  return name_;
+}
+
+/*!\brief Get mask of paths for a sample type
+
+  \param[in] sample_type Value of Baby::SampleType()
+
+  \return Mask with bit i%64 of word i/64 set for each path i
+*/
+const TriggerMenu::Mask & TriggerMenu::GetMask(int sample_type) const{
+  for(const auto &mask: masks_){
+    if(mask.first == sample_type) return mask.second;
+  }
+  return default_mask_;
+}
+
+/*!\brief Check if any path of the menu fired
+
+  \param[in] sample_type Value of Baby::SampleType()
+
+  \param[in] bits Packed trigger decisions, as from Baby::trig_bits()
+
+  \return True if at least one path fired
+*/
+bool TriggerMenu::Pass(int sample_type, const vector<uint64_t> &bits) const{
+  return Test(GetMask(sample_type), bits);
+}
+
+/*!\brief Check if any path of the menu fired in the current event
+
+  \param[in] b Baby at the current event
+
+  \return True if at least one path fired
+*/
+bool TriggerMenu::Pass(const Baby &b) const{
+  return Pass(b.SampleType(), b.trig_bits());
+}
+
+/*!\brief Check if any path of a mask fired
+
+  Paths beyond the end of the stored trigger decisions count as not fired.
+
+  \param[in] mask Mask from GetMask()
+
+  \param[in] bits Packed trigger decisions, as from Baby::trig_bits()
+
+  \return True if at least one path in mask fired
+*/
+bool TriggerMenu::Test(const Mask &mask, const vector<uint64_t> &bits){
+  size_t num_words = mask.size() < bits.size() ? mask.size() : bits.size();
+  for(size_t iword = 0; iword < num_words; ++iword){
+    if(mask[iword] & bits[iword]) return true;
+  }
+  return false;
+}
+
+/*!\brief Packs path indices into a mask
+
+  \param[in] paths Indices in trig
+
+  \return Mask with bit i%64 of word i/64 set for each path i
+*/
+TriggerMenu::Mask TriggerMenu::MakeMask(const vector<size_t> &paths){
+  Mask mask;
+  for(const auto &path: paths){
+    if(path/64 >= mask.size()) mask.resize(path/64+1, 0);
+    mask[path/64] |= static_cast<uint64_t>(1) << (path%64);
+  }
+  return mask;
+}
@@ -23,11 +23,14 @@
 #include "TArrow.h"
 #include "RooStats/RooStatsUtils.h"
 
+#include "core/setup_profiler.hpp"
+
 using namespace std;
 
 mutex Multithreading::root_mutex;
 
 set<string> Glob(const string &pattern){
+  SetupProfiler::Scope scope("glob");
   glob_t glob_result;
   glob(pattern.c_str(), GLOB_TILDE, nullptr, &glob_result);
   set<string> ret;
@@ -792,7 +795,11 @@ double calcKappa(vector<vector<float> > &entries, vector<vector<float> > &weight
     }
     mSigma = fabs(stdval-fKappas[imSigma]); pSigma = fKappas[ipSigma]-stdval;
   }
-  
+  if(!verbose && !do_plot) return stdval;
+
+  // The canvas and histograms below touch ROOT's global style and directory,
+  // so they are only built when needed and under the ROOT lock
+  lock_guard<mutex> lock(Multithreading::root_mutex);
   gStyle->SetOptStat(0);              // No Stats box
   TCanvas can;
   can.SetMargin(0.15, 0.05, 0.12, 0.11);
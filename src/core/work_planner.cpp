@@ -0,0 +1,139 @@
+/*! \class WorkPlanner
+
+  \brief Groups small ntuple files into units read by a single Baby
+
+  Each Baby pays for creating its TChain and for the SetBranchAddress call of
+  every variable in Baby::Initialize() before reading its first entry. For a
+  signal scan or skim split into thousands of small files, giving each file
+  its own Baby makes that setup dominate the event loop. Once a target size is
+  set with TargetBytes(), Process asks WorkPlanner::Pack() to bin-pack its
+  files into units of roughly that size on disk, and makes one Baby per unit.
+  The TChain of that Baby keeps the branch addresses set at activation and
+  reapplies them itself when it moves on to the next file, so the setup is
+  paid once per unit instead of once per file.
+
+  The size on disk stands in for the number of entries: counting entries would
+  require opening every file, which is the cost packing avoids, and files of
+  one sample have nearly constant size per event. Only files in the same
+  directory and with the same Baby::SetSampleType() are packed together, so
+  the file-level constants used by NamedFunc::Specialized(), such as
+  Baby::SampleType(), are the same for all files of a unit. Files at least as large as the target, and files whose size
+  cannot be determined (e.g. remote URLs), remain units of their own.
+
+  Packing is off by default. Units are never made larger than the packed
+  files of the process divided by the number of cores, so that a process
+  with a few mid-size files still keeps every thread busy. Files of a process
+  already packed into a Baby together with files of another process are read
+  again by a Baby of their own, which Process reports.
+*/
+#include "core/work_planner.hpp"
+
+#include <cmath>
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <utility>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+size_t WorkPlanner::target_bytes_ = 0;
+
+/*!\brief Splits files into units of work
+
+  Files are assigned in order of decreasing size to the currently smallest of
+  ceil(total/target) units of their directory and sample type, which yields
+  units of nearly equal size. The target is TargetBytes(), lowered to the
+  total size of the packed files divided by the number of cores.
+
+  \param[in] files Files to read
+
+  \param[in] sample_type Function giving the sample type of a file, e.g.
+  Baby::SetSampleType(). Files of different types are never packed together.
+
+  \return File names of each unit. Every file appears in exactly one unit.
+*/
+vector<set<string> > WorkPlanner::Pack(const set<string> &files,
+                                       const function<int(const string &)> &sample_type){
+  vector<set<string> > units;
+  vector<pair<long, string> > all_files;
+  double packed_total = 0.;
+  for(const auto &file: files){
+    long size = FileSize(file);
+    all_files.emplace_back(size, file);
+    if(size >= 0 && static_cast<size_t>(size) < target_bytes_) packed_total += size;
+  }
+  size_t num_cores = max(1u, thread::hardware_concurrency());
+  double target = min(static_cast<double>(target_bytes_), max(1., packed_total/num_cores));
+
+  map<pair<string, int>, vector<pair<long, string> > > small_files;
+  for(const auto &sized_file: all_files){
+    long size = sized_file.first;
+    const string &file = sized_file.second;
+    if(target_bytes_ == 0 || size < 0 || size >= target){
+      units.push_back(set<string>{file});
+    }else{
+      size_t slash = file.rfind('/');
+      string directory = slash == string::npos ? "" : file.substr(0, slash);
+      small_files[make_pair(directory, sample_type(file))].emplace_back(size, file);
+    }
+  }
+
+  for(auto &group: small_files){
+    auto &sized_files = group.second;
+    sort(sized_files.begin(), sized_files.end(),
+         [](const pair<long, string> &a, const pair<long, string> &b){
+           return a.first > b.first || (a.first == b.first && a.second < b.second);
+         });
+    double total = 0.;
+    for(const auto &sized_file: sized_files){
+      total += sized_file.first;
+    }
+    size_t num_units = max(static_cast<size_t>(1),
+                           static_cast<size_t>(ceil(total/target)));
+    vector<double> unit_sizes(num_units, 0.);
+    vector<set<string> > packed(num_units);
+    for(const auto &sized_file: sized_files){
+      size_t smallest = min_element(unit_sizes.cbegin(), unit_sizes.cend()) - unit_sizes.cbegin();
+      unit_sizes.at(smallest) += sized_file.first;
+      packed.at(smallest).insert(sized_file.second);
+    }
+    for(auto &unit: packed){
+      if(!unit.empty()) units.push_back(move(unit));
+    }
+  }
+  return units;
+}
+
+/*!\brief Get size on disk targeted by each unit of packed files
+
+  \return Target size in bytes. 0 if packing is disabled.
+*/
+size_t WorkPlanner::TargetBytes(){
+  return target_bytes_;
+}
+
+/*!\brief Set size on disk targeted by each unit of packed files
+
+  Only affects processes created afterwards.
+
+  \param[in] bytes Target size in bytes, e.g. 256 MB. 0 gives every file its
+  own Baby.
+*/
+void WorkPlanner::TargetBytes(size_t bytes){
+  target_bytes_ = bytes;
+}
+
+/*!\brief Get size of a file on disk
+
+  \param[in] path Path to file
+
+  \return Size in bytes, or -1 if the file cannot be accessed locally
+*/
+long WorkPlanner::FileSize(const string &path){
+  struct stat info;
+  if(stat(path.c_str(), &info) != 0) return -1;
+  return info.st_size;
+}
@@ -0,0 +1,217 @@
+/*! \class WorkspaceIndex
+
+  \brief Parses the names of all functions and variables in a RooWorkspace once
+  and provides constant-time lookup by (kind, bin, process)
+
+  Workspaces produced by write_datacards name their objects as
+  "kind_BLK_block_BIN_bin_PRC_process", with the "_BLK_" and "_PRC_" parts
+  optional (e.g. "frac_BIN_bin_PRC_process" or "nexp_BLK_block_BIN_bin"). Rather
+  than scanning the whole workspace with substring matching for every
+  requested yield, the names are split into their components on construction
+  and the objects are stored in a hash table.
+
+  Lookups are exact on the bin and process names and ignore the block, which is
+  redundant once the bin is known. If several objects share the same (kind,
+  bin, process), the first one found in the workspace is returned.
+*/
+#include "core/workspace_index.hpp"
+
+#include <algorithm>
+
+#include "TIterator.h"
+
+#include "core/utilities.hpp"
+
+using namespace std;
+
+namespace{
+  const string blk_tag = "_BLK_";
+  const string bin_tag = "_BIN_";
+  const string prc_tag = "_PRC_";
+}
+
+/*!\brief Splits a workspace name into kind, block, bin, and process
+
+  \param[in] name Name of function/variable in the workspace
+*/
+WorkspaceIndex::Entry::Entry(const string &name):
+  name_(name),
+  kind_(),
+  block_(),
+  bin_(),
+  process_(),
+  arg_(nullptr){
+  auto blk_pos = name.find(blk_tag);
+  auto bin_pos = name.find(bin_tag);
+  auto prc_pos = name.find(prc_tag);
+  if(bin_pos == string::npos) return;
+  if(blk_pos != string::npos && blk_pos > bin_pos) blk_pos = string::npos;
+  if(prc_pos != string::npos && prc_pos < bin_pos) return;
+
+  if(blk_pos != string::npos){
+    kind_ = name.substr(0, blk_pos);
+    block_ = name.substr(blk_pos+blk_tag.size(), bin_pos-blk_pos-blk_tag.size());
+  }else{
+    kind_ = name.substr(0, bin_pos);
+  }
+  if(prc_pos != string::npos){
+    bin_ = name.substr(bin_pos+bin_tag.size(), prc_pos-bin_pos-bin_tag.size());
+    process_ = name.substr(prc_pos+prc_tag.size());
+  }else{
+    bin_ = name.substr(bin_pos+bin_tag.size());
+  }
+}
+
+/*!\brief Check if name followed the kind_[BLK_block_]BIN_bin[_PRC_process]
+  convention
+
+  \return True if kind and bin could be extracted from the name
+*/
+bool WorkspaceIndex::Entry::Valid() const{
+  return kind_ != "" && bin_ != "";
+}
+
+/*!\brief Index all functions and variables in a workspace
+
+  \param[in] w Workspace to index
+*/
+WorkspaceIndex::WorkspaceIndex(const RooWorkspace &w):
+  entries_(),
+  lookup_(){
+  AddArgs(w.allFunctions());
+  AddArgs(w.allVars());
+}
+
+/*!\brief Index an arbitrary set of arguments, e.g. the observables of a dataset
+
+  \param[in] args Set of arguments to index
+*/
+WorkspaceIndex::WorkspaceIndex(const RooArgSet &args):
+  entries_(),
+  lookup_(){
+  AddArgs(args);
+}
+
+/*!\brief Get function/variable with given kind, bin, and process
+
+  \param[in] kind Name prefix (e.g. "ymc", "nbkg", "nexp")
+
+  \param[in] bin Plain bin name (without block)
+
+  \param[in] process Process name, or empty string for the bin total
+
+  \return Pointer to function/variable, or nullptr if not found
+*/
+RooAbsReal * WorkspaceIndex::Find(const string &kind,
+                                  const string &bin,
+                                  const string &process) const{
+  const Entry *entry = FindEntry(kind, bin, process);
+  return entry == nullptr ? nullptr : entry->arg_;
+}
+
+/*!\brief Get parsed entry with given kind, bin, and process
+
+  \param[in] kind Name prefix (e.g. "ymc", "nbkg", "nexp")
+
+  \param[in] bin Plain bin name (without block)
+
+  \param[in] process Process name, or empty string for the bin total
+
+  \return Pointer to entry, or nullptr if not found
+*/
+const WorkspaceIndex::Entry * WorkspaceIndex::FindEntry(const string &kind,
+                                                        const string &bin,
+                                                        const string &process) const{
+  auto loc = lookup_.find(MakeKey(kind, bin, process));
+  if(loc == lookup_.cend()) return nullptr;
+  return &entries_.at(loc->second);
+}
+
+/*!\brief Get all indexed entries in workspace iteration order
+
+  \return All entries that followed the naming convention
+*/
+const vector<WorkspaceIndex::Entry> & WorkspaceIndex::Entries() const{
+  return entries_;
+}
+
+/*!\brief Get all indexed entries of a given kind in workspace iteration order
+
+  \param[in] kind Name prefix (e.g. "ymc", "nbkg", "nexp")
+
+  \return Pointers to entries of the requested kind
+*/
+vector<const WorkspaceIndex::Entry*> WorkspaceIndex::Entries(const string &kind) const{
+  vector<const Entry*> out;
+  for(const auto &entry: entries_){
+    if(entry.kind_ == kind) out.push_back(&entry);
+  }
+  return out;
+}
+
+/*!\brief Get distinct bin names for a given kind in workspace iteration order
+
+  \param[in] kind Name prefix (e.g. "ymc", "nbkg", "nexp")
+
+  \return List of distinct bin names
+*/
+vector<string> WorkspaceIndex::Bins(const string &kind) const{
+  vector<string> bins;
+  for(const auto &entry: entries_){
+    if(entry.kind_ != kind) continue;
+    if(find(bins.cbegin(), bins.cend(), entry.bin_) != bins.cend()) continue;
+    bins.push_back(entry.bin_);
+  }
+  return bins;
+}
+
+/*!\brief Get distinct process names for a given kind in workspace iteration
+  order
+
+  \param[in] kind Name prefix (e.g. "ymc", "frac")
+
+  \return List of distinct non-empty process names
+*/
+vector<string> WorkspaceIndex::Processes(const string &kind) const{
+  vector<string> processes;
+  for(const auto &entry: entries_){
+    if(entry.kind_ != kind || entry.process_ == "") continue;
+    if(find(processes.cbegin(), processes.cend(), entry.process_) != processes.cend()) continue;
+    processes.push_back(entry.process_);
+  }
+  return processes;
+}
+
+/*!\brief Parse and store all arguments in a set
+
+  \param[in] args Set of arguments to add to the index
+*/
+void WorkspaceIndex::AddArgs(const RooArgSet &args){
+  TIter iter(args.createIterator());
+  int size = args.getSize();
+  RooAbsArg *arg = nullptr;
+  int i = 0;
+  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
+    ++i;
+    if(arg == nullptr) continue;
+    Entry entry(arg->GetName());
+    if(!entry.Valid()) continue;
+    entry.arg_ = dynamic_cast<RooAbsReal*>(arg);
+    if(entry.arg_ == nullptr) continue;
+    string key = MakeKey(entry.kind_, entry.bin_, entry.process_);
+    if(lookup_.find(key) != lookup_.cend()) continue;
+    lookup_[key] = entries_.size();
+    entries_.push_back(entry);
+  }
+  iter.Reset();
+}
+
+/*!\brief Build hash key from name components
+
+  \return Key unique to (kind, bin, process)
+*/
+string WorkspaceIndex::MakeKey(const string &kind,
+                               const string &bin,
+                               const string &process){
+  return kind+'\n'+bin+'\n'+process;
+}
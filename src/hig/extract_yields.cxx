@@ -9,6 +9,9 @@
 #include <algorithm>
 #include <initializer_list>
 #include <stdexcept>
+#include <map>
+#include <memory>
+#include <tuple>
 
 #include <getopt.h>
 
@@ -28,6 +31,8 @@
 #include "RooAbsData.h"
 
 #include "core/utilities.hpp"
+#include "core/workspace_index.hpp"
+#include "core/error_propagator.hpp"
 
 using namespace std;
 
@@ -36,6 +41,26 @@ namespace{
   string name_wspace("w");
   bool table_clean(false);
   bool r4_only(true);
+
+  //Indices are built on first use and reused for every subsequent bin/process
+  //lookup in the same workspace or dataset
+  map<const TObject*, unique_ptr<WorkspaceIndex> > indices;
+
+  const WorkspaceIndex & Index(const RooWorkspace &w){
+    auto &ws_index = indices[&w];
+    if(!ws_index) ws_index.reset(new WorkspaceIndex(w));
+    return *ws_index;
+  }
+
+  const WorkspaceIndex & Index(const RooArgSet &args){
+    auto &ws_index = indices[&args];
+    if(!ws_index) ws_index.reset(new WorkspaceIndex(args));
+    return *ws_index;
+  }
+
+  //Errors from the last PropagateErrors call for each fit result, keyed by
+  //function name and error type
+  map<tuple<const RooFitResult*, string, int>, double> error_cache;
 }
 
 int main(int argc, char *argv[]){
@@ -172,6 +197,7 @@ void PrintTable(RooWorkspace &w,
   string sig_name = GetSignalName(w);
   vector<string> prc_names = GetProcessNames(w);
   vector<string> bin_names = GetPlainBinNames(w);
+  PropagateErrors(w, f, bin_names);
 
   bool dosig(Contains(file_name, "sig_table"));
   bool blind_all(Contains(file_name, "r4blinded"));
@@ -263,178 +289,69 @@ void PrintTable(RooWorkspace &w,
 double GetMCYield(const RooWorkspace &w,
                   const string &bin_name,
                   const string &prc_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,8) != "ymc_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(!(Contains(name, "_PRC_"+prc_name))) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("ymc", bin_name, prc_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetMCTotal(const RooWorkspace &w,
                   const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,8) != "ymc_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("ymc", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetMCTotalErr(RooWorkspace &w,
                      const RooFitResult &f,
                      const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,8) != "ymc_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return GetError(*static_cast<RooAbsReal*>(arg), f);
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("ymc", bin_name);
+  if(arg == nullptr) return -1.;
+  return GetError(*arg, f);
 }
 
 double GetBkgPred(const RooWorkspace &w,
                   const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nbkg_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nbkg", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetBkgPredErr(RooWorkspace &w,
                      const RooFitResult &f,
                      const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nbkg_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return GetError(*static_cast<RooAbsReal*>(arg), f);
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nbkg", bin_name);
+  if(arg == nullptr) return -1.;
+  return GetError(*arg, f);
 }
 
 double GetSigPred(const RooWorkspace &w,
                   const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nsig_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nsig", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetSigPredErr(RooWorkspace &w,
                      const RooFitResult &f,
                      const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nsig_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return GetError(*static_cast<RooAbsReal*>(arg), f);
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nsig", bin_name);
+  if(arg == nullptr) return -1.;
+  return GetError(*arg, f);
 }
 
 double GetTotPred(const RooWorkspace &w,
                   const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nexp_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nexp", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetTotPredErr(RooWorkspace &w,
                      const RooFitResult &f,
                      const string &bin_name, int errtype){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nexp_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    //cout<<name<<endl;
-    return GetError(*static_cast<RooAbsReal*>(arg), f, errtype);
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("nexp", bin_name);
+  if(arg == nullptr) return -1.;
+  return GetError(*arg, f, errtype);
 }
 
 double GetObserved(const RooWorkspace &w,
@@ -446,60 +363,24 @@ double GetObserved(const RooWorkspace &w,
   if(data == nullptr) ERROR("Could not find dataset "+oss.str());
   const RooArgSet *args = data->get();
   if(args == nullptr) ERROR("Could not extract args");
-  TIter iter(args->createIterator());
-  int size = args->getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nobs_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(*args).Find("nobs", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetLambda(const RooWorkspace &w,
                  const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,12) != "kappamc_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return static_cast<RooRealVar*>(arg)->getVal();
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("kappamc", bin_name);
+  if(arg == nullptr) return -1.;
+  return arg->getVal();
 }
 
 double GetLambdaErr(RooWorkspace &w,
                     const RooFitResult &f,
                     const string &bin_name){
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,12) != "kappamc_BLK_") continue;
-    if(!(Contains(name, "_BIN_"+bin_name))) continue;
-    if(Contains(name, "_PRC_")) continue;
-    return GetError(*static_cast<RooAbsReal*>(arg), f);
-  }
-  iter.Reset();
-  return -1.;
+  RooAbsReal *arg = Index(w).Find("kappamc", bin_name);
+  if(arg == nullptr) return -1.;
+  return GetError(*arg, f);
 }
 
 RooRealVar * SetVariables(RooWorkspace &w,
@@ -701,46 +582,13 @@ vector<string> GetBinNames(const RooWorkspace &w){
 }
 
 vector<string> GetPlainBinNames(const RooWorkspace &w){
-  vector<string> names;
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nexp_BLK_") continue;
-    auto bpos = name.find("_BIN_");
-    auto ppos = name.find("_PRC_");
-    if(bpos == string::npos) continue;
-    string bin_name = name.substr(bpos+5, ppos-bpos-5);
-    Append(names, bin_name);
-  }
-  iter.Reset();
+  vector<string> names = Index(w).Bins("nexp");
   reverse(names.begin(), names.end());
   return names;
 }
 
 vector<string> GetProcessNames(const RooWorkspace &w){
-  vector<string> names;
-  TIter iter(w.allFunctions().createIterator());
-  int size = w.allFunctions().getSize();
-  RooAbsArg *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsArg*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "frac_BIN_") continue;
-    auto prc_pos = name.find("_PRC_");
-    if(prc_pos == string::npos) continue;
-    string bin_name = name.substr(prc_pos+5);
-    if(find(names.cbegin(), names.cend(), bin_name) != names.cend()) continue;
-    Append(names, bin_name);
-  }
-  iter.Reset();
-  return names;
+  return Index(w).Processes("frac");
 }
 
 vector<vector<double> > GetComponentYields(const RooWorkspace &w,
@@ -1006,113 +854,20 @@ void MakeCovarianceMatrix(RooWorkspace &w,
 			  const RooFitResult &f,
 			  string covar_file_name){
   SetVariables(w, f);
-  const RooArgList &fpf = f.floatParsFinal();
-
-  // Make list of parameter instances of cloneFunc in order of error matrix
-  RooArgList paramList;
-  vector<int> fpf_idx;
 
   vector<RooAbsReal*> yields;
-  RooArgSet funcs = w.allFunctions();
-  TIter iter(funcs.createIterator());
-  int size = funcs.getSize();
-  RooAbsReal *arg = nullptr;
-  int i = 0;
-  while((arg = static_cast<RooAbsReal*>(iter())) && i < size){
-    ++i;
-    if(arg == nullptr) continue;
-    string name = arg->GetName();
-    if(name.substr(0,9) != "nbkg_BLK_") continue;
-    if(!Contains(name, "_BIN_")) continue;
-    if(Contains(name, "_PRC_")) continue;
-    if(r4_only && !(Contains(name, "hig_3b")||Contains(name, "hig_4b"))) continue;
-    yields.push_back(arg);
+  vector<string> yield_names;
+  for(const auto &entry: Index(w).Entries("nbkg")){
+    if(entry->block_ == "" || entry->process_ != "") continue;
+    if(r4_only && !(Contains(entry->bin_, "hig_3b")||Contains(entry->bin_, "hig_4b"))) continue;
+    yields.push_back(entry->arg_);
+    yield_names.push_back(entry->name_);
   }
 
-  vector<vector<double> > errors(fpf.getSize(), vector<double>(yields.size(), 0.));
-  for(Int_t iparam = 0; iparam<fpf.getSize(); ++iparam){
-    RooRealVar &rrv2 = static_cast<RooRealVar&>(*w.var(fpf.at(iparam)->GetName()));
-    RooRealVar &rrv = static_cast<RooRealVar&>(fpf[iparam]);
-
-    double lambda = 0.01;
-    double cenVal = rrv.getVal();
-    double minVal = rrv.getMin();
-    double maxVal = rrv.getMax();
-    double downVal = cenVal-lambda*fabs(rrv.getErrorLo());
-    double upVal = cenVal+lambda*fabs(rrv.getErrorHi());
-
-    string parname = rrv.GetName();
-    // if(Contains(parname, "rx21_BLK_met3") || Contains(parname, "rx31_BLK_met3")){
-    //   cout<<iparam<<" - "<<parname<<": cenVal "<<setw(12)<<cenVal<<", Hi "<<setw(12)<< rrv.getErrorHi()
-    // 	  <<", Lo "<<setw(12)<<rrv.getErrorLo()
-    // 	  <<", upVal "<<setw(12)<<upVal
-    // 	  <<", downVal "<<setw(12)<<downVal<<", minVal "<<setw(12)<<minVal<<", maxVal "<<setw(12)<<maxVal<<endl;
-    // }
-
-    if(upVal-downVal >= maxVal-minVal){
-      //Error bars bigger than variable range
-      downVal = minVal;
-      upVal = maxVal;
-    }else if(downVal < minVal){
-      upVal += minVal - downVal;
-      downVal = minVal;
-    }else if(upVal > maxVal){
-      downVal -= upVal - maxVal;
-      upVal = maxVal;
-    }
-
-    // /// Adam's original
-    // rrv.setVal(upVal);
-    // for(size_t iyield = 0; iyield<yields.size(); ++iyield){
-    //   errors.at(iparam).at(iyield) = 0.5*yields.at(iyield)->getVal();
-    // }
-    // rrv.setVal(downVal);
-    // for(size_t iyield = 0; iyield<yields.size(); ++iyield){
-    //   errors.at(iparam).at(iyield) -= 0.5*yields.at(iyield)->getVal();
-    // }
-    // rrv.setVal(cenVal);
-
-    /// Up variation
-    rrv2.setVal(upVal);
-    for(size_t iyield = 0; iyield<yields.size(); ++iyield){
-      errors.at(iparam).at(iyield) = yields.at(iyield)->getVal()/lambda;
-    }
-    rrv2.setVal(cenVal);
-    for(size_t iyield = 0; iyield<yields.size(); ++iyield){
-      errors.at(iparam).at(iyield) -= yields.at(iyield)->getVal()/lambda;
-      // if(Contains(parname, "BLK_met1") || Contains(parname, "BLK_met2") || Contains(parname, "BLK_met3")){
-      // 	cout<<iparam<<" - "<<parname<<", Iyield "<<iyield<<": error "<<setw(12)<<errors.at(iparam).at(iyield)
-      // 	    <<", val "<<setw(12)<<yields.at(iyield)->getVal()<<endl;
-      // }
-    }
-    rrv2.setVal(cenVal);
-  }
-
-  vector<vector<double> > right(fpf.getSize(), vector<double>(yields.size(), 0.));
-  for(Int_t iparam = 0; iparam<fpf.getSize(); ++iparam){
-    for(size_t iyield = 0; iyield<yields.size(); ++iyield){
-      right.at(iparam).at(iyield) = 0.;
-      for(Int_t entry = 0; entry<fpf.getSize(); ++entry){
-	right.at(iparam).at(iyield) += f.correlation(fpf.at(iparam)->GetName(),fpf.at(entry)->GetName())
-	  * errors.at(entry).at(iyield);
-      }
-    }
-  }
-
-  vector<vector<double> > covar(yields.size(), vector<double>(yields.size(), 0.));
-  for(size_t irow = 0; irow < yields.size(); ++irow){
-    for(size_t icol = 0.; icol < yields.size(); ++icol){
-      covar.at(irow).at(icol) = 0.;
-      for(Int_t ientry = 0.; ientry < fpf.getSize(); ++ientry){
-	// if(((irow==4&&icol==5) || (irow==6&&icol==7)) && 
-	//    fabs(errors.at(ientry).at(irow) * right.at(ientry).at(icol))>0.0001)
-	//   cout<<irow<<", "<<icol<<" - entry "<<ientry<<": error "<<setw(12)<<errors.at(ientry).at(irow)
-	//       <<", right "<<setw(12)<<right.at(ientry).at(icol)
-	//       <<" -> prod = "<<setw(12)<<errors.at(ientry).at(irow) * right.at(ientry).at(icol)<<endl;
-	covar.at(irow).at(icol) += errors.at(ientry).at(irow) * right.at(ientry).at(icol);
-      }
-    }
-  }
+  double lambda = 0.01;
+  ErrorPropagator propagator(w, f);
+  propagator.Compute(yield_names, ErrorPropagator::CovarianceShift(lambda), 1./lambda);
+  vector<vector<double> > covar = propagator.Covariance();
 
   TH2D h_covar("", "Covariance Matrix",
 	       covar.size(), -0.5, covar.size()-0.5,
@@ -1260,8 +1015,40 @@ string PrettyBinName(string name){
   return name;
 }
 
+void PropagateErrors(RooWorkspace &w,
+                     const RooFitResult &f,
+                     const vector<string> &bin_names){
+  for(auto it = error_cache.begin(); it != error_cache.end(); ){
+    if(get<0>(it->first) == &f) it = error_cache.erase(it);
+    else ++it;
+  }
+
+  const WorkspaceIndex &ws_index = Index(w);
+  vector<string> sym_names, asym_names;
+  for(const auto &bin_name: bin_names){
+    for(const auto &kind: {"ymc", "nbkg", "nsig", "kappamc"}){
+      const WorkspaceIndex::Entry *entry = ws_index.FindEntry(kind, bin_name);
+      if(entry != nullptr) sym_names.push_back(entry->name_);
+    }
+    const WorkspaceIndex::Entry *entry = ws_index.FindEntry("nexp", bin_name);
+    if(entry != nullptr) asym_names.push_back(entry->name_);
+  }
+
+  ErrorPropagator propagator(w, f);
+  for(int errtype: {0, 1, -1}){
+    const vector<string> &names = errtype == 0 ? sym_names : asym_names;
+    vector<double> errors = propagator.Compute(names, ErrorPropagator::ErrorShift(errtype)).Errors();
+    for(size_t i = 0; i < names.size(); ++i){
+      error_cache[make_tuple(&f, names.at(i), errtype)] = errors.at(i);
+    }
+  }
+}
+
 double GetError(const RooAbsReal &var,
                 const RooFitResult &f, int errtype){
+  auto cached = error_cache.find(make_tuple(&f, string(var.GetName()), errtype));
+  if(cached != error_cache.end()) return cached->second;
+
   // Clone self for internal use
   RooAbsReal* cloneFunc = static_cast<RooAbsReal*>(var.cloneTree());
   RooArgSet* errorParams = cloneFunc->getObservables(f.floatParsFinal());
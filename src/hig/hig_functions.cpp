@@ -201,11 +201,15 @@ const NamedFunc wgt_syst_qcd("wgt_syst_qcd",[](const Baby &b) -> NamedFunc::Scal
 });
 
 // Definition of analysis trigger
+const TriggerMenu trig_menu_met = TriggerMenu("hig_met").Add({13, 33, 14, 15, 30, 31});
+const TriggerMenu trig_menu_el = TriggerMenu("hig_el").Add({22, 40, 24, 41});
+const TriggerMenu trig_menu_mu = TriggerMenu("hig_mu").Add({19, 55, 21});
+
 NamedFunc::ScalarType trig_hig_decision(const Baby &b){
-    bool mettrig = b.trig()->at(13)||b.trig()->at(33)||b.trig()->at(14)||b.trig()->at(15)
-      ||b.trig()->at(30)||b.trig()->at(31);
-    bool eltrig = b.trig()->at(22)||b.trig()->at(40)||b.trig()->at(24)||b.trig()->at(41);
-    bool mutrig = b.trig()->at(19)||b.trig()->at(55)||b.trig()->at(21);
+    const vector<uint64_t> &trig_bits = b.trig_bits();
+    bool mettrig = trig_menu_met.Pass(b.SampleType(), trig_bits);
+    bool eltrig = trig_menu_el.Pass(b.SampleType(), trig_bits);
+    bool mutrig = trig_menu_mu.Pass(b.SampleType(), trig_bits);
 
     if(b.nels()==1 && b.nmus()==0){
       if(mettrig || eltrig) return 1;
@@ -17,6 +17,7 @@
 #include "core/event_scan.hpp"
 #include "core/palette.hpp"
 #include "core/table.hpp"
+#include "core/param_weight.hpp"
 #include "core/hist1d.hpp"
 #include "core/plot_opt.hpp"
 #include "core/functions.hpp"
@@ -97,29 +98,37 @@ int main(int argc, char *argv[]){
   string sbd = "higd_drmax<=2.2 && higd_am<=200 && higd_dm <= 40 && !(higd_am>100 && higd_am<=140)";
   NamedFunc wgt = Higfuncs::weight_higd * Higfuncs::eff_higtrig;
 
-  NamedFunc bf_wgt("bf_wgt", [&](const Baby &b){
-    float wgt_ = 1;
-    if (b.type()==-999999){
+  // Signal yields are scanned in the branching fraction, so the bf dependence
+  // goes through a ParamWeight evaluated after the event loop
+  NamedFunc non_signal("non_signal", [](const Baby &b) -> NamedFunc::ScalarType{
+    return b.type()!=-999999;
+  });
+  auto signal_nh = [](int nh_sel){
+    return NamedFunc("signal_nh"+to_string(nh_sel), [nh_sel](const Baby &b) -> NamedFunc::ScalarType{
+      if (b.type()!=-999999) return 0.;
       int nh(0), nh_nonbb(0);
       for (unsigned i(0); i<b.mc_id()->size(); i++) {
         if (b.mc_id()->at(i)==25) nh++;
         if (b.mc_mom()->at(i)==25 && abs(b.mc_id()->at(i))!=5) nh_nonbb++;
       }
       nh_nonbb /=2;
-      if (hz_only) {
-        wgt_ *= 2*(nh==1);
-      } else if (zz_only) {
-        wgt_ *= 4*(nh==0);
-      } else {
-        if (incl_nonhh) wgt_ *= (bf*bf/.25*(nh==2) + 2*bf*(1-bf)/.5*(nh==1) + (1-bf)*(1-bf)/.25*(nh==0));
-        else wgt_ *= (bf*bf/.25*(nh==2));
-        if (!incl_nonbb) wgt_ *= (nh_nonbb==0);
-      }
+      if (!hz_only && !zz_only && !incl_nonbb && nh_nonbb!=0) return 0.;
+      return nh==nh_sel;
+    });
+  };
+  ParamWeight bf_wgt({"bf"});
+  bf_wgt.Add(non_signal, vector<unsigned>{0});
+  if (hz_only) {
+    bf_wgt.Add(signal_nh(1), vector<unsigned>{0}, 2.);
+  } else if (zz_only) {
+    bf_wgt.Add(signal_nh(0), vector<unsigned>{0}, 4.);
+  } else {
+    bf_wgt.Add(signal_nh(2), vector<unsigned>{2}, 1/.25);
+    if (incl_nonhh) {
+      bf_wgt.Add(signal_nh(1), [](const vector<double> &p){return 2*p[0]*(1-p[0])/.5;});
+      bf_wgt.Add(signal_nh(0), [](const vector<double> &p){return (1-p[0])*(1-p[0])/.25;});
     }
-    return wgt_;
-  });
-
-  wgt *= bf_wgt;
+  }
   
   //        Cutflow table
   //-------------------------------- 
@@ -146,7 +155,7 @@ int main(int argc, char *argv[]){
   TableRow("HIG, 3b", baseline + " && met>300 &&" +c_3b+"&&"+hig,0,1, wgt),
   // TableRow("SBD, 4b", baseline + " && met>300 &&" +c_4b+"&&"+sbd,0,0, wgt),
   // TableRow("HIG, 4b", baseline + " && met>300 &&" +c_4b+"&&"+hig,0,1, wgt)
-	},procs,0);
+	},procs,0).Parametric(bf_wgt, {bf});
 
   pm.min_print_ = true;
   pm.MakePlots(lumi);
@@ -281,6 +290,7 @@ void GetOptions(int argc, char *argv[]){
       {"excl_nonhh", no_argument, 0, 0}, 
       {"hz", no_argument, 0, 0}, 
       {"zz", no_argument, 0, 0}, 
+      {"bf", required_argument, 0, 0},
       {0, 0, 0, 0}
     };
 
@@ -33,6 +33,7 @@
 #include "core/plot_maker.hpp"
 #include "core/palette.hpp"
 #include "core/table.hpp"
+#include "core/task_graph.hpp"
 #include "core/abcd_method.hpp"
 #include "core/styles.hpp"
 #include "core/plot_opt.hpp"
@@ -431,10 +432,11 @@ int main(int argc, char *argv[]){
     vector<TableRow> table_cuts, table_cuts_mm;
     NamedFunc correction = do_correction ? corrections.at(mm_scen) : NamedFunc(1.);
     for(size_t icut=0; icut < abcds.back().allcuts.size(); icut++){
-      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(),
+      vector<NamedFunc> factors(abcds.back().allfactors[icut].begin(), abcds.back().allfactors[icut].end());
+      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(), factors,
                                     0,0,weights.at("no_mismeasurement")*correction));
       if(only_mc) {
-        table_cuts_mm.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(),
+        table_cuts_mm.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(), factors,
                                                    0,0,weights.at(mm_scen)));
       }
     }
@@ -454,12 +456,20 @@ int main(int argc, char *argv[]){
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////
   ////////////////////////// Calculating preds/kappas and printing table //////////////////////////////////////
-  vector<TString> tablenames;
+  // Each method's prediction and table run as tasks in parallel across methods.
+  // The kappa plots draw with ROOT and fill syst_names/syst_values in method
+  // order, so they run one after another in a chain.
+  vector<TString> tablenames(abcds.size());
+  vector<vector<vector<GammaParams> > > allyields_all(abcds.size());
+  vector<vector<vector<vector<float> > > > kappas_all(abcds.size()), kappas_mm_all(abcds.size()),
+    kmcdat_all(abcds.size()), datapreds_all(abcds.size()), preds_all(abcds.size());
+  vector<vector<vector<float> > > yieldsPlane_all(abcds.size());
+  TaskGraph post_loop;
+  vector<TaskGraph::TaskId> plot_tasks;
   for(size_t imethod=0; imethod<abcds.size(); imethod++) {
-    mm_scen = GetScenario(methods.at(imethod).Data());
     // allyields: [0] data, [1] bkg, [2] T1tttt(NC), [3] T1tttt(C)
     // if split_bkg [2/4] Other, [3/5] tt1l, [4/6] tt2l
-    vector<vector<GammaParams> > allyields;
+    vector<vector<GammaParams> > &allyields = allyields_all[imethod];
     Table * yield_table;
     if(only_mc){
       yield_table = static_cast<Table*>(pm.Figures()[imethod*2].get());
@@ -487,44 +497,55 @@ int main(int argc, char *argv[]){
       }
 
     //// Calculating kappa and Total bkg prediction
-    vector<vector<vector<float> > > kappas, kappas_mm, kmcdat, datapreds, preds;
-    vector<vector<float> > yieldsPlane = findPreds(abcds[imethod], allyields, kappas, kappas_mm, kmcdat, datapreds, preds);
+    TaskGraph::TaskId preds_task = post_loop.Add([&, imethod](){
+        yieldsPlane_all[imethod] = findPreds(abcds[imethod], allyields_all[imethod], kappas_all[imethod],
+                                             kappas_mm_all[imethod], kmcdat_all[imethod],
+                                             datapreds_all[imethod], preds_all[imethod]);
 
-    //// Print MC/Data yields, cuts applied, kappas, preds
-    if(debug) printDebug(abcds[imethod], allyields, TString(baseline.Name()), kappas, kappas_mm, preds);
+        //// Print MC/Data yields, cuts applied, kappas, preds
+        if(debug) printDebug(abcds[imethod], allyields_all[imethod], TString(baseline.Name()),
+                             kappas_all[imethod], kappas_mm_all[imethod], preds_all[imethod]);
+      });
 
     //// Makes table MC/Data yields, kappas, preds, Zbi
-    if(!only_kappa) {
-      TString fullname = printTable(abcds[imethod], allyields, kappas, datapreds, yieldsPlane, proc_sigs);
-      tablenames.push_back(fullname);
-    }
-    
-    // reserve vectors to be filled in plotKappa()
-    if (mm_scen=="syst_mcstat"){
-      syst_names.push_back("syst_mcstat_up");   syst_values.push_back(vector<float>()); 
-      syst_names.push_back("syst_mcstat_dn");   syst_values.push_back(vector<float>()); 
-    } else {
-      syst_names.push_back(mm_scen);
-      syst_values.push_back(vector<float>());
-    }
+    TaskGraph::TaskId table_task = post_loop.Add([&, imethod](){
+        if(!only_kappa) tablenames[imethod] = printTable(abcds[imethod], allyields_all[imethod], kappas_all[imethod],
+                                                         datapreds_all[imethod], yieldsPlane_all[imethod], proc_sigs);
+      }, {preds_task});
+
+    vector<TaskGraph::TaskId> plot_deps = {table_task};
+    if(!plot_tasks.empty()) plot_deps.push_back(plot_tasks.back());
+    plot_tasks.push_back(post_loop.Add([&, imethod](){
+        mm_scen = GetScenario(methods.at(imethod).Data());
+
+        // reserve vectors to be filled in plotKappa()
+        if (mm_scen=="syst_mcstat"){
+          syst_names.push_back("syst_mcstat_up");   syst_values.push_back(vector<float>()); 
+          syst_names.push_back("syst_mcstat_dn");   syst_values.push_back(vector<float>()); 
+        } else {
+          syst_names.push_back(mm_scen);
+          syst_values.push_back(vector<float>());
+        }
 
-    //// Plotting kappa
-    plotKappa(abcds[imethod], kappas, kappas_mm, kmcdat);
-
-    // piggy back on one of the scenarios to get the expected data stat unc.
-    if (mm_scen=="syst_mcstat"){
-      syst_names.push_back("syst_datastat_up"); syst_values.push_back(vector<float>());
-      syst_names.push_back("syst_datastat_dn"); syst_values.push_back(vector<float>());
-      unsigned nsys = syst_values.size();
-      for (auto &iplane: datapreds) {
-        for (auto &ibin: iplane) {
-          if (ibin[0]==0) ibin[0] = 1e-6; 
-          syst_values[nsys-1].push_back(ibin[1]/ibin[0]);
-          syst_values[nsys-2].push_back(ibin[2]/ibin[0]);
+        //// Plotting kappa
+        plotKappa(abcds[imethod], kappas_all[imethod], kappas_mm_all[imethod], kmcdat_all[imethod]);
+
+        // piggy back on one of the scenarios to get the expected data stat unc.
+        if (mm_scen=="syst_mcstat"){
+          syst_names.push_back("syst_datastat_up"); syst_values.push_back(vector<float>());
+          syst_names.push_back("syst_datastat_dn"); syst_values.push_back(vector<float>());
+          unsigned nsys = syst_values.size();
+          for (auto &iplane: datapreds_all[imethod]) {
+            for (auto &ibin: iplane) {
+              if (ibin[0]==0) ibin[0] = 1e-6; 
+              syst_values[nsys-1].push_back(ibin[1]/ibin[0]);
+              syst_values[nsys-2].push_back(ibin[2]/ibin[0]);
+            }
+          }
         }
-      }
-    }
+      }, plot_deps, true));
   } // Loop over ABCD methods
+  post_loop.Run(single_thread ? 1 : 0);
 
   // print AN systematics table
   if (Contains(mm_scen,"syst")) {
@@ -29,6 +29,8 @@
 #include "core/plot_maker.hpp"
 #include "core/palette.hpp"
 #include "core/table.hpp"
+#include "core/event_summary.hpp"
+#include "core/task_graph.hpp"
 #include "core/abcd_method.hpp"
 #include "core/styles.hpp"
 #include "core/plot_opt.hpp"
@@ -198,8 +200,20 @@ int main(int argc, char *argv[]){
   ////////////////////////////////////////// Defining ABCD methods //////////////////////////////////////////
   vector<abcd_method> abcds;
   vector<TString> abcdcuts, metcuts, bincuts;
+  vector<Table*> yield_tables;
   PlotMaker pm;
 
+  // Bins of all ABCD cuts. Once summarized, reruns fill the tables without reading the babies.
+  // The "met>X" and "hig_am>100" cuts need their edges in the bin below.
+  vector<EventSummary::Key> summary_keys = {EventSummary::Key("met", {100., 200., 300.}).IncludeInLowerBin({100., 200., 300.}),
+                                            EventSummary::Key("hig_am", {100., 140.}).IncludeInLowerBin({100.}),
+                                            EventSummary::Key("hig_dm", {40.}),
+                                            EventSummary::Key::Integer("nbt", 0, 5),
+                                            EventSummary::Key::Integer("nbm", 0, 5),
+                                            EventSummary::Key::Integer("nbl", 0, 5)};
+  auto &summary = pm.Push<EventSummary>("tables/table_preds_summary.bin", summary_keys,
+                                        vector<NamedFunc>{"weight"}, all_procs);
+
   ///// Running over these methods
   vector<TString> methods = {"TTML", "MMMM"};
 
@@ -235,11 +249,13 @@ int main(int argc, char *argv[]){
     if(method.Contains("noint")) abcds.back().setIntNbNj(false);
  
     vector<TableRow> table_cuts;
-    for(size_t icut=0; icut < abcds.back().allcuts.size(); icut++)
-      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data()));
+    for(size_t icut=0; icut < abcds.back().allcuts.size(); icut++){
+      vector<NamedFunc> factors(abcds.back().allfactors[icut].begin(), abcds.back().allfactors[icut].end());
+      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(), factors));
+    }
 
     TString tname = "preds"; tname += iabcd;
-    pm.Push<Table>(tname.Data(),  table_cuts, all_procs, true, false);
+    yield_tables.push_back(&pm.Push<Table>(tname.Data(),  table_cuts, all_procs, true, false).Summarized(summary));
   } // Loop over ABCD methods
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -252,12 +268,17 @@ int main(int argc, char *argv[]){
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////
   ////////////////////////// Calculating preds/kappas and printing table //////////////////////////////////////
-  vector<TString> tablenames;
+  // Each method's prediction, table and kappa plot run as tasks, with methods in
+  // parallel and kappa plots serialized since they draw with ROOT
+  vector<TString> tablenames(abcds.size());
+  vector<vector<vector<GammaParams> > > allyields_all(abcds.size());
+  vector<vector<vector<vector<float> > > > kappas_all(abcds.size()), preds_all(abcds.size());
+  TaskGraph post_loop;
   for(size_t imethod=0; imethod<abcds.size(); imethod++) {
-    Table * yield_table = static_cast<Table*>(pm.Figures()[imethod].get());
+    Table * yield_table = yield_tables[imethod];
     // allyields: [0] data, [1] bkg, [2] T1tttt(NC), [3] T1tttt(C)
     // if split_bkg [2/4] Other, [3/5] tt1l, [4/6] tt2l
-    vector<vector<GammaParams> > allyields;
+    vector<vector<GammaParams> > &allyields = allyields_all[imethod];
     if(!only_mc) allyields.push_back(yield_table->DataYield());
     else allyields.push_back(yield_table->BackgroundYield(lumi));
     allyields.push_back(yield_table->BackgroundYield(lumi));
@@ -272,22 +293,27 @@ int main(int argc, char *argv[]){
     }
 
     //// Calculating kappa and Total bkg prediction
-    vector<vector<vector<float> > > kappas, preds;
-    findPreds(abcds[imethod], allyields, kappas, preds);
+    TaskGraph::TaskId preds_task = post_loop.Add([&, imethod](){
+	findPreds(abcds[imethod], allyields_all[imethod], kappas_all[imethod], preds_all[imethod]);
 
-    //// Print MC/Data yields, cuts applied, kappas, preds
-    if(debug) printDebug(abcds[imethod], allyields, TString(baseline.Name()), kappas, preds);
+	//// Print MC/Data yields, cuts applied, kappas, preds
+	if(debug) printDebug(abcds[imethod], allyields_all[imethod], TString(baseline.Name()),
+			     kappas_all[imethod], preds_all[imethod]);
+      });
 
     //// Makes table MC/Data yields, kappas, preds, Zbi
-    if(!only_kappa) {
-      TString fullname = printTable(abcds[imethod], allyields, kappas, preds, proc_sigs);
-      tablenames.push_back(fullname);
-    }
+    TaskGraph::TaskId table_task = post_loop.Add([&, imethod](){
+	if(!only_kappa) tablenames[imethod] = printTable(abcds[imethod], allyields_all[imethod],
+							 kappas_all[imethod], preds_all[imethod], proc_sigs);
+      }, {preds_task});
 
     //// Plotting kappa
-    plotKappa(abcds[imethod], kappas);
+    post_loop.Add([&, imethod](){
+	plotKappa(abcds[imethod], kappas_all[imethod]);
+      }, {table_task}, true);
 
   } // Loop over ABCD methods
+  post_loop.Run(single_thread ? 1 : 0);
 
   if(!only_kappa){
     //// Printing names of ouput files
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <tuple>
+#include <algorithm>
 
 #include "TFile.h"
 #include "TIterator.h"
@@ -9,6 +12,8 @@
 
 #include "RooStats/ModelConfig.h"
 
+#include "core/workspace_index.hpp"
+
 using namespace std;
 using namespace RooStats;
 
@@ -59,6 +64,30 @@ int main(int argc, char *argv[]){
     << ' ' << setw(12) << nobs
     << endl;
     }
+
+    WorkspaceIndex ws_index(*w);
+    vector<const WorkspaceIndex::Entry*> entries;
+    for(const auto &entry: ws_index.Entries()) entries.push_back(&entry);
+    sort(entries.begin(), entries.end(),
+         [](const WorkspaceIndex::Entry *a, const WorkspaceIndex::Entry *b){
+           return make_tuple(a->bin_, a->kind_, a->process_) < make_tuple(b->bin_, b->kind_, b->process_);
+         });
+
+    cout << endl << "Indexed functions and variables by bin: " << endl;
+    cout
+      << ' ' << setw(12) << "Kind"
+      << ' ' << setw(32) << "Bin"
+      << ' ' << setw(24) << "Process"
+      << ' ' << setw(12) << "Value"
+      << endl;
+    for(const auto &entry: entries){
+      cout
+        << ' ' << setw(12) << entry->kind_
+        << ' ' << setw(32) << entry->bin_
+        << ' ' << setw(24) << entry->process_
+        << ' ' << setw(12) << entry->arg_->getVal()
+        << endl;
+    }
     
   }
 }
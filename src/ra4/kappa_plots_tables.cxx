@@ -31,6 +31,7 @@
 #include "core/plot_maker.hpp"
 #include "core/palette.hpp"
 #include "core/table.hpp"
+#include "core/task_graph.hpp"
 #include "core/abcd_method.hpp"
 #include "core/styles.hpp"
 #include "core/plot_opt.hpp"
@@ -537,17 +538,23 @@ int main(int argc, char *argv[]){
     NamedFunc correction = do_correction ? corrections.at(mm_scen) : NamedFunc(1.);
     for(size_t icut=0; icut < abcds.back().allcuts.size(); icut++){
       // Changing b-tag working point
-      string totcut = abcds.back().allcuts[icut].Data();
-      //// Adding cuts to table for yield calculation
-      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), totcut,
+      //// Adding cuts to table for yield calculation. Cuts are passed as
+      //// factors so that terms shared among bins are evaluated once per event
+      vector<NamedFunc> factors, factors_mm;
+      for(auto factor: abcds.back().allfactors[icut]){
+        factors.push_back(factor);
+        if (mm_scen=="smeared_met")
+          factor.ReplaceAll("met","adj_met").ReplaceAll("mt","adj_mt").ReplaceAll("adj_met_calo","met_calo");
+        factors_mm.push_back(factor);
+      }
+      table_cuts.push_back(TableRow(abcds.back().allcuts[icut].Data(), abcds.back().allcuts[icut].Data(), factors,
 				    0,0,weights.at("no_mismeasurement")*correction));
       if(only_mc) {
-        TString allcuts_(abcds.back().allcuts[icut]), totcut_(totcut);
+        TString allcuts_(abcds.back().allcuts[icut]);
         if (mm_scen=="smeared_met") {
           allcuts_.ReplaceAll("met","adj_met").ReplaceAll("mt","adj_mt").ReplaceAll("adj_met_calo","met_calo");
-          totcut_.ReplaceAll("met","adj_met").ReplaceAll("mt","adj_mt").ReplaceAll("adj_met_calo","met_calo");
         }
-        table_cuts_mm.push_back(TableRow(allcuts_.Data(), totcut_.Data(),
+        table_cuts_mm.push_back(TableRow(allcuts_.Data(), allcuts_.Data(), factors_mm,
 						   0,0,weights.at(mm_scen)));
       }
     }
@@ -567,12 +574,19 @@ int main(int argc, char *argv[]){
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////////////
   ////////////////////////// Calculating preds/kappas and printing table //////////////////////////////////////
-  vector<TString> tablenames;
+  // Each method's prediction, table and kappa plots run as tasks, with methods in
+  // parallel and kappa plots serialized since they draw with ROOT
+  vector<TString> tablenames(abcds.size());
+  vector<vector<vector<GammaParams> > > allyields_all(abcds.size());
+  vector<vector<vector<vector<float> > > > kappas_all(abcds.size()), kappas_mm_all(abcds.size()),
+    kmcdat_all(abcds.size()), kmcdat2_all(abcds.size()), kmcdat3_all(abcds.size()), preds_all(abcds.size());
+  vector<vector<vector<float> > > yieldsPlane_all(abcds.size());
+  TaskGraph post_loop;
   for(size_t imethod=0; imethod<abcds.size(); imethod++) {
     mm_scen = GetScenario(methods.at(imethod).Data());
     // allyields: [0] data, [1] bkg, [2] T1tttt(NC), [3] T1tttt(C)
     // if split_bkg [2/4] Other, [3/5] tt1l, [4/6] tt2l
-    vector<vector<GammaParams> > allyields;
+    vector<vector<GammaParams> > &allyields = allyields_all[imethod];
     Table * yield_table;
     if(only_mc){
       yield_table = static_cast<Table*>(pm.Figures()[imethod*2].get());
@@ -594,26 +608,37 @@ int main(int argc, char *argv[]){
     }
 
     //// Calculating kappa and Total bkg prediction
-    vector<vector<vector<float> > > kappas, kappas_mm, kmcdat, kmcdat2, kmcdat3, preds;
-    vector<vector<float> > yieldsPlane = findPreds(abcds[imethod], allyields, kappas, kappas_mm, kmcdat, kmcdat2, kmcdat3, preds);
+    TaskGraph::TaskId preds_task = post_loop.Add([&, imethod](){
+	yieldsPlane_all[imethod] = findPreds(abcds[imethod], allyields_all[imethod], kappas_all[imethod],
+					     kappas_mm_all[imethod], kmcdat_all[imethod], kmcdat2_all[imethod],
+					     kmcdat3_all[imethod], preds_all[imethod]);
 
-    //// Print MC/Data yields, cuts applied, kappas, preds
-    if(debug) printDebug(abcds[imethod], allyields, TString(baseline.Name()), kappas, kappas_mm, preds);
+	//// Print MC/Data yields, cuts applied, kappas, preds
+	if(debug) printDebug(abcds[imethod], allyields_all[imethod], TString(baseline.Name()),
+			     kappas_all[imethod], kappas_mm_all[imethod], preds_all[imethod]);
+      });
 
     //// Makes table MC/Data yields, kappas, preds, Zbi
-    if(!only_kappa) {
-      TString fullname = printTable(abcds[imethod], allyields, kappas, preds, yieldsPlane);
-      tablenames.push_back(fullname);
-    }
-
-    //// Plotting kappa comparison between MC and data
-    if (data_kappas) 
-      plotKappaMCData(abcds[imethod], kappas, kappas_mm, kmcdat, kmcdat2, kmcdat3);
-
-    if (mc_kappas) 
-      plotKappa(abcds[imethod], kappas);
+    TaskGraph::TaskId table_task = post_loop.Add([&, imethod](){
+	if(!only_kappa) tablenames[imethod] = printTable(abcds[imethod], allyields_all[imethod], kappas_all[imethod],
+							 preds_all[imethod], yieldsPlane_all[imethod]);
+      }, {preds_task});
+
+    //// Plotting kappa comparison between MC and data. The plots read mm_scen,
+    //// which is safe to set here since plotting tasks hold the ROOT lock.
+    post_loop.Add([&, imethod](){
+	mm_scen = GetScenario(methods.at(imethod).Data());
+	if (data_kappas) 
+	  plotKappaMCData(abcds[imethod], kappas_all[imethod], kappas_mm_all[imethod],
+			  kmcdat_all[imethod], kmcdat2_all[imethod], kmcdat3_all[imethod]);
+
+	if (mc_kappas) 
+	  plotKappa(abcds[imethod], kappas_all[imethod]);
+      }, {table_task}, true);
 
   } // Loop over ABCD methods
+  post_loop.Run(single_thread ? 1 : 0);
+  if(!abcds.empty()) mm_scen = GetScenario(methods.at(abcds.size()-1).Data());
 
   if(!only_kappa){
     //// Printing names of ouput files
@@ -12,6 +12,7 @@
 #include "core/process.hpp"
 #include "core/named_func.hpp"
 #include "core/plot_maker.hpp"
+#include "core/plot_session.hpp"
 #include "core/plot_opt.hpp"
 #include "core/palette.hpp"
 #include "core/hist1d.hpp"
@@ -139,7 +140,6 @@ int main() {
   pm16.Push<Hist1D>(Axis(25,-2.5,2.5, "els_sceta", "electron #eta",{}), "nels==1&&" +baseline, data16_mc16, log_stack).Weight("weight*w_prefire").Tag(tag);
   pm16.Push<Hist1D>(Axis(25,-2.5,2.5, "mus_eta",   "muon #eta",    {}), "nmus==1&&" +baseline, data16_mc16, log_stack).Weight("weight*w_prefire").Tag(tag);
   pm16.min_print_=true;
-	pm16.MakePlots(35.9);
 
   PlotMaker pm17;
 	// Without w_prefire
@@ -155,7 +155,11 @@ int main() {
   pm17.Push<Hist1D>(Axis(25,-2.5,2.5, "els_sceta", "electron #eta", {}), "nels==1&&" +baseline, data17_mc17, log_stack).Weight("weight*w_prefire").Tag(tag);
   pm17.Push<Hist1D>(Axis(25,-2.5,2.5, "mus_eta",   "muon #eta",     {}), "nmus==1&&" +baseline, data17_mc17, log_stack).Weight("weight*w_prefire").Tag(tag);
   pm17.min_print_=true;
-	pm17.MakePlots(41.5);
+
+  PlotSession session;
+  session.min_print_=true;
+  session.Add(pm16, 35.9).Add(pm17, 41.5);
+  session.Run();
 
 }
 